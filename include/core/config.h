@@ -62,6 +62,9 @@ typedef struct {
     uint64_t max_storage_size; // in bytes
     int retention_days;
     bool auto_delete_oldest;
+    char storage_path_cold[MAX_PATH_LENGTH]; // Slow tier for aged recordings, empty disables tiering
+    int tier_after_hours;            // Move recordings to the cold tier after this many hours
+    int tier_max_rate_mb;            // Cold tier copy throttle in MB/s (0 for unlimited)
 
     // New recording format options
     bool record_mp4_directly;        // Record directly to MP4 alongside HLS
@@ -74,6 +77,8 @@ typedef struct {
 
     // Database settings
     char db_path[MAX_PATH_LENGTH];
+    char db_memory_path[MAX_PATH_LENGTH]; // Live database on tmpfs with db_path holding snapshots, empty disables
+    int db_snapshot_interval;        // Seconds between snapshots, the most database changes a crash can lose
     
     // Web server settings
     int web_port;
@@ -81,6 +86,8 @@ typedef struct {
     bool web_auth_enabled;
     char web_username[32];
     char web_password[32]; // Stored as hash in actual implementation
+    int web_event_loops;             // Event loops serving HTTP, each with its own SO_REUSEPORT listener
+    char web_asset_pack[MAX_PATH_LENGTH]; // Packed web UI served from memory, empty means <web_root>.pack
     
     // Web optimization settings
     bool web_compression_enabled;    // Whether to enable gzip compression for text-based responses
@@ -0,0 +1,93 @@
+/**
+ * @file log_ring.h
+ * @brief In-memory ring of recent log entries
+ */
+
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "core/logger.h"
+
+/**
+ * @brief Log entries kept in memory
+ */
+#define LOG_RING_CAPACITY 1024
+
+/**
+ * @brief Longest message kept per entry, longer ones are truncated
+ */
+#define LOG_RING_MESSAGE_SIZE 512
+
+/**
+ * @brief Log entry copied out of the ring
+ */
+typedef struct {
+    uint64_t seq;               // Monotonic, starts at 1
+    log_level_t level;
+    char timestamp[20];         // ISO 8601 local time, YYYY-MM-DDTHH:MM:SS
+    char message[LOG_RING_MESSAGE_SIZE];
+} log_ring_entry_t;
+
+/**
+ * @brief Append a log entry, overwriting the oldest when the ring is full
+ *
+ * Called by the logger for every message it writes. Safe to call from any
+ * thread; never logs itself.
+ *
+ * @param level Log level
+ * @param timestamp ISO timestamp
+ * @param message Log message
+ * @return uint64_t Sequence number of the entry
+ */
+uint64_t log_ring_append(log_level_t level, const char *timestamp, const char *message);
+
+/**
+ * @brief Read entries at or above a level
+ *
+ * With since set, returns the entries after it, oldest first. With since 0,
+ * or a sequence number from before a restart, returns the newest entries.
+ *
+ * @param since Last sequence number the reader saw, 0 for none
+ * @param min_level Least severe level to include
+ * @param entries Array to copy the entries into
+ * @param max_entries Size of the array
+ * @param last_seq Where to store the sequence number to resume from
+ * @param more Where to store whether entries were left out, may be NULL
+ * @return int Number of entries copied
+ */
+int log_ring_read(uint64_t since, log_level_t min_level, log_ring_entry_t *entries,
+                  int max_entries, uint64_t *last_seq, bool *more);
+
+/**
+ * @brief Get the sequence number of the newest entry
+ *
+ * @return uint64_t Sequence number, 0 if nothing was logged yet
+ */
+uint64_t log_ring_last_seq(void);
+
+/**
+ * @brief Drop every entry, keeping the sequence numbers monotonic
+ */
+void log_ring_clear(void);
+
+/**
+ * @brief Parse a level name as used by the logs API
+ *
+ * @param name "error", "warning" (or "warn"), "info" or "debug"
+ * @param fallback Level returned for NULL or unknown names
+ * @return log_level_t Parsed level
+ */
+log_level_t log_ring_parse_level(const char *name, log_level_t fallback);
+
+/**
+ * @brief Get the name of a level as used by the logs API
+ *
+ * @param level Log level
+ * @return const char* "error", "warning", "info" or "debug"
+ */
+const char *log_ring_level_name(log_level_t level);
+
+#endif /* LOG_RING_H */
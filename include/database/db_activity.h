@@ -0,0 +1,66 @@
+#ifndef LIGHTNVR_DB_ACTIVITY_H
+#define LIGHTNVR_DB_ACTIVITY_H
+
+#include <stdint.h>
+#include <time.h>
+#include <sqlite3.h>
+
+// Bucket sizes of the activity rollup tables, in seconds
+#define ACTIVITY_BUCKET_MINUTE 60
+#define ACTIVITY_BUCKET_HOUR 3600
+
+// Detection activity of one stream and label in one bucket
+typedef struct {
+    time_t bucket;              // Start of the bucket
+    char stream_name[64];
+    char label[32];
+    int count;                  // Number of detections in the bucket
+    float max_confidence;       // Highest confidence in the bucket
+} detection_activity_t;
+
+/**
+ * Add one frame of detections to the minute and hour activity rollups
+ *
+ * Counts and max confidence are accumulated per stream, label and bucket.
+ * The caller must hold the database mutex.
+ *
+ * @param db Writer connection
+ * @param stream_id Stream dictionary id
+ * @param timestamp Timestamp of the frame
+ * @param label_ids Label dictionary id of each detection
+ * @param confidences Quantized confidence of each detection (0-65535)
+ * @param count Number of detections
+ * @return 0 on success, non-zero on failure
+ */
+int record_detection_activity_locked(sqlite3 *db, int stream_id, time_t timestamp,
+                                     const int *label_ids, const uint16_t *confidences, int count);
+
+/**
+ * Get detection activity per bucket
+ *
+ * Reads the minute or hour rollup table, so the cost depends on the number
+ * of buckets in the range rather than the number of detections.
+ *
+ * @param stream_name Stream name filter (NULL for all streams)
+ * @param start_time Start of the range
+ * @param end_time End of the range
+ * @param bucket_seconds ACTIVITY_BUCKET_MINUTE or ACTIVITY_BUCKET_HOUR
+ * @param activity Array to fill, ordered by bucket
+ * @param max_count Maximum number of entries to return
+ * @return Number of entries found, or -1 on error
+ */
+int get_detection_activity(const char *stream_name, time_t start_time, time_t end_time,
+                           int bucket_seconds, detection_activity_t *activity, int max_count);
+
+/**
+ * Delete minute activity buckets older than a cutoff
+ *
+ * Hour buckets are small and kept. The caller must hold the database mutex.
+ *
+ * @param db Writer connection
+ * @param cutoff_time Buckets starting before this time are deleted
+ * @return Number of buckets deleted, or -1 on error
+ */
+int delete_old_detection_activity_locked(sqlite3 *db, time_t cutoff_time);
+
+#endif // LIGHTNVR_DB_ACTIVITY_H
@@ -140,6 +140,10 @@ int db_auth_generate_api_key(int64_t user_id, char *api_key, size_t api_key_size
 /**
  * @brief Authenticate a user with username and password
  * 
+ * Verified credentials are cached in memory for a few minutes, so repeated
+ * requests skip the PBKDF2 hash (and the last login update). Changing the
+ * password, updating or deleting the user drops them from the cache.
+ * 
  * @param username Username
  * @param password Password
  * @param user_id Pointer to store the user ID (optional, can be NULL)
@@ -164,6 +168,10 @@ int db_auth_create_session(int64_t user_id, const char *ip_address, const char *
 /**
  * @brief Validate a session token
  * 
+ * Valid sessions are cached in memory for up to a minute. Deleting the
+ * session, the user's sessions, or updating the user drops them from the
+ * cache.
+ * 
  * @param token Session token
  * @param user_id Pointer to store the user ID (optional, can be NULL)
  * @return 0 on success, non-zero on failure
@@ -209,4 +217,11 @@ const char *db_auth_get_role_name(user_role_t role);
  */
 int db_auth_get_role_id(const char *role_name);
 
+/**
+ * @brief Drop all cached sessions and credentials
+ * 
+ * Used when the database is replaced.
+ */
+void db_auth_cache_clear(void);
+
 #endif /* LIGHTNVR_DB_AUTH_H */
@@ -1,15 +1,99 @@
 #ifndef LIGHTNVR_DB_BACKUP_H
 #define LIGHTNVR_DB_BACKUP_H
 
+#include <stdbool.h>
+#include <time.h>
+
+// Pages copied per backup step
+#define DB_BACKUP_STEP_PAGES 256
+
+// Pause between steps of a background backup, in milliseconds
+#define DB_BACKUP_STEP_SLEEP_MS 20
+
+// Restarts caused by writes before the rest is copied in one step
+#define DB_BACKUP_MAX_RESTARTS 10
+
+// Minimum interval between progress reports, in milliseconds
+#define DB_BACKUP_PROGRESS_INTERVAL_MS 500
+
+// Progress of the current or last backup
+typedef struct {
+    bool in_progress;
+    int pages_total;                // Pages in the source database
+    int pages_remaining;            // Pages still to copy
+    int restarts;                   // Times the copy restarted because the source changed
+    int result;                     // 0 on success, -1 on failure (once finished)
+    time_t started_at;
+    time_t finished_at;
+    char dest_path[256];
+} db_backup_progress_t;
+
+/**
+ * Function called as a backup makes progress and once when it finishes
+ * 
+ * Called from the thread running the backup.
+ */
+typedef void (*db_backup_progress_cb)(const db_backup_progress_t *progress, void *user_data);
+
 /**
  * Backup the database to a specified path
  * 
+ * Copies DB_BACKUP_STEP_PAGES pages per step into a temporary file that
+ * replaces dest_path once complete. Blocks until the backup is done.
+ * 
  * @param source_path Path to the source database file
  * @param dest_path Path to the destination backup file
  * @return 0 on success, non-zero on failure
  */
 int backup_database(const char *source_path, const char *dest_path);
 
+/**
+ * Copy the database without claiming the backup slot
+ * 
+ * Like backup_database, but runs alongside a user backup instead of
+ * failing, and reports no progress. Used for tmpfs snapshots, which
+ * must not be skipped while a backup runs. The destination must differ
+ * from that of any concurrent backup.
+ * 
+ * @param source_path Path to the source database file
+ * @param dest_path Path to the destination file
+ * @return 0 on success, non-zero on failure
+ */
+int snapshot_database(const char *source_path, const char *dest_path);
+
+/**
+ * Start a backup of the database on a background thread
+ * 
+ * Like backup_database, but sleeps DB_BACKUP_STEP_SLEEP_MS between steps so
+ * recording and web requests keep access to the database. Progress is
+ * reported to the callback set with set_backup_progress_callback.
+ * 
+ * @param source_path Path to the source database file
+ * @param dest_path Path to the destination backup file
+ * @return 0 if started, 1 if a backup is already running, -1 on error
+ */
+int backup_database_async(const char *source_path, const char *dest_path);
+
+/**
+ * Cancel a background backup and wait for its thread to exit
+ */
+void stop_backup_thread(void);
+
+/**
+ * Get the progress of the current or last backup
+ * 
+ * @param progress Structure to fill
+ */
+void get_backup_progress(db_backup_progress_t *progress);
+
+/**
+ * Set the function called as backups make progress
+ * 
+ * @param callback Function to call, or NULL to remove
+ * @param user_data Passed to the callback
+ */
+void set_backup_progress_callback(db_backup_progress_cb callback, void *user_data);
+
 /**
  * Restore database from backup
  * 
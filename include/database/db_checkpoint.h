@@ -0,0 +1,59 @@
+#ifndef LIGHTNVR_DB_CHECKPOINT_H
+#define LIGHTNVR_DB_CHECKPOINT_H
+
+#include <stdint.h>
+#include <time.h>
+
+// Run a PASSIVE checkpoint at least this often, in milliseconds
+#define DB_CHECKPOINT_INTERVAL_MS 5000
+
+// Wake the checkpoint thread early once a commit leaves this many pages in the WAL
+#define DB_CHECKPOINT_WAKE_PAGES 1000
+
+// Truncate the WAL once it grows past this size and no readers are active
+#define DB_CHECKPOINT_TRUNCATE_BYTES (16 * 1024 * 1024)
+
+// How long a TRUNCATE checkpoint may wait for the writer, in milliseconds
+#define DB_CHECKPOINT_BUSY_TIMEOUT_MS 100
+
+// WAL checkpoint metrics
+typedef struct {
+    uint64_t wal_bytes;             // Current size of the WAL file
+    int wal_frames;                 // Frames in the WAL after the last checkpoint
+    int checkpointed_frames;        // Frames copied to the database by the last checkpoint
+    uint64_t passive_count;         // PASSIVE checkpoints run
+    uint64_t truncate_count;        // TRUNCATE checkpoints run
+    uint64_t busy_count;            // Checkpoints that could not complete
+    double last_duration_ms;        // Duration of the last checkpoint
+    double max_duration_ms;         // Longest checkpoint so far
+    time_t last_checkpoint;         // Time of the last checkpoint
+} db_checkpoint_stats_t;
+
+/**
+ * Start the WAL checkpoint thread
+ *
+ * SQLite's automatic checkpoint runs inside whichever commit crosses the
+ * threshold, stalling that writer. This replaces it with a thread that runs
+ * PASSIVE checkpoints on its own connection every DB_CHECKPOINT_INTERVAL_MS
+ * (or sooner when the WAL reaches DB_CHECKPOINT_WAKE_PAGES), and truncates
+ * the WAL once it is larger than DB_CHECKPOINT_TRUNCATE_BYTES and no pooled
+ * readers are active. Only useful in WAL mode.
+ *
+ * @param db_path Path to the database file
+ * @return 0 on success, non-zero on failure
+ */
+int start_db_checkpoint(const char *db_path);
+
+/**
+ * Stop the WAL checkpoint thread and restore automatic checkpoints
+ */
+void stop_db_checkpoint(void);
+
+/**
+ * Get WAL checkpoint metrics
+ *
+ * @param stats Structure to fill
+ */
+void db_checkpoint_get_stats(db_checkpoint_stats_t *stats);
+
+#endif // LIGHTNVR_DB_CHECKPOINT_H
@@ -9,6 +9,9 @@
 #include "database/db_maintenance.h"
 #include "database/db_backup.h"
 
+// Number of read-only connections kept open for query paths
+#define DB_READER_POOL_SIZE 4
+
 /**
  * Initialize the database
  * 
@@ -36,4 +39,41 @@ sqlite3 *get_db_handle(void);
  */
 pthread_mutex_t *get_db_mutex(void);
 
+/**
+ * Get the path of the live database
+ * 
+ * With the database kept on tmpfs this is the memory path, while db_path
+ * only holds the last snapshot.
+ * 
+ * @return Path of the open database, empty if the database is not open
+ */
+const char *get_db_live_path(void);
+
+/**
+ * Check out a connection for read-only queries
+ * 
+ * In WAL mode this returns one of the pooled read-only connections, so
+ * readers never wait on the writer or on each other (only on a free
+ * connection when all are busy). Without a pool the writer connection is
+ * returned with the database mutex held. Either way the connection must
+ * be handed back with db_release_reader() and must not be used for writes.
+ * 
+ * @return SQLite database handle, or NULL if the database is not open
+ */
+sqlite3 *db_acquire_reader(void);
+
+/**
+ * Return a connection obtained from db_acquire_reader
+ * 
+ * @param reader Connection to return
+ */
+void db_release_reader(sqlite3 *reader);
+
+/**
+ * Count pooled read-only connections that are checked out
+ * 
+ * @return Number of readers currently in use
+ */
+int db_active_readers(void);
+
 #endif // LIGHTNVR_DB_CORE_H
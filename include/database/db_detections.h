@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <sqlite3.h>
 #include "video/detection_result.h"
 
 /**
@@ -15,6 +16,71 @@
  */
 int store_detections_in_db(const char *stream_name, const detection_result_t *result, time_t timestamp);
 
+/**
+ * Insert detection results using the writer connection
+ * 
+ * The caller must hold the database mutex and owns the transaction.
+ * Used by store_detections_in_db and the write-behind queue.
+ * 
+ * @param db Writer connection
+ * @param stream_name Stream name
+ * @param result Detection results
+ * @param timestamp Timestamp of the detection
+ * @return 0 on success, non-zero on failure
+ */
+int insert_detections_locked(sqlite3 *db, const char *stream_name, 
+                            const detection_result_t *result, time_t timestamp);
+
+/**
+ * Insert one frame of detections using the writer connection
+ * 
+ * The frame is stored as a single row: stream and labels as dictionary ids,
+ * confidences and boxes quantized to 16 bits and packed into a blob. The
+ * minute and hour activity rollups are updated in the same call.
+ * The caller must hold the database mutex.
+ * 
+ * @param db Writer connection
+ * @param stream_name Stream name
+ * @param timestamp Timestamp of the frame
+ * @param recording_id Recording covering the frame (0 for none)
+ * @param detections Detections in the frame
+ * @param count Number of detections (at most MAX_DETECTIONS are stored)
+ * @return 0 on success, non-zero on failure
+ */
+int insert_detection_frame_locked(sqlite3 *db, const char *stream_name, time_t timestamp,
+                                  uint64_t recording_id, const detection_t *detections, int count);
+
+/**
+ * Link stored detections to a recording and refresh its detection aggregates
+ * 
+ * Tags frames of the recording's stream and time span that were stored
+ * without a recording, then recomputes detection_count, max_confidence and
+ * detection_labels on the recording. The caller must hold the database mutex.
+ * 
+ * @param db Writer connection
+ * @param recording_id Recording ID
+ * @return 0 on success, non-zero on failure
+ */
+int refresh_recording_detections_locked(sqlite3 *db, uint64_t recording_id);
+
+/**
+ * Rebuild the detection activity rollups from the stored detection frames
+ * 
+ * The caller must hold the database mutex and owns the transaction.
+ * 
+ * @param db Writer connection
+ * @return 0 on success, non-zero on failure
+ */
+int rebuild_detection_activity_locked(sqlite3 *db);
+
+/**
+ * Forget cached label and stream dictionary ids
+ * 
+ * Must be called when a transaction that may have added dictionary entries
+ * is rolled back, or the database is replaced.
+ */
+void reset_detection_dictionaries(void);
+
 /**
  * Get detection results from the database with time range filtering
  * 
@@ -55,8 +121,11 @@ int get_detections_from_db(const char *stream_name, detection_result_t *result,
 /**
  * Delete old detections from the database
  * 
+ * Recordings that lost frames get their detection aggregates recomputed
+ * from the frames that are left.
+ * 
  * @param max_age Maximum age in seconds
- * @return Number of detections deleted, or -1 on error
+ * @return Number of detection frames deleted, or -1 on error
  */
 int delete_old_detections(uint64_t max_age);
 
@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <time.h>
+#include <sqlite3.h>
 
 // Event types
 typedef enum {
@@ -43,6 +44,40 @@ typedef struct {
 uint64_t add_event(event_type_t type, const char *stream_name, 
                   const char *description, const char *details);
 
+/**
+ * Queue an event to be added to the database
+ * 
+ * Unlike add_event this does not wait for the insert: the event is committed
+ * with the next write-behind batch, or written directly if the queue is not
+ * running.
+ * 
+ * @param type Event type
+ * @param stream_name Stream name (can be NULL for system events)
+ * @param description Short description of the event
+ * @param details Detailed information about the event (can be NULL)
+ * @return 0 on success, non-zero on failure
+ */
+int queue_event(event_type_t type, const char *stream_name, 
+               const char *description, const char *details);
+
+/**
+ * Insert an event using the writer connection
+ * 
+ * The caller must hold the database mutex. Used by add_event and the
+ * write-behind queue.
+ * 
+ * @param db Writer connection
+ * @param type Event type
+ * @param timestamp Time the event occurred
+ * @param stream_name Stream name (can be NULL)
+ * @param description Short description of the event
+ * @param details Detailed information about the event (can be NULL)
+ * @return Event ID on success, 0 on failure
+ */
+uint64_t insert_event_locked(sqlite3 *db, event_type_t type, time_t timestamp, 
+                            const char *stream_name, const char *description, 
+                            const char *details);
+
 /**
  * Get events from the database
  * 
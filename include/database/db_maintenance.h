@@ -2,6 +2,19 @@
 #define LIGHTNVR_DB_MAINTENANCE_H
 
 #include <stdint.h>
+#include <time.h>
+
+// Rows deleted per transaction when purging old rows
+#define DB_PURGE_CHUNK_ROWS 5000
+
+// Pause between purge chunks and vacuum steps so other writers get the database
+#define DB_MAINTENANCE_YIELD_MS 50
+
+// Free pages returned to the file system per incremental vacuum step
+#define DB_VACUUM_STEP_PAGES 256
+
+// Seconds between background maintenance passes
+#define DB_MAINTENANCE_INTERVAL 600
 
 /**
  * Get the database size
@@ -35,4 +48,45 @@ int check_database_integrity(void);
  */
 int database_execute_query(const char *sql, void **result, int *rows, int *cols);
 
+/**
+ * Delete rows older than a cutoff in bounded chunks
+ * 
+ * Deletes at most DB_PURGE_CHUNK_ROWS rows per transaction, oldest first,
+ * and releases the database mutex for DB_MAINTENANCE_YIELD_MS between
+ * chunks so recordings and web requests are not blocked for long.
+ * 
+ * @param table Table to purge (must have a rowid and an index on time_column)
+ * @param time_column Column holding the row time
+ * @param cutoff_time Rows with an older time are deleted
+ * @return Number of rows deleted, or -1 on error
+ */
+int db_purge_older_than(const char *table, const char *time_column, time_t cutoff_time);
+
+/**
+ * Return free pages to the file system
+ * 
+ * Runs PRAGMA incremental_vacuum in steps of DB_VACUUM_STEP_PAGES with a
+ * pause between steps. Does nothing unless the database file uses
+ * incremental auto_vacuum.
+ * 
+ * @param max_pages Maximum number of pages to release
+ * @return Number of pages released, or -1 on error
+ */
+int db_incremental_vacuum(int max_pages);
+
+/**
+ * Start the background maintenance thread
+ * 
+ * Every DB_MAINTENANCE_INTERVAL seconds it purges detections and events
+ * older than the configured retention and releases free pages.
+ * 
+ * @return 0 on success, non-zero on failure
+ */
+int start_db_maintenance(void);
+
+/**
+ * Stop the background maintenance thread
+ */
+void stop_db_maintenance(void);
+
 #endif // LIGHTNVR_DB_MAINTENANCE_H
@@ -0,0 +1,126 @@
+#ifndef LIGHTNVR_DB_RECORDING_INDEX_H
+#define LIGHTNVR_DB_RECORDING_INDEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Initial number of entries allocated for a stream
+#define RECORDING_INDEX_INITIAL_CAPACITY 256
+
+// Complete recording as held in the index
+typedef struct {
+    uint64_t id;
+    time_t start_time;
+    time_t end_time;
+    uint64_t size_bytes;
+    char file_path[256];
+} recording_index_entry_t;
+
+// Stretch of time with no recording
+typedef struct {
+    time_t start_time;
+    time_t end_time;
+} recording_gap_t;
+
+/**
+ * Load the recording index from the recordings table
+ *
+ * Holds every complete recording, per stream, sorted by start time, so
+ * timeline lookups are binary searches instead of queries. Must be called
+ * once the schema is up to date; replaces any previously loaded index.
+ *
+ * @return Number of recordings loaded, or -1 on error
+ */
+int recording_index_load(void);
+
+/**
+ * Drop the recording index
+ *
+ * Lookups fail with -1 until the index is loaded again.
+ */
+void recording_index_clear(void);
+
+/**
+ * Check whether the recording index is loaded
+ *
+ * @return true if lookups can be answered from the index
+ */
+bool recording_index_loaded(void);
+
+/**
+ * Add or update a complete recording
+ *
+ * Called with the database mutex held, after the row was written.
+ *
+ * @param stream_name Stream the recording belongs to
+ * @param id Recording ID
+ * @param start_time Start of the recording
+ * @param end_time End of the recording
+ * @param size_bytes Size of the recording file
+ * @param file_path Path of the recording file
+ */
+void recording_index_put(const char *stream_name, uint64_t id, time_t start_time,
+                         time_t end_time, uint64_t size_bytes, const char *file_path);
+
+/**
+ * Remove a recording
+ *
+ * Called with the database mutex held. Recordings that are not in the
+ * index are ignored.
+ *
+ * @param stream_name Stream the recording belongs to
+ * @param id Recording ID
+ * @param start_time Start of the recording
+ */
+void recording_index_remove(const char *stream_name, uint64_t id, time_t start_time);
+
+/**
+ * Remove all recordings that ended before a cutoff
+ *
+ * @param cutoff_time Recordings with an end time before this are removed
+ * @return Number of recordings removed
+ */
+int recording_index_remove_ended_before(time_t cutoff_time);
+
+/**
+ * Get the recordings of a stream that overlap a time range
+ *
+ * @param stream_name Stream to look up
+ * @param start_time Start of the range, 0 for no lower bound
+ * @param end_time End of the range, 0 for no upper bound
+ * @param entries Array to fill, ordered by start time
+ * @param max_count Size of the array
+ * @return Number of recordings found, or -1 if the index is not loaded
+ */
+int recording_index_find_range(const char *stream_name, time_t start_time, time_t end_time,
+                               recording_index_entry_t *entries, int max_count);
+
+/**
+ * Find the recording of a stream that covers a point in time
+ *
+ * When several recordings cover the time, the one that started last wins.
+ *
+ * @param stream_name Stream to look up
+ * @param timestamp Point in time
+ * @param entry Filled with the recording
+ * @return 0 if found, 1 if no recording covers the time, -1 if the index is not loaded
+ */
+int recording_index_find_covering(const char *stream_name, time_t timestamp,
+                                  recording_index_entry_t *entry);
+
+/**
+ * Find the stretches of a time range that no recording of a stream covers
+ *
+ * @param stream_name Stream to look up
+ * @param start_time Start of the range
+ * @param end_time End of the range
+ * @param min_gap Shortest gap to report, in seconds
+ * @param gaps Array to fill, ordered by start time
+ * @param max_count Size of the array
+ * @return Number of gaps found, or -1 if the index is not loaded
+ */
+int recording_index_find_gaps(const char *stream_name, time_t start_time, time_t end_time,
+                              int min_gap, recording_gap_t *gaps, int max_count);
+
+#endif // LIGHTNVR_DB_RECORDING_INDEX_H
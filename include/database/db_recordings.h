@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
+#include <sqlite3.h>
 
 // Recording metadata structure
 typedef struct {
@@ -18,8 +19,17 @@ typedef struct {
     int fps;
     char codec[16];
     bool is_complete;
+    int detection_count;        // Detections linked to this recording
+    float max_confidence;       // Highest detection confidence in this recording
+    char detection_labels[128]; // Comma-separated distinct labels detected
 } recording_metadata_t;
 
+// Position in a recording list ordered by (start_time, id)
+typedef struct {
+    time_t start_time;
+    uint64_t id;                // 0 for the start of the list
+} recording_cursor_t;
+
 /**
  * Add recording metadata to the database
  * 
@@ -31,6 +41,10 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata);
 /**
  * Update recording metadata in the database
  * 
+ * Progress updates (is_complete false) are queued and committed in batches
+ * by the write-behind queue when it is running; completing a recording is
+ * written immediately.
+ * 
  * @param id Recording ID
  * @param end_time New end time
  * @param size_bytes New size in bytes
@@ -40,6 +54,22 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata);
 int update_recording_metadata(uint64_t id, time_t end_time, 
                              uint64_t size_bytes, bool is_complete);
 
+/**
+ * Update recording metadata using the writer connection
+ * 
+ * The caller must hold the database mutex. Used by update_recording_metadata
+ * and the write-behind queue.
+ * 
+ * @param db Writer connection
+ * @param id Recording ID
+ * @param end_time New end time
+ * @param size_bytes New size in bytes
+ * @param is_complete Whether the recording is complete
+ * @return 0 on success, non-zero on failure
+ */
+int update_recording_metadata_locked(sqlite3 *db, uint64_t id, time_t end_time, 
+                                    uint64_t size_bytes, bool is_complete);
+
 /**
  * Get recording metadata from the database
  * 
@@ -57,6 +87,10 @@ int get_recording_metadata(time_t start_time, time_t end_time,
 /**
  * Get total count of recordings matching filter criteria
  * 
+ * Counts are cached per filter combination and adjusted as recordings are
+ * completed and deleted, so repeated calls for the same filters do not
+ * rescan the table. A cached count is recomputed after a few minutes.
+ * 
  * @param start_time Start time filter (0 for no filter)
  * @param end_time End time filter (0 for no filter)
  * @param stream_name Stream name filter (NULL for all streams)
@@ -79,6 +113,10 @@ int get_recording_count(time_t start_time, time_t end_time,
  * @param limit Maximum number of recordings to return
  * @param offset Number of recordings to skip (for pagination)
  * @return Number of recordings found, or -1 on error
+ * 
+ * When sorting by start time, the last row of each page served is remembered
+ * so that the following page is found by seeking on (start_time, id) instead
+ * of skipping offset rows.
  */
 int get_recording_metadata_paginated(time_t start_time, time_t end_time, 
                                    const char *stream_name, int has_detection,
@@ -86,6 +124,78 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
                                    recording_metadata_t *metadata, 
                                    int limit, int offset);
 
+/**
+ * Get the page of recordings that follows a cursor, ordered by start time
+ * 
+ * Seeks directly to the cursor on (start_time, id), so every page costs the
+ * same regardless of how deep into the list it is.
+ * 
+ * @param start_time Start time filter (0 for no filter)
+ * @param end_time End time filter (0 for no filter)
+ * @param stream_name Stream name filter (NULL for all streams)
+ * @param has_detection Filter for recordings with detection events (0 for all)
+ * @param ascending true for oldest first, false for newest first
+ * @param after Last recording of the previous page (NULL for the first page)
+ * @param metadata Array to fill with recording metadata
+ * @param limit Maximum number of recordings to return
+ * @param offset Number of recordings to skip, only used without a cursor
+ * @return Number of recordings found, or -1 on error
+ */
+int get_recording_metadata_after(time_t start_time, time_t end_time,
+                                 const char *stream_name, int has_detection,
+                                 bool ascending, const recording_cursor_t *after,
+                                 recording_metadata_t *metadata, int limit, int offset);
+
+/**
+ * Find where a page of recordings sorted by start time starts
+ * 
+ * Looks up the last recording of the page before, remembered when that page
+ * was served with the same filters, order and page size.
+ * 
+ * @param start_time Start time filter (0 for no filter)
+ * @param end_time End time filter (0 for no filter)
+ * @param stream_name Stream name filter (NULL for all streams)
+ * @param has_detection Filter for recordings with detection events (0 for all)
+ * @param ascending true for oldest first, false for newest first
+ * @param limit Page size
+ * @param offset Offset of the page
+ * @param anchor Set to the last recording of the page before, if known
+ * @param generation Set to the list version to pass to set_recording_page_anchor (may be NULL)
+ * @return true if the anchor is known
+ */
+bool get_recording_page_anchor(time_t start_time, time_t end_time,
+                               const char *stream_name, int has_detection,
+                               bool ascending, int limit, int offset,
+                               recording_cursor_t *anchor, uint64_t *generation);
+
+/**
+ * Remember the last recording of a full page sorted by start time
+ * 
+ * The page that follows is then found by seeking on it. Ignored if the
+ * listed recordings changed since generation was read.
+ * 
+ * @param start_time Start time filter (0 for no filter)
+ * @param end_time End time filter (0 for no filter)
+ * @param stream_name Stream name filter (NULL for all streams)
+ * @param has_detection Filter for recordings with detection events (0 for all)
+ * @param ascending true for oldest first, false for newest first
+ * @param limit Page size
+ * @param offset Offset of the page
+ * @param last Last recording of the page
+ * @param generation List version from get_recording_page_anchor before the page was read
+ */
+void set_recording_page_anchor(time_t start_time, time_t end_time,
+                               const char *stream_name, int has_detection,
+                               bool ascending, int limit, int offset,
+                               const recording_cursor_t *last, uint64_t generation);
+
+/**
+ * Drop all cached recording counts and page anchors
+ * 
+ * Needed after the recordings table is changed in bulk.
+ */
+void invalidate_recording_list_cache(void);
+
 /**
  * Get recording metadata by ID
  * 
@@ -111,4 +221,34 @@ int delete_recording_metadata(uint64_t id);
  */
 int delete_old_recording_metadata(uint64_t max_age);
 
+/**
+ * Get complete recordings that are candidates for moving to another storage tier
+ * 
+ * Only recordings whose file path starts with path_prefix and whose end time
+ * is older than older_than are returned, in ID order starting after after_id
+ * so that a caller can sweep past recordings it could not move.
+ * 
+ * @param older_than Only return recordings that ended before this time
+ * @param path_prefix File path prefix identifying the source tier
+ * @param after_id Only return recordings with an ID greater than this
+ * @param metadata Array to fill with recording metadata
+ * @param max_count Maximum number of recordings to return
+ * @return Number of recordings found, or -1 on error
+ */
+int get_recordings_for_tiering(time_t older_than, const char *path_prefix, uint64_t after_id,
+                              recording_metadata_t *metadata, int max_count);
+
+/**
+ * Atomically change the file path of a recording
+ * 
+ * The update only succeeds if the recording still points at old_path, so a
+ * recording that was deleted or moved concurrently is left untouched.
+ * 
+ * @param id Recording ID
+ * @param old_path Path the recording is expected to have
+ * @param new_path New path for the recording
+ * @return 0 on success, 1 if the recording no longer matches, -1 on error
+ */
+int update_recording_file_path(uint64_t id, const char *old_path, const char *new_path);
+
 #endif // LIGHTNVR_DB_RECORDINGS_H
@@ -0,0 +1,43 @@
+#ifndef LIGHTNVR_DB_SNAPSHOT_H
+#define LIGHTNVR_DB_SNAPSHOT_H
+
+// Shortest allowed interval between snapshots, in seconds
+#define DB_SNAPSHOT_MIN_INTERVAL 10
+
+/**
+ * Prepare a database that lives on tmpfs
+ *
+ * A live database left over from a previous run (process restart without a
+ * reboot) is newer than any snapshot and is kept if it was loaded for the
+ * same snapshot_path and passes a quick check.
+ * Otherwise the latest snapshot is copied into memory_path. With neither,
+ * a new database will be created at memory_path.
+ *
+ * @param memory_path Path of the live database on tmpfs
+ * @param snapshot_path Path of the snapshot on persistent storage
+ * @return 0 on success, non-zero if the database should stay on persistent storage
+ */
+int prepare_memory_database(const char *memory_path, const char *snapshot_path);
+
+/**
+ * Start snapshotting the live database to persistent storage
+ *
+ * Every interval seconds the live database is copied to snapshot_path with
+ * the SQLite backup API, so at most interval seconds of changes are lost
+ * if the device loses power.
+ *
+ * @param memory_path Path of the live database on tmpfs
+ * @param snapshot_path Path of the snapshot on persistent storage
+ * @param interval Seconds between snapshots
+ * @return 0 on success, non-zero on failure
+ */
+int start_db_snapshots(const char *memory_path, const char *snapshot_path, int interval);
+
+/**
+ * Stop snapshotting and take a final snapshot
+ *
+ * Must be called while the live database is still open.
+ */
+void stop_db_snapshots(void);
+
+#endif // LIGHTNVR_DB_SNAPSHOT_H
@@ -0,0 +1,59 @@
+#ifndef LIGHTNVR_DB_STMT_CACHE_H
+#define LIGHTNVR_DB_STMT_CACHE_H
+
+#include <sqlite3.h>
+#include <stdint.h>
+
+// Maximum number of prepared statements kept per connection
+#define DB_STMT_CACHE_SIZE 64
+
+// Maximum number of connections with a statement cache: the writer, the
+// reader pool and room for connections opened while the old ones close
+#define DB_STMT_CACHE_CONNECTIONS 8
+
+/**
+ * Get a prepared statement for the given SQL text
+ *
+ * Each connection has its own cache, looked up by exact SQL text, so each
+ * distinct query shape is prepared once per connection and then reused.
+ * The caller must be the only user of the connection (a checked out reader,
+ * or the writer under the database mutex); only that connection's
+ * statements are prepared or evicted. The returned
+ * statement has no bindings and is ready to be stepped. If the cached
+ * statement for this query is already in use by another caller, a
+ * private statement is prepared instead.
+ *
+ * @param db Database connection
+ * @param sql SQL text of the statement
+ * @return Prepared statement, or NULL if preparation failed
+ */
+sqlite3_stmt *db_stmt_cache_acquire(sqlite3 *db, const char *sql);
+
+/**
+ * Return a statement obtained from db_stmt_cache_acquire
+ *
+ * Cached statements are reset and their bindings cleared so they do not
+ * hold a read transaction open; private statements are finalized.
+ *
+ * @param stmt Statement to release (NULL is ignored)
+ */
+void db_stmt_cache_release(sqlite3_stmt *stmt);
+
+/**
+ * Finalize all cached statements for a connection
+ *
+ * Must be called before the connection is closed.
+ *
+ * @param db Database connection, or NULL to clear the whole cache
+ */
+void db_stmt_cache_clear(sqlite3 *db);
+
+/**
+ * Get statement cache hit and miss counters
+ *
+ * @param hits Number of lookups served from the cache (may be NULL)
+ * @param misses Number of lookups that had to prepare a statement (may be NULL)
+ */
+void db_stmt_cache_get_stats(uint64_t *hits, uint64_t *misses);
+
+#endif // LIGHTNVR_DB_STMT_CACHE_H
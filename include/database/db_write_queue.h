@@ -0,0 +1,97 @@
+#ifndef LIGHTNVR_DB_WRITE_QUEUE_H
+#define LIGHTNVR_DB_WRITE_QUEUE_H
+
+#include <stdint.h>
+#include <time.h>
+
+#include "database/db_events.h"
+#include "video/detection_result.h"
+
+// Commit queued writes at least this often, in milliseconds
+#define DB_WRITE_QUEUE_FLUSH_MS 500
+
+// Commit early once this many rows are queued
+#define DB_WRITE_QUEUE_BATCH_ROWS 256
+
+// Beyond this many queued rows writers bypass the queue and write directly
+#define DB_WRITE_QUEUE_MAX_ROWS 8192
+
+// Batches a write may be retried in before it is written on its own
+#define DB_WRITE_QUEUE_MAX_ATTEMPTS 3
+
+/**
+ * Start the write-behind queue
+ *
+ * Detection inserts, queued events and recording progress updates from all
+ * streams are grouped and committed by one thread in a single transaction
+ * every DB_WRITE_QUEUE_FLUSH_MS, or sooner once DB_WRITE_QUEUE_BATCH_ROWS
+ * rows are waiting. Each write is applied in a savepoint, so one that fails
+ * leaves nothing behind. A batch that cannot be committed is retried, then
+ * written one transaction per write.
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int init_db_write_queue(void);
+
+/**
+ * Stop the write-behind queue, committing anything still queued
+ */
+void shutdown_db_write_queue(void);
+
+/**
+ * Commit everything queued so far and wait for it to finish
+ *
+ * For readers that need what was queued before them, such as the detection
+ * aggregates computed when a recording completes. Must not be called with
+ * the database mutex held.
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int db_write_queue_flush(void);
+
+/**
+ * Queue detection results for insertion
+ *
+ * @param stream_name Stream name
+ * @param result Detection results (copied)
+ * @param timestamp Timestamp of the detection
+ * @return 0 if queued, non-zero if the caller must write directly
+ */
+int db_write_queue_detections(const char *stream_name, const detection_result_t *result, time_t timestamp);
+
+/**
+ * Queue an event for insertion
+ *
+ * @param type Event type
+ * @param timestamp Time the event occurred
+ * @param stream_name Stream name (can be NULL)
+ * @param description Short description of the event
+ * @param details Detailed information about the event (can be NULL)
+ * @return 0 if queued, non-zero if the caller must write directly
+ */
+int db_write_queue_event(event_type_t type, time_t timestamp, const char *stream_name,
+                         const char *description, const char *details);
+
+/**
+ * Queue a progress update for an in-progress recording
+ *
+ * A newer update for the same recording replaces one that is still queued.
+ *
+ * @param id Recording ID
+ * @param end_time New end time
+ * @param size_bytes New size in bytes
+ * @return 0 if queued, non-zero if the caller must write directly
+ */
+int db_write_queue_recording_update(uint64_t id, time_t end_time, uint64_t size_bytes);
+
+/**
+ * Drop queued progress updates for a recording
+ *
+ * Waits for a batch that is being committed to finish, so that once this
+ * returns no queued update for the recording can still be applied.
+ *
+ * @param id Recording ID
+ */
+void db_write_queue_cancel_recording_updates(uint64_t id);
+
+#endif // LIGHTNVR_DB_WRITE_QUEUE_H
@@ -31,6 +31,25 @@ typedef struct {
     uint64_t newest_recording_time;
 } storage_stats_t;
 
+// Maximum number of streams whose write rate is tracked
+#define MAX_TRACKED_STREAMS 32
+
+// Per-stream write rate
+typedef struct {
+    char stream_name[64];
+    uint64_t write_rate;        // Smoothed bytes per second
+} stream_write_rate_t;
+
+// Storage fill prediction
+typedef struct {
+    uint64_t total_write_rate;  // Sum of all stream write rates in bytes per second
+    uint64_t headroom_bytes;    // Space left before the storage limit or disk is full
+    int64_t seconds_to_full;    // Predicted time until full, -1 if nothing is being written
+    uint64_t bytes_needed;      // Space the current rate will consume over the prediction horizon
+    int stream_count;           // Number of streams contributing to the rate
+    time_t updated_at;          // When the prediction was last refreshed
+} storage_prediction_t;
+
 /**
  * Initialize the storage manager
  * 
@@ -164,11 +183,41 @@ int create_stream_directory(const char *stream_name);
  */
 bool ensure_disk_space(uint64_t min_free_bytes);
 
+/**
+ * Report write progress for a stream
+ * 
+ * Recording writers call this with the current size of the file they are
+ * writing; the storage manager turns successive sizes into a write rate.
+ * 
+ * @param stream_name Name of the stream
+ * @param file_bytes Current size of the file being written
+ */
+void storage_report_stream_write(const char *stream_name, uint64_t file_bytes);
+
+/**
+ * Get the latest storage fill prediction
+ * 
+ * @param prediction Pointer to prediction structure to fill
+ * @return 0 on success, non-zero on failure
+ */
+int get_storage_prediction(storage_prediction_t *prediction);
+
+/**
+ * Get smoothed write rates for all tracked streams
+ * 
+ * @param rates Array to fill with per-stream write rates
+ * @param max_count Maximum number of entries to return
+ * @return Number of entries filled, or -1 on error
+ */
+int get_stream_write_rates(stream_write_rate_t *rates, int max_count);
+
 /**
  * Start the retention policy thread
  * 
  * This thread periodically checks storage usage and applies the retention policy
- * to delete old recordings based on age and storage limits.
+ * to delete old recordings based on age and storage limits. Between passes it
+ * refreshes the fill prediction and starts retention early when the current
+ * write rate would exhaust the remaining space.
  * 
  * @param interval_seconds How often to check retention policy (in seconds)
  * @return 0 on success, non-zero on failure
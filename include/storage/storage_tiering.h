@@ -0,0 +1,63 @@
+#ifndef LIGHTNVR_STORAGE_TIERING_H
+#define LIGHTNVR_STORAGE_TIERING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Storage tiering statistics structure
+typedef struct {
+    bool enabled;
+    uint64_t migrated_recordings;   // Recordings moved to the cold tier since startup
+    uint64_t migrated_bytes;        // Bytes moved to the cold tier since startup
+    uint64_t failed_migrations;     // Copies that failed or did not verify
+    time_t last_pass_time;          // When the mover last looked for candidates
+} storage_tiering_stats_t;
+
+/**
+ * Start the storage tiering thread
+ *
+ * Completed recordings that ended more than age_hours ago and live under
+ * hot_path are copied to the same relative location under cold_path,
+ * verified, re-pointed in the database and then removed from hot_path.
+ *
+ * @param hot_path Fast tier root (usually the storage path)
+ * @param cold_path Slow tier root
+ * @param age_hours Age in hours after which recordings are moved
+ * @param max_bytes_per_sec Copy throttle in bytes per second (0 for unlimited)
+ * @return 0 on success, non-zero on failure
+ */
+int start_storage_tiering(const char *hot_path, const char *cold_path,
+                          int age_hours, uint64_t max_bytes_per_sec);
+
+/**
+ * Stop the storage tiering thread
+ *
+ * A copy in progress is abandoned and its temporary file removed.
+ *
+ * @return 0 on success, non-zero on failure
+ */
+int stop_storage_tiering(void);
+
+/**
+ * Get the cold tier root
+ *
+ * Stays set after the tiering thread stops, so retention keeps covering
+ * recordings already moved there.
+ *
+ * @param path Buffer for the path
+ * @param size Size of the buffer
+ * @return true if a cold tier was configured
+ */
+bool get_storage_tiering_cold_path(char *path, size_t size);
+
+/**
+ * Get storage tiering statistics
+ *
+ * @param stats Pointer to statistics structure to fill
+ * @return 0 on success, non-zero on failure
+ */
+int get_storage_tiering_stats(storage_tiering_stats_t *stats);
+
+#endif // LIGHTNVR_STORAGE_TIERING_H
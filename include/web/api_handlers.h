@@ -264,6 +264,21 @@ void mg_handle_test_stream(struct mg_connection *c, struct mg_http_message *hm);
  */
 int mg_extract_path_param(struct mg_http_message *hm, const char *prefix, char *param_buf, size_t buf_size);
 
+/**
+ * @brief Headers sent with every JSON API response
+ */
+#define MG_JSON_RESPONSE_HEADERS \
+    "Content-Type: application/json\r\n" \
+    "Connection: close\r\n" \
+    "Access-Control-Allow-Origin: *\r\n" \
+    "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n" \
+    "Access-Control-Allow-Headers: Content-Type, Authorization, X-Requested-With\r\n" \
+    "Access-Control-Allow-Credentials: true\r\n" \
+    "Access-Control-Max-Age: 86400\r\n" \
+    "Cache-Control: no-cache, no-store, must-revalidate\r\n" \
+    "Pragma: no-cache\r\n" \
+    "Expires: 0\r\n"
+
 /**
  * @brief Helper function to send a JSON response
  * 
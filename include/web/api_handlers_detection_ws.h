@@ -0,0 +1,46 @@
+/**
+ * @file api_handlers_detection_ws.h
+ * @brief Live detection results pushed over WebSocket
+ */
+
+#ifndef API_HANDLERS_DETECTION_WS_H
+#define API_HANDLERS_DETECTION_WS_H
+
+#include <time.h>
+
+#include "video/detection_result.h"
+
+/**
+ * @brief Topic prefix of the live detection streams
+ *
+ * Clients subscribe to "detection/live/<stream name>".
+ */
+#define DETECTION_WS_TOPIC "detection/live"
+
+/**
+ * @brief Detection updates kept for clients resuming after a reconnect
+ */
+#define DETECTION_WS_HISTORY 256
+
+/**
+ * @brief Register the live detection WebSocket topic
+ *
+ * @return 0 on success, non-zero on error
+ */
+int detection_ws_init(void);
+
+/**
+ * @brief Push the detections of a processed frame to subscribed clients
+ *
+ * Every update gets the next sequence number. An empty result is only
+ * pushed when the previous update for the stream had detections, so the
+ * overlay is cleared once and then stays quiet. Safe to call from any
+ * thread.
+ *
+ * @param stream_name Stream name
+ * @param result Detections above the stream's threshold
+ * @param timestamp Frame time, 0 for now
+ */
+void detection_ws_publish(const char *stream_name, const detection_result_t *result, time_t timestamp);
+
+#endif /* API_HANDLERS_DETECTION_WS_H */
@@ -6,7 +6,10 @@
 #ifndef API_HANDLERS_SYSTEM_WS_H
 #define API_HANDLERS_SYSTEM_WS_H
 
+#include <stdint.h>
+
 #include "mongoose.h"
+#include "database/db_backup.h"
 
 /**
  * @brief WebSocket handler for system logs
@@ -17,13 +20,38 @@
 void websocket_handle_system_logs(const char *client_id, const char *message);
 
 /**
- * @brief Fetch system logs with timestamp-based pagination
+ * @brief Fetch system logs after a sequence number
+ * 
+ * The reply carries latest_seq, which the client sends back as since on
+ * its next fetch to receive only newer entries.
  * 
  * @param client_id WebSocket client ID
  * @param min_level Minimum log level to include
- * @param last_timestamp Last timestamp received by client (for pagination)
+ * @param since Last sequence number the client received, 0 for the newest logs
+ * @param max_logs Most entries to send, 0 for the default
  * @return int Number of logs sent
  */
-int fetch_system_logs(const char *client_id, const char *min_level, const char *last_timestamp);
+int fetch_system_logs(const char *client_id, const char *min_level, uint64_t since, int max_logs);
+
+/**
+ * @brief WebSocket handler for database backup progress
+ * 
+ * Subscribing sends the current backup state, after which progress and
+ * the final result are pushed on the system/backup topic.
+ * 
+ * @param client_id WebSocket client ID
+ * @param message WebSocket message
+ */
+void websocket_handle_system_backup(const char *client_id, const char *message);
+
+/**
+ * @brief Send database backup progress to subscribed clients
+ * 
+ * Registered with set_backup_progress_callback.
+ * 
+ * @param progress Backup progress
+ * @param user_data Unused
+ */
+void system_backup_progress_ws(const db_backup_progress_t *progress, void *user_data);
 
 #endif /* API_HANDLERS_SYSTEM_WS_H */
@@ -8,6 +8,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdatomic.h>
 #include <time.h>
 #include "request_response.h"
 
@@ -38,6 +39,7 @@ typedef struct {
     int connection_timeout;         // Connection timeout in seconds
     bool daemon_mode;               // Daemon mode
     char pid_file[256];             // PID file path
+    int event_loops;                // Mongoose managers, each on its own thread and listener
 } http_server_config_t;
 
 /**
@@ -46,7 +48,7 @@ typedef struct {
 typedef struct http_server {
     struct mg_mgr *mgr;             // Mongoose event manager
     http_server_config_t config;    // Server configuration
-    bool running;                   // Server running flag
+    atomic_bool running;            // Server running flag, read by every event loop
     
     // Handler registry
     struct {
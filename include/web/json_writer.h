@@ -0,0 +1,163 @@
+/**
+ * @file json_writer.h
+ * @brief Streaming JSON writer for large API responses
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "mongoose.h"
+
+/**
+ * @brief Bytes buffered before they are written out as a chunk
+ */
+#define JSON_WRITER_CHUNK_SIZE 8192
+
+/**
+ * @brief Bytes allowed to wait in the send buffer before a streamed
+ *        response stops producing more
+ */
+#define JSON_WRITER_HIGH_WATER (64 * 1024)
+
+/**
+ * @brief Deepest nesting of objects and arrays
+ */
+#define JSON_WRITER_MAX_DEPTH 32
+
+/**
+ * @brief JSON response being written
+ *
+ * Values are formatted into a small buffer that is written to the
+ * connection as an HTTP chunk whenever it fills, so a response is never
+ * built as a cJSON tree or printed to a string.
+ */
+typedef struct {
+    struct mg_connection *c;
+    char buf[JSON_WRITER_CHUNK_SIZE];
+    size_t len;
+    int depth;
+    bool has_items[JSON_WRITER_MAX_DEPTH];  // Whether a comma goes before the next value
+    bool error;
+    size_t bytes_written;
+} json_writer_t;
+
+/**
+ * @brief Write the next part of a streamed response
+ *
+ * Called on the event loop thread whenever the connection's send buffer is
+ * below JSON_WRITER_HIGH_WATER. Should write a bounded batch, such as one
+ * page of database rows, and return.
+ *
+ * @param w Writer, already begun
+ * @param ctx Context passed to json_writer_stream
+ * @return 1 when the document is complete, 0 to be called again, -1 to
+ *         abort the response and close the connection
+ */
+typedef int (*json_writer_produce_fn)(json_writer_t *w, void *ctx);
+
+/**
+ * @brief Free the context of a streamed response
+ */
+typedef void (*json_writer_release_fn)(void *ctx);
+
+/**
+ * @brief Start a JSON response with chunked transfer encoding
+ *
+ * The whole document is written before the caller returns, so it collects
+ * in the connection's send buffer. Use json_writer_stream for responses
+ * that are not small and bounded.
+ *
+ * Must be called on the thread that polls the connection's manager.
+ *
+ * @param w Writer to initialize
+ * @param c Mongoose connection
+ * @param status_code HTTP status code
+ */
+void json_writer_begin(json_writer_t *w, struct mg_connection *c, int status_code);
+
+/**
+ * @brief Stream a JSON response, producing it as the client reads it
+ *
+ * Sends the headers, then takes over the connection's protocol handler the
+ * way mg_http_sendfile does and calls produce each time the send buffer
+ * drains below JSON_WRITER_HIGH_WATER, until it returns 1. Only one batch
+ * of rows and one chunk buffer are held at a time, however long the
+ * response is. release is called once the response is finished or the
+ * connection closes.
+ *
+ * Must be called on the thread that polls the connection's manager.
+ *
+ * @param c Mongoose connection
+ * @param status_code HTTP status code
+ * @param produce Callback that writes the next part of the document
+ * @param release Callback that frees ctx, may be NULL
+ * @param ctx Context passed to both callbacks
+ * @return 0 on success, -1 if nothing was sent and ctx was not released
+ */
+int json_writer_stream(struct mg_connection *c, int status_code,
+                       json_writer_produce_fn produce, json_writer_release_fn release, void *ctx);
+
+/**
+ * @brief Finish the response
+ *
+ * @param w Writer
+ * @return 0 on success, -1 if the document was not well formed
+ */
+int json_writer_end(json_writer_t *w);
+
+/**
+ * @brief Open an object
+ *
+ * @param w Writer
+ * @param key Member name inside an object, NULL inside an array or at the top
+ */
+void json_writer_object_begin(json_writer_t *w, const char *key);
+
+/**
+ * @brief Close the innermost object
+ */
+void json_writer_object_end(json_writer_t *w);
+
+/**
+ * @brief Open an array
+ *
+ * @param w Writer
+ * @param key Member name inside an object, NULL inside an array or at the top
+ */
+void json_writer_array_begin(json_writer_t *w, const char *key);
+
+/**
+ * @brief Close the innermost array
+ */
+void json_writer_array_end(json_writer_t *w);
+
+/**
+ * @brief Write a string, NULL is written as null
+ */
+void json_writer_string(json_writer_t *w, const char *key, const char *value);
+
+/**
+ * @brief Write a number, formatted as cJSON would
+ */
+void json_writer_number(json_writer_t *w, const char *key, double value);
+
+/**
+ * @brief Write an integer
+ */
+void json_writer_int(json_writer_t *w, const char *key, int64_t value);
+
+/**
+ * @brief Write a boolean
+ */
+void json_writer_bool(json_writer_t *w, const char *key, bool value);
+
+/**
+ * @brief Write null
+ */
+void json_writer_null(json_writer_t *w, const char *key);
+
+#endif /* JSON_WRITER_H */
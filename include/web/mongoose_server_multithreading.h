@@ -6,8 +6,41 @@
 #ifndef MONGOOSE_SERVER_MULTITHREADING_H
 #define MONGOOSE_SERVER_MULTITHREADING_H
 
+#include <stdint.h>
+#include <stdbool.h>
+
 #include "mongoose.h"
 
+/**
+ * @brief Worker threads that serve offloaded requests
+ */
+#define MG_WORKER_THREADS 4
+
+/**
+ * @brief Upper bound on the number of worker threads
+ */
+#define MG_WORKER_MAX_THREADS 32
+
+/**
+ * @brief Requests that may wait for a worker before new ones are shed
+ */
+#define MG_WORKER_QUEUE_SIZE 64
+
+/**
+ * @brief Requests of one route that may run at the same time
+ */
+#define MG_WORKER_ROUTE_CONCURRENCY 2
+
+/**
+ * @brief Requests of one route that may wait in the queue
+ */
+#define MG_WORKER_ROUTE_QUEUE_LIMIT 16
+
+/**
+ * @brief Seconds a shed client is asked to wait before retrying
+ */
+#define MG_WORKER_RETRY_AFTER 1
+
 /**
  * @brief Thread data structure for worker threads
  */
@@ -18,6 +51,64 @@ struct mg_thread_data {
   void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm);  // Handler function
 };
 
+/**
+ * @brief Worker pool metrics
+ */
+typedef struct {
+  int threads;                // Worker threads running
+  int active;                 // Requests being handled
+  int queued;                 // Requests waiting for a worker
+  uint64_t completed;         // Requests handled
+  uint64_t rejected;          // Requests shed with 503
+  double avg_queue_ms;        // Average time requests waited for a worker
+  double max_queue_ms;        // Longest time a request waited for a worker
+} mg_worker_pool_stats_t;
+
+/**
+ * @brief Start the worker pool
+ * 
+ * Offloaded requests are queued for a fixed set of worker threads instead
+ * of each getting a thread of its own. Requests are shed with 503 when the
+ * queue is full or their route already has MG_WORKER_ROUTE_QUEUE_LIMIT
+ * requests waiting, and no route runs on more than
+ * MG_WORKER_ROUTE_CONCURRENCY workers at once.
+ * 
+ * @param threads Number of worker threads
+ * @return 0 on success, -1 on failure
+ */
+int mg_worker_pool_init(int threads);
+
+/**
+ * @brief Stop the worker pool
+ * 
+ * Waits for requests being handled to finish and answers the queued ones
+ * with 503 Service Unavailable.
+ * Must be called before the Mongoose manager is freed.
+ */
+void mg_worker_pool_shutdown(void);
+
+/**
+ * @brief Get worker pool metrics
+ * 
+ * @param stats Structure to fill
+ */
+void mg_worker_pool_get_stats(mg_worker_pool_stats_t *stats);
+
+/**
+ * @brief Handle a request on a worker thread
+ * 
+ * The request is copied and handler_func runs on a worker with a detached
+ * connection, its response is sent back through mg_wakeup. When the pool
+ * is saturated a 503 is sent instead.
+ * 
+ * @param c Mongoose connection
+ * @param hm HTTP message
+ * @param handler_func Handler to run on the worker
+ * @return true if the request was queued, false if an error response was sent
+ */
+bool mg_offload_request(struct mg_connection *c, struct mg_http_message *hm,
+                        void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm));
+
 /**
  * @brief Start a thread
  * 
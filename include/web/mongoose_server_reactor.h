@@ -0,0 +1,127 @@
+/**
+ * @file mongoose_server_reactor.h
+ * @brief Event loops (reactors) serving the HTTP front end
+ */
+
+#ifndef MONGOOSE_SERVER_REACTOR_H
+#define MONGOOSE_SERVER_REACTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <pthread.h>
+
+#include "mongoose.h"
+#include "web/http_server.h"
+#include "web/websocket_outbox.h"
+
+/**
+ * @brief Most event loops the server runs
+ */
+#define MG_MAX_REACTORS 16
+
+/**
+ * @brief Poll timeout of each event loop in milliseconds
+ */
+#define MG_REACTOR_POLL_MS 10
+
+/**
+ * @brief Pending connections each listener queues
+ */
+#define MG_REACTOR_LISTEN_BACKLOG 128
+
+/**
+ * @brief Register an event loop
+ *
+ * WebSocket messages for connections of a registered manager are queued
+ * and sent from its own thread. The thread that created the server's main
+ * manager registers it; mg_reactors_start registers the others.
+ *
+ * @param mgr Mongoose manager
+ * @param thread Thread polling the manager
+ * @return 0 on success, -1 if too many are registered
+ */
+int mg_reactor_register(struct mg_mgr *mgr, pthread_t thread);
+
+/**
+ * @brief Listen on an address shared with the other event loops
+ *
+ * The listening socket is bound to the host and port of the listen URL
+ * (IPv4 or IPv6) with SO_REUSEPORT, so the kernel spreads new connections
+ * across all event loops listening on it. Mongoose cannot set SO_REUSEPORT
+ * itself, so the socket is handed to a regular Mongoose HTTP listener in
+ * place of the one it opened.
+ *
+ * @param mgr Mongoose manager
+ * @param url Listen URL, "https://" for TLS
+ * @param fn Event handler
+ * @param fn_data Event handler data
+ * @return Listening connection, or NULL on error
+ */
+struct mg_connection *mg_reactor_listen(struct mg_mgr *mgr, const char *url,
+                                        mg_event_handler_t fn, void *fn_data);
+
+/**
+ * @brief Start the additional event loops
+ *
+ * Starts server->config.event_loops - 1 event loops next to the main one,
+ * each with its own manager, thread and listener.
+ *
+ * @param server HTTP server
+ * @param url Listen URL of the main event loop
+ * @param fn Event handler
+ * @return Number of event loops started, or -1 on error
+ */
+int mg_reactors_start(http_server_t *server, const char *url, mg_event_handler_t fn);
+
+/**
+ * @brief Stop the additional event loops and free their managers
+ *
+ * Also drops the registration of the main manager. Must be called after
+ * the worker pool has stopped, workers wake connections of any loop.
+ */
+void mg_reactors_stop(void);
+
+/**
+ * @brief Send a WebSocket text message from any thread
+ *
+ * The message is handed to the event loop that owns the connection. If the
+ * connection is closed before then the message is dropped. It goes through
+ * the connection's outbox, so it stays behind broadcasts already queued.
+ *
+ * @param c WebSocket connection
+ * @param data Message data
+ * @param len Message length
+ * @return true if the message was sent or queued
+ */
+bool mg_reactor_ws_send(struct mg_connection *c, const char *data, size_t len);
+
+/**
+ * @brief Send a framed message to the WebSocket clients of every event loop
+ *
+ * Each event loop takes a reference to the frame, so it is framed once no
+ * matter how many clients receive it. Clients that are behind get it
+ * through their bounded queue.
+ *
+ * @param topic Only clients subscribed to this topic, NULL for all clients
+ * @param frame Framed message, the caller keeps its reference
+ * @return Number of event loops the message was queued for
+ */
+int mg_reactor_ws_publish(const char *topic, ws_frame_t *frame);
+
+/**
+ * @brief Send the messages queued for an event loop
+ *
+ * Called on the loop's own thread when its listener is polled.
+ *
+ * @param listener Listening connection of the event loop
+ */
+void mg_reactor_poll(struct mg_connection *listener);
+
+/**
+ * @brief Get the number of registered event loops
+ *
+ * @return Number of event loops
+ */
+int mg_reactor_count(void);
+
+#endif /* MONGOOSE_SERVER_REACTOR_H */
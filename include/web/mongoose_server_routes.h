@@ -0,0 +1,82 @@
+/**
+ * @file mongoose_server_routes.h
+ * @brief API route dispatch for the Mongoose HTTP server
+ */
+
+#ifndef MONGOOSE_SERVER_ROUTES_H
+#define MONGOOSE_SERVER_ROUTES_H
+
+#include <stddef.h>
+
+#include "mongoose.h"
+
+/**
+ * @brief Most parameters a route pattern can capture
+ */
+#define MG_ROUTE_MAX_PARAMS 4
+
+// API handler function type
+typedef void (*mg_api_handler_t)(struct mg_connection *c, struct mg_http_message *hm);
+
+// API route entry structure
+typedef struct {
+    const char *method;     // HTTP method (GET, POST, etc.)
+    const char *uri;        // URI pattern
+    mg_api_handler_t handler; // Handler function
+} mg_api_route_t;
+
+/**
+ * @brief Parameters captured by a route pattern
+ *
+ * The values point into the request URI.
+ */
+typedef struct {
+    struct mg_str values[MG_ROUTE_MAX_PARAMS];
+    int count;
+} mg_route_params_t;
+
+/**
+ * @brief Build the dispatch trie for a routes table
+ *
+ * Patterns are split into path segments. A segment that is just "#" is a
+ * parameter, or the rest of the URI when it is the last one; other segments
+ * containing "#", "*" or "?" are matched with mg_match and capture what the
+ * wildcards matched. As with mg_match, "#" also matches slashes, so such a
+ * segment may take several path segments of the request. When several
+ * routes match a request the one listed first wins, as with a linear scan
+ * of the table with mg_match.
+ *
+ * Must be called before the server starts; the trie is read-only after.
+ *
+ * @param routes Routes table ending with a NULL method
+ * @return 0 on success, -1 on error
+ */
+int mg_routes_init(const mg_api_route_t *routes);
+
+/**
+ * @brief Free the dispatch trie
+ */
+void mg_routes_free(void);
+
+/**
+ * @brief Find the route for a request
+ *
+ * @param hm HTTP message
+ * @param params Filled with the captured parameters, may be NULL
+ * @return Index of the route in the table, or -1 if none matches
+ */
+int mg_routes_match(struct mg_http_message *hm, mg_route_params_t *params);
+
+/**
+ * @brief Copy a parameter captured by the route of a request
+ *
+ * @param hm HTTP message
+ * @param index Index of the parameter in the pattern, from 0
+ * @param buf Buffer to fill, NUL terminated
+ * @param buf_size Size of the buffer
+ * @return Length of the parameter, or -1 if there is no such parameter or
+ *         it does not fit
+ */
+int mg_route_get_param(struct mg_http_message *hm, int index, char *buf, size_t buf_size);
+
+#endif /* MONGOOSE_SERVER_ROUTES_H */
@@ -0,0 +1,46 @@
+/**
+ * @file mongoose_server_sendfile.h
+ * @brief Zero-copy file serving for the Mongoose HTTP server
+ */
+
+#ifndef MONGOOSE_SERVER_SENDFILE_H
+#define MONGOOSE_SERVER_SENDFILE_H
+
+#include "mongoose.h"
+
+/**
+ * @brief Most bytes handed to sendfile in one call
+ */
+#define MG_SENDFILE_CHUNK_SIZE (1024 * 1024)
+
+/**
+ * @brief Most bytes sent to one connection per poll
+ *
+ * Keeps one fast client from holding up the rest of the event loop.
+ */
+#define MG_SENDFILE_MAX_PER_POLL (4 * 1024 * 1024)
+
+/**
+ * @brief Serve a file, copying the body straight from the page cache
+ *
+ * A drop-in replacement for mg_http_serve_file. Over plain HTTP the
+ * headers go out through Mongoose and the body is sent with sendfile(2),
+ * so it never passes through the connection's send buffer. Single byte
+ * ranges are answered with 206 or 416, and If-None-Match with 304.
+ * TLS connections fall back to mg_http_serve_file.
+ *
+ * If extra_headers set a Content-Type, no other is sent; otherwise it is
+ * taken from mime_types when that holds a single type, or guessed from
+ * the file extension.
+ *
+ * Must be called on the thread that polls the connection's manager.
+ *
+ * @param c Mongoose connection
+ * @param hm HTTP message, may be NULL
+ * @param path Path of the file
+ * @param opts Serve options
+ */
+void mg_http_sendfile(struct mg_connection *c, struct mg_http_message *hm,
+                      const char *path, const struct mg_http_serve_opts *opts);
+
+#endif /* MONGOOSE_SERVER_SENDFILE_H */
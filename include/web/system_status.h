@@ -0,0 +1,82 @@
+/**
+ * @file system_status.h
+ * @brief Background sampler behind GET /api/system/info
+ */
+
+#ifndef SYSTEM_STATUS_H
+#define SYSTEM_STATUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+/**
+ * @brief WebSocket topic carrying system status updates
+ */
+#define SYSTEM_STATUS_WS_TOPIC "system/status"
+
+// Seconds between samples of CPU, memory, disk space and server metrics
+#define SYSTEM_STATUS_FAST_INTERVAL 1
+
+// Seconds between database counts, interface and go2rtc lookups, and the
+// shortest time between snapshots that differ only in those metrics
+#define SYSTEM_STATUS_SLOW_INTERVAL 10
+
+// Seconds between walks of the storage directory
+#define SYSTEM_STATUS_STORAGE_INTERVAL 300
+
+/**
+ * @brief Rendered system status shared by every reader
+ *
+ * A snapshot is immutable once published. Readers hold a reference while
+ * they send it, so the sampler can publish the next one at any time.
+ */
+typedef struct {
+    atomic_int refs;
+    char etag[24];              // Quoted hash of the JSON
+    size_t len;
+    char json[];
+} system_status_snapshot_t;
+
+/**
+ * @brief Start the system status sampler
+ *
+ * Takes a first sample before returning, so a snapshot is always
+ * available while the sampler runs.
+ *
+ * @return 0 on success, non-zero on error
+ */
+int system_status_start(void);
+
+/**
+ * @brief Stop the system status sampler
+ */
+void system_status_stop(void);
+
+/**
+ * @brief Get the latest system status
+ *
+ * When the sampler is not running a snapshot is sampled on the spot.
+ * Release it with system_status_release().
+ *
+ * @return Snapshot, or NULL on error
+ */
+system_status_snapshot_t *system_status_acquire(void);
+
+/**
+ * @brief Drop a reference taken by system_status_acquire()
+ *
+ * @param snapshot Snapshot to release, may be NULL
+ */
+void system_status_release(system_status_snapshot_t *snapshot);
+
+/**
+ * @brief Register the system status WebSocket topic
+ *
+ * Subscribers get the latest snapshot straight away and every change after.
+ *
+ * @return 0 on success, non-zero on error
+ */
+int system_status_ws_init(void);
+
+#endif /* SYSTEM_STATUS_H */
@@ -0,0 +1,53 @@
+/**
+ * @file web_asset_pack.h
+ * @brief Web UI served from a precompressed archive held in memory
+ */
+
+#ifndef WEB_ASSET_PACK_H
+#define WEB_ASSET_PACK_H
+
+#include <stdbool.h>
+
+#include "mongoose.h"
+
+/**
+ * @brief Map an asset pack built by scripts/pack_web_assets.py
+ *
+ * The archive holds every file of the web UI with its gzip and brotli
+ * variants and a content hash for the ETag. It is mapped once, so assets
+ * are answered without touching the filesystem.
+ *
+ * Must be called before the server starts; the pack is read-only after.
+ *
+ * @param path Path of the archive
+ * @return 0 on success, -1 if it is missing or not a valid pack
+ */
+int web_asset_pack_open(const char *path);
+
+/**
+ * @brief Unmap the asset pack
+ */
+void web_asset_pack_close(void);
+
+/**
+ * @brief Check whether an asset pack is mapped
+ */
+bool web_asset_pack_loaded(void);
+
+/**
+ * @brief Answer a request for a web UI file from the asset pack
+ *
+ * Picks the brotli or gzip variant the client accepts when compression is
+ * enabled, answers If-None-Match with 304, and sets Cache-Control from the
+ * web cache max-age settings. A URI ending in "/" is served its index.html.
+ *
+ * Must be called on the thread that polls the connection's manager.
+ *
+ * @param c Mongoose connection
+ * @param hm HTTP message
+ * @param uri Path of the file, without the query string
+ * @return true if the response was sent, false if the pack has no such file
+ */
+bool web_asset_pack_serve(struct mg_connection *c, struct mg_http_message *hm, const char *uri);
+
+#endif /* WEB_ASSET_PACK_H */
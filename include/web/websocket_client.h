@@ -37,6 +37,27 @@ bool websocket_client_remove_by_connection(const struct mg_connection *conn);
  */
 bool websocket_client_is_subscribed(const char *client_id, const char *topic);
 
+/**
+ * @brief Check if the client on a connection is subscribed to a topic
+ *
+ * Unlike websocket_client_is_subscribed this never subscribes the client.
+ *
+ * @param conn Mongoose connection
+ * @param topic Topic to check
+ * @return bool true if subscribed, false otherwise
+ */
+bool websocket_client_connection_subscribed(const struct mg_connection *conn, const char *topic);
+
+/**
+ * @brief Check whether any client is subscribed to a topic
+ *
+ * Lets publishers skip building messages nobody will receive.
+ *
+ * @param topic Topic to check
+ * @return bool true if at least one client is subscribed
+ */
+bool websocket_client_topic_has_subscribers(const char *topic);
+
 /**
  * @brief Get all clients subscribed to a topic
  * 
@@ -5,6 +5,7 @@
 #include <stddef.h>
 #include "mongoose.h"
 #include "web/websocket_handler.h"
+#include "web/websocket_outbox.h"
 
 /**
  * @brief Initialize WebSocket manager
@@ -58,6 +59,31 @@ bool websocket_manager_is_initialized(void);
  */
 int websocket_manager_register_handler(const char *topic, websocket_handler_t handler, void *user_data);
 
+/**
+ * @brief Set what happens to messages of a topic for clients that are behind
+ * 
+ * Topics default to WS_TOPIC_POLICY_DROP_OLDEST. Topics carrying a state
+ * that supersedes the previous one should use WS_TOPIC_POLICY_COALESCE.
+ * 
+ * @param topic Topic name
+ * @param policy Queue policy
+ * @return int 0 on success, non-zero on error
+ */
+int websocket_manager_set_topic_policy(const char *topic, ws_topic_policy_t policy);
+
+/**
+ * @brief Publish a message to the clients subscribed to a topic
+ * 
+ * The message is framed once and the frame is shared by every event loop
+ * and every client. Safe to call from any thread.
+ * 
+ * @param topic Topic name
+ * @param data Message data
+ * @param data_len Message data length
+ * @return int Number of event loops the message was queued for
+ */
+int websocket_manager_publish(const char *topic, const char *data, size_t data_len);
+
 /**
  * @brief Broadcast a message to all WebSocket clients
  * 
@@ -68,4 +94,16 @@ int websocket_manager_register_handler(const char *topic, websocket_handler_t ha
  */
 int websocket_manager_broadcast(struct mg_mgr *mgr, const char *data, size_t data_len);
 
+/**
+ * @brief Send a framed message to the WebSocket clients of a manager
+ * 
+ * Must be called on the thread that polls the manager.
+ * 
+ * @param mgr Mongoose manager
+ * @param topic Only clients subscribed to this topic, NULL for all clients
+ * @param frame Framed message
+ * @return int Number of clients the message was sent or queued to
+ */
+int websocket_manager_broadcast_frame(struct mg_mgr *mgr, const char *topic, ws_frame_t *frame);
+
 #endif // WEBSOCKET_MANAGER_H
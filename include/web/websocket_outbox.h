@@ -0,0 +1,94 @@
+/**
+ * @file websocket_outbox.h
+ * @brief Shared WebSocket frames and bounded per-connection send queues
+ */
+
+#ifndef WEBSOCKET_OUTBOX_H
+#define WEBSOCKET_OUTBOX_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "mongoose.h"
+
+/**
+ * @brief Bytes a connection may have waiting in its send buffer before
+ *        broadcasts are held in its queue instead
+ */
+#define WS_OUTBOX_HIGH_WATER (256 * 1024)
+
+/**
+ * @brief Most broadcast messages held for one connection
+ */
+#define WS_OUTBOX_MAX_FRAMES 64
+
+/**
+ * @brief What to do with a broadcast when a connection is behind
+ */
+typedef enum {
+    WS_TOPIC_POLICY_DROP_OLDEST = 0,    // Queue it, dropping the oldest message once the queue is full
+    WS_TOPIC_POLICY_COALESCE            // Replace the message of the same topic still waiting
+} ws_topic_policy_t;
+
+/**
+ * @brief WebSocket text frame, framed once and shared by every recipient
+ */
+typedef struct {
+    atomic_int refs;
+    size_t len;
+    char data[];
+} ws_frame_t;
+
+/**
+ * @brief Frame a text message
+ *
+ * @param payload Message data
+ * @param len Message length
+ * @return Frame with one reference, or NULL on allocation failure
+ */
+ws_frame_t *ws_frame_create(const char *payload, size_t len);
+
+/**
+ * @brief Take another reference to a frame
+ *
+ * @return The frame
+ */
+ws_frame_t *ws_frame_ref(ws_frame_t *frame);
+
+/**
+ * @brief Drop a reference to a frame, freeing it with the last one
+ */
+void ws_frame_unref(ws_frame_t *frame);
+
+/**
+ * @brief Send a frame to a connection, or queue it if the connection is behind
+ *
+ * Must be called on the thread that polls the connection's manager.
+ *
+ * @param c WebSocket connection
+ * @param frame Frame to send, the queue takes its own reference
+ * @param topic Topic of the message, used to coalesce, may be NULL
+ * @param policy What to do when the connection is behind
+ * @return true if the frame was sent or queued, false if it was dropped
+ */
+bool ws_outbox_send(struct mg_connection *c, ws_frame_t *frame, const char *topic,
+                    ws_topic_policy_t policy);
+
+/**
+ * @brief Move queued frames into the send buffer as it drains
+ *
+ * Called on every poll of a WebSocket connection.
+ *
+ * @param c WebSocket connection
+ */
+void ws_outbox_flush(struct mg_connection *c);
+
+/**
+ * @brief Drop the queue of a closing connection
+ *
+ * @param c WebSocket connection
+ */
+void ws_outbox_release(struct mg_connection *c);
+
+#endif /* WEBSOCKET_OUTBOX_H */
@@ -32,6 +32,17 @@ fi
 
 echo "Build completed successfully. Output is in $BUILD_DIR"
 
+# Pack the build with precompressed variants so the server can answer from memory
+if command -v python3 &> /dev/null; then
+    echo "Packing web assets..."
+    rm -f dist.pack
+    python3 ../scripts/pack_web_assets.py dist dist.pack || \
+        echo "Warning: Packing failed, the server will serve web assets from disk."
+else
+    echo "Warning: python3 not found, skipping the web asset pack."
+    rm -f dist.pack
+fi
+
 # Update web_optimization.json to use the new dist directory
 CONFIG_FILE="$(dirname "$(dirname "$0")")/config/web_optimization.json"
 if [ -f "$CONFIG_FILE" ]; then
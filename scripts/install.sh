@@ -334,9 +334,22 @@ if [ -d "web" ]; then
         echo "Found prebuilt web assets, installing from dist directory..."
         cp -r web/dist/* "$DATA_DIR/www/"
         echo "Web interface files installed to $DATA_DIR/www/"
+
+        # The packed copy is served from memory when present
+        # An older pack would keep serving the previous UI instead of these files
+        if [ -f "web/dist.pack" ] && [ ! "web/dist.pack" -ot "web/dist/index.html" ]; then
+            cp web/dist.pack "$DATA_DIR/www.pack"
+            echo "Web asset pack installed to $DATA_DIR/www.pack"
+        else
+            if [ -f "web/dist.pack" ]; then
+                echo "Warning: web/dist.pack is older than web/dist, not installing it"
+            fi
+            rm -f "$DATA_DIR/www.pack"
+        fi
     else
         echo "No prebuilt web assets found, copying web directory as is..."
         cp -r web/* "$DATA_DIR/www/"
+        rm -f "$DATA_DIR/www.pack"
         echo "Note: For optimized web assets, run scripts/build_and_update_web_vite.sh before installation"
     fi
 else
@@ -0,0 +1,166 @@
+#!/usr/bin/env python3
+"""Pack the built web UI into a single archive served from memory by LightNVR.
+
+Every file under the web root is stored as is, gzip compressed and, when the
+brotli module or command is available, brotli compressed. A compressed
+variant is only kept when it is noticeably smaller than the original.
+
+Layout, all integers little endian:
+
+    header   "LNVRPAK1", uint32 entry count, uint32 reserved
+    entries  count x 72 bytes, sorted by path:
+               uint32 path offset, path length
+               uint32 content type offset, content type length
+               uint32 etag offset, etag length
+               3 x (uint64 offset, uint64 length) for identity, gzip, brotli
+    data     strings and file bodies, offsets are from the start of the file
+
+Usage: pack_web_assets.py [web_root] [output]
+"""
+
+import gzip
+import hashlib
+import os
+import shutil
+import struct
+import subprocess
+import sys
+
+MAGIC = b"LNVRPAK1"
+HEADER = struct.Struct("<8sII")
+ENTRY = struct.Struct("<IIIIIIQQQQQQ")
+
+# Compressed variants have to save at least this much to be worth a lookup
+MIN_SAVING = 0.9
+
+CONTENT_TYPES = {
+    ".html": "text/html; charset=utf-8",
+    ".htm": "text/html; charset=utf-8",
+    ".css": "text/css; charset=utf-8",
+    ".js": "application/javascript; charset=utf-8",
+    ".mjs": "application/javascript; charset=utf-8",
+    ".json": "application/json",
+    ".map": "application/json",
+    ".webmanifest": "application/manifest+json",
+    ".txt": "text/plain; charset=utf-8",
+    ".xml": "application/xml",
+    ".svg": "image/svg+xml",
+    ".png": "image/png",
+    ".jpg": "image/jpeg",
+    ".jpeg": "image/jpeg",
+    ".gif": "image/gif",
+    ".webp": "image/webp",
+    ".ico": "image/x-icon",
+    ".woff": "font/woff",
+    ".woff2": "font/woff2",
+    ".ttf": "font/ttf",
+    ".eot": "application/vnd.ms-fontobject",
+}
+
+# Formats that are already compressed
+NO_COMPRESS = {".png", ".jpg", ".jpeg", ".gif", ".webp", ".woff", ".woff2"}
+
+
+def brotli_compress(data):
+    """Compress with brotli, or return None when it is not available."""
+    try:
+        import brotli
+        return brotli.compress(data, quality=11)
+    except ImportError:
+        pass
+
+    if shutil.which("brotli"):
+        result = subprocess.run(["brotli", "-c", "-q", "11"], input=data,
+                                stdout=subprocess.PIPE, check=True)
+        return result.stdout
+
+    return None
+
+
+def collect_files(web_root):
+    """Return (url path, file path) pairs for everything under web_root."""
+    files = []
+    for dirpath, _, filenames in os.walk(web_root):
+        for name in filenames:
+            full = os.path.join(dirpath, name)
+            rel = os.path.relpath(full, web_root).replace(os.sep, "/")
+            files.append(("/" + rel, full))
+    files.sort(key=lambda item: item[0].encode("utf-8"))
+    return files
+
+
+def pack(web_root, output):
+    files = collect_files(web_root)
+    if not files:
+        print("No files found in %s" % web_root, file=sys.stderr)
+        return 1
+
+    have_brotli = brotli_compress(b"") is not None
+    if not have_brotli:
+        print("brotli not available, packing gzip variants only")
+
+    data = bytearray()
+    data_start = HEADER.size + ENTRY.size * len(files)
+
+    def add(blob):
+        offset = data_start + len(data)
+        data.extend(blob)
+        return offset, len(blob)
+
+    entries = []
+    original_total = 0
+    for url, path in files:
+        with open(path, "rb") as f:
+            body = f.read()
+        original_total += len(body)
+
+        ext = os.path.splitext(path)[1].lower()
+        content_type = CONTENT_TYPES.get(ext, "application/octet-stream")
+        etag = hashlib.sha256(body).hexdigest()[:32]
+
+        fields = []
+        fields.extend(add(url.encode("utf-8")))
+        fields.extend(add(content_type.encode("ascii")))
+        fields.extend(add(etag.encode("ascii")))
+
+        variants = [add(body)]
+        for compress in (lambda b: gzip.compress(b, compresslevel=9, mtime=0),
+                         brotli_compress if have_brotli else None):
+            blob = compress(body) if compress and ext not in NO_COMPRESS and body else None
+            if blob is not None and len(blob) < len(body) * MIN_SAVING:
+                variants.append(add(blob))
+            else:
+                variants.append((0, 0))
+
+        for offset, length in variants:
+            fields.extend((offset, length))
+        entries.append(ENTRY.pack(*fields))
+
+    tmp = output + ".tmp"
+    with open(tmp, "wb") as f:
+        f.write(HEADER.pack(MAGIC, len(entries), 0))
+        for entry in entries:
+            f.write(entry)
+        f.write(data)
+    os.replace(tmp, output)
+
+    print("Packed %d files (%d bytes) into %s (%d bytes)" %
+          (len(entries), original_total, output, os.path.getsize(output)))
+    return 0
+
+
+def main():
+    script_dir = os.path.dirname(os.path.abspath(__file__))
+    web_root = sys.argv[1] if len(sys.argv) > 1 else os.path.join(script_dir, "..", "web", "dist")
+    web_root = os.path.normpath(web_root)
+    output = sys.argv[2] if len(sys.argv) > 2 else web_root + ".pack"
+
+    if not os.path.isdir(web_root):
+        print("Web root %s does not exist, build the web UI first" % web_root, file=sys.stderr)
+        return 1
+
+    return pack(web_root, output)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
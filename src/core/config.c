@@ -34,12 +34,17 @@ void load_default_config(config_t *config) {
     config->max_storage_size = 0; // 0 means unlimited
     config->retention_days = 30;
     config->auto_delete_oldest = true;
+    config->storage_path_cold[0] = '\0'; // Tiering disabled unless a cold path is set
+    config->tier_after_hours = 24;
+    config->tier_max_rate_mb = 20;
     
     // Models settings
     snprintf(config->models_path, MAX_PATH_LENGTH, "/var/lib/lightnvr/models");
     
     // Database settings
     snprintf(config->db_path, MAX_PATH_LENGTH, "/var/lib/lightnvr/lightnvr.db");
+    config->db_memory_path[0] = '\0'; // Database stays on db_path unless a memory path is set
+    config->db_snapshot_interval = 300;
     
     // Web server settings
     config->web_port = 8080;
@@ -47,6 +52,8 @@ void load_default_config(config_t *config) {
     config->web_auth_enabled = true;
     snprintf(config->web_username, 32, "admin");
     snprintf(config->web_password, 32, "admin"); // Default password, should be changed
+    config->web_event_loops = 1;
+    config->web_asset_pack[0] = '\0';
     
     // Web optimization settings
     config->web_compression_enabled = true;
@@ -148,6 +155,14 @@ static int ensure_directories(const config_t *config) {
         log_info("Created HLS storage directory: %s", config->storage_path_hls);
     }
     
+    // Cold storage tier directory if specified
+    if (config->storage_path_cold[0] != '\0') {
+        if (create_directory(config->storage_path_cold) != 0) {
+            log_error("Failed to create cold storage directory: %s", config->storage_path_cold);
+            return -1;
+        }
+    }
+    
     // Models directory
     if (create_directory(config->models_path) != 0) {
         log_error("Failed to create models directory: %s", config->models_path);
@@ -213,6 +228,11 @@ int validate_config(const config_t *config) {
         return -1;
     }
     
+    if (config->db_memory_path[0] != '\0' && config->db_snapshot_interval < 10) {
+        log_error("Invalid database snapshot interval: %d", config->db_snapshot_interval);
+        return -1;
+    }
+    
     if (strlen(config->web_root) == 0) {
         log_error("Web root path is required");
         return -1;
@@ -224,6 +244,11 @@ int validate_config(const config_t *config) {
         return -1;
     }
     
+    if (config->web_event_loops < 1 || config->web_event_loops > 16) {
+        log_error("Invalid web event loops: %d (must be 1-16)", config->web_event_loops);
+        return -1;
+    }
+    
     // Check max streams
     if (config->max_streams <= 0 || config->max_streams > MAX_STREAMS) {
         log_error("Invalid max streams: %d (must be 1-%d)", config->max_streams, MAX_STREAMS);
@@ -271,6 +296,12 @@ static int config_ini_handler(void* user, const char* section, const char* name,
             config->retention_days = atoi(value);
         } else if (strcmp(name, "auto_delete_oldest") == 0) {
             config->auto_delete_oldest = (strcmp(value, "true") == 0 || strcmp(value, "1") == 0);
+        } else if (strcmp(name, "path_cold") == 0) {
+            strncpy(config->storage_path_cold, value, MAX_PATH_LENGTH - 1);
+        } else if (strcmp(name, "tier_after_hours") == 0) {
+            config->tier_after_hours = atoi(value);
+        } else if (strcmp(name, "tier_max_rate_mb") == 0) {
+            config->tier_max_rate_mb = atoi(value);
         }
     }
     // Models settings
@@ -283,6 +314,10 @@ static int config_ini_handler(void* user, const char* section, const char* name,
     else if (strcmp(section, "database") == 0) {
         if (strcmp(name, "path") == 0) {
             strncpy(config->db_path, value, MAX_PATH_LENGTH - 1);
+        } else if (strcmp(name, "memory_path") == 0) {
+            strncpy(config->db_memory_path, value, MAX_PATH_LENGTH - 1);
+        } else if (strcmp(name, "snapshot_interval") == 0) {
+            config->db_snapshot_interval = atoi(value);
         }
     }
     // Web server settings
@@ -297,6 +332,10 @@ static int config_ini_handler(void* user, const char* section, const char* name,
             strncpy(config->web_username, value, 31);
         } else if (strcmp(name, "password") == 0) {
             strncpy(config->web_password, value, 31);
+        } else if (strcmp(name, "event_loops") == 0) {
+            config->web_event_loops = atoi(value);
+        } else if (strcmp(name, "asset_pack") == 0) {
+            strncpy(config->web_asset_pack, value, MAX_PATH_LENGTH - 1);
         }
     }
     // Stream settings
@@ -832,7 +871,15 @@ int save_config(const config_t *config, const char *path) {
     
     fprintf(file, "max_size = %llu  ; 0 means unlimited, otherwise bytes\n", (unsigned long long)config->max_storage_size);
     fprintf(file, "retention_days = %d\n", config->retention_days);
-    fprintf(file, "auto_delete_oldest = %s\n\n", config->auto_delete_oldest ? "true" : "false");
+    fprintf(file, "auto_delete_oldest = %s\n", config->auto_delete_oldest ? "true" : "false");
+    
+    // Write tiering settings if a cold tier is configured
+    if (config->storage_path_cold[0] != '\0') {
+        fprintf(file, "path_cold = %s  ; Slow tier that aged recordings are moved to\n", config->storage_path_cold);
+        fprintf(file, "tier_after_hours = %d\n", config->tier_after_hours);
+        fprintf(file, "tier_max_rate_mb = %d  ; Copy throttle in MB/s, 0 means unlimited\n", config->tier_max_rate_mb);
+    }
+    fprintf(file, "\n");
     
     // Write models settings
     fprintf(file, "[models]\n");
@@ -840,7 +887,12 @@ int save_config(const config_t *config, const char *path) {
     
     // Write database settings
     fprintf(file, "[database]\n");
-    fprintf(file, "path = %s\n\n", config->db_path);
+    fprintf(file, "path = %s\n", config->db_path);
+    if (config->db_memory_path[0] != '\0') {
+        fprintf(file, "memory_path = %s  ; Live database on tmpfs, path receives snapshots\n", config->db_memory_path);
+        fprintf(file, "snapshot_interval = %d\n", config->db_snapshot_interval);
+    }
+    fprintf(file, "\n");
     
     // Write web server settings
     fprintf(file, "[web]\n");
@@ -849,6 +901,10 @@ int save_config(const config_t *config, const char *path) {
     fprintf(file, "auth_enabled = %s\n", config->web_auth_enabled ? "true" : "false");
     fprintf(file, "username = %s\n", config->web_username);
     fprintf(file, "password = %s  ; IMPORTANT: Change this default password!\n", config->web_password);
+    fprintf(file, "event_loops = %d\n", config->web_event_loops);
+    if (config->web_asset_pack[0] != '\0') {
+        fprintf(file, "asset_pack = %s\n", config->web_asset_pack);
+    }
     fprintf(file, "\n");
     
     // Write stream settings
@@ -929,12 +985,21 @@ void print_config(const config_t *config) {
     printf("    Max Storage Size: %llu bytes\n", (unsigned long long)config->max_storage_size);
     printf("    Retention Days: %d\n", config->retention_days);
     printf("    Auto Delete Oldest: %s\n", config->auto_delete_oldest ? "true" : "false");
+    if (config->storage_path_cold[0] != '\0') {
+        printf("    Cold Storage Path: %s\n", config->storage_path_cold);
+        printf("    Tier After: %d hours\n", config->tier_after_hours);
+        printf("    Tier Max Rate: %d MB/s\n", config->tier_max_rate_mb);
+    }
     
     printf("  Models Settings:\n");
     printf("    Models Path: %s\n", config->models_path);
     
     printf("  Database Settings:\n");
     printf("    Database Path: %s\n", config->db_path);
+    if (config->db_memory_path[0] != '\0') {
+        printf("    Database Memory Path: %s\n", config->db_memory_path);
+        printf("    Snapshot Interval: %d seconds\n", config->db_snapshot_interval);
+    }
     
     printf("  Web Server Settings:\n");
     printf("    Web Port: %d\n", config->web_port);
@@ -942,6 +1007,8 @@ void print_config(const config_t *config) {
     printf("    Web Auth Enabled: %s\n", config->web_auth_enabled ? "true" : "false");
     printf("    Web Username: %s\n", config->web_username);
     printf("    Web Password: %s\n", "********");
+    printf("    Web Event Loops: %d\n", config->web_event_loops);
+    printf("    Web Asset Pack: %s\n", config->web_asset_pack[0] != '\0' ? config->web_asset_pack : "(web root + .pack)");
     
     printf("  Stream Settings:\n");
     printf("    Max Streams: %d\n", config->max_streams);
@@ -0,0 +1,177 @@
+/**
+ * @file log_ring.c
+ * @brief In-memory ring of recent log entries
+ *
+ * The logger appends every message it writes here as well as to the log
+ * files. Each entry gets the next sequence number, so the logs API and its
+ * WebSocket topic can ask for "everything after N" without reading the log
+ * file back and parsing it on every poll.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
+
+#include "core/log_ring.h"
+
+// Level names used by the logs API
+static const char *log_ring_level_names[] = {
+    "error",
+    "warning",
+    "info",
+    "debug"
+};
+
+// Ring state
+static struct {
+    log_ring_entry_t entries[LOG_RING_CAPACITY];
+    uint64_t next_seq;
+    uint64_t oldest_seq;            // Oldest entry still in the ring
+    pthread_mutex_t mutex;
+} log_ring = {
+    .next_seq = 1,
+    .oldest_seq = 1,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * @brief Append a log entry, overwriting the oldest when the ring is full
+ */
+uint64_t log_ring_append(log_level_t level, const char *timestamp, const char *message) {
+    pthread_mutex_lock(&log_ring.mutex);
+
+    uint64_t seq = log_ring.next_seq++;
+    log_ring_entry_t *entry = &log_ring.entries[seq % LOG_RING_CAPACITY];
+    entry->seq = seq;
+    entry->level = level;
+    snprintf(entry->timestamp, sizeof(entry->timestamp), "%s", timestamp ? timestamp : "");
+    snprintf(entry->message, sizeof(entry->message), "%s", message ? message : "");
+
+    if (log_ring.next_seq - log_ring.oldest_seq > LOG_RING_CAPACITY) {
+        log_ring.oldest_seq = log_ring.next_seq - LOG_RING_CAPACITY;
+    }
+
+    pthread_mutex_unlock(&log_ring.mutex);
+
+    return seq;
+}
+
+/**
+ * @brief Read entries at or above a level
+ */
+int log_ring_read(uint64_t since, log_level_t min_level, log_ring_entry_t *entries,
+                  int max_entries, uint64_t *last_seq, bool *more) {
+    int count = 0;
+    bool truncated = false;
+
+    pthread_mutex_lock(&log_ring.mutex);
+
+    uint64_t newest = log_ring.next_seq - 1;
+    uint64_t resume = newest;
+
+    // Sequence numbers restart with the process
+    if (since > newest) {
+        since = 0;
+    }
+
+    if (since == 0) {
+        // Newest entries, collected backwards then put back in order
+        for (uint64_t seq = newest; seq >= log_ring.oldest_seq && seq > 0; seq--) {
+            const log_ring_entry_t *entry = &log_ring.entries[seq % LOG_RING_CAPACITY];
+            if (entry->level > min_level) {
+                continue;
+            }
+            if (count == max_entries) {
+                truncated = true;
+                break;
+            }
+            entries[count++] = *entry;
+        }
+
+        for (int i = 0, j = count - 1; i < j; i++, j--) {
+            log_ring_entry_t swap = entries[i];
+            entries[i] = entries[j];
+            entries[j] = swap;
+        }
+    } else {
+        // Entries that already left the ring are gone, start at the oldest
+        uint64_t start = since + 1 > log_ring.oldest_seq ? since + 1 : log_ring.oldest_seq;
+
+        for (uint64_t seq = start; seq <= newest; seq++) {
+            const log_ring_entry_t *entry = &log_ring.entries[seq % LOG_RING_CAPACITY];
+            if (entry->level > min_level) {
+                continue;
+            }
+            if (count == max_entries) {
+                // Resume right after the last entry handed out
+                resume = seq - 1;
+                truncated = true;
+                break;
+            }
+            entries[count++] = *entry;
+        }
+    }
+
+    pthread_mutex_unlock(&log_ring.mutex);
+
+    if (last_seq) {
+        *last_seq = resume;
+    }
+    if (more) {
+        *more = truncated;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Get the sequence number of the newest entry
+ */
+uint64_t log_ring_last_seq(void) {
+    pthread_mutex_lock(&log_ring.mutex);
+    uint64_t seq = log_ring.next_seq - 1;
+    pthread_mutex_unlock(&log_ring.mutex);
+
+    return seq;
+}
+
+/**
+ * @brief Drop every entry, keeping the sequence numbers monotonic
+ */
+void log_ring_clear(void) {
+    pthread_mutex_lock(&log_ring.mutex);
+    log_ring.oldest_seq = log_ring.next_seq;
+    pthread_mutex_unlock(&log_ring.mutex);
+}
+
+/**
+ * @brief Parse a level name as used by the logs API
+ */
+log_level_t log_ring_parse_level(const char *name, log_level_t fallback) {
+    if (!name) {
+        return fallback;
+    }
+
+    if (strcasecmp(name, "warn") == 0) {
+        return LOG_LEVEL_WARN;
+    }
+
+    for (int i = LOG_LEVEL_ERROR; i <= LOG_LEVEL_DEBUG; i++) {
+        if (strcasecmp(name, log_ring_level_names[i]) == 0) {
+            return (log_level_t)i;
+        }
+    }
+
+    return fallback;
+}
+
+/**
+ * @brief Get the name of a level as used by the logs API
+ */
+const char *log_ring_level_name(log_level_t level) {
+    if (level >= LOG_LEVEL_ERROR && level <= LOG_LEVEL_DEBUG) {
+        return log_ring_level_names[level];
+    }
+    return "info";
+}
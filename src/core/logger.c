@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <time.h>
 #include <pthread.h>
 #include <unistd.h>
@@ -280,7 +281,13 @@ void log_message_v(log_level_t level, const char *format, va_list args) {
     fflush(console);
     
     pthread_mutex_unlock(&logger.mutex);
-    
+
+    // Keep the entry in memory for the logs API if the ring is linked
+    extern __attribute__((weak)) uint64_t log_ring_append(log_level_t level, const char *timestamp, const char *message);
+    if (log_ring_append) {
+        log_ring_append(level, iso_timestamp, message);
+    }
+
     // Write to JSON log file if the function is available
     // This is a weak symbol that can be overridden by the actual implementation
     // If the JSON logger is not linked, this will be a no-op
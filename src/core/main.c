@@ -22,6 +22,7 @@
 #include "video/stream_state.h"
 #include "video/stream_state_adapter.h"
 #include "storage/storage_manager.h"
+#include "storage/storage_tiering.h"
 #include "video/streams.h"
 #include "video/hls_streaming.h"
 #include "video/mp4_recording.h"
@@ -677,6 +678,15 @@ int main(int argc, char *argv[]) {
         log_error("Failed to initialize storage manager");
         goto cleanup;
     }
+    
+    // Start moving aged recordings to the cold tier if one is configured
+    if (config.storage_path_cold[0] != '\0') {
+        if (start_storage_tiering(config.storage_path, config.storage_path_cold,
+                                  config.tier_after_hours,
+                                  (uint64_t)config.tier_max_rate_mb * 1024 * 1024) != 0) {
+            log_warn("Failed to start storage tiering, recordings will stay on the primary storage path");
+        }
+    }
 
     // Initialize stream state manager
     if (init_stream_state_manager(config.max_streams) != 0) {
@@ -919,6 +929,7 @@ int main(int argc, char *argv[]) {
         .max_connections = 100,
         .connection_timeout = 30,
         .daemon_mode = daemon_mode,
+        .event_loops = config.web_event_loops,
     };
     
     // Set CORS allowed origins, methods, and headers
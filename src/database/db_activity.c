@@ -0,0 +1,232 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+
+#include "database/db_activity.h"
+#include "database/db_core.h"
+#include "database/db_stmt_cache.h"
+#include "core/logger.h"
+#include "video/detection_result.h"
+
+// Rollup tables by bucket size
+static const struct {
+    int bucket_seconds;
+    const char *update_sql;
+    const char *insert_sql;
+} rollups[] = {
+    {
+        ACTIVITY_BUCKET_MINUTE,
+        "UPDATE detection_activity_minute SET count = count + ?, "
+        "max_confidence = MAX(max_confidence, ?) "
+        "WHERE stream_id = ? AND bucket = ? AND label_id = ?;",
+        "INSERT INTO detection_activity_minute (count, max_confidence, stream_id, bucket, label_id) "
+        "VALUES (?, ?, ?, ?, ?);"
+    },
+    {
+        ACTIVITY_BUCKET_HOUR,
+        "UPDATE detection_activity_hour SET count = count + ?, "
+        "max_confidence = MAX(max_confidence, ?) "
+        "WHERE stream_id = ? AND bucket = ? AND label_id = ?;",
+        "INSERT INTO detection_activity_hour (count, max_confidence, stream_id, bucket, label_id) "
+        "VALUES (?, ?, ?, ?, ?);"
+    }
+};
+
+// Add to one bucket, creating it if needed (caller holds the database mutex)
+static int add_to_bucket_locked(sqlite3 *db, const char *sql, const char *fallback_sql,
+                                int stream_id, time_t bucket, int label_id,
+                                int count, int max_confidence) {
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int(stmt, 1, count);
+    sqlite3_bind_int(stmt, 2, max_confidence);
+    sqlite3_bind_int(stmt, 3, stream_id);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)bucket);
+    sqlite3_bind_int(stmt, 5, label_id);
+
+    int rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to update detection activity: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    // First detection of this label in the bucket
+    if (sqlite3_changes(db) == 0 && fallback_sql) {
+        return add_to_bucket_locked(db, fallback_sql, NULL, stream_id, bucket, label_id,
+                                    count, max_confidence);
+    }
+
+    return 0;
+}
+
+// Add one frame of detections to the minute and hour activity rollups
+int record_detection_activity_locked(sqlite3 *db, int stream_id, time_t timestamp,
+                                     const int *label_ids, const uint16_t *confidences, int count) {
+    if (!db || !label_ids || !confidences || count <= 0) {
+        return -1;
+    }
+
+    // Combine detections of the same label first, a frame often has several
+    int labels[MAX_DETECTIONS];
+    int label_counts[MAX_DETECTIONS];
+    int label_max[MAX_DETECTIONS];
+    int label_total = 0;
+
+    for (int i = 0; i < count && i < MAX_DETECTIONS; i++) {
+        int j;
+        for (j = 0; j < label_total; j++) {
+            if (labels[j] == label_ids[i]) {
+                break;
+            }
+        }
+
+        if (j == label_total) {
+            labels[j] = label_ids[i];
+            label_counts[j] = 0;
+            label_max[j] = 0;
+            label_total++;
+        }
+
+        label_counts[j]++;
+        if (confidences[i] > label_max[j]) {
+            label_max[j] = confidences[i];
+        }
+    }
+
+    for (size_t r = 0; r < sizeof(rollups) / sizeof(rollups[0]); r++) {
+        time_t bucket = timestamp - (timestamp % rollups[r].bucket_seconds);
+
+        for (int j = 0; j < label_total; j++) {
+            if (add_to_bucket_locked(db, rollups[r].update_sql, rollups[r].insert_sql,
+                                     stream_id, bucket, labels[j],
+                                     label_counts[j], label_max[j]) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+// Get detection activity per bucket
+int get_detection_activity(const char *stream_name, time_t start_time, time_t end_time,
+                           int bucket_seconds, detection_activity_t *activity, int max_count) {
+    sqlite3 *db = get_db_handle();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    if (!activity || max_count <= 0) {
+        log_error("Invalid parameters for get_detection_activity");
+        return -1;
+    }
+
+    const char *table = bucket_seconds == ACTIVITY_BUCKET_MINUTE ?
+                        "detection_activity_minute" : "detection_activity_hour";
+    bucket_seconds = bucket_seconds == ACTIVITY_BUCKET_MINUTE ?
+                     ACTIVITY_BUCKET_MINUTE : ACTIVITY_BUCKET_HOUR;
+
+    // Include the bucket the range starts in
+    time_t first_bucket = start_time - (start_time % bucket_seconds);
+
+    char sql[512];
+    snprintf(sql, sizeof(sql),
+            "SELECT a.bucket, s.name, l.name, a.count, a.max_confidence "
+            "FROM %s a "
+            "JOIN detection_streams s ON s.id = a.stream_id "
+            "JOIN detection_labels l ON l.id = a.label_id "
+            "WHERE a.bucket >= ? AND a.bucket <= ?%s "
+            "ORDER BY a.bucket, s.name, l.name "
+            "LIMIT ?;",
+            table,
+            stream_name ? " AND a.stream_id = (SELECT id FROM detection_streams WHERE name = ?)" : "");
+
+    db = db_acquire_reader();
+
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+
+    // Bind parameters
+    int param_index = 1;
+    sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)first_bucket);
+    sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)end_time);
+    if (stream_name) {
+        sqlite3_bind_text(stmt, param_index++, stream_name, -1, SQLITE_TRANSIENT);
+    }
+    sqlite3_bind_int(stmt, param_index, max_count);
+
+    int count = 0;
+    int rc = SQLITE_DONE;
+    while (count < max_count && (rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        detection_activity_t *entry = &activity[count];
+        memset(entry, 0, sizeof(*entry));
+
+        entry->bucket = (time_t)sqlite3_column_int64(stmt, 0);
+
+        const char *stream = (const char *)sqlite3_column_text(stmt, 1);
+        if (stream) {
+            strncpy(entry->stream_name, stream, sizeof(entry->stream_name) - 1);
+        }
+
+        const char *label = (const char *)sqlite3_column_text(stmt, 2);
+        if (label) {
+            strncpy(entry->label, label, sizeof(entry->label) - 1);
+        }
+
+        entry->count = sqlite3_column_int(stmt, 3);
+        entry->max_confidence = (float)sqlite3_column_int(stmt, 4) / 65535.0f;
+
+        count++;
+    }
+
+    if (count < max_count && rc != SQLITE_DONE) {
+        log_error("Error while reading detection activity: %s", sqlite3_errmsg(db));
+    }
+
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
+
+    return count;
+}
+
+// Delete minute activity buckets older than a cutoff
+int delete_old_detection_activity_locked(sqlite3 *db, time_t cutoff_time) {
+    const char *sql = "DELETE FROM detection_activity_minute WHERE bucket < ?;";
+
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
+
+    int rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to delete old detection activity: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    return sqlite3_changes(db);
+}
@@ -12,9 +12,11 @@
 #include <stddef.h>
 #include <unistd.h>
 #include <sys/time.h>
+#include <pthread.h>
 
 #include "database/db_auth.h"
 #include "database/db_core.h"
+#include "database/db_stmt_cache.h"
 #include "core/logger.h"
 #include "core/config.h"
 
@@ -32,6 +34,43 @@
 // Default session expiry time (24 hours)
 #define DEFAULT_SESSION_EXPIRY 86400
 
+// Validated credentials remembered in memory, so authenticated requests
+// skip the database lookup and the PBKDF2 hash
+#define AUTH_CACHE_SIZE 64
+#define AUTH_CACHE_SESSION_TTL 60       // Sessions are rechecked against the database this often
+#define AUTH_CACHE_PASSWORD_TTL 300     // Passwords are rehashed this often
+#define AUTH_CACHE_KEY_LENGTH 32
+
+// Kinds of cached credentials
+typedef enum {
+    AUTH_CACHE_SESSION = 'S',
+    AUTH_CACHE_PASSWORD = 'P'
+} auth_cache_kind_t;
+
+// Cached credential, identified by a keyed hash so the cache never holds
+// tokens or passwords
+typedef struct {
+    bool valid;
+    unsigned char key[SHA256_DIGEST_LENGTH];
+    int64_t user_id;
+    time_t expires_at;
+    uint64_t last_used;
+} auth_cache_entry_t;
+
+static struct {
+    auth_cache_entry_t entries[AUTH_CACHE_SIZE];
+    unsigned char hmac_key[AUTH_CACHE_KEY_LENGTH];
+    bool hmac_key_ready;
+    uint64_t generation;                // Bumped by every invalidation
+    uint64_t tick;
+    pthread_mutex_t mutex;
+} auth_cache = {
+    .hmac_key_ready = false,
+    .generation = 0,
+    .tick = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
 // Role names
 static const char *role_names[] = {
     "admin",
@@ -181,6 +220,176 @@ static int hex_to_bin(const char *hex, unsigned char *data, size_t data_length)
     return 0;
 }
 
+/**
+ * Compute the cache key of a credential
+ * 
+ * HMAC-SHA256 with a random per-process key, so a leaked cache entry
+ * cannot be checked against guessed tokens or passwords.
+ * 
+ * @param kind Kind of credential
+ * @param name Username, or NULL for sessions
+ * @param secret Session token or password
+ * @param key Buffer to store the cache key
+ * @return 0 on success, non-zero on failure
+ */
+static int auth_cache_key(auth_cache_kind_t kind, const char *name, const char *secret,
+                          unsigned char *key) {
+    pthread_mutex_lock(&auth_cache.mutex);
+    if (!auth_cache.hmac_key_ready) {
+        char random_key[AUTH_CACHE_KEY_LENGTH + 1];
+        if (generate_random_string(random_key, AUTH_CACHE_KEY_LENGTH) != 0) {
+            pthread_mutex_unlock(&auth_cache.mutex);
+            return -1;
+        }
+        memcpy(auth_cache.hmac_key, random_key, AUTH_CACHE_KEY_LENGTH);
+        auth_cache.hmac_key_ready = true;
+    }
+    pthread_mutex_unlock(&auth_cache.mutex);
+    
+    const mbedtls_md_info_t *md_info = mbedtls_md_info_from_type(MBEDTLS_MD_SHA256);
+    if (md_info == NULL) {
+        return -1;
+    }
+    
+    mbedtls_md_context_t ctx;
+    mbedtls_md_init(&ctx);
+    
+    unsigned char kind_byte = (unsigned char)kind;
+    unsigned char separator = 0;
+    int rc = mbedtls_md_setup(&ctx, md_info, 1);
+    if (rc == 0) {
+        rc = mbedtls_md_hmac_starts(&ctx, auth_cache.hmac_key, AUTH_CACHE_KEY_LENGTH);
+    }
+    if (rc == 0) {
+        rc = mbedtls_md_hmac_update(&ctx, &kind_byte, 1);
+    }
+    if (rc == 0 && name) {
+        rc = mbedtls_md_hmac_update(&ctx, (const unsigned char *)name, strlen(name));
+    }
+    if (rc == 0) {
+        rc = mbedtls_md_hmac_update(&ctx, &separator, 1);
+    }
+    if (rc == 0) {
+        rc = mbedtls_md_hmac_update(&ctx, (const unsigned char *)secret, strlen(secret));
+    }
+    if (rc == 0) {
+        rc = mbedtls_md_hmac_finish(&ctx, key);
+    }
+    
+    mbedtls_md_free(&ctx);
+    return rc == 0 ? 0 : -1;
+}
+
+/**
+ * Look up a credential in the cache
+ * 
+ * @param key Cache key
+ * @param user_id Pointer to store the user ID
+ * @param generation Pointer to store the cache generation, for a later store
+ * @return true if the credential is cached and not expired
+ */
+static bool auth_cache_lookup(const unsigned char *key, int64_t *user_id, uint64_t *generation) {
+    time_t now = time(NULL);
+    bool found = false;
+    
+    pthread_mutex_lock(&auth_cache.mutex);
+    
+    *generation = auth_cache.generation;
+    
+    for (int i = 0; i < AUTH_CACHE_SIZE; i++) {
+        auth_cache_entry_t *entry = &auth_cache.entries[i];
+        if (entry->valid && memcmp(entry->key, key, SHA256_DIGEST_LENGTH) == 0) {
+            if (now >= entry->expires_at) {
+                entry->valid = false;
+                break;
+            }
+            entry->last_used = ++auth_cache.tick;
+            if (user_id) {
+                *user_id = entry->user_id;
+            }
+            found = true;
+            break;
+        }
+    }
+    
+    pthread_mutex_unlock(&auth_cache.mutex);
+    
+    return found;
+}
+
+/**
+ * Remember a validated credential
+ * 
+ * Nothing is stored if the cache was invalidated since the lookup, so a
+ * validation that raced a logout cannot bring the session back.
+ * 
+ * @param key Cache key
+ * @param user_id User the credential belongs to
+ * @param expires_at Time the entry expires
+ * @param generation Cache generation returned by the lookup
+ */
+static void auth_cache_store(const unsigned char *key, int64_t user_id, time_t expires_at,
+                             uint64_t generation) {
+    pthread_mutex_lock(&auth_cache.mutex);
+    
+    if (generation != auth_cache.generation) {
+        pthread_mutex_unlock(&auth_cache.mutex);
+        return;
+    }
+    
+    // Pick a free slot, otherwise evict the least recently used entry
+    auth_cache_entry_t *slot = &auth_cache.entries[0];
+    for (int i = 0; i < AUTH_CACHE_SIZE; i++) {
+        auth_cache_entry_t *entry = &auth_cache.entries[i];
+        if (!entry->valid) {
+            slot = entry;
+            break;
+        }
+        if (entry->last_used < slot->last_used) {
+            slot = entry;
+        }
+    }
+    
+    memcpy(slot->key, key, SHA256_DIGEST_LENGTH);
+    slot->user_id = user_id;
+    slot->expires_at = expires_at;
+    slot->last_used = ++auth_cache.tick;
+    slot->valid = true;
+    
+    pthread_mutex_unlock(&auth_cache.mutex);
+}
+
+/**
+ * Drop cached credentials
+ * 
+ * @param key Cache key to drop, or NULL to match by user
+ * @param user_id User whose credentials to drop, or -1 for all users
+ */
+static void auth_cache_invalidate(const unsigned char *key, int64_t user_id) {
+    pthread_mutex_lock(&auth_cache.mutex);
+    
+    for (int i = 0; i < AUTH_CACHE_SIZE; i++) {
+        auth_cache_entry_t *entry = &auth_cache.entries[i];
+        if (!entry->valid) {
+            continue;
+        }
+        if (key ? memcmp(entry->key, key, SHA256_DIGEST_LENGTH) == 0 :
+                  (user_id < 0 || entry->user_id == user_id)) {
+            entry->valid = false;
+        }
+    }
+    auth_cache.generation++;
+    
+    pthread_mutex_unlock(&auth_cache.mutex);
+}
+
+/**
+ * Drop all cached sessions and credentials
+ */
+void db_auth_cache_clear(void) {
+    auth_cache_invalidate(NULL, -1);
+}
+
 /**
  * Initialize the authentication system
  */
@@ -429,6 +638,9 @@ int db_auth_update_user(int64_t user_id, const char *email, int role, int is_act
     
     sqlite3_finalize(stmt);
     
+    // Role or active state may have changed
+    auth_cache_invalidate(NULL, user_id);
+    
     log_info("User updated successfully: %lld", (long long)user_id);
     return 0;
 }
@@ -543,6 +755,9 @@ int db_auth_change_password(int64_t user_id, const char *new_password) {
     
     sqlite3_finalize(stmt);
     
+    // The old password must stop working immediately
+    auth_cache_invalidate(NULL, user_id);
+    
     log_info("Password changed successfully for user: %lld", (long long)user_id);
     return 0;
 }
@@ -593,6 +808,8 @@ int db_auth_delete_user(int64_t user_id) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate(NULL, user_id);
+    
     log_info("User deleted successfully: %lld", (long long)user_id);
     return 0;
 }
@@ -749,14 +966,14 @@ int db_auth_get_user_by_api_key(const char *api_key, user_t *user) {
     }
     
     // Query the user
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db,
-                               "SELECT id, username, email, role, api_key, created_at, "
-                               "updated_at, last_login, is_active "
-                               "FROM users WHERE api_key = ?;",
-                               -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    db = db_acquire_reader();
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db,
+                                               "SELECT id, username, email, role, api_key, created_at, "
+                                               "updated_at, last_login, is_active "
+                                               "FROM users WHERE api_key = ?;");
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
         return -1;
     }
     
@@ -764,7 +981,8 @@ int db_auth_get_user_by_api_key(const char *api_key, user_t *user) {
     
     if (sqlite3_step(stmt) != SQLITE_ROW) {
         log_debug("User not found for API key");
-        sqlite3_finalize(stmt);
+        db_stmt_cache_release(stmt);
+        db_release_reader(db);
         return -1;
     }
     
@@ -796,7 +1014,8 @@ int db_auth_get_user_by_api_key(const char *api_key, user_t *user) {
     user->last_login = sqlite3_column_int64(stmt, 7);
     user->is_active = sqlite3_column_int(stmt, 8) != 0;
     
-    sqlite3_finalize(stmt);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
     
     return 0;
 }
@@ -882,6 +1101,14 @@ int db_auth_authenticate(const char *username, const char *password, int64_t *us
         return -1;
     }
     
+    // Credentials verified recently skip the lookup and the PBKDF2 hash
+    unsigned char cache_key[SHA256_DIGEST_LENGTH];
+    bool cacheable = auth_cache_key(AUTH_CACHE_PASSWORD, username, password, cache_key) == 0;
+    uint64_t cache_generation = 0;
+    if (cacheable && auth_cache_lookup(cache_key, user_id, &cache_generation)) {
+        return 0;
+    }
+    
     // Query the user
     sqlite3_stmt *stmt;
     int rc = sqlite3_prepare_v2(db,
@@ -955,6 +1182,10 @@ int db_auth_authenticate(const char *username, const char *password, int64_t *us
         *user_id = id;
     }
     
+    if (cacheable) {
+        auth_cache_store(cache_key, id, time(NULL) + AUTH_CACHE_PASSWORD_TTL, cache_generation);
+    }
+    
     // Update last login time
     sqlite3_finalize(stmt);
     
@@ -1074,16 +1305,24 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
         return -1;
     }
     
+    // Recently validated sessions are answered from memory
+    unsigned char cache_key[SHA256_DIGEST_LENGTH];
+    bool cacheable = auth_cache_key(AUTH_CACHE_SESSION, NULL, token, cache_key) == 0;
+    uint64_t cache_generation = 0;
+    if (cacheable && auth_cache_lookup(cache_key, user_id, &cache_generation)) {
+        return 0;
+    }
+    
     // Query the session
-    sqlite3_stmt *stmt;
-    int rc = sqlite3_prepare_v2(db,
-                               "SELECT s.id, s.user_id, s.expires_at, u.is_active "
-                               "FROM sessions s "
-                               "JOIN users u ON s.user_id = u.id "
-                               "WHERE s.token = ?;",
-                               -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    db = db_acquire_reader();
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db,
+                                               "SELECT s.id, s.user_id, s.expires_at, u.is_active "
+                                               "FROM sessions s "
+                                               "JOIN users u ON s.user_id = u.id "
+                                               "WHERE s.token = ?;");
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
         return -1;
     }
     
@@ -1091,7 +1330,8 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
     
     if (sqlite3_step(stmt) != SQLITE_ROW) {
         log_debug("Session not found for token");
-        sqlite3_finalize(stmt);
+        db_stmt_cache_release(stmt);
+        db_release_reader(db);
         return -1;
     }
     
@@ -1101,7 +1341,8 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
     
     if (now > expires_at) {
         log_debug("Session has expired");
-        sqlite3_finalize(stmt);
+        db_stmt_cache_release(stmt);
+        db_release_reader(db);
         return -1;
     }
     
@@ -1109,7 +1350,8 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
     int is_active = sqlite3_column_int(stmt, 3);
     if (!is_active) {
         log_debug("User is inactive");
-        sqlite3_finalize(stmt);
+        db_stmt_cache_release(stmt);
+        db_release_reader(db);
         return -1;
     }
     
@@ -1119,7 +1361,14 @@ int db_auth_validate_session(const char *token, int64_t *user_id) {
         *user_id = id;
     }
     
-    sqlite3_finalize(stmt);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
+    
+    if (cacheable) {
+        time_t cache_expiry = now + AUTH_CACHE_SESSION_TTL;
+        auth_cache_store(cache_key, id, cache_expiry < expires_at ? cache_expiry : expires_at,
+                         cache_generation);
+    }
     
     return 0;
 }
@@ -1158,6 +1407,13 @@ int db_auth_delete_session(const char *token) {
     
     sqlite3_finalize(stmt);
     
+    unsigned char cache_key[SHA256_DIGEST_LENGTH];
+    if (auth_cache_key(AUTH_CACHE_SESSION, NULL, token, cache_key) == 0) {
+        auth_cache_invalidate(cache_key, -1);
+    } else {
+        db_auth_cache_clear();
+    }
+    
     log_info("Session deleted successfully");
     return 0;
 }
@@ -1191,6 +1447,8 @@ int db_auth_delete_user_sessions(int64_t user_id) {
     
     sqlite3_finalize(stmt);
     
+    auth_cache_invalidate(NULL, user_id);
+    
     log_info("Sessions deleted successfully for user: %lld", (long long)user_id);
     return 0;
 }
@@ -14,46 +14,127 @@
 #include <errno.h>
 #include <stdbool.h>
 #include <fcntl.h>
+#include <stdint.h>
 
 #include "database/db_core.h"
 #include "database/db_backup.h"
+#include "database/db_stmt_cache.h"
 #include "core/logger.h"
 
-// Flag to indicate if a backup is in progress
-static bool backup_in_progress = false;
+// Backup state, shared by blocking and background backups
+static struct {
+    bool in_progress;
+    bool cancel;                    // Set to abandon a background backup
+    bool thread_active;             // A background backup thread needs joining
+    pthread_t thread;
+    char source_path[1024];
+    char dest_path[1024];
+    db_backup_progress_t progress;
+    db_backup_progress_cb callback;
+    void *callback_data;
+    pthread_mutex_t mutex;
+} backup_state = {
+    .in_progress = false,
+    .cancel = false,
+    .thread_active = false,
+    .callback = NULL,
+    .callback_data = NULL,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
 
-// Backup the database to a specified path
-int backup_database(const char *source_path, const char *dest_path) {
+// Milliseconds on the monotonic clock
+static uint64_t monotonic_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// Claim the backup slot, returns false if a backup is already running
+static bool begin_backup(const char *dest_path) {
+    pthread_mutex_lock(&backup_state.mutex);
+    
+    if (backup_state.in_progress) {
+        pthread_mutex_unlock(&backup_state.mutex);
+        return false;
+    }
+    
+    backup_state.in_progress = true;
+    backup_state.cancel = false;
+    memset(&backup_state.progress, 0, sizeof(backup_state.progress));
+    backup_state.progress.in_progress = true;
+    backup_state.progress.started_at = time(NULL);
+    strncpy(backup_state.progress.dest_path, dest_path, sizeof(backup_state.progress.dest_path) - 1);
+    
+    pthread_mutex_unlock(&backup_state.mutex);
+    return true;
+}
+
+// Update progress and notify the listener
+static void report_backup_progress(int remaining, int total, int restarts, bool done, int result) {
+    pthread_mutex_lock(&backup_state.mutex);
+    
+    backup_state.progress.pages_remaining = remaining;
+    backup_state.progress.pages_total = total;
+    backup_state.progress.restarts = restarts;
+    if (done) {
+        backup_state.progress.in_progress = false;
+        backup_state.progress.result = result;
+        backup_state.progress.finished_at = time(NULL);
+        backup_state.in_progress = false;
+    }
+    
+    db_backup_progress_t progress = backup_state.progress;
+    db_backup_progress_cb callback = backup_state.callback;
+    void *callback_data = backup_state.callback_data;
+    
+    pthread_mutex_unlock(&backup_state.mutex);
+    
+    if (callback) {
+        callback(&progress, callback_data);
+    }
+}
+
+// Mark the backup finished and notify the listener
+static void finish_backup(int result) {
+    pthread_mutex_lock(&backup_state.mutex);
+    int total = backup_state.progress.pages_total;
+    int restarts = backup_state.progress.restarts;
+    pthread_mutex_unlock(&backup_state.mutex);
+    
+    report_backup_progress(0, total, restarts, true, result);
+}
+
+// Copy the database a few pages at a time into dest_path. Only backups
+// holding the backup slot report progress and can be cancelled.
+static int run_backup(const char *source_path, const char *dest_path, int step_sleep_ms, bool in_slot) {
     int rc;
     sqlite3 *source_db = NULL;
     sqlite3 *dest_db = NULL;
     sqlite3_backup *backup = NULL;
     
-    if (backup_in_progress) {
-        log_warn("Backup already in progress, skipping");
-        return -1;
-    }
-    
-    backup_in_progress = true;
-    
     log_info("Starting database backup from %s to %s", source_path, dest_path);
     
+    // Write to a temporary file so an interrupted backup never replaces a good one
+    char temp_path[1100];
+    snprintf(temp_path, sizeof(temp_path), "%s.tmp", dest_path);
+    unlink(temp_path);
+    
     // Open the source database
     rc = sqlite3_open_v2(source_path, &source_db, SQLITE_OPEN_READONLY, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to open source database for backup: %s", sqlite3_errmsg(source_db));
         sqlite3_close(source_db);
-        backup_in_progress = false;
         return -1;
     }
     
+    sqlite3_busy_timeout(source_db, 10000);
+    
     // Open the destination database
-    rc = sqlite3_open_v2(dest_path, &dest_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
+    rc = sqlite3_open_v2(temp_path, &dest_db, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to open destination database for backup: %s", sqlite3_errmsg(dest_db));
         sqlite3_close(source_db);
         sqlite3_close(dest_db);
-        backup_in_progress = false;
         return -1;
     }
     
@@ -63,28 +144,90 @@ int backup_database(const char *source_path, const char *dest_path) {
         log_error("Failed to initialize backup: %s", sqlite3_errmsg(dest_db));
         sqlite3_close(source_db);
         sqlite3_close(dest_db);
-        backup_in_progress = false;
+        unlink(temp_path);
         return -1;
     }
     
-    // Perform the backup
-    rc = sqlite3_backup_step(backup, -1);
-    if (rc != SQLITE_DONE) {
-        log_error("Failed to perform backup: %s", sqlite3_errmsg(dest_db));
-        sqlite3_backup_finish(backup);
-        sqlite3_close(source_db);
-        sqlite3_close(dest_db);
-        backup_in_progress = false;
-        return -1;
+    // Copy a few pages per step. The source read lock is only held during a
+    // step, and a write to the source between steps makes SQLite restart the
+    // copy from the first page on the next step.
+    int restarts = 0;
+    int step_pages = DB_BACKUP_STEP_PAGES;
+    int last_remaining = -1;
+    uint64_t last_report = 0;
+    
+    while (true) {
+        rc = sqlite3_backup_step(backup, step_pages);
+        
+        int remaining = sqlite3_backup_remaining(backup);
+        int total = sqlite3_backup_pagecount(backup);
+        
+        if (rc == SQLITE_OK && last_remaining >= 0 && remaining > last_remaining) {
+            restarts++;
+            log_debug("Database changed during backup, restarted copy (%d restarts)", restarts);
+            
+            // A busy database would restart the copy forever; in WAL mode a
+            // single step only holds a read transaction, which does not block
+            // the writer, so finish the copy in one go
+            if (restarts >= DB_BACKUP_MAX_RESTARTS && step_pages > 0) {
+                log_info("Database keeps changing during backup, copying the rest in one step");
+                step_pages = -1;
+            }
+        }
+        last_remaining = remaining;
+        
+        if (rc == SQLITE_DONE) {
+            break;
+        }
+        
+        if (rc != SQLITE_OK && rc != SQLITE_BUSY && rc != SQLITE_LOCKED) {
+            log_error("Failed to perform backup: %s", sqlite3_errmsg(dest_db));
+            sqlite3_backup_finish(backup);
+            sqlite3_close(source_db);
+            sqlite3_close(dest_db);
+            unlink(temp_path);
+            return -1;
+        }
+        
+        bool cancel = false;
+        if (in_slot) {
+            pthread_mutex_lock(&backup_state.mutex);
+            cancel = backup_state.cancel;
+            pthread_mutex_unlock(&backup_state.mutex);
+        }
+        
+        if (cancel) {
+            log_info("Database backup cancelled");
+            sqlite3_backup_finish(backup);
+            sqlite3_close(source_db);
+            sqlite3_close(dest_db);
+            unlink(temp_path);
+            return -1;
+        }
+        
+        uint64_t now = monotonic_ms();
+        if (in_slot && now - last_report >= DB_BACKUP_PROGRESS_INTERVAL_MS) {
+            report_backup_progress(remaining, total, restarts, false, 0);
+            last_report = now;
+        }
+        
+        if (step_sleep_ms > 0) {
+            usleep(step_sleep_ms * 1000);
+        } else if (rc != SQLITE_OK) {
+            // Busy, give the other connection a moment
+            usleep(10000);
+        }
     }
     
+    int total = sqlite3_backup_pagecount(backup);
+    
     // Finish the backup
     rc = sqlite3_backup_finish(backup);
     if (rc != SQLITE_OK) {
         log_error("Failed to finish backup: %s", sqlite3_errmsg(dest_db));
         sqlite3_close(source_db);
         sqlite3_close(dest_db);
-        backup_in_progress = false;
+        unlink(temp_path);
         return -1;
     }
     
@@ -92,11 +235,127 @@ int backup_database(const char *source_path, const char *dest_path) {
     sqlite3_close(source_db);
     sqlite3_close(dest_db);
     
-    log_info("Database backup completed successfully");
-    backup_in_progress = false;
+    if (rename(temp_path, dest_path) != 0) {
+        log_error("Failed to move backup into place: %s", strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+    
+    log_info("Database backup completed successfully (%d pages, %d restarts)", total, restarts);
+    return 0;
+}
+
+// Backup the database to a specified path
+int backup_database(const char *source_path, const char *dest_path) {
+    if (!source_path || !dest_path) {
+        return -1;
+    }
+    
+    if (!begin_backup(dest_path)) {
+        log_warn("Backup already in progress, skipping");
+        return -1;
+    }
+    
+    int result = run_backup(source_path, dest_path, 0, true);
+    finish_backup(result);
+    
+    return result;
+}
+
+// Copy the database without claiming the backup slot
+int snapshot_database(const char *source_path, const char *dest_path) {
+    if (!source_path || !dest_path) {
+        return -1;
+    }
+    
+    return run_backup(source_path, dest_path, 0, false);
+}
+
+// Background backup thread
+static void *backup_thread_func(void *arg) {
+    (void)arg;
+    
+    int result = run_backup(backup_state.source_path, backup_state.dest_path, DB_BACKUP_STEP_SLEEP_MS, true);
+    finish_backup(result);
+    
+    return NULL;
+}
+
+// Start a backup of the database on a background thread
+int backup_database_async(const char *source_path, const char *dest_path) {
+    if (!source_path || !dest_path) {
+        return -1;
+    }
+    
+    if (!begin_backup(dest_path)) {
+        log_warn("Backup already in progress, skipping");
+        return 1;
+    }
+    
+    pthread_mutex_lock(&backup_state.mutex);
+    
+    // Reap the thread of the previous background backup
+    if (backup_state.thread_active) {
+        pthread_join(backup_state.thread, NULL);
+        backup_state.thread_active = false;
+    }
+    
+    strncpy(backup_state.source_path, source_path, sizeof(backup_state.source_path) - 1);
+    backup_state.source_path[sizeof(backup_state.source_path) - 1] = '\0';
+    strncpy(backup_state.dest_path, dest_path, sizeof(backup_state.dest_path) - 1);
+    backup_state.dest_path[sizeof(backup_state.dest_path) - 1] = '\0';
+    
+    if (pthread_create(&backup_state.thread, NULL, backup_thread_func, NULL) != 0) {
+        log_error("Failed to create database backup thread");
+        pthread_mutex_unlock(&backup_state.mutex);
+        finish_backup(-1);
+        return -1;
+    }
+    
+    backup_state.thread_active = true;
+    pthread_mutex_unlock(&backup_state.mutex);
+    
+    log_info("Started background database backup to %s", dest_path);
     return 0;
 }
 
+// Cancel a background backup and wait for its thread to exit
+void stop_backup_thread(void) {
+    pthread_mutex_lock(&backup_state.mutex);
+    
+    if (!backup_state.thread_active) {
+        pthread_mutex_unlock(&backup_state.mutex);
+        return;
+    }
+    
+    backup_state.cancel = true;
+    pthread_t thread = backup_state.thread;
+    backup_state.thread_active = false;
+    
+    pthread_mutex_unlock(&backup_state.mutex);
+    
+    pthread_join(thread, NULL);
+}
+
+// Get the progress of the current or last backup
+void get_backup_progress(db_backup_progress_t *progress) {
+    if (!progress) {
+        return;
+    }
+    
+    pthread_mutex_lock(&backup_state.mutex);
+    *progress = backup_state.progress;
+    pthread_mutex_unlock(&backup_state.mutex);
+}
+
+// Set the function called as backups make progress
+void set_backup_progress_callback(db_backup_progress_cb callback, void *user_data) {
+    pthread_mutex_lock(&backup_state.mutex);
+    backup_state.callback = callback;
+    backup_state.callback_data = user_data;
+    pthread_mutex_unlock(&backup_state.mutex);
+}
+
 // Restore database from backup
 int restore_database_from_backup(const char *backup_path, const char *db_path) {
     int rc;
@@ -114,6 +373,7 @@ int restore_database_from_backup(const char *backup_path, const char *db_path) {
     // Close the current database if it's open
     if (db) {
         log_info("Closing current database before restore");
+        db_stmt_cache_clear(db);
         sqlite3_close_v2(db);
         // Note: We don't set the global db to NULL here, as that's handled by the core module
     }
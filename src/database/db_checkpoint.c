@@ -0,0 +1,254 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+
+#include "database/db_checkpoint.h"
+#include "database/db_core.h"
+#include "core/logger.h"
+
+// SQLite's default automatic checkpoint threshold, restored on stop
+#define SQLITE_DEFAULT_AUTOCHECKPOINT_PAGES 1000
+
+// Checkpoint thread state
+static struct {
+    pthread_t thread;
+    bool running;
+    int wal_pages;                  // WAL size reported by the last commit
+    sqlite3 *conn;                  // Connection used only by the checkpoint thread
+    char wal_path[1024];
+    db_checkpoint_stats_t stats;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} checkpoint = {
+    .running = false,
+    .wal_pages = 0,
+    .conn = NULL,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+// Called by SQLite after each commit on the writer connection (db mutex held)
+static int wal_commit_hook(void *arg, sqlite3 *db, const char *name, int pages) {
+    (void)arg;
+    (void)db;
+    (void)name;
+
+    pthread_mutex_lock(&checkpoint.mutex);
+    checkpoint.wal_pages = pages;
+    if (pages >= DB_CHECKPOINT_WAKE_PAGES) {
+        pthread_cond_signal(&checkpoint.cond);
+    }
+    pthread_mutex_unlock(&checkpoint.mutex);
+
+    return SQLITE_OK;
+}
+
+// Get the size of the WAL file
+static uint64_t get_wal_size(void) {
+    struct stat st;
+    if (stat(checkpoint.wal_path, &st) != 0) {
+        return 0;
+    }
+    return (uint64_t)st.st_size;
+}
+
+// Milliseconds between two monotonic times
+static double elapsed_ms(const struct timespec *start, const struct timespec *end) {
+    return (double)(end->tv_sec - start->tv_sec) * 1000.0 +
+           (double)(end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+// Run one checkpoint, escalating to TRUNCATE when the WAL is too large
+static void run_checkpoint(void) {
+    uint64_t wal_bytes = get_wal_size();
+
+    // TRUNCATE waits for readers to finish with the WAL, so only try it
+    // when none of the pooled readers are checked out
+    bool truncate = wal_bytes > DB_CHECKPOINT_TRUNCATE_BYTES && db_active_readers() == 0;
+    int mode = truncate ? SQLITE_CHECKPOINT_TRUNCATE : SQLITE_CHECKPOINT_PASSIVE;
+
+    int log_frames = 0;
+    int checkpointed_frames = 0;
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int rc = sqlite3_wal_checkpoint_v2(checkpoint.conn, NULL, mode, &log_frames, &checkpointed_frames);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double duration = elapsed_ms(&start, &end);
+
+    if (rc != SQLITE_OK && rc != SQLITE_BUSY) {
+        log_warn("WAL checkpoint failed: %s", sqlite3_errmsg(checkpoint.conn));
+    } else if (truncate) {
+        log_info("Truncated %llu byte WAL in %.1f ms%s",
+                 (unsigned long long)wal_bytes, duration, rc == SQLITE_BUSY ? " (busy)" : "");
+    }
+
+    pthread_mutex_lock(&checkpoint.mutex);
+    db_checkpoint_stats_t *stats = &checkpoint.stats;
+    stats->wal_bytes = get_wal_size();
+    stats->wal_frames = log_frames;
+    stats->checkpointed_frames = checkpointed_frames;
+    if (truncate) {
+        stats->truncate_count++;
+    } else {
+        stats->passive_count++;
+    }
+    // PASSIVE never waits, so it is busy when readers pin frames it could not copy
+    if (rc != SQLITE_OK || checkpointed_frames < log_frames) {
+        stats->busy_count++;
+    }
+    stats->last_duration_ms = duration;
+    if (duration > stats->max_duration_ms) {
+        stats->max_duration_ms = duration;
+    }
+    stats->last_checkpoint = time(NULL);
+    checkpoint.wal_pages = 0;
+    pthread_mutex_unlock(&checkpoint.mutex);
+}
+
+// Checkpoint thread
+static void *checkpoint_thread_func(void *arg) {
+    (void)arg;
+
+    log_info("WAL checkpoint thread started");
+
+    while (true) {
+        pthread_mutex_lock(&checkpoint.mutex);
+
+        if (checkpoint.running && checkpoint.wal_pages < DB_CHECKPOINT_WAKE_PAGES) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += DB_CHECKPOINT_INTERVAL_MS / 1000;
+            deadline.tv_nsec += (long)(DB_CHECKPOINT_INTERVAL_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&checkpoint.cond, &checkpoint.mutex, &deadline);
+        }
+
+        bool running = checkpoint.running;
+        pthread_mutex_unlock(&checkpoint.mutex);
+
+        if (!running) {
+            break;
+        }
+
+        run_checkpoint();
+    }
+
+    log_info("WAL checkpoint thread exiting");
+    return NULL;
+}
+
+// Start the WAL checkpoint thread
+int start_db_checkpoint(const char *db_path) {
+    if (!db_path) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&checkpoint.mutex);
+
+    if (checkpoint.running) {
+        pthread_mutex_unlock(&checkpoint.mutex);
+        return 0;
+    }
+
+    // Checkpoints run on their own connection so they never hold the
+    // database mutex; like the readers it must not share the writer's cache
+    int rc = sqlite3_open_v2(db_path, &checkpoint.conn,
+                             SQLITE_OPEN_READWRITE | SQLITE_OPEN_NOMUTEX |
+                             SQLITE_OPEN_PRIVATECACHE,
+                             NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to open checkpoint connection: %s",
+                  checkpoint.conn ? sqlite3_errmsg(checkpoint.conn) : "out of memory");
+        sqlite3_close(checkpoint.conn);
+        checkpoint.conn = NULL;
+        pthread_mutex_unlock(&checkpoint.mutex);
+        return -1;
+    }
+
+    sqlite3_busy_timeout(checkpoint.conn, DB_CHECKPOINT_BUSY_TIMEOUT_MS);
+    sqlite3_wal_autocheckpoint(checkpoint.conn, 0);
+
+    snprintf(checkpoint.wal_path, sizeof(checkpoint.wal_path), "%s-wal", db_path);
+    memset(&checkpoint.stats, 0, sizeof(checkpoint.stats));
+    checkpoint.wal_pages = 0;
+    checkpoint.running = true;
+
+    if (pthread_create(&checkpoint.thread, NULL, checkpoint_thread_func, NULL) != 0) {
+        log_error("Failed to create WAL checkpoint thread");
+        checkpoint.running = false;
+        sqlite3_close(checkpoint.conn);
+        checkpoint.conn = NULL;
+        pthread_mutex_unlock(&checkpoint.mutex);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&checkpoint.mutex);
+
+    // Replace the writer's automatic checkpoint with a hook that wakes the thread
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    if (db) {
+        pthread_mutex_lock(db_mutex);
+        sqlite3_wal_hook(db, wal_commit_hook, NULL);
+        pthread_mutex_unlock(db_mutex);
+    }
+
+    log_info("WAL checkpoint thread started (every %d ms, truncate above %d bytes)",
+             DB_CHECKPOINT_INTERVAL_MS, DB_CHECKPOINT_TRUNCATE_BYTES);
+    return 0;
+}
+
+// Stop the WAL checkpoint thread and restore automatic checkpoints
+void stop_db_checkpoint(void) {
+    pthread_mutex_lock(&checkpoint.mutex);
+
+    if (!checkpoint.running) {
+        pthread_mutex_unlock(&checkpoint.mutex);
+        return;
+    }
+
+    checkpoint.running = false;
+    pthread_cond_signal(&checkpoint.cond);
+    pthread_mutex_unlock(&checkpoint.mutex);
+
+    pthread_join(checkpoint.thread, NULL);
+
+    // Setting the automatic checkpoint removes the hook
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    if (db) {
+        pthread_mutex_lock(db_mutex);
+        sqlite3_wal_autocheckpoint(db, SQLITE_DEFAULT_AUTOCHECKPOINT_PAGES);
+        pthread_mutex_unlock(db_mutex);
+    }
+
+    sqlite3_close(checkpoint.conn);
+    checkpoint.conn = NULL;
+
+    log_info("WAL checkpoint thread stopped");
+}
+
+// Get WAL checkpoint metrics
+void db_checkpoint_get_stats(db_checkpoint_stats_t *stats) {
+    if (!stats) {
+        return;
+    }
+
+    pthread_mutex_lock(&checkpoint.mutex);
+    *stats = checkpoint.stats;
+    if (checkpoint.running) {
+        stats->wal_bytes = get_wal_size();
+    }
+    pthread_mutex_unlock(&checkpoint.mutex);
+}
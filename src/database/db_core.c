@@ -20,8 +20,20 @@
 #include "database/db_core.h"
 #include "database/db_schema.h"
 #include "database/db_backup.h"
+#include "database/db_stmt_cache.h"
+#include "database/db_write_queue.h"
+#include "database/db_recordings.h"
+#include "database/db_recording_index.h"
+#include "database/db_detections.h"
+#include "database/db_maintenance.h"
+#include "database/db_checkpoint.h"
+#include "database/db_snapshot.h"
+#include "core/config.h"
 #include "core/logger.h"
 
+// Auth caches live in db_auth.c, which not every binary links
+extern __attribute__((weak)) void db_auth_cache_clear(void);
+
 // Database handle
 static sqlite3 *db = NULL;
 
@@ -46,6 +58,93 @@ static bool wal_mode_enabled = false;
 // Flag to indicate if a backup is in progress
 static bool backup_in_progress = false;
 
+// Pool of read-only connections for query paths (WAL mode only)
+static struct {
+    sqlite3 *conns[DB_READER_POOL_SIZE];
+    bool in_use[DB_READER_POOL_SIZE];
+    int count;
+    pthread_mutex_t mutex;
+    pthread_cond_t available;
+} reader_pool = {
+    .count = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .available = PTHREAD_COND_INITIALIZER
+};
+
+// Open the read-only connection pool
+static void open_reader_pool(const char *db_path) {
+    pthread_mutex_lock(&reader_pool.mutex);
+    
+    for (int i = 0; i < DB_READER_POOL_SIZE; i++) {
+        sqlite3 *reader = NULL;
+        
+        // Each reader is only ever used by the thread that checked it out,
+        // and must not share a cache with the writer or it would take
+        // table locks against it
+        int rc = sqlite3_open_v2(db_path, &reader, 
+                                 SQLITE_OPEN_READONLY | SQLITE_OPEN_NOMUTEX | 
+                                 SQLITE_OPEN_PRIVATECACHE, 
+                                 NULL);
+        if (rc != SQLITE_OK) {
+            log_warn("Failed to open read-only database connection %d: %s", 
+                    i, reader ? sqlite3_errmsg(reader) : "out of memory");
+            sqlite3_close(reader);
+            break;
+        }
+        
+        sqlite3_busy_timeout(reader, 10000);
+        
+        reader_pool.conns[reader_pool.count] = reader;
+        reader_pool.in_use[reader_pool.count] = false;
+        reader_pool.count++;
+    }
+    
+    pthread_mutex_unlock(&reader_pool.mutex);
+    
+    log_info("Opened %d read-only database connections", reader_pool.count);
+}
+
+// Close the read-only connection pool, waiting for readers to be returned
+static void close_reader_pool(void) {
+    pthread_mutex_lock(&reader_pool.mutex);
+    
+    for (int i = 0; i < reader_pool.count; i++) {
+        // Wait up to 5 seconds for each connection still in use
+        int waited = 0;
+        while (reader_pool.in_use[i] && waited < 50) {
+            struct timespec timeout;
+            clock_gettime(CLOCK_REALTIME, &timeout);
+            timeout.tv_nsec += 100000000;  // 100ms
+            if (timeout.tv_nsec >= 1000000000) {
+                timeout.tv_sec++;
+                timeout.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&reader_pool.available, &reader_pool.mutex, &timeout);
+            waited++;
+        }
+        
+        if (reader_pool.in_use[i]) {
+            log_warn("Closing read-only database connection %d while still in use", i);
+        }
+        
+        db_stmt_cache_clear(reader_pool.conns[i]);
+        sqlite3_close_v2(reader_pool.conns[i]);
+        reader_pool.conns[i] = NULL;
+        reader_pool.in_use[i] = false;
+    }
+    
+    int closed = reader_pool.count;
+    reader_pool.count = 0;
+    
+    // Wake any thread still waiting so it falls back to the writer
+    pthread_cond_broadcast(&reader_pool.available);
+    pthread_mutex_unlock(&reader_pool.mutex);
+    
+    if (closed > 0) {
+        log_info("Closed %d read-only database connections", closed);
+    }
+}
+
 // Create directory if it doesn't exist
 static int create_directory(const char *path) {
     struct stat st;
@@ -96,14 +195,28 @@ int init_database(const char *db_path) {
     
     log_info("Initializing database at path: %s", db_path);
     
-    // Store the database path for backup/recovery operations
-    strncpy(db_file_path, db_path, sizeof(db_file_path) - 1);
-    db_file_path[sizeof(db_file_path) - 1] = '\0';
-    
     // Create backup path by appending .bak to the database path
     snprintf(db_backup_path, sizeof(db_backup_path), "%s.bak", db_path);
     log_info("Backup path set to: %s", db_backup_path);
     
+    // With a memory path configured the live database sits on tmpfs and
+    // db_path only receives periodic snapshots, sparing the flash from
+    // every WAL write
+    const char *snapshot_path = NULL;
+    if (g_config.db_memory_path[0] != '\0' && strcmp(g_config.db_memory_path, db_path) != 0) {
+        if (prepare_memory_database(g_config.db_memory_path, db_path) == 0) {
+            snapshot_path = db_path;
+            db_path = g_config.db_memory_path;
+            log_info("Live database kept in memory at %s", db_path);
+        } else {
+            log_warn("Failed to prepare database in memory, using %s directly", db_path);
+        }
+    }
+    
+    // Store the database path for backup/recovery operations
+    strncpy(db_file_path, db_path, sizeof(db_file_path) - 1);
+    db_file_path[sizeof(db_file_path) - 1] = '\0';
+    
     // Check if database already exists
     FILE *test_file = fopen(db_path, "r");
     if (test_file) {
@@ -319,19 +432,42 @@ int init_database(const char *db_path) {
         return -1;
     }
     
-    // Create detections table
+    // Create detection tables: one row per frame with the detections packed
+    // into a blob, streams and labels stored once in dictionary tables
     const char *create_detections_table = 
-        "CREATE TABLE IF NOT EXISTS detections ("
-        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-        "stream_name TEXT NOT NULL,"
+        "CREATE TABLE IF NOT EXISTS detection_streams ("
+        "id INTEGER PRIMARY KEY,"
+        "name TEXT NOT NULL UNIQUE"
+        ");"
+        "CREATE TABLE IF NOT EXISTS detection_labels ("
+        "id INTEGER PRIMARY KEY,"
+        "name TEXT NOT NULL UNIQUE"
+        ");"
+        "CREATE TABLE IF NOT EXISTS detection_frames ("
+        "id INTEGER PRIMARY KEY,"
+        "stream_id INTEGER NOT NULL,"
         "timestamp INTEGER NOT NULL,"
-        "label TEXT NOT NULL,"
-        "confidence REAL NOT NULL,"
-        "x REAL NOT NULL,"
-        "y REAL NOT NULL,"
-        "width REAL NOT NULL,"
-        "height REAL NOT NULL"
-        ");";
+        "recording_id INTEGER,"
+        "count INTEGER NOT NULL,"
+        "max_confidence INTEGER NOT NULL,"
+        "data BLOB NOT NULL"
+        ");"
+        "CREATE TABLE IF NOT EXISTS detection_activity_minute ("
+        "stream_id INTEGER NOT NULL,"
+        "bucket INTEGER NOT NULL,"
+        "label_id INTEGER NOT NULL,"
+        "count INTEGER NOT NULL,"
+        "max_confidence INTEGER NOT NULL,"
+        "PRIMARY KEY (stream_id, bucket, label_id)"
+        ") WITHOUT ROWID;"
+        "CREATE TABLE IF NOT EXISTS detection_activity_hour ("
+        "stream_id INTEGER NOT NULL,"
+        "bucket INTEGER NOT NULL,"
+        "label_id INTEGER NOT NULL,"
+        "count INTEGER NOT NULL,"
+        "max_confidence INTEGER NOT NULL,"
+        "PRIMARY KEY (stream_id, bucket, label_id)"
+        ") WITHOUT ROWID;";
     
     rc = sqlite3_exec(db, create_detections_table, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
@@ -404,8 +540,11 @@ int init_database(const char *db_path) {
         "CREATE INDEX IF NOT EXISTS idx_recordings_stream ON recordings (stream_name);"
         "CREATE INDEX IF NOT EXISTS idx_recordings_complete_stream_start ON recordings (is_complete, stream_name, start_time);"
         "CREATE INDEX IF NOT EXISTS idx_streams_name ON streams (name);"
-        "CREATE INDEX IF NOT EXISTS idx_detections_stream_timestamp ON detections (stream_name, timestamp);"
-        "CREATE INDEX IF NOT EXISTS idx_detections_timestamp ON detections (timestamp);";
+        "CREATE INDEX IF NOT EXISTS idx_detection_frames_stream_timestamp ON detection_frames (stream_id, timestamp);"
+        "CREATE INDEX IF NOT EXISTS idx_detection_frames_timestamp ON detection_frames (timestamp);"
+        "CREATE INDEX IF NOT EXISTS idx_detection_frames_recording ON detection_frames (recording_id);"
+        "CREATE INDEX IF NOT EXISTS idx_detection_activity_minute_bucket ON detection_activity_minute (bucket);"
+        "CREATE INDEX IF NOT EXISTS idx_detection_activity_hour_bucket ON detection_activity_hour (bucket);";
     
     rc = sqlite3_exec(db, create_indexes, NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
@@ -438,6 +577,36 @@ int init_database(const char *db_path) {
     
     log_info("Database initialized successfully");
     
+    // Answer timeline lookups from memory instead of the recordings table
+    if (recording_index_load() < 0) {
+        log_warn("Failed to load recording index, timeline lookups will query the database");
+    }
+    
+    // Readers only run concurrently with the writer in WAL mode
+    if (wal_mode_enabled) {
+        open_reader_pool(db_path);
+        
+        // Checkpoint from a background thread instead of inside commits
+        if (start_db_checkpoint(db_path) != 0) {
+            log_warn("Failed to start WAL checkpoint thread, using automatic checkpoints");
+        }
+    }
+    
+    // Start grouping detection, event and progress writes into batches
+    if (init_db_write_queue() != 0) {
+        log_warn("Failed to start database write queue, writes will be committed individually");
+    }
+    
+    // Copy the in-memory database to persistent storage in the background
+    if (snapshot_path && start_db_snapshots(db_path, snapshot_path, g_config.db_snapshot_interval) != 0) {
+        log_warn("Failed to start database snapshots, changes will not be saved to %s", snapshot_path);
+    }
+    
+    // Purge old detections and events and release free pages in the background
+    if (start_db_maintenance() != 0) {
+        log_warn("Failed to start database maintenance, old detections and events will not be purged");
+    }
+    
     // Create an initial backup if this is a new database
     if (is_new_database) {
         log_info("Creating initial backup of new database");
@@ -456,6 +625,18 @@ int init_database(const char *db_path) {
 void shutdown_database(void) {
     log_info("Starting database shutdown process");
     
+    // Stop purging first, a purge in progress finishes its current chunk
+    stop_db_maintenance();
+    
+    // Commit anything still queued while the database is fully open
+    shutdown_db_write_queue();
+    
+    // The final checkpoint below runs on the writer connection
+    stop_db_checkpoint();
+    
+    // A background backup would race the final one below
+    stop_backup_thread();
+    
     // Create a final backup before shutting down
     if (db != NULL && db_file_path[0] != '\0') {
         log_info("Creating final backup before shutdown");
@@ -466,6 +647,12 @@ void shutdown_database(void) {
         }
     }
     
+    // Save the in-memory database to persistent storage
+    stop_db_snapshots();
+    
+    // Close the read-only connections before the writer
+    close_reader_pool();
+    
     // First, ensure all threads have stopped using the database
     // by waiting a bit longer before acquiring the mutex
     usleep(500000);  // 500ms to allow in-flight operations to complete
@@ -514,6 +701,19 @@ void shutdown_database(void) {
             }
         }
         
+        // Drop the statement cache first so it does not keep pointers to
+        // statements finalized below
+        db_stmt_cache_clear(db_to_close);
+        
+        // Counts and dictionary ids cached for the old database do not apply
+        // to the restored one
+        invalidate_recording_list_cache();
+        recording_index_clear();
+        reset_detection_dictionaries();
+        if (db_auth_cache_clear) {
+            db_auth_cache_clear();
+        }
+        
         // Finalize all prepared statements before closing the database
         // This helps prevent "corrupted size vs. prev_size in fastbins" errors
         int stmt_count = 0;
@@ -609,4 +809,75 @@ pthread_mutex_t *get_db_mutex(void) {
     return &db_mutex;
 }
 
+// Get the path of the live database
+const char *get_db_live_path(void) {
+    return db_file_path;
+}
+
+// Check out a connection for read-only queries
+sqlite3 *db_acquire_reader(void) {
+    pthread_mutex_lock(&reader_pool.mutex);
+    
+    while (reader_pool.count > 0) {
+        for (int i = 0; i < reader_pool.count; i++) {
+            if (!reader_pool.in_use[i]) {
+                reader_pool.in_use[i] = true;
+                sqlite3 *reader = reader_pool.conns[i];
+                pthread_mutex_unlock(&reader_pool.mutex);
+                return reader;
+            }
+        }
+        
+        // All readers are busy
+        pthread_cond_wait(&reader_pool.available, &reader_pool.mutex);
+    }
+    
+    pthread_mutex_unlock(&reader_pool.mutex);
+    
+    // No pool, share the writer connection under the database mutex
+    pthread_mutex_lock(&db_mutex);
+    return db;
+}
+
+// Count pooled read-only connections that are checked out
+int db_active_readers(void) {
+    int active = 0;
+    
+    pthread_mutex_lock(&reader_pool.mutex);
+    for (int i = 0; i < reader_pool.count; i++) {
+        if (reader_pool.in_use[i]) {
+            active++;
+        }
+    }
+    pthread_mutex_unlock(&reader_pool.mutex);
+    
+    return active;
+}
+
+// Return a connection obtained from db_acquire_reader
+void db_release_reader(sqlite3 *reader) {
+    pthread_mutex_lock(&reader_pool.mutex);
+    
+    for (int i = 0; i < reader_pool.count; i++) {
+        if (reader_pool.conns[i] == reader) {
+            reader_pool.in_use[i] = false;
+            pthread_cond_signal(&reader_pool.available);
+            pthread_mutex_unlock(&reader_pool.mutex);
+            return;
+        }
+    }
+    
+    pthread_mutex_unlock(&reader_pool.mutex);
+    
+    // Only the writer connection was handed out under the database mutex
+    if (reader != db) {
+        // A pooled connection closed while checked out, e.g. when
+        // close_reader_pool gave up waiting for it
+        log_error("Ignoring release of unknown database connection %p", (void *)reader);
+        return;
+    }
+    
+    pthread_mutex_unlock(&db_mutex);
+}
+
 // These functions have been moved to db_backup.c
@@ -9,12 +9,453 @@
 #include <sqlite3.h>
 #include <stdbool.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "database/db_detections.h"
 #include "database/db_core.h"
+#include "database/db_activity.h"
+#include "database/db_maintenance.h"
+#include "database/db_stmt_cache.h"
+#include "database/db_write_queue.h"
 #include "core/logger.h"
 #include "video/detection_result.h"
 
+// Names kept in memory per dictionary; further names are looked up in the database
+#define DETECTION_DICT_CACHE_SIZE 128
+#define DETECTION_DICT_NAME_SIZE 64
+
+// Boxes and confidences are stored as fractions of this value
+#define DETECTION_QUANT_MAX 65535
+
+// Bytes per detection in a packed frame: label id, confidence, x, y, width,
+// height, each a little-endian 16-bit integer
+#define DETECTION_PACKED_SIZE 12
+
+// Append a label to a comma-separated list if it is not already there and fits
+static void add_label_to_list(char *list, size_t list_size, const char *label) {
+    size_t label_len = strlen(label);
+    if (label_len == 0) {
+        return;
+    }
+    
+    const char *p = list;
+    while (*p) {
+        const char *end = strchr(p, ',');
+        size_t len = end ? (size_t)(end - p) : strlen(p);
+        if (len == label_len && strncmp(p, label, len) == 0) {
+            return;
+        }
+        if (!end) {
+            break;
+        }
+        p = end + 1;
+    }
+    
+    size_t used = strlen(list);
+    size_t needed = label_len + (used > 0 ? 1 : 0);
+    if (used + needed >= list_size) {
+        return;
+    }
+    
+    if (used > 0) {
+        list[used++] = ',';
+    }
+    memcpy(list + used, label, label_len + 1);
+}
+
+// Dictionary mapping names to the integer ids stored in detection frames
+typedef struct {
+    const char *insert_sql;     // Adds a name if it is not there yet
+    const char *id_sql;         // Looks up the id of a name
+    const char *name_sql;       // Looks up the name of an id
+    int count;
+    int ids[DETECTION_DICT_CACHE_SIZE];
+    char names[DETECTION_DICT_CACHE_SIZE][DETECTION_DICT_NAME_SIZE];
+    pthread_mutex_t mutex;
+} detection_dict_t;
+
+static detection_dict_t label_dict = {
+    .insert_sql = "INSERT OR IGNORE INTO detection_labels (name) VALUES (?);",
+    .id_sql = "SELECT id FROM detection_labels WHERE name = ?;",
+    .name_sql = "SELECT name FROM detection_labels WHERE id = ?;",
+    .count = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+static detection_dict_t stream_dict = {
+    .insert_sql = "INSERT OR IGNORE INTO detection_streams (name) VALUES (?);",
+    .id_sql = "SELECT id FROM detection_streams WHERE name = ?;",
+    .name_sql = "SELECT name FROM detection_streams WHERE id = ?;",
+    .count = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Remember a dictionary entry if there is room
+static void dict_cache_add(detection_dict_t *dict, int id, const char *name) {
+    if (strlen(name) >= DETECTION_DICT_NAME_SIZE) {
+        return;
+    }
+    
+    pthread_mutex_lock(&dict->mutex);
+    if (dict->count < DETECTION_DICT_CACHE_SIZE) {
+        dict->ids[dict->count] = id;
+        strcpy(dict->names[dict->count], name);
+        dict->count++;
+    }
+    pthread_mutex_unlock(&dict->mutex);
+}
+
+// Get the id for a name, adding it to the dictionary table if needed
+// (caller holds the database mutex)
+static int dict_get_or_add_id_locked(sqlite3 *db, detection_dict_t *dict, const char *name) {
+    pthread_mutex_lock(&dict->mutex);
+    for (int i = 0; i < dict->count; i++) {
+        if (strcmp(dict->names[i], name) == 0) {
+            int id = dict->ids[i];
+            pthread_mutex_unlock(&dict->mutex);
+            return id;
+        }
+    }
+    pthread_mutex_unlock(&dict->mutex);
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, dict->insert_sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    int rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to add dictionary entry %s: %s", name, sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    stmt = db_stmt_cache_acquire(db, dict->id_sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    sqlite3_bind_text(stmt, 1, name, -1, SQLITE_STATIC);
+    int id = -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        id = sqlite3_column_int(stmt, 0);
+    }
+    db_stmt_cache_release(stmt);
+    
+    if (id >= 0) {
+        dict_cache_add(dict, id, name);
+    }
+    
+    return id;
+}
+
+// Get the name for an id, "unknown" if it is not in the dictionary
+static void dict_get_name(sqlite3 *db, detection_dict_t *dict, int id, char *name, size_t name_size) {
+    pthread_mutex_lock(&dict->mutex);
+    for (int i = 0; i < dict->count; i++) {
+        if (dict->ids[i] == id) {
+            strncpy(name, dict->names[i], name_size - 1);
+            name[name_size - 1] = '\0';
+            pthread_mutex_unlock(&dict->mutex);
+            return;
+        }
+    }
+    pthread_mutex_unlock(&dict->mutex);
+    
+    strncpy(name, "unknown", name_size - 1);
+    name[name_size - 1] = '\0';
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, dict->name_sql);
+    if (!stmt) {
+        return;
+    }
+    sqlite3_bind_int(stmt, 1, id);
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *value = (const char *)sqlite3_column_text(stmt, 0);
+        if (value) {
+            strncpy(name, value, name_size - 1);
+            name[name_size - 1] = '\0';
+            dict_cache_add(dict, id, name);
+        }
+    }
+    db_stmt_cache_release(stmt);
+}
+
+// Forget cached dictionary ids
+void reset_detection_dictionaries(void) {
+    detection_dict_t *dicts[] = { &label_dict, &stream_dict };
+    for (int i = 0; i < 2; i++) {
+        pthread_mutex_lock(&dicts[i]->mutex);
+        dicts[i]->count = 0;
+        pthread_mutex_unlock(&dicts[i]->mutex);
+    }
+}
+
+// Quantize a value in the range 0.0-1.0 to 16 bits
+static uint16_t quantize_unit(float value) {
+    if (!(value > 0.0f)) {
+        return 0;
+    }
+    if (value >= 1.0f) {
+        return DETECTION_QUANT_MAX;
+    }
+    return (uint16_t)lrintf(value * DETECTION_QUANT_MAX);
+}
+
+static float dequantize_unit(uint16_t value) {
+    return (float)value / DETECTION_QUANT_MAX;
+}
+
+static void put_u16(unsigned char *p, uint16_t value) {
+    p[0] = (unsigned char)(value & 0xff);
+    p[1] = (unsigned char)(value >> 8);
+}
+
+static uint16_t get_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// Decode a packed frame, returns the number of detections written to out
+static int decode_detection_frame(sqlite3 *db, const unsigned char *data, int size,
+                                  detection_t *out, int max_count) {
+    int count = 0;
+    
+    for (int offset = 0; offset + DETECTION_PACKED_SIZE <= size && count < max_count;
+         offset += DETECTION_PACKED_SIZE) {
+        const unsigned char *p = data + offset;
+        detection_t *det = &out[count++];
+        
+        dict_get_name(db, &label_dict, get_u16(p), det->label, sizeof(det->label));
+        det->confidence = dequantize_unit(get_u16(p + 2));
+        det->x = dequantize_unit(get_u16(p + 4));
+        det->y = dequantize_unit(get_u16(p + 6));
+        det->width = dequantize_unit(get_u16(p + 8));
+        det->height = dequantize_unit(get_u16(p + 10));
+    }
+    
+    return count;
+}
+
+// Insert one frame of detections (caller holds the database mutex)
+int insert_detection_frame_locked(sqlite3 *db, const char *stream_name, time_t timestamp,
+                                  uint64_t recording_id, const detection_t *detections, int count) {
+    if (count <= 0) {
+        return 0;
+    }
+    if (count > MAX_DETECTIONS) {
+        count = MAX_DETECTIONS;
+    }
+    
+    int stream_id = dict_get_or_add_id_locked(db, &stream_dict, stream_name);
+    if (stream_id < 0) {
+        return -1;
+    }
+    
+    unsigned char data[MAX_DETECTIONS * DETECTION_PACKED_SIZE];
+    int label_ids[MAX_DETECTIONS];
+    uint16_t confidences[MAX_DETECTIONS];
+    uint16_t max_confidence = 0;
+    
+    for (int i = 0; i < count; i++) {
+        int label_id = dict_get_or_add_id_locked(db, &label_dict, detections[i].label);
+        if (label_id < 0 || label_id > DETECTION_QUANT_MAX) {
+            log_error("No dictionary id for detection label %s", detections[i].label);
+            return -1;
+        }
+        
+        unsigned char *p = data + i * DETECTION_PACKED_SIZE;
+        uint16_t confidence = quantize_unit(detections[i].confidence);
+        put_u16(p, (uint16_t)label_id);
+        put_u16(p + 2, confidence);
+        put_u16(p + 4, quantize_unit(detections[i].x));
+        put_u16(p + 6, quantize_unit(detections[i].y));
+        put_u16(p + 8, quantize_unit(detections[i].width));
+        put_u16(p + 10, quantize_unit(detections[i].height));
+        
+        label_ids[i] = label_id;
+        confidences[i] = confidence;
+        if (confidence > max_confidence) {
+            max_confidence = confidence;
+        }
+    }
+    
+    const char *sql = "INSERT INTO detection_frames (stream_id, timestamp, recording_id, count, "
+                      "max_confidence, data) VALUES (?, ?, ?, ?, ?, ?);";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, stream_id);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)timestamp);
+    if (recording_id > 0) {
+        sqlite3_bind_int64(stmt, 3, (sqlite3_int64)recording_id);
+    } else {
+        sqlite3_bind_null(stmt, 3);
+    }
+    sqlite3_bind_int(stmt, 4, count);
+    sqlite3_bind_int(stmt, 5, max_confidence);
+    sqlite3_bind_blob(stmt, 6, data, count * DETECTION_PACKED_SIZE, SQLITE_STATIC);
+    
+    int rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to insert detection frame: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    return record_detection_activity_locked(db, stream_id, timestamp, label_ids, confidences, count);
+}
+
+// Rebuild the activity rollups from the stored detection frames (caller holds
+// the database mutex)
+int rebuild_detection_activity_locked(sqlite3 *db) {
+    char *err_msg = NULL;
+    
+    int rc = sqlite3_exec(db, "DELETE FROM detection_activity_minute; DELETE FROM detection_activity_hour;",
+                          NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to clear detection activity: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    
+    sqlite3_stmt *stmt;
+    rc = sqlite3_prepare_v2(db, "SELECT stream_id, timestamp, data FROM detection_frames;", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    int frames = 0;
+    int result = 0;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const unsigned char *data = sqlite3_column_blob(stmt, 2);
+        int size = sqlite3_column_bytes(stmt, 2);
+        
+        // Only the label ids and confidences are needed, no need to decode names
+        int label_ids[MAX_DETECTIONS];
+        uint16_t confidences[MAX_DETECTIONS];
+        int count = 0;
+        for (int offset = 0; offset + DETECTION_PACKED_SIZE <= size && count < MAX_DETECTIONS;
+             offset += DETECTION_PACKED_SIZE) {
+            label_ids[count] = get_u16(data + offset);
+            confidences[count] = get_u16(data + offset + 2);
+            count++;
+        }
+        
+        if (count > 0 &&
+            record_detection_activity_locked(db, sqlite3_column_int(stmt, 0),
+                                             (time_t)sqlite3_column_int64(stmt, 1),
+                                             label_ids, confidences, count) != 0) {
+            result = -1;
+            break;
+        }
+        frames++;
+    }
+    
+    if (result == 0 && rc != SQLITE_DONE) {
+        log_error("Failed to read detection frames: %s", sqlite3_errmsg(db));
+        result = -1;
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    if (result == 0) {
+        log_info("Rebuilt detection activity from %d frames", frames);
+    }
+    return result;
+}
+
+/**
+ * Insert detection results using the writer connection
+ * 
+ * The caller must hold the database mutex and owns the transaction.
+ * 
+ * @param db Writer connection
+ * @param stream_name Stream name
+ * @param result Detection results
+ * @param timestamp Timestamp of the detection
+ * @return 0 on success, non-zero on failure
+ */
+int insert_detections_locked(sqlite3 *db, const char *stream_name, 
+                            const detection_result_t *result, time_t timestamp) {
+    // Find the recording of this stream that covers the timestamp; a recording
+    // still in progress has no end time yet
+    uint64_t recording_id = 0;
+    char labels[128] = {0};
+    
+    const char *find_sql = "SELECT id, detection_labels FROM recordings "
+                           "WHERE stream_name = ? AND start_time <= ? "
+                           "AND (end_time IS NULL OR end_time = 0 OR end_time >= ?) "
+                           "ORDER BY start_time DESC LIMIT 1;";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, find_sql);
+    if (stmt) {
+        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)timestamp);
+        sqlite3_bind_int64(stmt, 3, (sqlite3_int64)timestamp);
+        
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            recording_id = (uint64_t)sqlite3_column_int64(stmt, 0);
+            const char *existing = (const char *)sqlite3_column_text(stmt, 1);
+            if (existing) {
+                strncpy(labels, existing, sizeof(labels) - 1);
+            }
+        }
+        
+        db_stmt_cache_release(stmt);
+    } else {
+        log_warn("Failed to look up recording for detections: %s", sqlite3_errmsg(db));
+    }
+    
+    if (insert_detection_frame_locked(db, stream_name, timestamp, recording_id,
+                                      result->detections, result->count) != 0) {
+        return -1;
+    }
+    
+    float max_confidence = 0.0f;
+    for (int i = 0; i < result->count; i++) {
+        if (result->detections[i].confidence > max_confidence) {
+            max_confidence = result->detections[i].confidence;
+        }
+        add_label_to_list(labels, sizeof(labels), result->detections[i].label);
+    }
+    
+    // Keep the recording's detection aggregates current
+    if (recording_id > 0) {
+        const char *update_sql = "UPDATE recordings SET detection_count = detection_count + ?, "
+                                 "max_confidence = MAX(COALESCE(max_confidence, 0), ?), "
+                                 "detection_labels = ? WHERE id = ?;";
+        
+        stmt = db_stmt_cache_acquire(db, update_sql);
+        if (!stmt) {
+            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+            return -1;
+        }
+        
+        sqlite3_bind_int(stmt, 1, result->count);
+        sqlite3_bind_double(stmt, 2, max_confidence);
+        sqlite3_bind_text(stmt, 3, labels, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 4, (sqlite3_int64)recording_id);
+        
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            log_error("Failed to update detection aggregates for recording %llu: %s", 
+                     (unsigned long long)recording_id, sqlite3_errmsg(db));
+            db_stmt_cache_release(stmt);
+            return -1;
+        }
+        
+        db_stmt_cache_release(stmt);
+    }
+    
+    return 0;
+}
+
 /**
  * Store detection results in the database
  * 
@@ -25,7 +466,6 @@
  */
 int store_detections_in_db(const char *stream_name, const detection_result_t *result, time_t timestamp) {
     int rc;
-    sqlite3_stmt *stmt;
     
     sqlite3 *db = get_db_handle();
     pthread_mutex_t *db_mutex = get_db_mutex();
@@ -46,79 +486,21 @@ int store_detections_in_db(const char *stream_name, const detection_result_t *re
         timestamp = time(NULL);
     }
     
-    log_info("Storing %d detections in database for stream %s", result->count, stream_name);
-    
-    // Log the first detection for debugging
-    if (result->count > 0) {
-        log_info("First detection: %s (%.2f%%) at [%.2f, %.2f, %.2f, %.2f]",
-                result->detections[0].label,
-                result->detections[0].confidence * 100.0f,
-                result->detections[0].x,
-                result->detections[0].y,
-                result->detections[0].width,
-                result->detections[0].height);
+    if (result->count <= 0) {
+        return 0;
     }
     
-    pthread_mutex_lock(db_mutex);
-    
-    // Check if detections table exists
-    char *err_msg = NULL;
-    char **query_result;
-    int rows, cols;
-    rc = sqlite3_get_table(db, 
-                          "SELECT name FROM sqlite_master WHERE type='table' AND name='detections';", 
-                          &query_result, &rows, &cols, &err_msg);
+    log_debug("Storing %d detections for stream %s", result->count, stream_name);
     
-    if (rc != SQLITE_OK) {
-        log_error("Failed to check if detections table exists: %s", err_msg);
-        sqlite3_free(err_msg);
-        pthread_mutex_unlock(db_mutex);
-        return -1;
+    // Hand off to the write-behind queue, which commits in batches
+    if (db_write_queue_detections(stream_name, result, timestamp) == 0) {
+        return 0;
     }
     
-    if (rows == 0) {
-        log_error("Detections table does not exist, recreating it");
-        sqlite3_free_table(query_result);
-        
-        // Create detections table
-        const char *create_detections_table = 
-            "CREATE TABLE IF NOT EXISTS detections ("
-            "id INTEGER PRIMARY KEY AUTOINCREMENT,"
-            "stream_name TEXT NOT NULL,"
-            "timestamp INTEGER NOT NULL,"
-            "label TEXT NOT NULL,"
-            "confidence REAL NOT NULL,"
-            "x REAL NOT NULL,"
-            "y REAL NOT NULL,"
-            "width REAL NOT NULL,"
-            "height REAL NOT NULL"
-            ");";
-        
-        rc = sqlite3_exec(db, create_detections_table, NULL, NULL, &err_msg);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to create detections table: %s", err_msg);
-            sqlite3_free(err_msg);
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Create indexes
-        const char *create_indexes = 
-            "CREATE INDEX IF NOT EXISTS idx_detections_stream_timestamp ON detections (stream_name, timestamp);"
-            "CREATE INDEX IF NOT EXISTS idx_detections_timestamp ON detections (timestamp);";
-        
-        rc = sqlite3_exec(db, create_indexes, NULL, NULL, &err_msg);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to create indexes: %s", err_msg);
-            sqlite3_free(err_msg);
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-    } else {
-        sqlite3_free_table(query_result);
-    }
+    // Queue not running or full, write directly
+    pthread_mutex_lock(db_mutex);
     
-    // Begin transaction for better performance when inserting multiple detections
+    char *err_msg = NULL;
     rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         log_error("Failed to begin transaction: %s", err_msg);
@@ -127,76 +509,61 @@ int store_detections_in_db(const char *stream_name, const detection_result_t *re
         return -1;
     }
     
-    const char *sql = "INSERT INTO detections (stream_name, timestamp, label, confidence, x, y, width, height) "
-                      "VALUES (?, ?, ?, ?, ?, ?, ?, ?);";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+    if (insert_detections_locked(db, stream_name, result, timestamp) != 0) {
         sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        reset_detection_dictionaries();
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // Insert each detection
-    for (int i = 0; i < result->count; i++) {
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)timestamp);
-        sqlite3_bind_text(stmt, 3, result->detections[i].label, -1, SQLITE_STATIC);
-        sqlite3_bind_double(stmt, 4, result->detections[i].confidence);
-        sqlite3_bind_double(stmt, 5, result->detections[i].x);
-        sqlite3_bind_double(stmt, 6, result->detections[i].y);
-        sqlite3_bind_double(stmt, 7, result->detections[i].width);
-        sqlite3_bind_double(stmt, 8, result->detections[i].height);
-        
-        // Execute statement
-        rc = sqlite3_step(stmt);
-        if (rc != SQLITE_DONE) {
-            log_error("Failed to insert detection %d: %s", i, sqlite3_errmsg(db));
-            sqlite3_finalize(stmt);
-            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Reset statement and clear bindings for next detection
-        sqlite3_reset(stmt);
-        sqlite3_clear_bindings(stmt);
-    }
-    
-    sqlite3_finalize(stmt);
-    
     // Commit transaction
     rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg);
     if (rc != SQLITE_OK) {
         log_error("Failed to commit transaction: %s", err_msg);
         sqlite3_free(err_msg);
         sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+        reset_detection_dictionaries();
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
-    // Verify the detections were stored
-    char verify_sql[256];
-    snprintf(verify_sql, sizeof(verify_sql), 
-            "SELECT COUNT(*) FROM detections WHERE stream_name = '%s' AND timestamp = %lld;",
-            stream_name, (long long)timestamp);
+    pthread_mutex_unlock(db_mutex);
     
-    rc = sqlite3_get_table(db, verify_sql, &query_result, &rows, &cols, &err_msg);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to verify detections were stored: %s", err_msg);
-        sqlite3_free(err_msg);
-    } else if (rows > 0 && cols > 0) {
-        int count = atoi(query_result[1]); // First row, first column
-        log_info("Verified %d detections were stored in database for stream %s", count, stream_name);
-        sqlite3_free_table(query_result);
+    return 0;
+}
+
+// Prepare a query for the newest detection frames of a stream in a time range
+// (0 for an open end), binding all parameters
+static sqlite3_stmt *prepare_frame_query(sqlite3 *db, const char *stream_name,
+                                         time_t start_time, time_t end_time, int limit) {
+    char sql[512];
+    
+    snprintf(sql, sizeof(sql), 
+            "SELECT timestamp, data FROM detection_frames "
+            "WHERE stream_id = (SELECT id FROM detection_streams WHERE name = ?)%s%s "
+            "ORDER BY timestamp DESC, id DESC "
+            "LIMIT ?;",
+            start_time > 0 ? " AND timestamp >= ?" : "",
+            end_time > 0 ? " AND timestamp <= ?" : "");
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return NULL;
     }
     
-    pthread_mutex_unlock(db_mutex);
+    // Bind parameters
+    int param_index = 1;
+    sqlite3_bind_text(stmt, param_index++, stream_name, -1, SQLITE_TRANSIENT);
+    if (start_time > 0) {
+        sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)start_time);
+    }
+    if (end_time > 0) {
+        sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)end_time);
+    }
+    sqlite3_bind_int(stmt, param_index, limit);
     
-    log_info("Successfully stored %d detections in database for stream %s", result->count, stream_name);
-    return 0;
+    return stmt;
 }
 
 /**
@@ -211,11 +578,7 @@ int store_detections_in_db(const char *stream_name, const detection_result_t *re
  */
 int get_detections_from_db_time_range(const char *stream_name, detection_result_t *result, 
                                      uint64_t max_age, time_t start_time, time_t end_time) {
-    int rc;
-    sqlite3_stmt *stmt;
-    
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -230,194 +593,71 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
     // Initialize result
     memset(result, 0, sizeof(detection_result_t));
     
-    pthread_mutex_lock(db_mutex);
-    
-    // Build query based on filters
-    char sql[512];
+    db = db_acquire_reader();
     
     if (start_time > 0 && end_time > 0) {
-        // Time range filter
         log_info("Getting detections for stream %s between %lld and %lld", 
                 stream_name, (long long)start_time, (long long)end_time);
-        
-        snprintf(sql, sizeof(sql), 
-                "SELECT label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ? AND timestamp <= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)start_time);
-        sqlite3_bind_int64(stmt, 3, (sqlite3_int64)end_time);
-        sqlite3_bind_int(stmt, 4, MAX_DETECTIONS);
     } else if (start_time > 0) {
-        // Start time filter only
         log_info("Getting detections for stream %s from %lld", 
                 stream_name, (long long)start_time);
-        
-        snprintf(sql, sizeof(sql), 
-                "SELECT label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)start_time);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
     } else if (end_time > 0) {
-        // End time filter only
         log_info("Getting detections for stream %s until %lld", 
                 stream_name, (long long)end_time);
-        
-        snprintf(sql, sizeof(sql), 
-                "SELECT label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp <= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)end_time);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
     } else if (max_age > 0) {
-        // Max age filter
-        // Calculate cutoff time
+        // Only the detections of the latest frame within the max age
         time_t cutoff_time = time(NULL) - max_age;
         
         log_info("Getting detections for stream %s since %lld (max age %llu seconds)", 
                 stream_name, (long long)cutoff_time, (unsigned long long)max_age);
         
-        // First get the latest timestamp
-        snprintf(sql, sizeof(sql), 
-                "SELECT MAX(timestamp) "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
+        sqlite3_stmt *stmt = prepare_frame_query(db, stream_name, cutoff_time, 0, 1);
+        if (!stmt) {
+            db_release_reader(db);
             return -1;
         }
         
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)cutoff_time);
-        
-        // Execute query to get latest timestamp
         time_t latest_timestamp = 0;
         if (sqlite3_step(stmt) == SQLITE_ROW) {
             latest_timestamp = (time_t)sqlite3_column_int64(stmt, 0);
         }
         
-        sqlite3_finalize(stmt);
+        db_stmt_cache_release(stmt);
         
         // If no timestamp found, return empty result
         if (latest_timestamp == 0) {
-            pthread_mutex_unlock(db_mutex);
+            db_release_reader(db);
             log_info("No recent detections found for stream %s", stream_name);
             return 0;
         }
         
-        // Now get all detections at that timestamp
-        snprintf(sql, sizeof(sql), 
-                "SELECT label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp = ? "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)latest_timestamp);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
+        start_time = latest_timestamp;
+        end_time = latest_timestamp;
     } else {
-        // No filters, just get the latest detections
         log_info("Getting latest detections for stream %s (no time filters)", stream_name);
-        
-        snprintf(sql, sizeof(sql), 
-                "SELECT label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, MAX_DETECTIONS);
     }
     
-    // Execute query and fetch results
+    // Every frame holds at least one detection
+    sqlite3_stmt *stmt = prepare_frame_query(db, stream_name, start_time, end_time, MAX_DETECTIONS);
+    if (!stmt) {
+        db_release_reader(db);
+        return -1;
+    }
+    
+    // Execute query and decode the frames
     int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < MAX_DETECTIONS) {
-        // Get detection data
-        const char *label = (const char *)sqlite3_column_text(stmt, 0);
-        float confidence = (float)sqlite3_column_double(stmt, 1);
-        float x = (float)sqlite3_column_double(stmt, 2);
-        float y = (float)sqlite3_column_double(stmt, 3);
-        float width = (float)sqlite3_column_double(stmt, 4);
-        float height = (float)sqlite3_column_double(stmt, 5);
-        
-        // Store in result
-        if (label) {
-            strncpy(result->detections[count].label, label, MAX_LABEL_LENGTH - 1);
-            result->detections[count].label[MAX_LABEL_LENGTH - 1] = '\0';
-        } else {
-            strncpy(result->detections[count].label, "unknown", MAX_LABEL_LENGTH - 1);
-        }
+    while (count < MAX_DETECTIONS && sqlite3_step(stmt) == SQLITE_ROW) {
+        const unsigned char *data = sqlite3_column_blob(stmt, 1);
+        int size = sqlite3_column_bytes(stmt, 1);
         
-        result->detections[count].confidence = confidence;
-        result->detections[count].x = x;
-        result->detections[count].y = y;
-        result->detections[count].width = width;
-        result->detections[count].height = height;
-        
-        count++;
+        count += decode_detection_frame(db, data, size, &result->detections[count],
+                                        MAX_DETECTIONS - count);
     }
     
     result->count = count;
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
     
     log_info("Found %d detections in database for stream %s", count, stream_name);
     return count;
@@ -436,11 +676,7 @@ int get_detections_from_db_time_range(const char *stream_name, detection_result_
  */
 int get_detection_timestamps(const char *stream_name, detection_result_t *result, time_t *timestamps,
                            uint64_t max_age, time_t start_time, time_t end_time) {
-    int rc;
-    sqlite3_stmt *stmt;
-    
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -452,150 +688,49 @@ int get_detection_timestamps(const char *stream_name, detection_result_t *result
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
-    // Build query based on filters
-    char sql[512];
+    if (start_time <= 0 && end_time <= 0 && max_age > 0) {
+        start_time = time(NULL) - max_age;
+    }
     
-    if (start_time > 0 && end_time > 0) {
-        // Time range filter
-        snprintf(sql, sizeof(sql), 
-                "SELECT timestamp, label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ? AND timestamp <= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)start_time);
-        sqlite3_bind_int64(stmt, 3, (sqlite3_int64)end_time);
-        sqlite3_bind_int(stmt, 4, MAX_DETECTIONS);
-    } else if (start_time > 0) {
-        // Start time filter only
-        snprintf(sql, sizeof(sql), 
-                "SELECT timestamp, label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)start_time);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
-    } else if (end_time > 0) {
-        // End time filter only
-        snprintf(sql, sizeof(sql), 
-                "SELECT timestamp, label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp <= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)end_time);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
-    } else if (max_age > 0) {
-        // Max age filter
-        // Calculate cutoff time
-        time_t cutoff_time = time(NULL) - max_age;
-        
-        // First get the latest timestamp
-        snprintf(sql, sizeof(sql), 
-                "SELECT timestamp, label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? AND timestamp >= ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)cutoff_time);
-        sqlite3_bind_int(stmt, 3, MAX_DETECTIONS);
-    } else {
-        // No filters, just get the latest detections
-        snprintf(sql, sizeof(sql), 
-                "SELECT timestamp, label, confidence, x, y, width, height "
-                "FROM detections "
-                "WHERE stream_name = ? "
-                "ORDER BY timestamp DESC "
-                "LIMIT ?;");
-        
-        rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-        if (rc != SQLITE_OK) {
-            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-            pthread_mutex_unlock(db_mutex);
-            return -1;
-        }
-        
-        // Bind parameters
-        sqlite3_bind_text(stmt, 1, stream_name, -1, SQLITE_STATIC);
-        sqlite3_bind_int(stmt, 2, MAX_DETECTIONS);
+    sqlite3_stmt *stmt = prepare_frame_query(db, stream_name, start_time, end_time, MAX_DETECTIONS);
+    if (!stmt) {
+        db_release_reader(db);
+        return -1;
     }
     
     // Execute query and fetch results
     int count = 0;
-    while (sqlite3_step(stmt) == SQLITE_ROW && count < result->count) {
-        // Get timestamp
-        timestamps[count] = (time_t)sqlite3_column_int64(stmt, 0);
-        
-        // Get detection data to match with result
-        const char *label = (const char *)sqlite3_column_text(stmt, 1);
-        float confidence = (float)sqlite3_column_double(stmt, 2);
-        float x = (float)sqlite3_column_double(stmt, 3);
-        float y = (float)sqlite3_column_double(stmt, 4);
-        float width = (float)sqlite3_column_double(stmt, 5);
-        float height = (float)sqlite3_column_double(stmt, 6);
-        
-        // Find matching detection in result
-        for (int i = 0; i < result->count; i++) {
-            if (strcmp(result->detections[i].label, label) == 0 &&
-                fabs(result->detections[i].confidence - confidence) < 0.001 &&
-                fabs(result->detections[i].x - x) < 0.001 &&
-                fabs(result->detections[i].y - y) < 0.001 &&
-                fabs(result->detections[i].width - width) < 0.001 &&
-                fabs(result->detections[i].height - height) < 0.001) {
-                // Found matching detection, store timestamp
-                timestamps[i] = timestamps[count];
-                break;
+    while (count < result->count && sqlite3_step(stmt) == SQLITE_ROW) {
+        time_t timestamp = (time_t)sqlite3_column_int64(stmt, 0);
+        const unsigned char *data = sqlite3_column_blob(stmt, 1);
+        int size = sqlite3_column_bytes(stmt, 1);
+        
+        detection_t frame[MAX_DETECTIONS];
+        int frame_count = decode_detection_frame(db, data, size, frame, MAX_DETECTIONS);
+        
+        for (int j = 0; j < frame_count && count < result->count; j++, count++) {
+            timestamps[count] = timestamp;
+            
+            // Find matching detection in result
+            for (int i = 0; i < result->count; i++) {
+                if (strcmp(result->detections[i].label, frame[j].label) == 0 &&
+                    fabs(result->detections[i].confidence - frame[j].confidence) < 0.001 &&
+                    fabs(result->detections[i].x - frame[j].x) < 0.001 &&
+                    fabs(result->detections[i].y - frame[j].y) < 0.001 &&
+                    fabs(result->detections[i].width - frame[j].width) < 0.001 &&
+                    fabs(result->detections[i].height - frame[j].height) < 0.001) {
+                    // Found matching detection, store timestamp
+                    timestamps[i] = timestamp;
+                    break;
+                }
             }
         }
-        
-        count++;
     }
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
     
     return 0;
 }
@@ -613,17 +748,168 @@ int get_detections_from_db(const char *stream_name, detection_result_t *result,
     return get_detections_from_db_time_range(stream_name, result, max_age, 0, 0);
 }
 
+// Link detection frames stored before a recording row existed to it and refresh
+// the recording's detection aggregates (caller holds the database mutex)
+int refresh_recording_detections_locked(sqlite3 *db, uint64_t recording_id) {
+    // Detections stored before the recording row existed, e.g. the ones that
+    // triggered a detection-based recording, were not tagged at insert time
+    const char *link_sql = 
+        "UPDATE detection_frames SET recording_id = ?1 "
+        "WHERE recording_id IS NULL "
+        "AND stream_id = (SELECT s.id FROM detection_streams s, recordings r "
+        "WHERE r.id = ?1 AND s.name = r.stream_name) "
+        "AND timestamp >= (SELECT start_time FROM recordings WHERE id = ?1) "
+        "AND timestamp <= (SELECT end_time FROM recordings WHERE id = ?1);";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, link_sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)recording_id);
+    int rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to link detections to recording %llu: %s", 
+                 (unsigned long long)recording_id, sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    // Labels are packed into the frames, so the aggregates are built here
+    const char *frames_sql = "SELECT count, max_confidence, data FROM detection_frames "
+                             "WHERE recording_id = ?;";
+    
+    stmt = db_stmt_cache_acquire(db, frames_sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)recording_id);
+    
+    int detection_count = 0;
+    int max_confidence = 0;
+    char labels[128] = {0};
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        detection_count += sqlite3_column_int(stmt, 0);
+        if (sqlite3_column_int(stmt, 1) > max_confidence) {
+            max_confidence = sqlite3_column_int(stmt, 1);
+        }
+        
+        detection_t frame[MAX_DETECTIONS];
+        int frame_count = decode_detection_frame(db, sqlite3_column_blob(stmt, 2),
+                                                 sqlite3_column_bytes(stmt, 2),
+                                                 frame, MAX_DETECTIONS);
+        for (int i = 0; i < frame_count; i++) {
+            add_label_to_list(labels, sizeof(labels), frame[i].label);
+        }
+    }
+    
+    db_stmt_cache_release(stmt);
+    
+    const char *update_sql = "UPDATE recordings SET detection_count = ?, max_confidence = ?, "
+                             "detection_labels = ? WHERE id = ?;";
+    
+    stmt = db_stmt_cache_acquire(db, update_sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    sqlite3_bind_int(stmt, 1, detection_count);
+    sqlite3_bind_double(stmt, 2, dequantize_unit((uint16_t)max_confidence));
+    sqlite3_bind_text(stmt, 3, labels, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)recording_id);
+    
+    rc = sqlite3_step(stmt);
+    db_stmt_cache_release(stmt);
+    
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to update detection aggregates for recording %llu: %s", 
+                 (unsigned long long)recording_id, sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    return 0;
+}
+
+// Recompute the detection aggregates of recordings that may have lost frames
+// to a purge. Their frames lie within the recording, so only recordings that
+// started before the cutoff and still count detections are affected.
+static int refresh_purged_recordings(time_t cutoff_time) {
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    pthread_mutex_lock(db_mutex);
+    
+    sqlite3 *db = get_db_handle();
+    if (!db) {
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+    
+    const char *select_sql = "SELECT id FROM recordings "
+                             "WHERE start_time < ? AND detection_count > 0;";
+    
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, select_sql, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
+    
+    uint64_t *ids = NULL;
+    int count = 0;
+    int capacity = 0;
+    
+    while (sqlite3_step(stmt) == SQLITE_ROW) {
+        if (count == capacity) {
+            int new_capacity = capacity > 0 ? capacity * 2 : 64;
+            uint64_t *new_ids = realloc(ids, (size_t)new_capacity * sizeof(uint64_t));
+            if (!new_ids) {
+                log_error("Failed to allocate memory for purged recordings");
+                break;
+            }
+            ids = new_ids;
+            capacity = new_capacity;
+        }
+        ids[count++] = (uint64_t)sqlite3_column_int64(stmt, 0);
+    }
+    
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(db_mutex);
+    
+    // One recording per lock so inserts are not held off for the whole refresh
+    int refreshed = 0;
+    for (int i = 0; i < count; i++) {
+        pthread_mutex_lock(db_mutex);
+        db = get_db_handle();
+        if (db && refresh_recording_detections_locked(db, ids[i]) == 0) {
+            refreshed++;
+        }
+        pthread_mutex_unlock(db_mutex);
+    }
+    
+    free(ids);
+    
+    if (refreshed > 0) {
+        log_info("Refreshed detection aggregates of %d recordings after purge", refreshed);
+    }
+    
+    return refreshed;
+}
+
 /**
  * Delete old detections from the database
  * 
  * @param max_age Maximum age in seconds
- * @return Number of detections deleted, or -1 on error
+ * @return Number of detection frames deleted, or -1 on error
  */
 int delete_old_detections(uint64_t max_age) {
-    int rc;
-    sqlite3_stmt *stmt;
-    int deleted_count = 0;
-    
     sqlite3 *db = get_db_handle();
     pthread_mutex_t *db_mutex = get_db_mutex();
     
@@ -632,37 +918,30 @@ int delete_old_detections(uint64_t max_age) {
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
-    
-    const char *sql = "DELETE FROM detections WHERE timestamp < ?;";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
-        return -1;
-    }
-    
     // Calculate cutoff time
     time_t cutoff_time = time(NULL) - max_age;
     
-    // Bind parameters
-    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
-    
-    // Execute statement
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error("Failed to delete old detections: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
-        pthread_mutex_unlock(db_mutex);
+    // Purge in chunks so detection inserts are not held off for the whole purge
+    int deleted_count = db_purge_older_than("detection_frames", "timestamp", cutoff_time);
+    if (deleted_count < 0) {
+        log_error("Failed to delete old detections");
         return -1;
     }
     
-    deleted_count = sqlite3_changes(db);
+    // Recordings outlive their detections, keep their counts and labels in
+    // line with the frames that are left
+    if (deleted_count > 0) {
+        refresh_purged_recordings(cutoff_time);
+    }
     
-    sqlite3_finalize(stmt);
+    // Minute activity is only kept as long as the detections it summarizes
+    pthread_mutex_lock(db_mutex);
+    db = get_db_handle();
+    if (db) {
+        delete_old_detection_activity_locked(db, cutoff_time);
+    }
     pthread_mutex_unlock(db_mutex);
     
-    log_info("Deleted %d old detections from database", deleted_count);
+    log_info("Deleted %d old detection frames from database", deleted_count);
     return deleted_count;
 }
@@ -11,43 +11,29 @@
 
 #include "database/db_events.h"
 #include "database/db_core.h"
+#include "database/db_maintenance.h"
+#include "database/db_stmt_cache.h"
+#include "database/db_write_queue.h"
 #include "core/logger.h"
 
-// Add an event to the database
-uint64_t add_event(event_type_t type, const char *stream_name, 
-                  const char *description, const char *details) {
-    int rc;
-    sqlite3_stmt *stmt;
+// Insert an event using the writer connection (caller holds the database mutex)
+uint64_t insert_event_locked(sqlite3 *db, event_type_t type, time_t timestamp, 
+                            const char *stream_name, const char *description, 
+                            const char *details) {
     uint64_t event_id = 0;
     
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized");
-        return 0;
-    }
-    
-    if (!description) {
-        log_error("Event description is required");
-        return 0;
-    }
-    
-    pthread_mutex_lock(db_mutex);
-    
     const char *sql = "INSERT INTO events (type, timestamp, stream_name, description, details) "
                       "VALUES (?, ?, ?, ?, ?);";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
         return 0;
     }
     
     // Bind parameters
     sqlite3_bind_int(stmt, 1, (int)type);
-    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)time(NULL));
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)timestamp);
     
     if (stream_name) {
         sqlite3_bind_text(stmt, 3, stream_name, -1, SQLITE_STATIC);
@@ -64,7 +50,7 @@ uint64_t add_event(event_type_t type, const char *stream_name,
     }
     
     // Execute statement
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to add event: %s", sqlite3_errmsg(db));
     } else {
@@ -72,12 +58,50 @@ uint64_t add_event(event_type_t type, const char *stream_name,
         log_debug("Added event with ID %llu", (unsigned long long)event_id);
     }
     
-    sqlite3_finalize(stmt);
+    db_stmt_cache_release(stmt);
+    
+    return event_id;
+}
+
+// Add an event to the database
+uint64_t add_event(event_type_t type, const char *stream_name, 
+                  const char *description, const char *details) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return 0;
+    }
+    
+    if (!description) {
+        log_error("Event description is required");
+        return 0;
+    }
+    
+    pthread_mutex_lock(db_mutex);
+    uint64_t event_id = insert_event_locked(db, type, time(NULL), stream_name, description, details);
     pthread_mutex_unlock(db_mutex);
     
     return event_id;
 }
 
+// Queue an event to be added to the database
+int queue_event(event_type_t type, const char *stream_name, 
+               const char *description, const char *details) {
+    if (!description) {
+        log_error("Event description is required");
+        return -1;
+    }
+    
+    if (db_write_queue_event(type, time(NULL), stream_name, description, details) == 0) {
+        return 0;
+    }
+    
+    // Queue not running or full, write directly
+    return add_event(type, stream_name, description, details) != 0 ? 0 : -1;
+}
+
 // Get events from the database
 int get_events(time_t start_time, time_t end_time, int type, 
               const char *stream_name, event_info_t *events, int max_count) {
@@ -86,7 +110,6 @@ int get_events(time_t start_time, time_t end_time, int type,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -98,7 +121,7 @@ int get_events(time_t start_time, time_t end_time, int type,
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     // Build query based on filters
     char sql[1024];
@@ -125,7 +148,7 @@ int get_events(time_t start_time, time_t end_time, int type,
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -184,7 +207,7 @@ int get_events(time_t start_time, time_t end_time, int type,
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
     
     log_info("Found %d events in database matching criteria", count);
     return count;
@@ -192,48 +215,22 @@ int get_events(time_t start_time, time_t end_time, int type,
 
 // Delete old events from the database
 int delete_old_events(uint64_t max_age) {
-    int rc;
-    sqlite3_stmt *stmt;
-    int deleted_count = 0;
-    
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
-    
-    const char *sql = "DELETE FROM events WHERE timestamp < ?;";
-    
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
-        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
-        return -1;
-    }
-    
     // Calculate cutoff time
     time_t cutoff_time = time(NULL) - max_age;
     
-    // Bind parameters
-    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
-    
-    // Execute statement
-    rc = sqlite3_step(stmt);
-    if (rc != SQLITE_DONE) {
-        log_error("Failed to delete old events: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
-        pthread_mutex_unlock(db_mutex);
+    // Purge in chunks so event inserts are not held off for the whole purge
+    int deleted_count = db_purge_older_than("events", "timestamp", cutoff_time);
+    if (deleted_count < 0) {
+        log_error("Failed to delete old events");
         return -1;
     }
     
-    deleted_count = sqlite3_changes(db);
-    
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
-    
     return deleted_count;
 }
@@ -11,12 +11,50 @@
 #include <unistd.h>
 #include <errno.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "database/db_core.h"
 #include "database/db_maintenance.h"
 #include "database/db_backup.h"
+#include "database/db_detections.h"
+#include "database/db_events.h"
+#include "core/config.h"
 #include "core/logger.h"
 
+// Wait before the first maintenance pass so it does not compete with startup
+#define DB_MAINTENANCE_STARTUP_DELAY 60
+
+// Pages released per maintenance pass
+#define DB_VACUUM_PAGES_PER_PASS 8192
+
+// Background maintenance state
+static struct {
+    pthread_t thread;
+    bool running;
+    bool stopping;              // Set by stop_db_maintenance, ends a purge or vacuum early
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} maintenance = {
+    .running = false,
+    .stopping = false,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+// Check whether maintenance has been asked to stop
+static bool maintenance_stopping(void) {
+    pthread_mutex_lock(&maintenance.mutex);
+    bool stopping = maintenance.stopping;
+    pthread_mutex_unlock(&maintenance.mutex);
+    return stopping;
+}
+
+// Pause between chunks, returns true if maintenance is stopping
+static bool maintenance_yield(void) {
+    usleep(DB_MAINTENANCE_YIELD_MS * 1000);
+    return maintenance_stopping();
+}
+
 // Get the database size
 int64_t get_database_size(void) {
     int rc;
@@ -200,3 +238,256 @@ int database_execute_query(const char *sql, void **result, int *rows, int *cols)
     pthread_mutex_unlock(db_mutex);
     return 0;
 }
+
+// Delete rows older than a cutoff in bounded chunks
+int db_purge_older_than(const char *table, const char *time_column, time_t cutoff_time) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    if (!db || !table || !time_column) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    // Walk the time index so each chunk removes the oldest rows without
+    // sorting, and an interrupted purge leaves no gaps
+    char sql[256];
+    snprintf(sql, sizeof(sql), 
+            "DELETE FROM %s WHERE rowid IN "
+            "(SELECT rowid FROM %s WHERE %s < ? ORDER BY %s LIMIT %d);",
+            table, table, time_column, time_column, DB_PURGE_CHUNK_ROWS);
+    
+    int total = 0;
+    int chunks = 0;
+    
+    while (true) {
+        pthread_mutex_lock(db_mutex);
+        
+        // The connection may have been replaced by a restore since the last chunk
+        db = get_db_handle();
+        if (!db) {
+            pthread_mutex_unlock(db_mutex);
+            return -1;
+        }
+        
+        sqlite3_stmt *stmt;
+        int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+        if (rc != SQLITE_OK) {
+            log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+            pthread_mutex_unlock(db_mutex);
+            return -1;
+        }
+        
+        sqlite3_bind_int64(stmt, 1, (sqlite3_int64)cutoff_time);
+        
+        // Each chunk commits on its own
+        rc = sqlite3_step(stmt);
+        int deleted = sqlite3_changes(db);
+        sqlite3_finalize(stmt);
+        
+        // The message belongs to the connection, read it before another thread uses it
+        if (rc != SQLITE_DONE) {
+            log_error("Failed to purge old rows from %s: %s", table, sqlite3_errmsg(db));
+            pthread_mutex_unlock(db_mutex);
+            return total > 0 ? total : -1;
+        }
+        
+        pthread_mutex_unlock(db_mutex);
+        
+        total += deleted;
+        chunks++;
+        
+        if (deleted < DB_PURGE_CHUNK_ROWS || maintenance_yield()) {
+            break;
+        }
+    }
+    
+    if (total > 0) {
+        log_info("Purged %d old rows from %s in %d chunks", total, table, chunks);
+    }
+    
+    return total;
+}
+
+// Return free pages to the file system
+int db_incremental_vacuum(int max_pages) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    int released = 0;
+    
+    while (released < max_pages) {
+        pthread_mutex_lock(db_mutex);
+        
+        db = get_db_handle();
+        if (!db) {
+            pthread_mutex_unlock(db_mutex);
+            return -1;
+        }
+        
+        int auto_vacuum = 0;
+        int freelist = 0;
+        sqlite3_stmt *stmt;
+        
+        if (sqlite3_prepare_v2(db, "PRAGMA auto_vacuum;", -1, &stmt, NULL) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                auto_vacuum = sqlite3_column_int(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+        }
+        
+        // 2 is INCREMENTAL; the mode of an existing file only changes with a full VACUUM
+        if (auto_vacuum != 2) {
+            pthread_mutex_unlock(db_mutex);
+            log_debug("Database does not use incremental auto_vacuum, skipping incremental vacuum");
+            return 0;
+        }
+        
+        if (sqlite3_prepare_v2(db, "PRAGMA freelist_count;", -1, &stmt, NULL) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                freelist = sqlite3_column_int(stmt, 0);
+            }
+            sqlite3_finalize(stmt);
+        }
+        
+        if (freelist == 0) {
+            pthread_mutex_unlock(db_mutex);
+            break;
+        }
+        
+        int step = freelist < DB_VACUUM_STEP_PAGES ? freelist : DB_VACUUM_STEP_PAGES;
+        if (step > max_pages - released) {
+            step = max_pages - released;
+        }
+        
+        char sql[64];
+        snprintf(sql, sizeof(sql), "PRAGMA incremental_vacuum(%d);", step);
+        
+        char *err_msg = NULL;
+        int rc = sqlite3_exec(db, sql, NULL, NULL, &err_msg);
+        
+        pthread_mutex_unlock(db_mutex);
+        
+        if (rc != SQLITE_OK) {
+            log_error("Failed to run incremental vacuum: %s", err_msg);
+            sqlite3_free(err_msg);
+            return released > 0 ? released : -1;
+        }
+        
+        released += step;
+        
+        if (maintenance_yield()) {
+            break;
+        }
+    }
+    
+    if (released > 0) {
+        log_info("Incremental vacuum released %d free pages", released);
+    }
+    
+    return released;
+}
+
+// Run one maintenance pass
+static void run_maintenance_pass(void) {
+    int retention_days = g_config.retention_days;
+    
+    if (retention_days > 0) {
+        uint64_t max_age = (uint64_t)retention_days * 86400;
+        
+        if (delete_old_detections(max_age) < 0) {
+            log_warn("Failed to purge old detections");
+        }
+        
+        if (!maintenance_stopping() && delete_old_events(max_age) < 0) {
+            log_warn("Failed to purge old events");
+        }
+    }
+    
+    if (!maintenance_stopping()) {
+        db_incremental_vacuum(DB_VACUUM_PAGES_PER_PASS);
+    }
+}
+
+// Background maintenance thread
+static void *maintenance_thread_func(void *arg) {
+    (void)arg;
+    
+    log_info("Database maintenance thread started");
+    
+    int wait_seconds = DB_MAINTENANCE_STARTUP_DELAY;
+    
+    while (true) {
+        pthread_mutex_lock(&maintenance.mutex);
+        
+        if (maintenance.running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += wait_seconds;
+            pthread_cond_timedwait(&maintenance.cond, &maintenance.mutex, &deadline);
+        }
+        
+        bool running = maintenance.running;
+        pthread_mutex_unlock(&maintenance.mutex);
+        
+        if (!running) {
+            break;
+        }
+        
+        run_maintenance_pass();
+        wait_seconds = DB_MAINTENANCE_INTERVAL;
+    }
+    
+    log_info("Database maintenance thread exiting");
+    return NULL;
+}
+
+// Start the background maintenance thread
+int start_db_maintenance(void) {
+    pthread_mutex_lock(&maintenance.mutex);
+    
+    if (maintenance.running) {
+        pthread_mutex_unlock(&maintenance.mutex);
+        return 0;
+    }
+    
+    maintenance.running = true;
+    maintenance.stopping = false;
+    
+    if (pthread_create(&maintenance.thread, NULL, maintenance_thread_func, NULL) != 0) {
+        log_error("Failed to create database maintenance thread");
+        maintenance.running = false;
+        pthread_mutex_unlock(&maintenance.mutex);
+        return -1;
+    }
+    
+    pthread_mutex_unlock(&maintenance.mutex);
+    
+    log_info("Database maintenance started (every %d seconds)", DB_MAINTENANCE_INTERVAL);
+    return 0;
+}
+
+// Stop the background maintenance thread
+void stop_db_maintenance(void) {
+    pthread_mutex_lock(&maintenance.mutex);
+    
+    if (!maintenance.running) {
+        pthread_mutex_unlock(&maintenance.mutex);
+        return;
+    }
+    
+    maintenance.running = false;
+    maintenance.stopping = true;
+    pthread_cond_signal(&maintenance.cond);
+    pthread_mutex_unlock(&maintenance.mutex);
+    
+    // A purge in progress stops after its current chunk
+    pthread_join(maintenance.thread, NULL);
+    
+    log_info("Database maintenance stopped");
+}
@@ -0,0 +1,467 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "database/db_recording_index.h"
+#include "database/db_core.h"
+#include "core/logger.h"
+
+// Recording as stored in the index
+typedef struct {
+    uint64_t id;
+    time_t start_time;
+    time_t end_time;
+    uint64_t size_bytes;
+    char *file_path;
+} index_entry_t;
+
+// Recordings of one stream, sorted by (start_time, id)
+typedef struct {
+    char name[64];
+    index_entry_t *entries;
+    int count;
+    int capacity;
+    time_t max_duration;    // Longest recording seen, bounds how early an overlap can start
+} stream_index_t;
+
+static struct {
+    bool loaded;
+    stream_index_t *streams;
+    int stream_count;
+    int stream_capacity;
+    pthread_mutex_t mutex;
+} recording_index = {
+    .loaded = false,
+    .streams = NULL,
+    .stream_count = 0,
+    .stream_capacity = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Free all streams (caller holds the index mutex)
+static void free_streams_locked(void) {
+    for (int i = 0; i < recording_index.stream_count; i++) {
+        stream_index_t *stream = &recording_index.streams[i];
+        for (int j = 0; j < stream->count; j++) {
+            free(stream->entries[j].file_path);
+        }
+        free(stream->entries);
+    }
+    free(recording_index.streams);
+
+    recording_index.streams = NULL;
+    recording_index.stream_count = 0;
+    recording_index.stream_capacity = 0;
+    recording_index.loaded = false;
+}
+
+// Find a stream, optionally adding it (caller holds the index mutex)
+static stream_index_t *find_stream_locked(const char *name, bool create) {
+    for (int i = 0; i < recording_index.stream_count; i++) {
+        if (strcmp(recording_index.streams[i].name, name) == 0) {
+            return &recording_index.streams[i];
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+
+    if (recording_index.stream_count == recording_index.stream_capacity) {
+        int capacity = recording_index.stream_capacity ? recording_index.stream_capacity * 2 : 16;
+        stream_index_t *streams = realloc(recording_index.streams, capacity * sizeof(stream_index_t));
+        if (!streams) {
+            return NULL;
+        }
+        recording_index.streams = streams;
+        recording_index.stream_capacity = capacity;
+    }
+
+    stream_index_t *stream = &recording_index.streams[recording_index.stream_count++];
+    memset(stream, 0, sizeof(*stream));
+    strncpy(stream->name, name, sizeof(stream->name) - 1);
+
+    return stream;
+}
+
+// First entry at or after (start_time, id)
+static int lower_bound(const stream_index_t *stream, time_t start_time, uint64_t id) {
+    int low = 0;
+    int high = stream->count;
+
+    while (low < high) {
+        int mid = low + (high - low) / 2;
+        const index_entry_t *entry = &stream->entries[mid];
+        if (entry->start_time < start_time ||
+            (entry->start_time == start_time && entry->id < id)) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return low;
+}
+
+// First entry that can overlap a range starting at start_time
+static int first_overlap(const stream_index_t *stream, time_t start_time) {
+    if (start_time <= 0) {
+        return 0;
+    }
+    return lower_bound(stream, start_time - stream->max_duration, 0);
+}
+
+// Copy an entry out of the index
+static void copy_entry(const index_entry_t *src, recording_index_entry_t *dst) {
+    dst->id = src->id;
+    dst->start_time = src->start_time;
+    dst->end_time = src->end_time;
+    dst->size_bytes = src->size_bytes;
+    strncpy(dst->file_path, src->file_path, sizeof(dst->file_path) - 1);
+    dst->file_path[sizeof(dst->file_path) - 1] = '\0';
+}
+
+// Add or update a recording (caller holds the index mutex)
+static int put_locked(const char *stream_name, uint64_t id, time_t start_time,
+                      time_t end_time, uint64_t size_bytes, const char *file_path) {
+    stream_index_t *stream = find_stream_locked(stream_name, true);
+    if (!stream) {
+        return -1;
+    }
+
+    // Recordings are added in start order, so this is almost always the end
+    int pos = lower_bound(stream, start_time, id);
+
+    if (pos < stream->count && stream->entries[pos].id == id) {
+        index_entry_t *entry = &stream->entries[pos];
+        if (strcmp(entry->file_path, file_path) != 0) {
+            char *path = strdup(file_path);
+            if (!path) {
+                return -1;
+            }
+            free(entry->file_path);
+            entry->file_path = path;
+        }
+        entry->end_time = end_time;
+        entry->size_bytes = size_bytes;
+    } else {
+        if (stream->count == stream->capacity) {
+            int capacity = stream->capacity ? stream->capacity * 2 : RECORDING_INDEX_INITIAL_CAPACITY;
+            index_entry_t *entries = realloc(stream->entries, capacity * sizeof(index_entry_t));
+            if (!entries) {
+                return -1;
+            }
+            stream->entries = entries;
+            stream->capacity = capacity;
+        }
+
+        char *path = strdup(file_path);
+        if (!path) {
+            return -1;
+        }
+
+        memmove(&stream->entries[pos + 1], &stream->entries[pos],
+                (stream->count - pos) * sizeof(index_entry_t));
+        stream->count++;
+
+        index_entry_t *entry = &stream->entries[pos];
+        entry->id = id;
+        entry->start_time = start_time;
+        entry->end_time = end_time;
+        entry->size_bytes = size_bytes;
+        entry->file_path = path;
+    }
+
+    if (end_time - start_time > stream->max_duration) {
+        stream->max_duration = end_time - start_time;
+    }
+
+    return 0;
+}
+
+// Load the recording index from the recordings table
+int recording_index_load(void) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+
+    const char *sql = "SELECT id, stream_name, start_time, end_time, size_bytes, file_path "
+                      "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL "
+                      "ORDER BY stream_name, start_time, id;";
+
+    // Hold the database mutex so no recording changes between the query and
+    // the index going live
+    pthread_mutex_lock(db_mutex);
+
+    sqlite3_stmt *stmt;
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+    free_streams_locked();
+
+    int count = 0;
+    int rc;
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        const char *stream_name = (const char *)sqlite3_column_text(stmt, 1);
+        const char *file_path = (const char *)sqlite3_column_text(stmt, 5);
+
+        if (put_locked(stream_name ? stream_name : "",
+                       (uint64_t)sqlite3_column_int64(stmt, 0),
+                       (time_t)sqlite3_column_int64(stmt, 2),
+                       (time_t)sqlite3_column_int64(stmt, 3),
+                       (uint64_t)sqlite3_column_int64(stmt, 4),
+                       file_path ? file_path : "") != 0) {
+            log_error("Out of memory loading recording index");
+            rc = SQLITE_NOMEM;
+            break;
+        }
+        count++;
+    }
+
+    if (rc != SQLITE_DONE) {
+        if (rc != SQLITE_NOMEM) {
+            log_error("Failed to load recording index: %s", sqlite3_errmsg(db));
+        }
+        free_streams_locked();
+        count = -1;
+    } else {
+        recording_index.loaded = true;
+    }
+
+    int stream_count = recording_index.stream_count;
+    pthread_mutex_unlock(&recording_index.mutex);
+
+    sqlite3_finalize(stmt);
+    pthread_mutex_unlock(db_mutex);
+
+    if (count >= 0) {
+        log_info("Loaded %d recordings of %d streams into the recording index", count, stream_count);
+    }
+
+    return count;
+}
+
+// Drop the recording index
+void recording_index_clear(void) {
+    pthread_mutex_lock(&recording_index.mutex);
+    free_streams_locked();
+    pthread_mutex_unlock(&recording_index.mutex);
+}
+
+// Check whether the recording index is loaded
+bool recording_index_loaded(void) {
+    pthread_mutex_lock(&recording_index.mutex);
+    bool loaded = recording_index.loaded;
+    pthread_mutex_unlock(&recording_index.mutex);
+    return loaded;
+}
+
+// Add or update a complete recording
+void recording_index_put(const char *stream_name, uint64_t id, time_t start_time,
+                         time_t end_time, uint64_t size_bytes, const char *file_path) {
+    if (!stream_name || !file_path) {
+        return;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    if (recording_index.loaded &&
+        put_locked(stream_name, id, start_time, end_time, size_bytes, file_path) != 0) {
+        // A missing recording would make lookups wrong, so stop using the
+        // index and let them go to the database
+        log_error("Out of memory updating recording index, disabling it");
+        free_streams_locked();
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+}
+
+// Remove a recording
+void recording_index_remove(const char *stream_name, uint64_t id, time_t start_time) {
+    if (!stream_name) {
+        return;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    stream_index_t *stream = recording_index.loaded ? find_stream_locked(stream_name, false) : NULL;
+    if (stream) {
+        int pos = lower_bound(stream, start_time, id);
+        if (pos < stream->count && stream->entries[pos].id == id) {
+            free(stream->entries[pos].file_path);
+            memmove(&stream->entries[pos], &stream->entries[pos + 1],
+                    (stream->count - pos - 1) * sizeof(index_entry_t));
+            stream->count--;
+        }
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+}
+
+// Remove all recordings that ended before a cutoff
+int recording_index_remove_ended_before(time_t cutoff_time) {
+    int removed = 0;
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    for (int i = 0; recording_index.loaded && i < recording_index.stream_count; i++) {
+        stream_index_t *stream = &recording_index.streams[i];
+        int kept = 0;
+
+        for (int j = 0; j < stream->count; j++) {
+            if (stream->entries[j].end_time < cutoff_time) {
+                free(stream->entries[j].file_path);
+                removed++;
+            } else {
+                stream->entries[kept++] = stream->entries[j];
+            }
+        }
+
+        stream->count = kept;
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+
+    return removed;
+}
+
+// Get the recordings of a stream that overlap a time range
+int recording_index_find_range(const char *stream_name, time_t start_time, time_t end_time,
+                               recording_index_entry_t *entries, int max_count) {
+    if (!stream_name || !entries || max_count <= 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    if (!recording_index.loaded) {
+        pthread_mutex_unlock(&recording_index.mutex);
+        return -1;
+    }
+
+    int count = 0;
+    stream_index_t *stream = find_stream_locked(stream_name, false);
+
+    if (stream) {
+        for (int i = first_overlap(stream, start_time); i < stream->count && count < max_count; i++) {
+            const index_entry_t *entry = &stream->entries[i];
+            if (end_time > 0 && entry->start_time > end_time) {
+                break;
+            }
+            if (start_time > 0 && entry->end_time < start_time) {
+                continue;
+            }
+            copy_entry(entry, &entries[count++]);
+        }
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+
+    return count;
+}
+
+// Find the recording of a stream that covers a point in time
+int recording_index_find_covering(const char *stream_name, time_t timestamp,
+                                  recording_index_entry_t *entry) {
+    if (!stream_name || !entry) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    if (!recording_index.loaded) {
+        pthread_mutex_unlock(&recording_index.mutex);
+        return -1;
+    }
+
+    const index_entry_t *found = NULL;
+    stream_index_t *stream = find_stream_locked(stream_name, false);
+
+    if (stream) {
+        for (int i = first_overlap(stream, timestamp); i < stream->count; i++) {
+            const index_entry_t *candidate = &stream->entries[i];
+            if (candidate->start_time > timestamp) {
+                break;
+            }
+            if (candidate->end_time >= timestamp) {
+                found = candidate;
+            }
+        }
+    }
+
+    if (found) {
+        copy_entry(found, entry);
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+
+    return found ? 0 : 1;
+}
+
+// Find the stretches of a time range that no recording of a stream covers
+int recording_index_find_gaps(const char *stream_name, time_t start_time, time_t end_time,
+                              int min_gap, recording_gap_t *gaps, int max_count) {
+    if (!stream_name || !gaps || max_count <= 0 || end_time < start_time) {
+        return -1;
+    }
+
+    if (min_gap < 1) {
+        min_gap = 1;
+    }
+
+    pthread_mutex_lock(&recording_index.mutex);
+
+    if (!recording_index.loaded) {
+        pthread_mutex_unlock(&recording_index.mutex);
+        return -1;
+    }
+
+    int count = 0;
+    time_t covered = start_time;
+    stream_index_t *stream = find_stream_locked(stream_name, false);
+
+    if (stream) {
+        for (int i = first_overlap(stream, start_time); i < stream->count && count < max_count; i++) {
+            const index_entry_t *entry = &stream->entries[i];
+            if (entry->start_time > end_time) {
+                break;
+            }
+
+            if (entry->start_time - covered >= min_gap) {
+                gaps[count].start_time = covered;
+                gaps[count].end_time = entry->start_time;
+                count++;
+            }
+
+            if (entry->end_time > covered) {
+                covered = entry->end_time;
+            }
+        }
+    }
+
+    if (count < max_count && end_time - covered >= min_gap) {
+        gaps[count].start_time = covered;
+        gaps[count].end_time = end_time;
+        count++;
+    }
+
+    pthread_mutex_unlock(&recording_index.mutex);
+
+    return count;
+}
@@ -8,11 +8,242 @@
 #include <time.h>
 #include <sqlite3.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "database/db_recordings.h"
 #include "database/db_core.h"
+#include "database/db_detections.h"
+#include "database/db_stmt_cache.h"
+#include "database/db_write_queue.h"
+#include "database/db_recording_index.h"
 #include "core/logger.h"
 
+// Number of filter combinations whose counts and page anchors are cached
+#define RECORDING_LIST_CACHE_SIZE 16
+
+// Cached counts are recomputed after this many seconds even without changes
+#define RECORDING_COUNT_CACHE_TTL 300
+
+// Pages per filter whose starting row is remembered
+#define RECORDING_MAX_PAGE_ANCHORS 64
+
+// Cached count and page anchors for one filter combination
+typedef struct {
+    bool in_use;
+    time_t start_time;
+    time_t end_time;
+    bool has_stream;
+    char stream_name[64];
+    bool has_detection;
+    int count;
+    bool count_valid;
+    time_t counted_at;
+    bool anchor_ascending;                              // Order the anchors were recorded for
+    int anchor_limit;                                   // Page size the anchors were recorded for
+    time_t anchor_start[RECORDING_MAX_PAGE_ANCHORS];    // Last row of page i+1, 0 id if unknown
+    uint64_t anchor_id[RECORDING_MAX_PAGE_ANCHORS];
+    uint64_t last_used;
+} recording_list_cache_entry_t;
+
+static struct {
+    recording_list_cache_entry_t entries[RECORDING_LIST_CACHE_SIZE];
+    uint64_t generation;    // Bumped whenever the set of listed recordings changes
+    uint64_t tick;
+    pthread_mutex_t mutex;
+} list_cache = {
+    .generation = 0,
+    .tick = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+
+// Read the detection aggregate columns starting at column col
+static void read_detection_summary(sqlite3_stmt *stmt, int col, recording_metadata_t *metadata) {
+    metadata->detection_count = sqlite3_column_int(stmt, col);
+    metadata->max_confidence = (float)sqlite3_column_double(stmt, col + 1);
+    
+    const char *labels = (const char *)sqlite3_column_text(stmt, col + 2);
+    if (labels) {
+        strncpy(metadata->detection_labels, labels, sizeof(metadata->detection_labels) - 1);
+        metadata->detection_labels[sizeof(metadata->detection_labels) - 1] = '\0';
+    } else {
+        metadata->detection_labels[0] = '\0';
+    }
+}
+
+// Look up the cache entry for a filter combination (caller holds list_cache.mutex)
+static recording_list_cache_entry_t *find_list_cache_entry(time_t start_time, time_t end_time,
+                                                          const char *stream_name, int has_detection,
+                                                          bool create) {
+    recording_list_cache_entry_t *slot = NULL;
+    
+    list_cache.tick++;
+    
+    for (int i = 0; i < RECORDING_LIST_CACHE_SIZE; i++) {
+        recording_list_cache_entry_t *entry = &list_cache.entries[i];
+        if (!entry->in_use) {
+            if (!slot) {
+                slot = entry;
+            }
+            continue;
+        }
+        
+        if (entry->start_time == start_time && entry->end_time == end_time &&
+            entry->has_detection == (has_detection != 0) &&
+            entry->has_stream == (stream_name != NULL) &&
+            (!stream_name || strcmp(entry->stream_name, stream_name) == 0)) {
+            entry->last_used = list_cache.tick;
+            return entry;
+        }
+        
+        if (!slot || (slot->in_use && entry->last_used < slot->last_used)) {
+            slot = entry;
+        }
+    }
+    
+    if (!create || !slot) {
+        return NULL;
+    }
+    
+    // Reuse an empty slot or evict the least recently used filter
+    memset(slot, 0, sizeof(*slot));
+    slot->in_use = true;
+    slot->start_time = start_time;
+    slot->end_time = end_time;
+    slot->has_detection = has_detection != 0;
+    if (stream_name) {
+        slot->has_stream = true;
+        strncpy(slot->stream_name, stream_name, sizeof(slot->stream_name) - 1);
+    }
+    slot->last_used = list_cache.tick;
+    
+    return slot;
+}
+
+// Apply a change in the set of listed recordings to the cached counts
+static void adjust_recording_list_cache(const char *stream_name, time_t start_time,
+                                        bool has_detection, int delta) {
+    pthread_mutex_lock(&list_cache.mutex);
+    
+    list_cache.generation++;
+    
+    for (int i = 0; i < RECORDING_LIST_CACHE_SIZE; i++) {
+        recording_list_cache_entry_t *entry = &list_cache.entries[i];
+        if (!entry->in_use) {
+            continue;
+        }
+        
+        // Skip filters the recording does not fall under
+        if ((entry->start_time > 0 && start_time < entry->start_time) ||
+            (entry->end_time > 0 && start_time > entry->end_time) ||
+            (entry->has_stream && (!stream_name || strcmp(entry->stream_name, stream_name) != 0)) ||
+            (entry->has_detection && !has_detection)) {
+            continue;
+        }
+        
+        if (entry->count_valid) {
+            entry->count += delta;
+            if (entry->count < 0) {
+                entry->count_valid = false;
+            }
+        }
+        
+        // Rows shifted between pages, so the anchors no longer line up
+        memset(entry->anchor_id, 0, sizeof(entry->anchor_id));
+    }
+    
+    pthread_mutex_unlock(&list_cache.mutex);
+}
+
+// Adjust the cached counts for a recording that was completed or is about to be
+// deleted (caller holds the database mutex)
+static void adjust_recording_list_cache_by_id(sqlite3 *db, uint64_t id, int delta) {
+    const char *sql = "SELECT stream_name, start_time, detection_count FROM recordings "
+                      "WHERE id = ? AND is_complete = 1 AND end_time IS NOT NULL;";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        invalidate_recording_list_cache();
+        return;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+    
+    // Recordings that are not listed do not affect the counts
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *stream = (const char *)sqlite3_column_text(stmt, 0);
+        adjust_recording_list_cache(stream, (time_t)sqlite3_column_int64(stmt, 1),
+                                    sqlite3_column_int(stmt, 2) > 0, delta);
+    }
+    
+    db_stmt_cache_release(stmt);
+}
+
+// Check whether a recording currently shows up in recording lists (caller holds
+// the database mutex)
+static bool recording_is_listed_locked(sqlite3 *db, uint64_t id) {
+    const char *sql = "SELECT 1 FROM recordings "
+                      "WHERE id = ? AND is_complete = 1 AND end_time IS NOT NULL;";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        return false;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+    bool listed = sqlite3_step(stmt) == SQLITE_ROW;
+    db_stmt_cache_release(stmt);
+    
+    return listed;
+}
+
+// Bring the recording index in line with a recording's row, or take the
+// recording out of it when the row is about to be deleted (caller holds the
+// database mutex)
+static void sync_recording_index_locked(sqlite3 *db, uint64_t id, bool removing) {
+    if (!recording_index_loaded()) {
+        return;
+    }
+    
+    const char *sql = "SELECT stream_name, start_time, end_time, size_bytes, file_path, "
+                      "is_complete = 1 AND end_time IS NOT NULL "
+                      "FROM recordings WHERE id = ?;";
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return;
+    }
+    
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)id);
+    
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        const char *stream = (const char *)sqlite3_column_text(stmt, 0);
+        time_t start_time = (time_t)sqlite3_column_int64(stmt, 1);
+        
+        if (!removing && sqlite3_column_int(stmt, 5)) {
+            const char *file_path = (const char *)sqlite3_column_text(stmt, 4);
+            recording_index_put(stream, id, start_time,
+                                (time_t)sqlite3_column_int64(stmt, 2),
+                                (uint64_t)sqlite3_column_int64(stmt, 3),
+                                file_path ? file_path : "");
+        } else {
+            recording_index_remove(stream, id, start_time);
+        }
+    }
+    
+    db_stmt_cache_release(stmt);
+}
+
+// Drop all cached recording counts and page anchors
+void invalidate_recording_list_cache(void) {
+    pthread_mutex_lock(&list_cache.mutex);
+    list_cache.generation++;
+    memset(list_cache.entries, 0, sizeof(list_cache.entries));
+    pthread_mutex_unlock(&list_cache.mutex);
+}
+
 // Add recording metadata to the database
 uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
     int rc;
@@ -38,8 +269,8 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
                       "size_bytes, width, height, fps, codec, is_complete) "
                       "VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?);";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
         pthread_mutex_unlock(db_mutex);
         return 0;
@@ -70,37 +301,32 @@ uint64_t add_recording_metadata(const recording_metadata_t *metadata) {
     } else {
         recording_id = (uint64_t)sqlite3_last_insert_rowid(db);
         log_debug("Added recording metadata with ID %llu", (unsigned long long)recording_id);
+        
+        if (metadata->is_complete && metadata->end_time > 0) {
+            adjust_recording_list_cache(metadata->stream_name, metadata->start_time, false, 1);
+            recording_index_put(metadata->stream_name, recording_id, metadata->start_time,
+                                metadata->end_time, metadata->size_bytes, metadata->file_path);
+        }
     }
     
-    sqlite3_finalize(stmt);
+    db_stmt_cache_release(stmt);
     pthread_mutex_unlock(db_mutex);
     
     return recording_id;
 }
 
-// Update recording metadata in the database
-int update_recording_metadata(uint64_t id, time_t end_time, 
-                             uint64_t size_bytes, bool is_complete) {
-    int rc;
-    sqlite3_stmt *stmt;
-    
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized");
-        return -1;
-    }
-    
-    pthread_mutex_lock(db_mutex);
-    
+// Update recording metadata using the writer connection (caller holds the database mutex)
+int update_recording_metadata_locked(sqlite3 *db, uint64_t id, time_t end_time, 
+                                    uint64_t size_bytes, bool is_complete) {
     const char *sql = "UPDATE recordings SET end_time = ?, size_bytes = ?, is_complete = ? "
                       "WHERE id = ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    // Completing a recording adds it to the lists unless it was already complete
+    bool was_listed = is_complete && recording_is_listed_locked(db, id);
+    
+    sqlite3_stmt *stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
         return -1;
     }
     
@@ -111,20 +337,58 @@ int update_recording_metadata(uint64_t id, time_t end_time,
     sqlite3_bind_int64(stmt, 4, (sqlite3_int64)id);
     
     // Execute statement
-    rc = sqlite3_step(stmt);
+    int rc = sqlite3_step(stmt);
     if (rc != SQLITE_DONE) {
         log_error("Failed to update recording metadata: %s", sqlite3_errmsg(db));
-        sqlite3_finalize(stmt);
-        pthread_mutex_unlock(db_mutex);
+        db_stmt_cache_release(stmt);
         return -1;
     }
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_stmt_cache_release(stmt);
+    
+    if (is_complete) {
+        refresh_recording_detections_locked(db, id);
+        if (!was_listed) {
+            adjust_recording_list_cache_by_id(db, id, 1);
+        }
+    }
+    
+    sync_recording_index_locked(db, id, false);
     
     return 0;
 }
 
+// Update recording metadata in the database
+int update_recording_metadata(uint64_t id, time_t end_time, 
+                             uint64_t size_bytes, bool is_complete) {
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    if (is_complete) {
+        // A queued progress update must not land after this and clear the
+        // complete flag again, so drop any that are still pending
+        db_write_queue_cancel_recording_updates(id);
+        
+        // The detection aggregates are computed from the frames when the
+        // recording completes, so the queued frames have to be in first
+        db_write_queue_flush();
+    } else if (db_write_queue_recording_update(id, end_time, size_bytes) == 0) {
+        // Progress updates are written behind in batches
+        return 0;
+    }
+    
+    pthread_mutex_lock(db_mutex);
+    int result = update_recording_metadata_locked(db, id, end_time, size_bytes, is_complete);
+    pthread_mutex_unlock(db_mutex);
+    
+    return result;
+}
+
 // Get recording metadata by ID
 int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
     int rc;
@@ -132,7 +396,6 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
     int result = -1;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -144,16 +407,17 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     const char *sql = "SELECT id, stream_name, file_path, start_time, end_time, "
-                      "size_bytes, width, height, fps, codec, is_complete "
+                      "size_bytes, width, height, fps, codec, is_complete, "
+                      "detection_count, max_confidence, detection_labels "
                       "FROM recordings WHERE id = ?;";
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -202,12 +466,13 @@ int get_recording_metadata_by_id(uint64_t id, recording_metadata_t *metadata) {
         }
         
         metadata->is_complete = sqlite3_column_int(stmt, 10) != 0;
+        read_detection_summary(stmt, 11, metadata);
         
         result = 0; // Success
     }
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
     
     return result;
 }
@@ -221,7 +486,6 @@ int get_recording_metadata(time_t start_time, time_t end_time,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -233,12 +497,13 @@ int get_recording_metadata(time_t start_time, time_t end_time,
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     // Build query based on filters
     char sql[1024];
     strcpy(sql, "SELECT id, stream_name, file_path, start_time, end_time, "
-                 "size_bytes, width, height, fps, codec, is_complete "
+                 "size_bytes, width, height, fps, codec, is_complete, "
+                 "detection_count, max_confidence, detection_labels "
                  "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL"); // Only complete recordings with end_time set
     
     if (start_time > 0) {
@@ -258,7 +523,7 @@ int get_recording_metadata(time_t start_time, time_t end_time,
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -324,6 +589,7 @@ int get_recording_metadata(time_t start_time, time_t end_time,
             }
             
             metadata[count].is_complete = sqlite3_column_int(stmt, 10) != 0;
+            read_detection_summary(stmt, 11, &metadata[count]);
             
             count++;
         }
@@ -334,7 +600,7 @@ int get_recording_metadata(time_t start_time, time_t end_time,
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
     
     log_info("Found %d recordings in database matching criteria", count);
     return count;
@@ -348,27 +614,36 @@ int get_recording_count(time_t start_time, time_t end_time,
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    // Serve the count from the cache while it is fresh; it is kept up to date
+    // as recordings are completed and deleted
+    pthread_mutex_lock(&list_cache.mutex);
+    recording_list_cache_entry_t *entry = find_list_cache_entry(start_time, end_time, stream_name,
+                                                                has_detection, false);
+    if (entry && entry->count_valid && time(NULL) - entry->counted_at < RECORDING_COUNT_CACHE_TTL) {
+        count = entry->count;
+        pthread_mutex_unlock(&list_cache.mutex);
+        log_debug("Using cached recording count: %d", count);
+        return count;
+    }
+    uint64_t generation = list_cache.generation;
+    pthread_mutex_unlock(&list_cache.mutex);
+    
+    db = db_acquire_reader();
     
     // Build query based on filters
     char sql[1024];
     
+    strcpy(sql, "SELECT COUNT(*) FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+    
     if (has_detection) {
-        // Use a JOIN with the detections table to filter recordings with detections
-        strcpy(sql, "SELECT COUNT(DISTINCT r.id) FROM recordings r "
-                    "INNER JOIN detections d ON r.stream_name = d.stream_name "
-                    "WHERE r.is_complete = 1 AND r.end_time IS NOT NULL "
-                    "AND d.timestamp BETWEEN r.start_time AND r.end_time");
-    } else {
-        // Simple query without detection filter
-        strcpy(sql, "SELECT COUNT(*) FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+        // Detections are linked to recordings at insert time
+        strcat(sql, " AND detection_count > 0");
     }
     
     if (start_time > 0) {
@@ -382,11 +657,7 @@ int get_recording_count(time_t start_time, time_t end_time,
     }
     
     if (stream_name) {
-        if (has_detection) {
-            strcat(sql, " AND r.stream_name = ?");
-        } else {
-            strcat(sql, " AND stream_name = ?");
-        }
+        strcat(sql, " AND stream_name = ?");
     }
     
     log_info("SQL query for get_recording_count: %s", sql);
@@ -394,7 +665,7 @@ int get_recording_count(time_t start_time, time_t end_time,
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -422,130 +693,87 @@ int get_recording_count(time_t start_time, time_t end_time,
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
+    
+    // Only cache the result if no recording was completed or deleted meanwhile
+    if (count >= 0) {
+        pthread_mutex_lock(&list_cache.mutex);
+        if (list_cache.generation == generation) {
+            entry = find_list_cache_entry(start_time, end_time, stream_name, has_detection, true);
+            if (entry) {
+                entry->count = count;
+                entry->count_valid = true;
+                entry->counted_at = time(NULL);
+            }
+        }
+        pthread_mutex_unlock(&list_cache.mutex);
+    }
     
     log_info("Total count of recordings matching criteria: %d", count);
     return count;
 }
 
-// Get paginated recording metadata from the database with sorting
-int get_recording_metadata_paginated(time_t start_time, time_t end_time, 
-                                   const char *stream_name, int has_detection,
-                                   const char *sort_field, const char *sort_order,
-                                   recording_metadata_t *metadata, 
-                                   int limit, int offset) {
+// Run one page query, positioned either by a keyset cursor or by an offset
+static int query_recordings_page(time_t start_time, time_t end_time,
+                                 const char *stream_name, int has_detection,
+                                 const char *sort_field, bool ascending,
+                                 const recording_cursor_t *after, int offset,
+                                 recording_metadata_t *metadata, int limit) {
     int rc;
     sqlite3_stmt *stmt;
     int count = 0;
     
-    sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
-    
-    if (!db) {
-        log_error("Database not initialized");
-        return -1;
-    }
-    
-    if (!metadata || limit <= 0) {
-        log_error("Invalid parameters for get_recording_metadata_paginated");
-        return -1;
-    }
-    
-    pthread_mutex_lock(db_mutex);
-    
-    // Validate and sanitize sort field to prevent SQL injection
-    char safe_sort_field[32] = "start_time"; // Default sort field
-    if (sort_field) {
-        if (strcmp(sort_field, "id") == 0 ||
-            strcmp(sort_field, "stream_name") == 0 ||
-            strcmp(sort_field, "start_time") == 0 ||
-            strcmp(sort_field, "end_time") == 0 ||
-            strcmp(sort_field, "size_bytes") == 0) {
-            strncpy(safe_sort_field, sort_field, sizeof(safe_sort_field) - 1);
-            safe_sort_field[sizeof(safe_sort_field) - 1] = '\0';
-        } else {
-            log_warn("Invalid sort field: %s, using default", sort_field);
-        }
-    }
-    
-    // Validate sort order
-    char safe_sort_order[8] = "DESC"; // Default sort order
-    if (sort_order) {
-        if (strcasecmp(sort_order, "asc") == 0) {
-            strcpy(safe_sort_order, "ASC");
-        } else if (strcasecmp(sort_order, "desc") == 0) {
-            strcpy(safe_sort_order, "DESC");
-        } else {
-            log_warn("Invalid sort order: %s, using default", sort_order);
-        }
-    }
+    sqlite3 *db = db_acquire_reader();
     
     // Build query based on filters
     char sql[1024];
     
+    snprintf(sql, sizeof(sql), 
+            "SELECT id, stream_name, file_path, start_time, end_time, "
+            "size_bytes, width, height, fps, codec, is_complete, "
+            "detection_count, max_confidence, detection_labels "
+            "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+    
     if (has_detection) {
-        // Use a JOIN with the detections table to filter recordings with detections
-        snprintf(sql, sizeof(sql), 
-                "SELECT DISTINCT r.id, r.stream_name, r.file_path, r.start_time, r.end_time, "
-                "r.size_bytes, r.width, r.height, r.fps, r.codec, r.is_complete "
-                "FROM recordings r "
-                "INNER JOIN detections d ON r.stream_name = d.stream_name "
-                "WHERE r.is_complete = 1 AND r.end_time IS NOT NULL "
-                "AND d.timestamp BETWEEN r.start_time AND r.end_time");
-    } else {
-        // Simple query without detection filter
-        snprintf(sql, sizeof(sql), 
-                "SELECT id, stream_name, file_path, start_time, end_time, "
-                "size_bytes, width, height, fps, codec, is_complete "
-                "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL");
+        // Detections are linked to recordings at insert time
+        strcat(sql, " AND detection_count > 0");
     }
     
     if (start_time > 0) {
-        if (has_detection) {
-            strcat(sql, " AND r.start_time >= ?");
-        } else {
-            strcat(sql, " AND start_time >= ?");
-        }
+        strcat(sql, " AND start_time >= ?");
         log_info("Adding start_time filter to paginated query: %ld", (long)start_time);
     }
     
     if (end_time > 0) {
-        if (has_detection) {
-            strcat(sql, " AND r.start_time <= ?");
-        } else {
-            strcat(sql, " AND start_time <= ?");
-        }
+        strcat(sql, " AND start_time <= ?");
         log_info("Adding end_time filter to paginated query: %ld", (long)end_time);
     }
     
     if (stream_name) {
-        if (has_detection) {
-            strcat(sql, " AND r.stream_name = ?");
-        } else {
-            strcat(sql, " AND stream_name = ?");
-        }
+        strcat(sql, " AND stream_name = ?");
     }
     
-    // Add ORDER BY clause with sanitized field and order
-    char order_clause[64];
-    if (has_detection) {
-        snprintf(order_clause, sizeof(order_clause), " ORDER BY r.%s %s", safe_sort_field, safe_sort_order);
-    } else {
-        snprintf(order_clause, sizeof(order_clause), " ORDER BY %s %s", safe_sort_field, safe_sort_order);
+    if (after) {
+        // Seek past the cursor on (start_time, id); the first term is a plain
+        // range so the start_time index is used to find the starting row
+        strcat(sql, ascending ? " AND start_time >= ? AND (start_time > ? OR id > ?)"
+                              : " AND start_time <= ? AND (start_time < ? OR id < ?)");
     }
+    
+    // Add ORDER BY clause with sanitized field and order, id keeps ties stable
+    char order_clause[64];
+    snprintf(order_clause, sizeof(order_clause), " ORDER BY %s %s, id %s",
+             sort_field, ascending ? "ASC" : "DESC", ascending ? "ASC" : "DESC");
     strcat(sql, order_clause);
     
-    // Add LIMIT and OFFSET for pagination
-    char limit_clause[64];
-    snprintf(limit_clause, sizeof(limit_clause), " LIMIT ? OFFSET ?");
-    strcat(sql, limit_clause);
+    strcat(sql, after ? " LIMIT ?" : " LIMIT ? OFFSET ?");
     
     log_info("SQL query for get_recording_metadata_paginated: %s", sql);
     
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -564,9 +792,17 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
         sqlite3_bind_text(stmt, param_index++, stream_name, -1, SQLITE_STATIC);
     }
     
+    if (after) {
+        sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)after->start_time);
+        sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)after->start_time);
+        sqlite3_bind_int64(stmt, param_index++, (sqlite3_int64)after->id);
+    }
+    
     // Bind LIMIT and OFFSET parameters
     sqlite3_bind_int(stmt, param_index++, limit);
-    sqlite3_bind_int(stmt, param_index, offset);
+    if (!after) {
+        sqlite3_bind_int(stmt, param_index, offset);
+    }
     
     // Execute query and fetch results
     int rc_step;
@@ -613,6 +849,7 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
             }
             
             metadata[count].is_complete = sqlite3_column_int(stmt, 10) != 0;
+            read_detection_summary(stmt, 11, &metadata[count]);
             
             count++;
         }
@@ -623,10 +860,182 @@ int get_recording_metadata_paginated(time_t start_time, time_t end_time,
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
+    
+    return count;
+}
+
+// Find the last recording of the page before a page sorted by start time
+bool get_recording_page_anchor(time_t start_time, time_t end_time,
+                               const char *stream_name, int has_detection,
+                               bool ascending, int limit, int offset,
+                               recording_cursor_t *anchor, uint64_t *generation) {
+    if (limit <= 0 || offset < 0 || !anchor) {
+        return false;
+    }
+    
+    int page = offset / limit;
+    bool found = false;
+    
+    pthread_mutex_lock(&list_cache.mutex);
+    recording_list_cache_entry_t *entry = find_list_cache_entry(start_time, end_time, stream_name,
+                                                                has_detection, false);
+    if (entry && offset % limit == 0 && page > 0 && page <= RECORDING_MAX_PAGE_ANCHORS &&
+        entry->anchor_ascending == ascending && entry->anchor_limit == limit &&
+        entry->anchor_id[page - 1] != 0) {
+        anchor->start_time = entry->anchor_start[page - 1];
+        anchor->id = entry->anchor_id[page - 1];
+        found = true;
+    }
+    if (generation) {
+        *generation = list_cache.generation;
+    }
+    pthread_mutex_unlock(&list_cache.mutex);
+    
+    return found;
+}
+
+// Remember the last recording of a full page sorted by start time
+void set_recording_page_anchor(time_t start_time, time_t end_time,
+                               const char *stream_name, int has_detection,
+                               bool ascending, int limit, int offset,
+                               const recording_cursor_t *last, uint64_t generation) {
+    if (limit <= 0 || offset < 0 || offset % limit != 0 || !last || last->id == 0) {
+        return;
+    }
+    
+    int page = offset / limit;
+    if (page >= RECORDING_MAX_PAGE_ANCHORS) {
+        return;
+    }
+    
+    pthread_mutex_lock(&list_cache.mutex);
+    // Rows added or removed since the page was read may have shifted it
+    if (list_cache.generation == generation) {
+        recording_list_cache_entry_t *entry = find_list_cache_entry(start_time, end_time, stream_name,
+                                                                    has_detection, true);
+        if (entry) {
+            if (entry->anchor_ascending != ascending || entry->anchor_limit != limit) {
+                memset(entry->anchor_id, 0, sizeof(entry->anchor_id));
+                entry->anchor_ascending = ascending;
+                entry->anchor_limit = limit;
+            }
+            entry->anchor_start[page] = last->start_time;
+            entry->anchor_id[page] = last->id;
+        }
+    }
+    pthread_mutex_unlock(&list_cache.mutex);
+}
+
+// Get paginated recording metadata from the database with sorting
+int get_recording_metadata_paginated(time_t start_time, time_t end_time, 
+                                   const char *stream_name, int has_detection,
+                                   const char *sort_field, const char *sort_order,
+                                   recording_metadata_t *metadata, 
+                                   int limit, int offset) {
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
     
-    log_info("Found %d recordings in database matching criteria (page %d, limit %d)", 
-             count, (offset / limit) + 1, limit);
+    if (!metadata || limit <= 0) {
+        log_error("Invalid parameters for get_recording_metadata_paginated");
+        return -1;
+    }
+    
+    // Validate and sanitize sort field to prevent SQL injection
+    char safe_sort_field[32] = "start_time"; // Default sort field
+    if (sort_field) {
+        if (strcmp(sort_field, "id") == 0 ||
+            strcmp(sort_field, "stream_name") == 0 ||
+            strcmp(sort_field, "start_time") == 0 ||
+            strcmp(sort_field, "end_time") == 0 ||
+            strcmp(sort_field, "size_bytes") == 0) {
+            strncpy(safe_sort_field, sort_field, sizeof(safe_sort_field) - 1);
+            safe_sort_field[sizeof(safe_sort_field) - 1] = '\0';
+        } else {
+            log_warn("Invalid sort field: %s, using default", sort_field);
+        }
+    }
+    
+    // Validate sort order
+    bool ascending = false; // Default sort order
+    if (sort_order) {
+        if (strcasecmp(sort_order, "asc") == 0) {
+            ascending = true;
+        } else if (strcasecmp(sort_order, "desc") != 0) {
+            log_warn("Invalid sort order: %s, using default", sort_order);
+        }
+    }
+    
+    if (offset < 0) {
+        offset = 0;
+    }
+    
+    // Pages sorted by start time are located from the last row of the page
+    // before when it has been seen, so page N costs the same as page 1
+    bool keyset = strcmp(safe_sort_field, "start_time") == 0;
+    int page = offset / limit;
+    recording_cursor_t anchor = {0};
+    bool have_anchor = false;
+    uint64_t generation = 0;
+    
+    if (keyset) {
+        have_anchor = get_recording_page_anchor(start_time, end_time, stream_name, has_detection,
+                                                ascending, limit, offset, &anchor, &generation);
+    }
+    
+    int count = query_recordings_page(start_time, end_time, stream_name, has_detection,
+                                      safe_sort_field, ascending, have_anchor ? &anchor : NULL,
+                                      offset, metadata, limit);
+    
+    // Remember where the next page starts
+    if (keyset && count == limit) {
+        recording_cursor_t last = {
+            .start_time = metadata[count - 1].start_time,
+            .id = metadata[count - 1].id
+        };
+        set_recording_page_anchor(start_time, end_time, stream_name, has_detection,
+                                  ascending, limit, offset, &last, generation);
+    }
+    
+    if (count >= 0) {
+        log_info("Found %d recordings in database matching criteria (page %d, limit %d%s)", 
+                 count, page + 1, limit, have_anchor ? ", keyset" : "");
+    }
+    return count;
+}
+
+// Get the page of recordings that follows a cursor, ordered by start time
+int get_recording_metadata_after(time_t start_time, time_t end_time,
+                                 const char *stream_name, int has_detection,
+                                 bool ascending, const recording_cursor_t *after,
+                                 recording_metadata_t *metadata, int limit, int offset) {
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    if (!metadata || limit <= 0 || offset < 0) {
+        log_error("Invalid parameters for get_recording_metadata_after");
+        return -1;
+    }
+    
+    // A cursor without a row behind it starts from the first page
+    if (after && after->id == 0) {
+        after = NULL;
+    }
+    
+    int count = query_recordings_page(start_time, end_time, stream_name, has_detection,
+                                      "start_time", ascending, after, offset, metadata, limit);
+    
+    if (count >= 0) {
+        log_info("Found %d recordings in database matching criteria (cursor, limit %d)", count, limit);
+    }
     return count;
 }
 
@@ -645,11 +1054,17 @@ int delete_recording_metadata(uint64_t id) {
     
     pthread_mutex_lock(db_mutex);
     
+    // Take the recording out of the cached counts and the index while its
+    // row is still there
+    adjust_recording_list_cache_by_id(db, id, -1);
+    sync_recording_index_locked(db, id, true);
+    
     const char *sql = "DELETE FROM recordings WHERE id = ?;";
     
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        sync_recording_index_locked(db, id, false);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
@@ -662,6 +1077,7 @@ int delete_recording_metadata(uint64_t id) {
     if (rc != SQLITE_DONE) {
         log_error("Failed to delete recording metadata: %s", sqlite3_errmsg(db));
         sqlite3_finalize(stmt);
+        sync_recording_index_locked(db, id, false);
         pthread_mutex_unlock(db_mutex);
         return -1;
     }
@@ -714,8 +1130,165 @@ int delete_old_recording_metadata(uint64_t max_age) {
     
     deleted_count = sqlite3_changes(db);
     
+    if (deleted_count > 0) {
+        invalidate_recording_list_cache();
+        recording_index_remove_ended_before(cutoff_time);
+    }
+    
     sqlite3_finalize(stmt);
     pthread_mutex_unlock(db_mutex);
     
     return deleted_count;
 }
+
+// Get complete recordings that are candidates for moving to another storage tier
+int get_recordings_for_tiering(time_t older_than, const char *path_prefix, uint64_t after_id,
+                              recording_metadata_t *metadata, int max_count) {
+    int rc;
+    sqlite3_stmt *stmt;
+    int count = 0;
+    
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    if (!path_prefix || !metadata || max_count <= 0) {
+        log_error("Invalid parameters for get_recordings_for_tiering");
+        return -1;
+    }
+    
+    db = db_acquire_reader();
+    
+    // Compare the prefix with substr() rather than LIKE so that '%' and '_'
+    // in storage paths are not treated as wildcards
+    const char *sql = "SELECT id, stream_name, file_path, start_time, end_time, "
+                      "size_bytes, width, height, fps, codec, is_complete, "
+                      "detection_count, max_confidence, detection_labels "
+                      "FROM recordings WHERE is_complete = 1 AND end_time IS NOT NULL "
+                      "AND end_time < ? AND substr(file_path, 1, ?) = ? AND id > ? "
+                      "ORDER BY id ASC LIMIT ?;";
+    
+    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        db_release_reader(db);
+        return -1;
+    }
+    
+    // Bind parameters
+    sqlite3_bind_int64(stmt, 1, (sqlite3_int64)older_than);
+    sqlite3_bind_int(stmt, 2, (int)strlen(path_prefix));
+    sqlite3_bind_text(stmt, 3, path_prefix, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 4, (sqlite3_int64)after_id);
+    sqlite3_bind_int(stmt, 5, max_count);
+    
+    // Execute query and fetch results
+    int rc_step;
+    while ((rc_step = sqlite3_step(stmt)) == SQLITE_ROW && count < max_count) {
+        metadata[count].id = (uint64_t)sqlite3_column_int64(stmt, 0);
+        
+        const char *stream = (const char *)sqlite3_column_text(stmt, 1);
+        if (stream) {
+            strncpy(metadata[count].stream_name, stream, sizeof(metadata[count].stream_name) - 1);
+            metadata[count].stream_name[sizeof(metadata[count].stream_name) - 1] = '\0';
+        } else {
+            metadata[count].stream_name[0] = '\0';
+        }
+        
+        const char *path = (const char *)sqlite3_column_text(stmt, 2);
+        if (path) {
+            strncpy(metadata[count].file_path, path, sizeof(metadata[count].file_path) - 1);
+            metadata[count].file_path[sizeof(metadata[count].file_path) - 1] = '\0';
+        } else {
+            metadata[count].file_path[0] = '\0';
+        }
+        
+        metadata[count].start_time = (time_t)sqlite3_column_int64(stmt, 3);
+        metadata[count].end_time = (time_t)sqlite3_column_int64(stmt, 4);
+        metadata[count].size_bytes = (uint64_t)sqlite3_column_int64(stmt, 5);
+        metadata[count].width = sqlite3_column_int(stmt, 6);
+        metadata[count].height = sqlite3_column_int(stmt, 7);
+        metadata[count].fps = sqlite3_column_int(stmt, 8);
+        
+        const char *codec = (const char *)sqlite3_column_text(stmt, 9);
+        if (codec) {
+            strncpy(metadata[count].codec, codec, sizeof(metadata[count].codec) - 1);
+            metadata[count].codec[sizeof(metadata[count].codec) - 1] = '\0';
+        } else {
+            metadata[count].codec[0] = '\0';
+        }
+        
+        metadata[count].is_complete = sqlite3_column_int(stmt, 10) != 0;
+        read_detection_summary(stmt, 11, &metadata[count]);
+        
+        count++;
+    }
+    
+    if (rc_step != SQLITE_DONE && rc_step != SQLITE_ROW) {
+        log_error("Error while fetching recordings for tiering: %s", sqlite3_errmsg(db));
+    }
+    
+    sqlite3_finalize(stmt);
+    db_release_reader(db);
+    
+    return count;
+}
+
+// Atomically change the file path of a recording
+int update_recording_file_path(uint64_t id, const char *old_path, const char *new_path) {
+    int rc;
+    sqlite3_stmt *stmt;
+    
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    if (!old_path || !new_path) {
+        log_error("Invalid parameters for update_recording_file_path");
+        return -1;
+    }
+    
+    pthread_mutex_lock(db_mutex);
+    
+    const char *sql = "UPDATE recordings SET file_path = ? WHERE id = ? AND file_path = ?;";
+    
+    stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+    
+    // Bind parameters
+    sqlite3_bind_text(stmt, 1, new_path, -1, SQLITE_STATIC);
+    sqlite3_bind_int64(stmt, 2, (sqlite3_int64)id);
+    sqlite3_bind_text(stmt, 3, old_path, -1, SQLITE_STATIC);
+    
+    // Execute statement
+    rc = sqlite3_step(stmt);
+    if (rc != SQLITE_DONE) {
+        log_error("Failed to update recording file path: %s", sqlite3_errmsg(db));
+        db_stmt_cache_release(stmt);
+        pthread_mutex_unlock(db_mutex);
+        return -1;
+    }
+    
+    int changes = sqlite3_changes(db);
+    
+    db_stmt_cache_release(stmt);
+    
+    if (changes > 0) {
+        sync_recording_index_locked(db, id, false);
+    }
+    
+    pthread_mutex_unlock(db_mutex);
+    
+    return (changes > 0) ? 0 : 1;
+}
@@ -10,10 +10,11 @@
 
 #include "database/db_schema.h"
 #include "database/db_core.h"
+#include "database/db_detections.h"
 #include "core/logger.h"
 
 // Current schema version - increment this when adding new migrations
-#define CURRENT_SCHEMA_VERSION 5
+#define CURRENT_SCHEMA_VERSION 8
 
 // Migration function type
 typedef int (*migration_func_t)(void);
@@ -23,6 +24,9 @@ static int migration_v1_to_v2(void);
 static int migration_v2_to_v3(void);
 static int migration_v3_to_v4(void);
 static int migration_v4_to_v5(void);
+static int migration_v5_to_v6(void);
+static int migration_v6_to_v7(void);
+static int migration_v7_to_v8(void);
 
 // Array of migration functions
 static migration_func_t migrations[] = {
@@ -30,7 +34,10 @@ static migration_func_t migrations[] = {
     migration_v1_to_v2, // v1->v2
     migration_v2_to_v3, // v2->v3
     migration_v3_to_v4, // v3->v4
-    migration_v4_to_v5  // v4->v5
+    migration_v4_to_v5, // v4->v5
+    migration_v5_to_v6, // v5->v6
+    migration_v6_to_v7, // v6->v7
+    migration_v7_to_v8  // v7->v8
 };
 
 /**
@@ -402,6 +409,23 @@ int add_column_if_not_exists(const char *table_name, const char *column_name, co
     return 0;
 }
 
+// Check whether a table exists
+static bool table_exists(sqlite3 *db, const char *table_name) {
+    sqlite3_stmt *stmt;
+    
+    if (sqlite3_prepare_v2(db, "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = ?;",
+                           -1, &stmt, NULL) != SQLITE_OK) {
+        log_error("Failed to prepare statement to check table existence: %s", sqlite3_errmsg(db));
+        return false;
+    }
+    
+    sqlite3_bind_text(stmt, 1, table_name, -1, SQLITE_STATIC);
+    bool exists = sqlite3_step(stmt) == SQLITE_ROW;
+    sqlite3_finalize(stmt);
+    
+    return exists;
+}
+
 /**
  * Migration from version 1 to 2
  * - Add detection columns to streams table
@@ -576,3 +600,243 @@ static int migration_v4_to_v5(void) {
     log_info("Completed migration v4 to v5 with result: %d", rc);
     return 0;
 }
+
+/**
+ * Migration from version 5 to 6
+ * - Link detections to the recording they occurred in
+ * - Keep per-recording detection aggregates on the recordings table
+ */
+static int migration_v5_to_v6(void) {
+    log_info("Running migration from v5 to v6: Linking detections to recordings");
+    
+    int rc = 0;
+    char *err_msg = NULL;
+    
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    // Databases created after v7 never had the per-detection table
+    bool legacy_detections = table_exists(db, "detections");
+    
+    if (legacy_detections) {
+        log_info("Adding recording_id column to detections");
+        rc |= add_column_if_not_exists("detections", "recording_id", "INTEGER");
+    }
+    
+    log_info("Adding detection aggregate columns to recordings");
+    rc |= add_column_if_not_exists("recordings", "detection_count", "INTEGER DEFAULT 0");
+    rc |= add_column_if_not_exists("recordings", "max_confidence", "REAL DEFAULT 0");
+    rc |= add_column_if_not_exists("recordings", "detection_labels", "TEXT DEFAULT ''");
+    
+    if (rc != 0) {
+        log_error("Failed to add detection linkage columns");
+        return -1;
+    }
+    
+    const char *create_indexes = 
+        "CREATE INDEX IF NOT EXISTS idx_recordings_stream_start ON recordings (stream_name, start_time);"
+        "CREATE INDEX IF NOT EXISTS idx_recordings_with_detections ON recordings (start_time) "
+        "WHERE detection_count > 0;";
+    
+    rc = sqlite3_exec(db, create_indexes, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to create detection linkage indexes: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    
+    if (!legacy_detections) {
+        log_info("Completed migration v5 to v6");
+        return 0;
+    }
+    
+    // Tag existing detections with the recording covering their timestamp
+    log_info("Linking existing detections to recordings, this may take a while on large databases");
+    const char *link_detections = 
+        "UPDATE detections SET recording_id = ("
+        "SELECT r.id FROM recordings r "
+        "WHERE r.stream_name = detections.stream_name "
+        "AND r.start_time <= detections.timestamp "
+        "AND r.end_time >= detections.timestamp "
+        "ORDER BY r.start_time DESC LIMIT 1) "
+        "WHERE recording_id IS NULL;";
+    
+    rc = sqlite3_exec(db, link_detections, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to link detections to recordings: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    
+    // Fill in the aggregates for recordings that have detections
+    const char *fill_aggregates = 
+        "UPDATE recordings SET "
+        "detection_count = (SELECT COUNT(*) FROM detections WHERE recording_id = recordings.id), "
+        "max_confidence = (SELECT MAX(confidence) FROM detections WHERE recording_id = recordings.id), "
+        "detection_labels = COALESCE((SELECT substr(group_concat(DISTINCT label), 1, 127) "
+        "FROM detections WHERE recording_id = recordings.id), '') "
+        "WHERE id IN (SELECT DISTINCT recording_id FROM detections WHERE recording_id IS NOT NULL);";
+    
+    rc = sqlite3_exec(db, fill_aggregates, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to fill recording detection aggregates: %s", err_msg);
+        sqlite3_free(err_msg);
+        return -1;
+    }
+    
+    log_info("Completed migration v5 to v6");
+    return 0;
+}
+
+/**
+ * Migration from version 6 to 7
+ * - Pack the per-detection rows into one row per frame, with stream and
+ *   label dictionary ids and 16-bit quantized boxes
+ */
+static int migration_v6_to_v7(void) {
+    log_info("Running migration from v6 to v7: Packing detections into compact frames");
+    
+    int rc;
+    sqlite3_stmt *stmt;
+    char *err_msg = NULL;
+    
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    // The compact tables are created at startup, only old rows need converting
+    if (!table_exists(db, "detections")) {
+        log_info("No per-detection table to convert");
+        log_info("Completed migration v6 to v7");
+        return 0;
+    }
+    
+    log_info("Converting existing detections, this may take a while on large databases");
+    
+    const char *select_sql = 
+        "SELECT stream_name, timestamp, recording_id, label, confidence, x, y, width, height "
+        "FROM detections ORDER BY stream_name, timestamp, id;";
+    
+    rc = sqlite3_prepare_v2(db, select_sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+    
+    char frame_stream[64] = {0};
+    time_t frame_timestamp = 0;
+    uint64_t frame_recording = 0;
+    detection_t frame[MAX_DETECTIONS];
+    int frame_count = 0;
+    int rows = 0;
+    int frames = 0;
+    int result = 0;
+    
+    while (result == 0) {
+        rc = sqlite3_step(stmt);
+        
+        const char *stream = NULL;
+        time_t timestamp = 0;
+        uint64_t recording_id = 0;
+        if (rc == SQLITE_ROW) {
+            stream = (const char *)sqlite3_column_text(stmt, 0);
+            timestamp = (time_t)sqlite3_column_int64(stmt, 1);
+            recording_id = (uint64_t)sqlite3_column_int64(stmt, 2);
+            if (!stream) {
+                continue;
+            }
+        }
+        
+        // Rows of the same stream and second form one frame
+        if (frame_count > 0 && 
+            (rc != SQLITE_ROW || frame_count == MAX_DETECTIONS ||
+             strncmp(stream, frame_stream, sizeof(frame_stream) - 1) != 0 ||
+             timestamp != frame_timestamp || recording_id != frame_recording)) {
+            if (insert_detection_frame_locked(db, frame_stream, frame_timestamp, frame_recording,
+                                              frame, frame_count) != 0) {
+                result = -1;
+                break;
+            }
+            frames++;
+            frame_count = 0;
+        }
+        
+        if (rc != SQLITE_ROW) {
+            if (rc != SQLITE_DONE) {
+                log_error("Failed to read detections: %s", sqlite3_errmsg(db));
+                result = -1;
+            }
+            break;
+        }
+        
+        if (frame_count == 0) {
+            strncpy(frame_stream, stream, sizeof(frame_stream) - 1);
+            frame_stream[sizeof(frame_stream) - 1] = '\0';
+            frame_timestamp = timestamp;
+            frame_recording = recording_id;
+        }
+        
+        detection_t *det = &frame[frame_count++];
+        memset(det, 0, sizeof(*det));
+        const char *label = (const char *)sqlite3_column_text(stmt, 3);
+        strncpy(det->label, label ? label : "unknown", sizeof(det->label) - 1);
+        det->confidence = (float)sqlite3_column_double(stmt, 4);
+        det->x = (float)sqlite3_column_double(stmt, 5);
+        det->y = (float)sqlite3_column_double(stmt, 6);
+        det->width = (float)sqlite3_column_double(stmt, 7);
+        det->height = (float)sqlite3_column_double(stmt, 8);
+        rows++;
+    }
+    
+    sqlite3_finalize(stmt);
+    
+    if (result != 0) {
+        // Ids handed out in this transaction disappear with the rollback
+        reset_detection_dictionaries();
+        return -1;
+    }
+    
+    log_info("Packed %d detections into %d frames", rows, frames);
+    
+    rc = sqlite3_exec(db, "DROP TABLE detections;", NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        log_error("Failed to drop per-detection table: %s", err_msg);
+        sqlite3_free(err_msg);
+        reset_detection_dictionaries();
+        return -1;
+    }
+    
+    log_info("Completed migration v6 to v7");
+    return 0;
+}
+
+/**
+ * Migration from version 7 to 8
+ * - Fill the minute and hour detection activity rollups from existing frames
+ */
+static int migration_v7_to_v8(void) {
+    log_info("Running migration from v7 to v8: Building detection activity rollups");
+    
+    sqlite3 *db = get_db_handle();
+    
+    if (!db) {
+        log_error("Database not initialized");
+        return -1;
+    }
+    
+    // The rollup tables are created at startup, only existing frames are added
+    if (rebuild_detection_activity_locked(db) != 0) {
+        log_error("Failed to build detection activity rollups");
+        return -1;
+    }
+    
+    log_info("Completed migration v7 to v8");
+    return 0;
+}
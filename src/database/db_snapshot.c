@@ -0,0 +1,256 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <unistd.h>
+#include <libgen.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sqlite3.h>
+
+#include "database/db_snapshot.h"
+#include "database/db_backup.h"
+#include "core/logger.h"
+
+// Snapshot thread state
+static struct {
+    pthread_t thread;
+    bool running;
+    int interval;
+    char memory_path[1024];
+    char snapshot_path[1024];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} snapshot = {
+    .running = false,
+    .interval = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER
+};
+
+// Check that a database opens and passes a quick check
+static bool database_is_usable(const char *path) {
+    sqlite3 *db = NULL;
+    bool usable = false;
+
+    if (sqlite3_open_v2(path, &db, SQLITE_OPEN_READONLY, NULL) == SQLITE_OK) {
+        sqlite3_stmt *stmt;
+        if (sqlite3_prepare_v2(db, "PRAGMA quick_check;", -1, &stmt, NULL) == SQLITE_OK) {
+            if (sqlite3_step(stmt) == SQLITE_ROW) {
+                const char *result = (const char *)sqlite3_column_text(stmt, 0);
+                usable = result && strcmp(result, "ok") == 0;
+            }
+            sqlite3_finalize(stmt);
+        }
+    }
+    sqlite3_close(db);
+
+    return usable;
+}
+
+// Remove a database file together with its WAL and shared memory files
+static void remove_database_files(const char *path) {
+    char side_path[1100];
+
+    unlink(path);
+    snprintf(side_path, sizeof(side_path), "%s-wal", path);
+    unlink(side_path);
+    snprintf(side_path, sizeof(side_path), "%s-shm", path);
+    unlink(side_path);
+}
+
+// Path of the file naming the snapshot a live database belongs to
+static void owner_file_path(const char *memory_path, char *path, size_t size) {
+    snprintf(path, size, "%s.owner", memory_path);
+}
+
+// Check that a live database was loaded for this snapshot path
+static bool memory_database_belongs_to(const char *memory_path, const char *snapshot_path) {
+    char path[1100];
+    char owner[1024] = "";
+
+    owner_file_path(memory_path, path, sizeof(path));
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+    if (!fgets(owner, sizeof(owner), file)) {
+        owner[0] = '\0';
+    }
+    fclose(file);
+
+    owner[strcspn(owner, "\n")] = '\0';
+    return strcmp(owner, snapshot_path) == 0;
+}
+
+// Record which snapshot path a live database belongs to
+static void record_memory_database_owner(const char *memory_path, const char *snapshot_path) {
+    char path[1100];
+
+    owner_file_path(memory_path, path, sizeof(path));
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        log_warn("Failed to record owner of database in memory at %s: %s", memory_path, strerror(errno));
+        return;
+    }
+    fprintf(file, "%s\n", snapshot_path);
+    fclose(file);
+}
+
+// Prepare a database that lives on tmpfs
+int prepare_memory_database(const char *memory_path, const char *snapshot_path) {
+    if (!memory_path || !snapshot_path) {
+        return -1;
+    }
+
+    // The tmpfs directory is gone after a reboot
+    char *dir_path = strdup(memory_path);
+    if (!dir_path) {
+        return -1;
+    }
+    char *dir = dirname(dir_path);
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        log_error("Failed to create database memory directory %s: %s", dir, strerror(errno));
+        free(dir_path);
+        return -1;
+    }
+    free(dir_path);
+
+    struct stat st;
+    if (stat(memory_path, &st) == 0) {
+        // After db_path changes the database in memory holds the old data
+        if (!memory_database_belongs_to(memory_path, snapshot_path)) {
+            log_info("Live database in memory at %s belongs to another snapshot, discarding it", memory_path);
+            remove_database_files(memory_path);
+        } else if (database_is_usable(memory_path)) {
+            log_info("Using live database left in memory at %s", memory_path);
+            return 0;
+        } else {
+            log_warn("Live database in memory at %s is damaged, discarding it", memory_path);
+            remove_database_files(memory_path);
+        }
+    }
+
+    if (stat(snapshot_path, &st) != 0) {
+        log_info("No database snapshot at %s, a new database will be created in memory", snapshot_path);
+        record_memory_database_owner(memory_path, snapshot_path);
+        return 0;
+    }
+
+    // Recover from the latest snapshot
+    log_info("Loading database snapshot %s into %s", snapshot_path, memory_path);
+    if (snapshot_database(snapshot_path, memory_path) != 0) {
+        log_error("Failed to load database snapshot into memory");
+        remove_database_files(memory_path);
+        return -1;
+    }
+
+    record_memory_database_owner(memory_path, snapshot_path);
+    log_info("Database snapshot loaded (%lld bytes)", (long long)st.st_size);
+    return 0;
+}
+
+// Copy the live database to persistent storage
+static int take_snapshot(void) {
+    time_t start = time(NULL);
+
+    // snapshot_database writes to a temporary file and renames it into place,
+    // so a power cut during a snapshot leaves the previous one intact. It
+    // does not share the backup slot, so a user backup cannot skip it.
+    if (snapshot_database(snapshot.memory_path, snapshot.snapshot_path) != 0) {
+        log_warn("Failed to snapshot database to %s", snapshot.snapshot_path);
+        return -1;
+    }
+
+    log_debug("Database snapshot written to %s in %ld seconds",
+              snapshot.snapshot_path, (long)(time(NULL) - start));
+    return 0;
+}
+
+// Snapshot thread
+static void *snapshot_thread_func(void *arg) {
+    (void)arg;
+
+    log_info("Database snapshot thread started");
+
+    while (true) {
+        pthread_mutex_lock(&snapshot.mutex);
+
+        if (snapshot.running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += snapshot.interval;
+            pthread_cond_timedwait(&snapshot.cond, &snapshot.mutex, &deadline);
+        }
+
+        bool running = snapshot.running;
+        pthread_mutex_unlock(&snapshot.mutex);
+
+        if (!running) {
+            break;
+        }
+
+        take_snapshot();
+    }
+
+    log_info("Database snapshot thread exiting");
+    return NULL;
+}
+
+// Start snapshotting the live database to persistent storage
+int start_db_snapshots(const char *memory_path, const char *snapshot_path, int interval) {
+    if (!memory_path || !snapshot_path) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&snapshot.mutex);
+
+    if (snapshot.running) {
+        pthread_mutex_unlock(&snapshot.mutex);
+        return 0;
+    }
+
+    strncpy(snapshot.memory_path, memory_path, sizeof(snapshot.memory_path) - 1);
+    snapshot.memory_path[sizeof(snapshot.memory_path) - 1] = '\0';
+    strncpy(snapshot.snapshot_path, snapshot_path, sizeof(snapshot.snapshot_path) - 1);
+    snapshot.snapshot_path[sizeof(snapshot.snapshot_path) - 1] = '\0';
+    snapshot.interval = interval < DB_SNAPSHOT_MIN_INTERVAL ? DB_SNAPSHOT_MIN_INTERVAL : interval;
+    snapshot.running = true;
+
+    if (pthread_create(&snapshot.thread, NULL, snapshot_thread_func, NULL) != 0) {
+        log_error("Failed to create database snapshot thread");
+        snapshot.running = false;
+        pthread_mutex_unlock(&snapshot.mutex);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&snapshot.mutex);
+
+    log_info("Database snapshots started (every %d seconds to %s)", snapshot.interval, snapshot_path);
+    return 0;
+}
+
+// Stop snapshotting and take a final snapshot
+void stop_db_snapshots(void) {
+    pthread_mutex_lock(&snapshot.mutex);
+
+    if (!snapshot.running) {
+        pthread_mutex_unlock(&snapshot.mutex);
+        return;
+    }
+
+    snapshot.running = false;
+    pthread_cond_signal(&snapshot.cond);
+    pthread_mutex_unlock(&snapshot.mutex);
+
+    pthread_join(snapshot.thread, NULL);
+
+    log_info("Taking final database snapshot");
+    if (take_snapshot() == 0) {
+        log_info("Final database snapshot written to %s", snapshot.snapshot_path);
+    }
+
+    log_info("Database snapshots stopped");
+}
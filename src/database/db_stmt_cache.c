@@ -0,0 +1,273 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "database/db_stmt_cache.h"
+#include "core/logger.h"
+
+// Cached prepared statement
+typedef struct {
+    char *sql;              // SQL text the statement was prepared from
+    uint32_t hash;          // Hash of the SQL text for quick comparison
+    sqlite3_stmt *stmt;
+    bool in_use;
+    uint64_t last_used;     // Lookup counter value when last handed out
+} stmt_cache_entry_t;
+
+// Statements of one connection
+//
+// A connection is only used by the thread that checked it out (or holds the
+// database mutex, for the writer), so a cache only ever prepares, resets and
+// finalizes statements on the connection its caller is holding.
+typedef struct {
+    sqlite3 *db;            // NULL for a free cache
+    stmt_cache_entry_t entries[DB_STMT_CACHE_SIZE];
+    uint64_t hits;
+    uint64_t misses;
+    pthread_mutex_t mutex;
+} stmt_cache_t;
+
+static stmt_cache_t stmt_caches[DB_STMT_CACHE_CONNECTIONS];
+static pthread_mutex_t stmt_caches_mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool stmt_caches_initialized = false;
+
+// FNV-1a hash of the SQL text
+static uint32_t hash_sql(const char *sql) {
+    uint32_t hash = 2166136261u;
+    while (*sql) {
+        hash ^= (unsigned char)*sql++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Free a cache entry (caller must hold the cache's mutex)
+static void free_entry(stmt_cache_entry_t *entry) {
+    if (entry->stmt) {
+        sqlite3_finalize(entry->stmt);
+    }
+    free(entry->sql);
+    memset(entry, 0, sizeof(stmt_cache_entry_t));
+}
+
+// Initialize the cache mutexes (caller must hold stmt_caches_mutex)
+static void init_caches(void) {
+    if (stmt_caches_initialized) {
+        return;
+    }
+
+    for (int i = 0; i < DB_STMT_CACHE_CONNECTIONS; i++) {
+        pthread_mutex_init(&stmt_caches[i].mutex, NULL);
+    }
+    stmt_caches_initialized = true;
+}
+
+// Find the cache of a connection, optionally claiming a free one for it
+static stmt_cache_t *find_cache(sqlite3 *db, bool create) {
+    stmt_cache_t *cache = NULL;
+    stmt_cache_t *free_cache = NULL;
+
+    pthread_mutex_lock(&stmt_caches_mutex);
+    init_caches();
+
+    for (int i = 0; i < DB_STMT_CACHE_CONNECTIONS; i++) {
+        if (stmt_caches[i].db == db) {
+            cache = &stmt_caches[i];
+            break;
+        }
+        if (!stmt_caches[i].db && !free_cache) {
+            free_cache = &stmt_caches[i];
+        }
+    }
+
+    if (!cache && create) {
+        if (free_cache) {
+            free_cache->db = db;
+            cache = free_cache;
+        } else {
+            log_warn("No statement cache left for database connection %p", (void *)db);
+        }
+    }
+
+    pthread_mutex_unlock(&stmt_caches_mutex);
+
+    return cache;
+}
+
+// Get a prepared statement for the given SQL text
+sqlite3_stmt *db_stmt_cache_acquire(sqlite3 *db, const char *sql) {
+    if (!db || !sql) {
+        return NULL;
+    }
+
+    stmt_cache_t *cache = find_cache(db, true);
+    if (!cache) {
+        // Not cached, released as a private statement
+        sqlite3_stmt *stmt = NULL;
+        if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+            return NULL;
+        }
+        return stmt;
+    }
+
+    uint32_t hash = hash_sql(sql);
+
+    pthread_mutex_lock(&cache->mutex);
+
+    uint64_t tick = cache->hits + cache->misses;
+    bool busy = false;
+    stmt_cache_entry_t *slot = NULL;
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        stmt_cache_entry_t *entry = &cache->entries[i];
+        if (!entry->stmt) {
+            if (!slot || slot->stmt) {
+                slot = entry;
+            }
+            continue;
+        }
+        if (entry->hash == hash && strcmp(entry->sql, sql) == 0) {
+            if (entry->in_use) {
+                busy = true;
+                break;
+            }
+            entry->in_use = true;
+            entry->last_used = tick;
+            cache->hits++;
+            sqlite3_stmt *stmt = entry->stmt;
+            pthread_mutex_unlock(&cache->mutex);
+            return stmt;
+        }
+        // Otherwise evict the least recently used idle entry
+        if (!entry->in_use && (!slot || (slot->stmt && entry->last_used < slot->last_used))) {
+            slot = entry;
+        }
+    }
+
+    cache->misses++;
+
+    sqlite3_stmt *stmt = NULL;
+    int rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        pthread_mutex_unlock(&cache->mutex);
+        return NULL;
+    }
+
+    // The cached copy is in use, or every entry is: hand out a private statement
+    char *sql_copy = (busy || !slot) ? NULL : strdup(sql);
+    if (!sql_copy) {
+        pthread_mutex_unlock(&cache->mutex);
+        return stmt;
+    }
+
+    if (slot->stmt) {
+        free_entry(slot);
+    }
+
+    slot->sql = sql_copy;
+    slot->hash = hash;
+    slot->stmt = stmt;
+    slot->in_use = true;
+    slot->last_used = tick;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return stmt;
+}
+
+// Return a statement obtained from db_stmt_cache_acquire
+void db_stmt_cache_release(sqlite3_stmt *stmt) {
+    if (!stmt) {
+        return;
+    }
+
+    stmt_cache_t *cache = find_cache(sqlite3_db_handle(stmt), false);
+    if (cache) {
+        pthread_mutex_lock(&cache->mutex);
+
+        for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+            if (cache->entries[i].stmt == stmt) {
+                sqlite3_reset(stmt);
+                sqlite3_clear_bindings(stmt);
+                cache->entries[i].in_use = false;
+                pthread_mutex_unlock(&cache->mutex);
+                return;
+            }
+        }
+
+        pthread_mutex_unlock(&cache->mutex);
+    }
+
+    // Not cached, this was a private statement
+    sqlite3_finalize(stmt);
+}
+
+// Finalize the statements of one cache and free it
+static int clear_cache(stmt_cache_t *cache) {
+    int cleared = 0;
+
+    pthread_mutex_lock(&cache->mutex);
+
+    for (int i = 0; i < DB_STMT_CACHE_SIZE; i++) {
+        stmt_cache_entry_t *entry = &cache->entries[i];
+        if (entry->stmt) {
+            if (entry->in_use) {
+                log_warn("Finalizing cached statement that is still in use: %s", entry->sql);
+            }
+            free_entry(entry);
+            cleared++;
+        }
+    }
+    cache->db = NULL;
+
+    pthread_mutex_unlock(&cache->mutex);
+
+    return cleared;
+}
+
+// Finalize all cached statements for a connection
+void db_stmt_cache_clear(sqlite3 *db) {
+    int cleared = 0;
+
+    pthread_mutex_lock(&stmt_caches_mutex);
+    init_caches();
+
+    for (int i = 0; i < DB_STMT_CACHE_CONNECTIONS; i++) {
+        if (stmt_caches[i].db && (!db || stmt_caches[i].db == db)) {
+            cleared += clear_cache(&stmt_caches[i]);
+        }
+    }
+
+    pthread_mutex_unlock(&stmt_caches_mutex);
+
+    if (cleared > 0) {
+        log_info("Cleared %d cached prepared statements", cleared);
+    }
+}
+
+// Get statement cache hit and miss counters
+void db_stmt_cache_get_stats(uint64_t *hits, uint64_t *misses) {
+    uint64_t total_hits = 0;
+    uint64_t total_misses = 0;
+
+    pthread_mutex_lock(&stmt_caches_mutex);
+    init_caches();
+
+    for (int i = 0; i < DB_STMT_CACHE_CONNECTIONS; i++) {
+        pthread_mutex_lock(&stmt_caches[i].mutex);
+        total_hits += stmt_caches[i].hits;
+        total_misses += stmt_caches[i].misses;
+        pthread_mutex_unlock(&stmt_caches[i].mutex);
+    }
+
+    pthread_mutex_unlock(&stmt_caches_mutex);
+
+    if (hits) {
+        *hits = total_hits;
+    }
+    if (misses) {
+        *misses = total_misses;
+    }
+}
@@ -11,6 +11,7 @@
 
 #include "database/db_streams.h"
 #include "database/db_core.h"
+#include "database/db_stmt_cache.h"
 #include "database/db_schema.h"
 #include "database/db_schema_cache.h"
 #include "core/logger.h"
@@ -276,7 +277,6 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
     int result = -1;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -288,7 +288,7 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     // Use our cached schema management functions to check for columns
     bool has_detection_columns = cached_column_exists("streams", "detection_based_recording");
@@ -318,10 +318,10 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
               "FROM streams WHERE name = ?;";
     }
     
-    rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
-    if (rc != SQLITE_OK) {
+    stmt = db_stmt_cache_acquire(db, sql);
+    if (!stmt) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -419,8 +419,8 @@ int get_stream_config_by_name(const char *name, stream_config_t *stream) {
         result = 0; // Success
     }
     
-    sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_stmt_cache_release(stmt);
+    db_release_reader(db);
     
     return result;
 }
@@ -438,7 +438,6 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
     int count = 0;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
@@ -450,7 +449,7 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     // Use our cached schema management functions to check for columns
     bool has_detection_columns = cached_column_exists("streams", "detection_based_recording");
@@ -483,7 +482,7 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -579,7 +578,7 @@ int get_all_stream_configs(stream_config_t *streams, int max_count) {
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
     
     return count;
 }
@@ -595,21 +594,20 @@ int get_enabled_stream_count(void) {
     int count = -1;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     const char *sql = "SELECT COUNT(*) FROM streams WHERE enabled = 1;";
     
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -618,7 +616,7 @@ int get_enabled_stream_count(void) {
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
     
     return count;
 }
@@ -634,21 +632,20 @@ int count_stream_configs(void) {
     int count = -1;
     
     sqlite3 *db = get_db_handle();
-    pthread_mutex_t *db_mutex = get_db_mutex();
     
     if (!db) {
         log_error("Database not initialized");
         return -1;
     }
     
-    pthread_mutex_lock(db_mutex);
+    db = db_acquire_reader();
     
     const char *sql = "SELECT COUNT(*) FROM streams;";
     
     rc = sqlite3_prepare_v2(db, sql, -1, &stmt, NULL);
     if (rc != SQLITE_OK) {
         log_error("Failed to prepare statement: %s", sqlite3_errmsg(db));
-        pthread_mutex_unlock(db_mutex);
+        db_release_reader(db);
         return -1;
     }
     
@@ -657,7 +654,7 @@ int count_stream_configs(void) {
     }
     
     sqlite3_finalize(stmt);
-    pthread_mutex_unlock(db_mutex);
+    db_release_reader(db);
     
     return count;
 }
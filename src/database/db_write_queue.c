@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sqlite3.h>
+
+#include "database/db_write_queue.h"
+#include "database/db_core.h"
+#include "database/db_detections.h"
+#include "database/db_events.h"
+#include "database/db_recordings.h"
+#include "core/logger.h"
+
+// Kinds of queued writes
+typedef enum {
+    WRITE_OP_DETECTIONS,
+    WRITE_OP_EVENT,
+    WRITE_OP_RECORDING_UPDATE
+} write_op_type_t;
+
+// Queued write
+typedef struct write_op {
+    write_op_type_t type;
+    int rows;                   // Rows this write produces, for batch sizing
+    int attempts;               // Batches this write was part of that failed to commit
+    struct write_op *next;
+    union {
+        struct {
+            char stream_name[64];
+            time_t timestamp;
+            detection_result_t result;
+        } detections;
+        struct {
+            event_type_t type;
+            time_t timestamp;
+            bool has_stream;
+            char stream_name[64];
+            char *description;
+            char *details;
+        } event;
+        struct {
+            uint64_t id;
+            time_t end_time;
+            uint64_t size_bytes;
+        } recording;
+    } data;
+} write_op_t;
+
+// Write-behind queue state
+static struct {
+    pthread_t thread;
+    bool running;
+    write_op_t *head;
+    write_op_t *tail;
+    int pending_rows;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    pthread_mutex_t commit_mutex;   // Held while a batch is taken and committed, keeps batches in order
+} write_queue = {
+    .running = false,
+    .head = NULL,
+    .tail = NULL,
+    .pending_rows = 0,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .commit_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Free a queued write
+static void free_write_op(write_op_t *op) {
+    if (op->type == WRITE_OP_EVENT) {
+        free(op->data.event.description);
+        free(op->data.event.details);
+    }
+    free(op);
+}
+
+// Append a write to the queue, returns non-zero if the caller keeps ownership
+static int enqueue_write_op(write_op_t *op) {
+    pthread_mutex_lock(&write_queue.mutex);
+
+    if (!write_queue.running || write_queue.pending_rows + op->rows > DB_WRITE_QUEUE_MAX_ROWS) {
+        pthread_mutex_unlock(&write_queue.mutex);
+        return -1;
+    }
+
+    op->next = NULL;
+    if (write_queue.tail) {
+        write_queue.tail->next = op;
+    } else {
+        write_queue.head = op;
+    }
+    write_queue.tail = op;
+    write_queue.pending_rows += op->rows;
+
+    if (write_queue.pending_rows >= DB_WRITE_QUEUE_BATCH_ROWS) {
+        pthread_cond_signal(&write_queue.cond);
+    }
+
+    pthread_mutex_unlock(&write_queue.mutex);
+    return 0;
+}
+
+// Apply a single queued write (caller holds the database mutex)
+static int apply_write_op(sqlite3 *db, const write_op_t *op) {
+    switch (op->type) {
+        case WRITE_OP_DETECTIONS:
+            return insert_detections_locked(db, op->data.detections.stream_name,
+                                            &op->data.detections.result,
+                                            op->data.detections.timestamp);
+        case WRITE_OP_EVENT:
+            return insert_event_locked(db, op->data.event.type, op->data.event.timestamp,
+                                       op->data.event.has_stream ? op->data.event.stream_name : NULL,
+                                       op->data.event.description, op->data.event.details) != 0 ? 0 : -1;
+        case WRITE_OP_RECORDING_UPDATE:
+            return update_recording_metadata_locked(db, op->data.recording.id,
+                                                    op->data.recording.end_time,
+                                                    op->data.recording.size_bytes, false);
+    }
+
+    return -1;
+}
+
+// Put a batch that could not be committed back at the front of the queue
+// (caller holds commit_mutex)
+static void requeue_batch(write_op_t *batch, int rows) {
+    write_op_t *last = batch;
+    while (last->next) {
+        last = last->next;
+    }
+
+    pthread_mutex_lock(&write_queue.mutex);
+    last->next = write_queue.head;
+    write_queue.head = batch;
+    if (!write_queue.tail) {
+        write_queue.tail = last;
+    }
+    write_queue.pending_rows += rows;
+    pthread_mutex_unlock(&write_queue.mutex);
+}
+
+// Apply a write inside a savepoint so a failure leaves none of it behind
+// (caller holds the database mutex and has a transaction open)
+static int apply_write_op_atomic(sqlite3 *db, const write_op_t *op) {
+    if (sqlite3_exec(db, "SAVEPOINT write_op;", NULL, NULL, NULL) != SQLITE_OK) {
+        log_error("Failed to create savepoint for queued write: %s", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    if (apply_write_op(db, op) != 0) {
+        sqlite3_exec(db, "ROLLBACK TO write_op;", NULL, NULL, NULL);
+        sqlite3_exec(db, "RELEASE write_op;", NULL, NULL, NULL);
+
+        // Labels or streams added by the rolled back write are gone again
+        if (op->type == WRITE_OP_DETECTIONS) {
+            reset_detection_dictionaries();
+        }
+        return -1;
+    }
+
+    sqlite3_exec(db, "RELEASE write_op;", NULL, NULL, NULL);
+    return 0;
+}
+
+// Apply each write in its own transaction, the way callers write directly
+// when the queue is full (caller holds the database mutex)
+static int apply_writes_directly(sqlite3 *db, const write_op_t *batch) {
+    int failed = 0;
+
+    for (const write_op_t *op = batch; op; op = op->next) {
+        int rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, NULL);
+        if (rc == SQLITE_OK && apply_write_op_atomic(db, op) == 0) {
+            rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, NULL);
+            if (rc == SQLITE_OK) {
+                continue;
+            }
+        }
+
+        log_error("Dropping queued write after %d failed batches: %s", op->attempts, sqlite3_errmsg(db));
+        if (rc == SQLITE_OK || !sqlite3_get_autocommit(db)) {
+            sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+            reset_detection_dictionaries();
+        }
+        failed++;
+    }
+
+    return failed > 0 ? -1 : 0;
+}
+
+// Take everything queued and commit it in one transaction
+static int commit_pending_writes(void) {
+    int result = 0;
+
+    pthread_mutex_lock(&write_queue.commit_mutex);
+
+    pthread_mutex_lock(&write_queue.mutex);
+    write_op_t *batch = write_queue.head;
+    int rows = write_queue.pending_rows;
+    bool running = write_queue.running;
+    write_queue.head = NULL;
+    write_queue.tail = NULL;
+    write_queue.pending_rows = 0;
+    pthread_mutex_unlock(&write_queue.mutex);
+
+    if (!batch) {
+        pthread_mutex_unlock(&write_queue.commit_mutex);
+        return 0;
+    }
+
+    sqlite3 *db = get_db_handle();
+    pthread_mutex_t *db_mutex = get_db_mutex();
+
+    if (!db) {
+        log_error("Database not initialized, dropping %d queued rows", rows);
+        result = -1;
+    } else {
+        pthread_mutex_lock(db_mutex);
+
+        int ops = 0;
+        int failed = 0;
+        char *err_msg = NULL;
+        int rc = sqlite3_exec(db, "BEGIN TRANSACTION;", NULL, NULL, &err_msg);
+        if (rc == SQLITE_OK) {
+            for (write_op_t *op = batch; op; op = op->next) {
+                if (apply_write_op_atomic(db, op) != 0) {
+                    failed++;
+                }
+                ops++;
+            }
+
+            rc = sqlite3_exec(db, "COMMIT;", NULL, NULL, &err_msg);
+            if (rc != SQLITE_OK) {
+                sqlite3_exec(db, "ROLLBACK;", NULL, NULL, NULL);
+                reset_detection_dictionaries();
+            }
+        }
+
+        if (rc != SQLITE_OK) {
+            log_error("Failed to commit %d queued rows: %s", rows, err_msg ? err_msg : sqlite3_errmsg(db));
+            sqlite3_free(err_msg);
+
+            bool retry = running;
+            for (write_op_t *op = batch; op; op = op->next) {
+                if (++op->attempts >= DB_WRITE_QUEUE_MAX_ATTEMPTS) {
+                    retry = false;
+                }
+            }
+
+            if (retry) {
+                // Usually a lock held elsewhere, try again with the next batch
+                requeue_batch(batch, rows);
+                batch = NULL;
+            } else {
+                apply_writes_directly(db, batch);
+            }
+            result = -1;
+        } else {
+            log_debug("Committed %d queued writes (%d rows, %d failed)", ops, rows, failed);
+            if (failed > 0) {
+                result = -1;
+            }
+        }
+
+        pthread_mutex_unlock(db_mutex);
+    }
+
+    while (batch) {
+        write_op_t *next = batch->next;
+        free_write_op(batch);
+        batch = next;
+    }
+
+    pthread_mutex_unlock(&write_queue.commit_mutex);
+
+    return result;
+}
+
+// Write-behind thread
+static void *write_queue_thread_func(void *arg) {
+    (void)arg;
+
+    log_info("Database write queue thread started");
+
+    while (true) {
+        pthread_mutex_lock(&write_queue.mutex);
+
+        if (write_queue.running && write_queue.pending_rows < DB_WRITE_QUEUE_BATCH_ROWS) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += DB_WRITE_QUEUE_FLUSH_MS / 1000;
+            deadline.tv_nsec += (long)(DB_WRITE_QUEUE_FLUSH_MS % 1000) * 1000000L;
+            if (deadline.tv_nsec >= 1000000000L) {
+                deadline.tv_sec++;
+                deadline.tv_nsec -= 1000000000L;
+            }
+            pthread_cond_timedwait(&write_queue.cond, &write_queue.mutex, &deadline);
+        }
+
+        bool running = write_queue.running;
+        pthread_mutex_unlock(&write_queue.mutex);
+
+        commit_pending_writes();
+
+        if (!running) {
+            break;
+        }
+    }
+
+    log_info("Database write queue thread exiting");
+    return NULL;
+}
+
+// Start the write-behind queue
+int init_db_write_queue(void) {
+    pthread_mutex_lock(&write_queue.mutex);
+
+    if (write_queue.running) {
+        pthread_mutex_unlock(&write_queue.mutex);
+        return 0;
+    }
+
+    write_queue.running = true;
+
+    if (pthread_create(&write_queue.thread, NULL, write_queue_thread_func, NULL) != 0) {
+        log_error("Failed to create database write queue thread");
+        write_queue.running = false;
+        pthread_mutex_unlock(&write_queue.mutex);
+        return -1;
+    }
+
+    pthread_mutex_unlock(&write_queue.mutex);
+
+    log_info("Database write queue started (flush every %d ms or %d rows)",
+             DB_WRITE_QUEUE_FLUSH_MS, DB_WRITE_QUEUE_BATCH_ROWS);
+    return 0;
+}
+
+// Stop the write-behind queue, committing anything still queued
+void shutdown_db_write_queue(void) {
+    pthread_mutex_lock(&write_queue.mutex);
+
+    if (!write_queue.running) {
+        pthread_mutex_unlock(&write_queue.mutex);
+        return;
+    }
+
+    write_queue.running = false;
+    pthread_cond_signal(&write_queue.cond);
+    pthread_mutex_unlock(&write_queue.mutex);
+
+    // The thread commits whatever is left before exiting
+    pthread_join(write_queue.thread, NULL);
+
+    log_info("Database write queue stopped");
+}
+
+// Commit everything queued so far and wait for it to finish
+int db_write_queue_flush(void) {
+    return commit_pending_writes();
+}
+
+// Queue detection results for insertion
+int db_write_queue_detections(const char *stream_name, const detection_result_t *result, time_t timestamp) {
+    if (!stream_name || !result || result->count <= 0) {
+        return -1;
+    }
+
+    write_op_t *op = calloc(1, sizeof(write_op_t));
+    if (!op) {
+        return -1;
+    }
+
+    op->type = WRITE_OP_DETECTIONS;
+    op->rows = result->count;
+    strncpy(op->data.detections.stream_name, stream_name, sizeof(op->data.detections.stream_name) - 1);
+    op->data.detections.timestamp = timestamp;
+    memcpy(&op->data.detections.result, result, sizeof(detection_result_t));
+
+    if (enqueue_write_op(op) != 0) {
+        free_write_op(op);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Queue an event for insertion
+int db_write_queue_event(event_type_t type, time_t timestamp, const char *stream_name,
+                         const char *description, const char *details) {
+    if (!description) {
+        return -1;
+    }
+
+    write_op_t *op = calloc(1, sizeof(write_op_t));
+    if (!op) {
+        return -1;
+    }
+
+    op->type = WRITE_OP_EVENT;
+    op->rows = 1;
+    op->data.event.type = type;
+    op->data.event.timestamp = timestamp;
+    if (stream_name) {
+        op->data.event.has_stream = true;
+        strncpy(op->data.event.stream_name, stream_name, sizeof(op->data.event.stream_name) - 1);
+    }
+    op->data.event.description = strdup(description);
+    op->data.event.details = details ? strdup(details) : NULL;
+
+    if (!op->data.event.description || (details && !op->data.event.details) ||
+        enqueue_write_op(op) != 0) {
+        free_write_op(op);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Queue a progress update for an in-progress recording
+int db_write_queue_recording_update(uint64_t id, time_t end_time, uint64_t size_bytes) {
+    // Replace an update for the same recording that has not been committed
+    // yet. A requeued batch can hold an older one too, so only the last
+    // update is replaced or it would be applied before a stale one.
+    pthread_mutex_lock(&write_queue.mutex);
+    if (!write_queue.running) {
+        pthread_mutex_unlock(&write_queue.mutex);
+        return -1;
+    }
+    write_op_t *queued = NULL;
+    for (write_op_t *op = write_queue.head; op; op = op->next) {
+        if (op->type == WRITE_OP_RECORDING_UPDATE && op->data.recording.id == id) {
+            queued = op;
+        }
+    }
+    if (queued) {
+        queued->data.recording.end_time = end_time;
+        queued->data.recording.size_bytes = size_bytes;
+        pthread_mutex_unlock(&write_queue.mutex);
+        return 0;
+    }
+    pthread_mutex_unlock(&write_queue.mutex);
+
+    write_op_t *op = calloc(1, sizeof(write_op_t));
+    if (!op) {
+        return -1;
+    }
+
+    op->type = WRITE_OP_RECORDING_UPDATE;
+    op->rows = 1;
+    op->data.recording.id = id;
+    op->data.recording.end_time = end_time;
+    op->data.recording.size_bytes = size_bytes;
+
+    if (enqueue_write_op(op) != 0) {
+        free_write_op(op);
+        return -1;
+    }
+
+    return 0;
+}
+
+// Drop queued progress updates for a recording
+void db_write_queue_cancel_recording_updates(uint64_t id) {
+    // Taking the commit lock waits out a batch that may contain this recording
+    pthread_mutex_lock(&write_queue.commit_mutex);
+    pthread_mutex_lock(&write_queue.mutex);
+
+    write_op_t *prev = NULL;
+    write_op_t *op = write_queue.head;
+    while (op) {
+        write_op_t *next = op->next;
+
+        if (op->type == WRITE_OP_RECORDING_UPDATE && op->data.recording.id == id) {
+            if (prev) {
+                prev->next = next;
+            } else {
+                write_queue.head = next;
+            }
+            if (write_queue.tail == op) {
+                write_queue.tail = prev;
+            }
+            write_queue.pending_rows -= op->rows;
+            free_write_op(op);
+        } else {
+            prev = op;
+        }
+
+        op = next;
+    }
+
+    pthread_mutex_unlock(&write_queue.mutex);
+    pthread_mutex_unlock(&write_queue.commit_mutex);
+}
@@ -11,8 +11,18 @@
 #include <pthread.h>
 
 #include "storage/storage_manager.h"
+#include "storage/storage_tiering.h"
 #include "core/logger.h"
 
+// How often the fill prediction is refreshed, in seconds
+#define PREDICTION_CHECK_INTERVAL 10
+
+// Predictive retention frees enough space for this many seconds of writes
+#define PREDICTION_HORIZON_SECONDS 900
+
+// Weight given to the newest sample in the smoothed write rate
+#define WRITE_RATE_SMOOTHING 0.3
+
 // Storage manager state
 static struct {
     char storage_path[256];
@@ -70,6 +80,11 @@ int init_storage_manager(const char *storage_path, uint64_t max_size) {
 
 // Shutdown the storage manager
 void shutdown_storage_manager(void) {
+    // Stop the tiering mover before the retention thread so no copy is left half done
+    if (stop_storage_tiering() != 0) {
+        log_warn("Failed to stop storage tiering thread");
+    }
+    
     // Stop the retention policy thread
     if (stop_retention_policy_thread() != 0) {
         log_warn("Failed to stop retention policy thread");
@@ -222,49 +237,47 @@ int delete_recording(const char *path) {
     return 0;
 }
 
-// Apply retention policy
-int apply_retention_policy(void) {
-    log_info("Applying retention policy (max size: %lu bytes, retention days: %d)", 
-             storage_manager.max_size, storage_manager.retention_days);
+// Work out how many bytes must be deleted so that bytes_needed more can be written
+static uint64_t bytes_over_limit(const storage_stats_t *stats, uint64_t bytes_needed) {
+    uint64_t over = 0;
     
-    // Get current storage stats
-    storage_stats_t stats;
-    if (get_storage_stats(&stats) != 0) {
-        log_error("Failed to get storage statistics");
-        return -1;
+    // Configured storage limit
+    if (storage_manager.max_size > 0 && stats->used_space + bytes_needed > storage_manager.max_size) {
+        over = stats->used_space + bytes_needed - storage_manager.max_size;
     }
     
-    // Check if we need to apply retention policy
-    bool need_cleanup_size = (storage_manager.max_size > 0 && stats.used_space > storage_manager.max_size);
-    bool need_cleanup_days = (storage_manager.retention_days > 0);
-    
-    if (!need_cleanup_size && !need_cleanup_days) {
-        log_debug("No retention policy to apply");
-        return 0;
+    // Physical free space on the filesystem
+    if (bytes_needed > stats->free_space && bytes_needed - stats->free_space > over) {
+        over = bytes_needed - stats->free_space;
     }
     
-    // Calculate cutoff time for retention days
+    return over;
+}
+
+// Recording file considered for size-based cleanup
+typedef struct {
+    char path[768];
+    time_t mtime;
+    off_t size;
+} recording_file_t;
+
+// Apply retention to the recordings under one storage root. Files older
+// than cutoff_time (0 for no age limit) are deleted, then the oldest of
+// the rest until bytes_to_free bytes were freed under this root.
+static int apply_retention_to_root(const char *root, uint64_t bytes_to_free, time_t cutoff_time,
+                                   int *deleted_count, uint64_t *freed_space) {
     time_t now = time(NULL);
-    time_t cutoff_time = now - (storage_manager.retention_days * 86400); // 86400 seconds in a day
-    
-    // Track deleted files
-    int deleted_count = 0;
-    uint64_t freed_space = 0;
+    bool need_cleanup_size = (bytes_to_free > 0);
+    uint64_t freed_here = 0;
     
     // Scan the storage directory
-    DIR *dir = opendir(storage_manager.storage_path);
+    DIR *dir = opendir(root);
     if (!dir) {
-        log_error("Failed to open storage directory: %s", strerror(errno));
+        log_error("Failed to open storage directory %s: %s", root, strerror(errno));
         return -1;
     }
     
     // First pass: collect all recording files with their timestamps and sizes
-    typedef struct {
-        char path[768];
-        time_t mtime;
-        off_t size;
-    } recording_file_t;
-    
     recording_file_t *files = NULL;
     int file_count = 0;
     int file_capacity = 0;
@@ -278,7 +291,7 @@ int apply_retention_policy(void) {
         
         // Check if it's a directory (stream directory)
         char stream_path[512];
-        snprintf(stream_path, sizeof(stream_path), "%s/%s", storage_manager.storage_path, entry->d_name);
+        snprintf(stream_path, sizeof(stream_path), "%s/%s", root, entry->d_name);
         
         struct stat st;
         if (stat(stream_path, &st) == 0 && S_ISDIR(st.st_mode)) {
@@ -293,6 +306,12 @@ int apply_retention_policy(void) {
                         continue;
                     }
                     
+                    // Leave copies the tiering mover is still writing alone
+                    size_t name_len = strlen(rec_entry->d_name);
+                    if (name_len > 5 && strcmp(rec_entry->d_name + name_len - 5, ".tier") == 0) {
+                        continue;
+                    }
+                    
                     // Check if it's a file
                     char rec_path[768];
                     snprintf(rec_path, sizeof(rec_path), "%s/%s", stream_path, rec_entry->d_name);
@@ -300,13 +319,13 @@ int apply_retention_policy(void) {
                     struct stat rec_st;
                     if (stat(rec_path, &rec_st) == 0 && S_ISREG(rec_st.st_mode)) {
                         // Check if file is older than retention days
-                        if (need_cleanup_days && rec_st.st_mtime < cutoff_time) {
+                        if (cutoff_time > 0 && rec_st.st_mtime < cutoff_time) {
                             // Delete file directly if it's older than retention days
                             if (unlink(rec_path) == 0) {
                                 log_debug("Deleted old recording: %s (age: %ld days)", 
                                          rec_path, (now - rec_st.st_mtime) / 86400);
-                                deleted_count++;
-                                freed_space += rec_st.st_size;
+                                (*deleted_count)++;
+                                freed_here += rec_st.st_size;
                             } else {
                                 log_error("Failed to delete old recording: %s (error: %s)", 
                                          rec_path, strerror(errno));
@@ -321,6 +340,7 @@ int apply_retention_policy(void) {
                                     free(files);
                                     closedir(stream_dir);
                                     closedir(dir);
+                                    *freed_space += freed_here;
                                     return -1;
                                 }
                                 files = new_files;
@@ -343,9 +363,9 @@ int apply_retention_policy(void) {
     closedir(dir);
     
     // If we need to clean up by size and we still have too much used space
-    if (need_cleanup_size && stats.used_space - freed_space > storage_manager.max_size && file_count > 0) {
-        log_info("Need to free more space: %lu bytes over limit", 
-                (stats.used_space - freed_space) - storage_manager.max_size);
+    if (need_cleanup_size && freed_here < bytes_to_free && file_count > 0) {
+        log_info("Need to free more space under %s: %lu bytes over limit", 
+                root, bytes_to_free - freed_here);
         
         // Sort files by modification time (oldest first)
         for (int i = 0; i < file_count - 1; i++) {
@@ -360,14 +380,14 @@ int apply_retention_policy(void) {
         
         // Delete oldest files until we're under the limit
         for (int i = 0; i < file_count; i++) {
-            if (stats.used_space - freed_space <= storage_manager.max_size) {
+            if (freed_here >= bytes_to_free) {
                 break;
             }
             
             if (unlink(files[i].path) == 0) {
                 log_debug("Deleted recording to free space: %s", files[i].path);
-                deleted_count++;
-                freed_space += files[i].size;
+                (*deleted_count)++;
+                freed_here += files[i].size;
             } else {
                 log_error("Failed to delete recording: %s (error: %s)", 
                          files[i].path, strerror(errno));
@@ -378,12 +398,80 @@ int apply_retention_policy(void) {
     // Free memory
     free(files);
     
+    *freed_space += freed_here;
+    return 0;
+}
+
+// Apply retention policy, additionally making room for bytes_needed more bytes
+static int apply_retention_policy_internal(uint64_t bytes_needed) {
+    log_info("Applying retention policy (max size: %lu bytes, retention days: %d, headroom wanted: %lu bytes)", 
+             storage_manager.max_size, storage_manager.retention_days, bytes_needed);
+    
+    // Get current storage stats
+    storage_stats_t stats;
+    if (get_storage_stats(&stats) != 0) {
+        log_error("Failed to get storage statistics");
+        return -1;
+    }
+    
+    // Recordings moved to the cold tier age out the same way, and the cold
+    // disk has to keep room for what the hot tier will hand over
+    char cold_path[256];
+    bool have_cold = get_storage_tiering_cold_path(cold_path, sizeof(cold_path));
+    uint64_t cold_bytes_to_free = 0;
+    if (have_cold) {
+        struct statvfs cold_stats;
+        if (statvfs(cold_path, &cold_stats) == 0) {
+            uint64_t cold_free = (uint64_t)cold_stats.f_bavail * cold_stats.f_frsize;
+            if (bytes_needed > cold_free) {
+                cold_bytes_to_free = bytes_needed - cold_free;
+            }
+        } else {
+            log_warn("Failed to get filesystem statistics for cold tier %s: %s", cold_path, strerror(errno));
+        }
+    }
+    
+    // Check if we need to apply retention policy
+    uint64_t bytes_to_free = bytes_over_limit(&stats, bytes_needed);
+    bool need_cleanup_size = (bytes_to_free > 0 || cold_bytes_to_free > 0);
+    bool need_cleanup_days = (storage_manager.retention_days > 0);
+    
+    if (!need_cleanup_size && !need_cleanup_days) {
+        log_debug("No retention policy to apply");
+        return 0;
+    }
+    
+    // Calculate cutoff time for retention days
+    time_t cutoff_time = 0;
+    if (need_cleanup_days) {
+        cutoff_time = time(NULL) - (storage_manager.retention_days * 86400); // 86400 seconds in a day
+    }
+    
+    // Track deleted files
+    int deleted_count = 0;
+    uint64_t freed_space = 0;
+    
+    if (apply_retention_to_root(storage_manager.storage_path, bytes_to_free, cutoff_time,
+                                &deleted_count, &freed_space) != 0) {
+        return -1;
+    }
+    
+    if (have_cold && apply_retention_to_root(cold_path, cold_bytes_to_free, cutoff_time,
+                                             &deleted_count, &freed_space) != 0) {
+        log_warn("Failed to apply retention policy to cold tier %s", cold_path);
+    }
+    
     log_info("Retention policy applied: deleted %d files, freed %lu bytes", 
              deleted_count, freed_space);
     
     return deleted_count;
 }
 
+// Apply retention policy
+int apply_retention_policy(void) {
+    return apply_retention_policy_internal(0);
+}
+
 // Set maximum storage size
 int set_max_storage_size(uint64_t max_size) {
     storage_manager.max_size = max_size;
@@ -437,8 +525,179 @@ int create_stream_directory(const char *stream_name) {
 
 // Check disk space and ensure minimum free space is available
 bool ensure_disk_space(uint64_t min_free_bytes) {
-    // Stub implementation
-    return true;
+    storage_stats_t stats;
+    if (get_storage_stats(&stats) != 0) {
+        return false;
+    }
+    
+    if (bytes_over_limit(&stats, min_free_bytes) == 0) {
+        return true;
+    }
+    
+    log_warn("Less than %lu bytes of headroom left, applying retention policy now", min_free_bytes);
+    if (apply_retention_policy_internal(min_free_bytes) < 0) {
+        return false;
+    }
+    
+    if (get_storage_stats(&stats) != 0) {
+        return false;
+    }
+    
+    return bytes_over_limit(&stats, min_free_bytes) == 0;
+}
+
+// Per-stream write rate tracking
+static struct {
+    char stream_name[64];
+    uint64_t last_file_bytes;   // Size last reported for the file being written
+    uint64_t pending_bytes;     // Bytes written since the last rate sample
+    double rate;                // Smoothed write rate in bytes per second
+    bool active;
+} stream_rates[MAX_TRACKED_STREAMS];
+
+static pthread_mutex_t stream_rates_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct timespec last_rate_sample = {0, 0};
+
+// Latest prediction, refreshed by the retention thread
+static storage_prediction_t current_prediction = {
+    .seconds_to_full = -1
+};
+
+// Record write progress for a stream
+void storage_report_stream_write(const char *stream_name, uint64_t file_bytes) {
+    if (!stream_name || stream_name[0] == '\0') {
+        return;
+    }
+    
+    pthread_mutex_lock(&stream_rates_mutex);
+    
+    int slot = -1;
+    for (int i = 0; i < MAX_TRACKED_STREAMS; i++) {
+        if (stream_rates[i].active && strcmp(stream_rates[i].stream_name, stream_name) == 0) {
+            slot = i;
+            break;
+        }
+        if (slot < 0 && !stream_rates[i].active) {
+            slot = i;
+        }
+    }
+    
+    if (slot < 0) {
+        pthread_mutex_unlock(&stream_rates_mutex);
+        return;
+    }
+    
+    if (!stream_rates[slot].active) {
+        memset(&stream_rates[slot], 0, sizeof(stream_rates[slot]));
+        strncpy(stream_rates[slot].stream_name, stream_name, sizeof(stream_rates[slot].stream_name) - 1);
+        stream_rates[slot].active = true;
+    }
+    
+    // A smaller size than last time means the writer rotated to a new file
+    if (file_bytes >= stream_rates[slot].last_file_bytes) {
+        stream_rates[slot].pending_bytes += file_bytes - stream_rates[slot].last_file_bytes;
+    } else {
+        stream_rates[slot].pending_bytes += file_bytes;
+    }
+    stream_rates[slot].last_file_bytes = file_bytes;
+    
+    pthread_mutex_unlock(&stream_rates_mutex);
+}
+
+// Fold pending bytes into the smoothed per-stream rates and refresh the prediction
+static void update_storage_prediction(int horizon_seconds) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    
+    pthread_mutex_lock(&stream_rates_mutex);
+    
+    double elapsed = (now.tv_sec - last_rate_sample.tv_sec) + 
+                     (now.tv_nsec - last_rate_sample.tv_nsec) / 1e9;
+    bool first_sample = (last_rate_sample.tv_sec == 0 && last_rate_sample.tv_nsec == 0);
+    last_rate_sample = now;
+    
+    double total_rate = 0;
+    int stream_count = 0;
+    for (int i = 0; i < MAX_TRACKED_STREAMS; i++) {
+        if (!stream_rates[i].active) {
+            continue;
+        }
+        
+        if (!first_sample && elapsed > 0) {
+            double sample = stream_rates[i].pending_bytes / elapsed;
+            stream_rates[i].rate = (stream_rates[i].rate == 0) ? sample :
+                WRITE_RATE_SMOOTHING * sample + (1.0 - WRITE_RATE_SMOOTHING) * stream_rates[i].rate;
+        }
+        stream_rates[i].pending_bytes = 0;
+        
+        total_rate += stream_rates[i].rate;
+        stream_count++;
+    }
+    
+    pthread_mutex_unlock(&stream_rates_mutex);
+    
+    storage_stats_t stats;
+    memset(&stats, 0, sizeof(stats));
+    struct statvfs fs_stats;
+    if (statvfs(storage_manager.storage_path, &fs_stats) == 0) {
+        stats.total_space = (uint64_t)fs_stats.f_blocks * fs_stats.f_frsize;
+        stats.free_space = (uint64_t)fs_stats.f_bavail * fs_stats.f_frsize;
+        stats.used_space = stats.total_space - stats.free_space;
+    }
+    
+    // Headroom is whichever runs out first: the configured limit or the disk
+    uint64_t headroom = stats.free_space;
+    if (storage_manager.max_size > 0) {
+        uint64_t limit_headroom = (stats.used_space < storage_manager.max_size) ?
+                                  storage_manager.max_size - stats.used_space : 0;
+        if (limit_headroom < headroom) {
+            headroom = limit_headroom;
+        }
+    }
+    
+    pthread_mutex_lock(&stream_rates_mutex);
+    current_prediction.total_write_rate = (uint64_t)total_rate;
+    current_prediction.headroom_bytes = headroom;
+    current_prediction.seconds_to_full = (total_rate >= 1.0) ? (int64_t)(headroom / total_rate) : -1;
+    current_prediction.bytes_needed = (uint64_t)(total_rate * horizon_seconds);
+    current_prediction.stream_count = stream_count;
+    current_prediction.updated_at = time(NULL);
+    pthread_mutex_unlock(&stream_rates_mutex);
+}
+
+// Get the latest storage fill prediction
+int get_storage_prediction(storage_prediction_t *prediction) {
+    if (!prediction) {
+        return -1;
+    }
+    
+    pthread_mutex_lock(&stream_rates_mutex);
+    memcpy(prediction, &current_prediction, sizeof(storage_prediction_t));
+    pthread_mutex_unlock(&stream_rates_mutex);
+    
+    return 0;
+}
+
+// Get smoothed write rates for all tracked streams
+int get_stream_write_rates(stream_write_rate_t *rates, int max_count) {
+    if (!rates || max_count <= 0) {
+        return -1;
+    }
+    
+    int count = 0;
+    pthread_mutex_lock(&stream_rates_mutex);
+    for (int i = 0; i < MAX_TRACKED_STREAMS && count < max_count; i++) {
+        if (!stream_rates[i].active) {
+            continue;
+        }
+        strncpy(rates[count].stream_name, stream_rates[i].stream_name, sizeof(rates[count].stream_name) - 1);
+        rates[count].stream_name[sizeof(rates[count].stream_name) - 1] = '\0';
+        rates[count].write_rate = (uint64_t)stream_rates[i].rate;
+        count++;
+    }
+    pthread_mutex_unlock(&stream_rates_mutex);
+    
+    return count;
 }
 
 // Retention policy thread state
@@ -456,6 +715,10 @@ static struct {
 static void* retention_policy_thread_func(void *arg) {
     log_info("Retention policy thread started with interval: %d seconds", retention_thread.interval_seconds);
     
+    // Look ahead no further than the retention interval
+    int horizon = retention_thread.interval_seconds < PREDICTION_HORIZON_SECONDS ?
+                  retention_thread.interval_seconds : PREDICTION_HORIZON_SECONDS;
+    
     while (retention_thread.running) {
         // Apply retention policy
         int deleted = apply_retention_policy();
@@ -465,9 +728,30 @@ static void* retention_policy_thread_func(void *arg) {
             log_error("Retention policy thread encountered an error");
         }
         
-        // Sleep for the specified interval
+        // Between full passes, keep the fill prediction fresh and start
+        // retention early if the disk would fill before the horizon
         for (int i = 0; i < retention_thread.interval_seconds && retention_thread.running; i++) {
             sleep(1);
+            
+            if ((i + 1) % PREDICTION_CHECK_INTERVAL != 0) {
+                continue;
+            }
+            
+            update_storage_prediction(horizon);
+            
+            storage_prediction_t prediction;
+            get_storage_prediction(&prediction);
+            if (prediction.seconds_to_full >= 0 && prediction.seconds_to_full < horizon) {
+                log_warn("Storage predicted to fill in %lld seconds at %llu bytes/s, freeing %llu bytes ahead of time",
+                         (long long)prediction.seconds_to_full,
+                         (unsigned long long)prediction.total_write_rate,
+                         (unsigned long long)prediction.bytes_needed);
+                deleted = apply_retention_policy_internal(prediction.bytes_needed);
+                if (deleted > 0) {
+                    log_info("Predictive retention deleted %d recordings", deleted);
+                }
+                update_storage_prediction(horizon);
+            }
         }
     }
     
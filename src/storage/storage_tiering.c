@@ -0,0 +1,456 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <pthread.h>
+#include <libgen.h>
+
+#include "storage/storage_tiering.h"
+#include "database/db_recordings.h"
+#include "core/logger.h"
+
+// Number of recordings examined per mover pass
+#define TIERING_BATCH_SIZE 32
+
+// Copy chunk size; the throttle is applied once per chunk
+#define TIERING_CHUNK_SIZE (1024 * 1024)
+
+// Seconds to wait between passes when there is nothing to move
+#define TIERING_IDLE_INTERVAL 300
+
+// Storage tiering thread state
+static struct {
+    pthread_t thread;
+    bool running;
+    pthread_mutex_t mutex;
+    char hot_path[256];
+    char cold_path[256];
+    int age_hours;
+    uint64_t max_bytes_per_sec;
+    storage_tiering_stats_t stats;
+} tiering = {
+    .running = false,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Check whether the tiering thread should keep going
+static bool tiering_running(void) {
+    pthread_mutex_lock(&tiering.mutex);
+    bool running = tiering.running;
+    pthread_mutex_unlock(&tiering.mutex);
+    return running;
+}
+
+// FNV-1a over a buffer, continuing from hash
+static uint64_t fnv1a_update(uint64_t hash, const unsigned char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        hash ^= data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+// Create every missing directory leading up to path's final component
+static int create_parent_directories(const char *path) {
+    char tmp[512];
+    strncpy(tmp, path, sizeof(tmp) - 1);
+    tmp[sizeof(tmp) - 1] = '\0';
+
+    char *dir = dirname(tmp);
+    for (char *p = dir + 1; *p; p++) {
+        if (*p == '/') {
+            *p = '\0';
+            if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+                return -1;
+            }
+            *p = '/';
+        }
+    }
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Sleep long enough that copied bytes stay under the configured rate
+static void throttle_copy(const struct timespec *start, uint64_t copied) {
+    if (tiering.max_bytes_per_sec == 0) {
+        return;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    double elapsed = (now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+    double expected = (double)copied / (double)tiering.max_bytes_per_sec;
+
+    if (expected > elapsed) {
+        usleep((useconds_t)((expected - elapsed) * 1e6));
+    }
+}
+
+// Copy src to dst with throttling, returning the content hash of what was written
+static int copy_file_throttled(const char *src, const char *dst, uint64_t *hash_out, uint64_t *size_out) {
+    int in_fd = open(src, O_RDONLY);
+    if (in_fd < 0) {
+        log_error("Tiering: failed to open %s: %s", src, strerror(errno));
+        return -1;
+    }
+
+    int out_fd = open(dst, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out_fd < 0) {
+        log_error("Tiering: failed to create %s: %s", dst, strerror(errno));
+        close(in_fd);
+        return -1;
+    }
+
+    unsigned char *buffer = malloc(TIERING_CHUNK_SIZE);
+    if (!buffer) {
+        log_error("Tiering: failed to allocate copy buffer");
+        close(in_fd);
+        close(out_fd);
+        return -1;
+    }
+
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t copied = 0;
+    int result = 0;
+
+    while (tiering_running()) {
+        ssize_t n = read(in_fd, buffer, TIERING_CHUNK_SIZE);
+        if (n == 0) {
+            break;
+        }
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            log_error("Tiering: read error on %s: %s", src, strerror(errno));
+            result = -1;
+            break;
+        }
+
+        ssize_t written = 0;
+        while (written < n) {
+            ssize_t w = write(out_fd, buffer + written, n - written);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                log_error("Tiering: write error on %s: %s", dst, strerror(errno));
+                result = -1;
+                break;
+            }
+            written += w;
+        }
+        if (result != 0) {
+            break;
+        }
+
+        hash = fnv1a_update(hash, buffer, n);
+        copied += n;
+
+        throttle_copy(&start, copied);
+    }
+
+    // Stopped mid-copy because of shutdown
+    if (!tiering_running() && result == 0) {
+        result = -1;
+    }
+
+    if (result == 0 && fsync(out_fd) != 0) {
+        log_error("Tiering: fsync failed on %s: %s", dst, strerror(errno));
+        result = -1;
+    }
+
+    free(buffer);
+    close(in_fd);
+    if (close(out_fd) != 0 && result == 0) {
+        log_error("Tiering: close failed on %s: %s", dst, strerror(errno));
+        result = -1;
+    }
+
+    *hash_out = hash;
+    *size_out = copied;
+    return result;
+}
+
+// Re-read a file and compute its content hash
+static int hash_file(const char *path, uint64_t *hash_out, uint64_t *size_out) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    unsigned char *buffer = malloc(TIERING_CHUNK_SIZE);
+    if (!buffer) {
+        close(fd);
+        return -1;
+    }
+
+    uint64_t hash = 14695981039346656037ULL;
+    uint64_t total = 0;
+    ssize_t n;
+
+    while ((n = read(fd, buffer, TIERING_CHUNK_SIZE)) != 0) {
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            free(buffer);
+            close(fd);
+            return -1;
+        }
+        hash = fnv1a_update(hash, buffer, n);
+        total += n;
+    }
+
+    free(buffer);
+    close(fd);
+
+    *hash_out = hash;
+    *size_out = total;
+    return 0;
+}
+
+// Move a single recording from the hot tier to the cold tier
+static int migrate_recording(const recording_metadata_t *recording) {
+    size_t hot_len = strlen(tiering.hot_path);
+    const char *relative = recording->file_path + hot_len;
+
+    char dest_path[512];
+    char temp_path[520];
+    snprintf(dest_path, sizeof(dest_path), "%s%s%s", tiering.cold_path,
+             (relative[0] == '/') ? "" : "/", relative);
+    snprintf(temp_path, sizeof(temp_path), "%s.tier", dest_path);
+
+    if (strlen(dest_path) >= sizeof(recording->file_path)) {
+        log_warn("Tiering: destination path too long for recording %llu, skipping",
+                 (unsigned long long)recording->id);
+        return -1;
+    }
+
+    struct stat src_st;
+    if (stat(recording->file_path, &src_st) != 0) {
+        log_warn("Tiering: recording %llu file missing: %s",
+                 (unsigned long long)recording->id, recording->file_path);
+        return -1;
+    }
+
+    if (create_parent_directories(dest_path) != 0) {
+        log_error("Tiering: failed to create directories for %s: %s", dest_path, strerror(errno));
+        return -1;
+    }
+
+    // Copy
+    uint64_t copy_hash = 0, copy_size = 0;
+    if (copy_file_throttled(recording->file_path, temp_path, &copy_hash, &copy_size) != 0) {
+        unlink(temp_path);
+        return -1;
+    }
+
+    // Verify: size must match the source as it was before the copy and the
+    // copy must read back with the same content hash
+    uint64_t verify_hash = 0, verify_size = 0;
+    if (copy_size != (uint64_t)src_st.st_size ||
+        hash_file(temp_path, &verify_hash, &verify_size) != 0 ||
+        verify_hash != copy_hash || verify_size != copy_size) {
+        log_error("Tiering: verification failed for %s", temp_path);
+        unlink(temp_path);
+        return -1;
+    }
+
+    if (rename(temp_path, dest_path) != 0) {
+        log_error("Tiering: failed to rename %s to %s: %s", temp_path, dest_path, strerror(errno));
+        unlink(temp_path);
+        return -1;
+    }
+
+    // Re-point the recording; only succeeds if nobody deleted or moved it meanwhile
+    int rc = update_recording_file_path(recording->id, recording->file_path, dest_path);
+    if (rc != 0) {
+        if (rc > 0) {
+            log_info("Tiering: recording %llu changed during copy, discarding copy",
+                     (unsigned long long)recording->id);
+        }
+        unlink(dest_path);
+        return -1;
+    }
+
+    // The database now points at the cold copy, so the hot copy can go
+    if (unlink(recording->file_path) != 0 && errno != ENOENT) {
+        log_warn("Tiering: failed to remove hot copy %s: %s", recording->file_path, strerror(errno));
+    }
+
+    log_info("Tiering: moved recording %llu to %s (%llu bytes)",
+             (unsigned long long)recording->id, dest_path, (unsigned long long)copy_size);
+
+    pthread_mutex_lock(&tiering.mutex);
+    tiering.stats.migrated_recordings++;
+    tiering.stats.migrated_bytes += copy_size;
+    pthread_mutex_unlock(&tiering.mutex);
+
+    return 0;
+}
+
+// Storage tiering thread function
+static void* storage_tiering_thread_func(void *arg) {
+    (void)arg;
+
+    log_info("Storage tiering thread started (%s -> %s after %d hours)",
+             tiering.hot_path, tiering.cold_path, tiering.age_hours);
+
+    recording_metadata_t *batch = calloc(TIERING_BATCH_SIZE, sizeof(recording_metadata_t));
+    if (!batch) {
+        log_error("Failed to allocate storage tiering batch");
+        return NULL;
+    }
+
+    // Match on the directory boundary so /data/rec does not claim /data/rec2
+    char prefix[260];
+    snprintf(prefix, sizeof(prefix), "%s/", tiering.hot_path);
+
+    // Sweep cursor; recordings that cannot be moved are passed over until the next sweep
+    uint64_t last_id = 0;
+
+    while (tiering_running()) {
+        time_t cutoff = time(NULL) - (time_t)tiering.age_hours * 3600;
+
+        pthread_mutex_lock(&tiering.mutex);
+        tiering.stats.last_pass_time = time(NULL);
+        pthread_mutex_unlock(&tiering.mutex);
+
+        int count = get_recordings_for_tiering(cutoff, prefix, last_id, batch, TIERING_BATCH_SIZE);
+
+        for (int i = 0; i < count && tiering_running(); i++) {
+            last_id = batch[i].id;
+            if (migrate_recording(&batch[i]) != 0 && tiering_running()) {
+                pthread_mutex_lock(&tiering.mutex);
+                tiering.stats.failed_migrations++;
+                pthread_mutex_unlock(&tiering.mutex);
+            }
+        }
+
+        // Continue the sweep straight away after a full batch, otherwise idle and start over
+        int wait_seconds = 1;
+        if (count < TIERING_BATCH_SIZE) {
+            last_id = 0;
+            wait_seconds = TIERING_IDLE_INTERVAL;
+        }
+        for (int i = 0; i < wait_seconds && tiering_running(); i++) {
+            sleep(1);
+        }
+    }
+
+    free(batch);
+    log_info("Storage tiering thread exiting");
+    return NULL;
+}
+
+// Start the storage tiering thread
+int start_storage_tiering(const char *hot_path, const char *cold_path,
+                          int age_hours, uint64_t max_bytes_per_sec) {
+    if (!hot_path || !cold_path || hot_path[0] == '\0' || cold_path[0] == '\0') {
+        log_error("Storage tiering requires both a hot and a cold path");
+        return -1;
+    }
+
+    if (strcmp(hot_path, cold_path) == 0) {
+        log_error("Storage tiering hot and cold paths must differ");
+        return -1;
+    }
+
+    pthread_mutex_lock(&tiering.mutex);
+
+    if (tiering.running) {
+        log_warn("Storage tiering thread is already running");
+        pthread_mutex_unlock(&tiering.mutex);
+        return 0;
+    }
+
+    strncpy(tiering.hot_path, hot_path, sizeof(tiering.hot_path) - 1);
+    tiering.hot_path[sizeof(tiering.hot_path) - 1] = '\0';
+    strncpy(tiering.cold_path, cold_path, sizeof(tiering.cold_path) - 1);
+    tiering.cold_path[sizeof(tiering.cold_path) - 1] = '\0';
+
+    // Strip trailing slashes so prefix matching and path joining are consistent
+    size_t len = strlen(tiering.hot_path);
+    while (len > 1 && tiering.hot_path[len - 1] == '/') {
+        tiering.hot_path[--len] = '\0';
+    }
+    len = strlen(tiering.cold_path);
+    while (len > 1 && tiering.cold_path[len - 1] == '/') {
+        tiering.cold_path[--len] = '\0';
+    }
+
+    tiering.age_hours = (age_hours < 1) ? 1 : age_hours;
+    tiering.max_bytes_per_sec = max_bytes_per_sec;
+    tiering.running = true;
+
+    if (pthread_create(&tiering.thread, NULL, storage_tiering_thread_func, NULL) != 0) {
+        log_error("Failed to create storage tiering thread: %s", strerror(errno));
+        tiering.running = false;
+        pthread_mutex_unlock(&tiering.mutex);
+        return -1;
+    }
+
+    tiering.stats.enabled = true;
+    pthread_mutex_unlock(&tiering.mutex);
+
+    return 0;
+}
+
+// Stop the storage tiering thread
+int stop_storage_tiering(void) {
+    pthread_mutex_lock(&tiering.mutex);
+
+    if (!tiering.running) {
+        pthread_mutex_unlock(&tiering.mutex);
+        return 0;
+    }
+
+    tiering.running = false;
+    pthread_mutex_unlock(&tiering.mutex);
+
+    if (pthread_join(tiering.thread, NULL) != 0) {
+        log_error("Failed to join storage tiering thread: %s", strerror(errno));
+        return -1;
+    }
+
+    pthread_mutex_lock(&tiering.mutex);
+    tiering.stats.enabled = false;
+    pthread_mutex_unlock(&tiering.mutex);
+
+    log_info("Storage tiering thread stopped");
+    return 0;
+}
+
+// Get the cold tier root
+bool get_storage_tiering_cold_path(char *path, size_t size) {
+    if (!path || size == 0) {
+        return false;
+    }
+
+    pthread_mutex_lock(&tiering.mutex);
+    snprintf(path, size, "%s", tiering.cold_path);
+    pthread_mutex_unlock(&tiering.mutex);
+
+    return path[0] != '\0';
+}
+
+// Get storage tiering statistics
+int get_storage_tiering_stats(storage_tiering_stats_t *stats) {
+    if (!stats) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&tiering.mutex);
+    memcpy(stats, &tiering.stats, sizeof(storage_tiering_stats_t));
+    pthread_mutex_unlock(&tiering.mutex);
+
+    return 0;
+}
@@ -20,6 +20,7 @@
 #include "video/detection_stream_thread.h"
 #include "database/database_manager.h"
 #include "web/api_handlers_detection_results.h"
+#include "web/api_handlers_detection_ws.h"
 
 // Define model types (same as in detection_integration.c)
 #define MODEL_TYPE_SOD "sod"
@@ -452,6 +453,9 @@ int process_frame_for_recording(const char *stream_name, const unsigned char *fr
         log_info("No detections met the threshold (%.2f), skipping database storage", threshold);
     }
 
+    // Push the filtered boxes to live overlays, including the empty update that clears them
+    detection_ws_publish(stream_name, &filtered_result, frame_time);
+
     // Check if any objects were detected above threshold
     bool detection_triggered = false;
     for (int i = 0; i < result->count; i++) {
@@ -26,6 +26,7 @@
 #include "video/mp4_writer_internal.h"
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
+#include "storage/storage_manager.h"
 
 // Thread-related fields for the MP4 writer
 typedef struct {
@@ -966,6 +967,9 @@ static void *mp4_writer_rtsp_thread(void *arg) {
                         log_info("File size for %s: %llu bytes", 
                                 current_path, (unsigned long long)size_bytes);
                         
+                        // Account for the tail of the file in the stream's write rate
+                        storage_report_stream_write(stream_name, size_bytes);
+                        
                         // Mark the recording as complete with the correct file size
                         update_recording_metadata(thread_ctx->writer->current_recording_id, current_time, size_bytes, true);
                         log_info("Marked previous recording (ID: %llu) as complete for stream %s (size: %llu bytes)", 
@@ -1079,6 +1083,7 @@ static void *mp4_writer_rtsp_thread(void *arg) {
                 uint64_t size_bytes = st.st_size;
                 // Update size but don't mark as complete yet
                 update_recording_metadata(thread_ctx->writer->current_recording_id, 0, size_bytes, false);
+                storage_report_stream_write(stream_name, size_bytes);
                 log_debug("Updated recording metadata for ID: %llu, size: %llu bytes", 
                         (unsigned long long)thread_ctx->writer->current_recording_id, 
                         (unsigned long long)size_bytes);
@@ -70,20 +70,8 @@ void mg_send_json_response(struct mg_connection *c, int status_code, const char
         return;
     }
     
-    // Set proper headers for CORS and caching
-    const char *headers = "Content-Type: application/json\r\n"
-                         "Connection: close\r\n"
-                         "Access-Control-Allow-Origin: *\r\n"
-                         "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
-                         "Access-Control-Allow-Headers: Content-Type, Authorization, X-Requested-With\r\n"
-                         "Access-Control-Allow-Credentials: true\r\n"
-                         "Access-Control-Max-Age: 86400\r\n"
-                         "Cache-Control: no-cache, no-store, must-revalidate\r\n"
-                         "Pragma: no-cache\r\n"
-                         "Expires: 0\r\n";
-    
     log_info("Sending JSON response with status code %d", status_code);
-    mg_http_reply(c, status_code, headers, "%s", json_str);
+    mg_http_reply(c, status_code, MG_JSON_RESPONSE_HEADERS, "%s", json_str);
 }
 
 /**
@@ -97,16 +85,7 @@ void mg_send_json_error(struct mg_connection *c, int status_code, const char *er
     }
     
     // Set proper headers for CORS and caching
-    const char *headers = "Content-Type: application/json\r\n"
-                         "Connection: close\r\n"
-                         "Access-Control-Allow-Origin: *\r\n"
-                         "Access-Control-Allow-Methods: GET, POST, PUT, DELETE, OPTIONS\r\n"
-                         "Access-Control-Allow-Headers: Content-Type, Authorization, X-Requested-With\r\n"
-                         "Access-Control-Allow-Credentials: true\r\n"
-                         "Access-Control-Max-Age: 86400\r\n"
-                         "Cache-Control: no-cache, no-store, must-revalidate\r\n"
-                         "Pragma: no-cache\r\n"
-                         "Expires: 0\r\n";
+    const char *headers = MG_JSON_RESPONSE_HEADERS;
     
     // Create error JSON
     cJSON *error = cJSON_CreateObject();
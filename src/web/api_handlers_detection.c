@@ -11,6 +11,7 @@
 
 #include "web/api_handlers.h"
 #include "web/mongoose_adapter.h"
+#include "web/json_writer.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "mongoose.h"
@@ -90,68 +91,45 @@ void mg_handle_get_detection_results(struct mg_connection *c, struct mg_http_mes
         return;
     }
     
-    // Create JSON response
-    cJSON *response = cJSON_CreateObject();
-    if (!response) {
-        log_error("Failed to create response JSON object");
+    // At most MAX_DETECTIONS rows, so the response is written in one go
+    json_writer_t *writer = (json_writer_t *)malloc(sizeof(json_writer_t));
+    if (!writer) {
+        log_error("Failed to allocate JSON writer");
         mg_send_json_error(c, 500, "Failed to create response JSON");
         return;
     }
     
-    // Create detections array
-    cJSON *detections_array = cJSON_CreateArray();
-    if (!detections_array) {
-        log_error("Failed to create detections JSON array");
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to create detections JSON");
-        return;
-    }
-    
-    // Add detections array to response
-    cJSON_AddItemToObject(response, "detections", detections_array);
-    
-    // Add timestamp
-    char timestamp[32];
-    time_t now = time(NULL);
-    struct tm *tm_info = localtime(&now);
-    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
-    cJSON_AddStringToObject(response, "timestamp", timestamp);
+    json_writer_begin(writer, c, 200);
+    json_writer_object_begin(writer, NULL);
     
     // Add each detection to the array
+    json_writer_array_begin(writer, "detections");
     for (int i = 0; i < result.count; i++) {
-        cJSON *detection = cJSON_CreateObject();
-        if (!detection) {
-            log_error("Failed to create detection JSON object");
-            continue;
-        }
-        
         // Add detection properties
-        cJSON_AddStringToObject(detection, "label", result.detections[i].label);
-        cJSON_AddNumberToObject(detection, "confidence", result.detections[i].confidence);
-        cJSON_AddNumberToObject(detection, "x", result.detections[i].x);
-        cJSON_AddNumberToObject(detection, "y", result.detections[i].y);
-        cJSON_AddNumberToObject(detection, "width", result.detections[i].width);
-        cJSON_AddNumberToObject(detection, "height", result.detections[i].height);
-        cJSON_AddNumberToObject(detection, "timestamp", (double)timestamps[i]);
-        
-        cJSON_AddItemToArray(detections_array, detection);
+        json_writer_object_begin(writer, NULL);
+        json_writer_string(writer, "label", result.detections[i].label);
+        json_writer_number(writer, "confidence", result.detections[i].confidence);
+        json_writer_number(writer, "x", result.detections[i].x);
+        json_writer_number(writer, "y", result.detections[i].y);
+        json_writer_number(writer, "width", result.detections[i].width);
+        json_writer_number(writer, "height", result.detections[i].height);
+        json_writer_int(writer, "timestamp", (int64_t)timestamps[i]);
+        json_writer_object_end(writer);
     }
+    json_writer_array_end(writer);
     
-    // Convert to string
-    char *json_str = cJSON_PrintUnformatted(response);
-    if (!json_str) {
-        log_error("Failed to convert response JSON to string");
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to convert response JSON to string");
-        return;
-    }
+    // Add timestamp
+    char timestamp[32];
+    time_t now = time(NULL);
+    struct tm tm_buf;
+    struct tm *tm_info = localtime_r(&now, &tm_buf);
+    strftime(timestamp, sizeof(timestamp), "%Y-%m-%d %H:%M:%S", tm_info);
+    json_writer_string(writer, "timestamp", timestamp);
     
-    // Send response
-    mg_send_json_response(c, 200, json_str);
+    json_writer_object_end(writer);
+    json_writer_end(writer);
     
-    // Clean up
-    free(json_str);
-    cJSON_Delete(response);
+    free(writer);
     
     log_info("Successfully handled GET /api/detection/results/%s request", stream_name);
 }
@@ -0,0 +1,343 @@
+/**
+ * @file api_handlers_detection_ws.c
+ * @brief Live detection results pushed over WebSocket
+ *
+ * Each processed frame's detections are published to the stream's topic
+ * as soon as they are filtered, instead of the UI polling for them. Every
+ * update carries a sequence number; a client reconnecting with the last
+ * one it saw is replayed what it missed from a short history, or sent the
+ * latest state when the history no longer reaches back that far.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "cJSON.h"
+#include "web/api_handlers_detection_ws.h"
+#include "web/websocket_manager.h"
+#include "web/websocket_client.h"
+#include "web/mongoose_server_reactor.h"
+#include "core/config.h"
+#include "core/logger.h"
+
+// Longest topic the WebSocket client registry keeps
+#define MAX_TOPIC_LENGTH 64
+
+// Largest update: MAX_DETECTIONS escaped labels and five numbers each
+#define DETECTION_WS_MESSAGE_SIZE 4096
+
+/**
+ * @brief Update kept for resuming clients
+ */
+typedef struct {
+    uint64_t seq;
+    int stream;                 // Index into the stream table
+    char *message;
+} detection_update_t;
+
+/**
+ * @brief Latest state of a stream
+ */
+typedef struct {
+    char topic[MAX_TOPIC_LENGTH];
+    int last_count;
+    char *last_message;
+} detection_stream_state_t;
+
+// Live detection state
+static struct {
+    detection_stream_state_t streams[MAX_STREAMS];
+    int stream_count;
+    detection_update_t history[DETECTION_WS_HISTORY];
+    uint64_t next_seq;
+    pthread_mutex_t mutex;
+} detection_ws = {
+    .stream_count = 0,
+    .next_seq = 1,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * @brief Append a JSON string, escaping what JSON requires
+ */
+static size_t append_json_string(char *buf, size_t size, size_t pos, const char *value) {
+    if (pos < size) {
+        buf[pos] = '"';
+    }
+    pos++;
+
+    for (const char *p = value; *p; p++) {
+        unsigned char ch = (unsigned char)*p;
+        if (ch == '"' || ch == '\\') {
+            pos += (size_t)snprintf(pos < size ? buf + pos : NULL, pos < size ? size - pos : 0, "\\%c", ch);
+        } else if (ch < 0x20) {
+            pos += (size_t)snprintf(pos < size ? buf + pos : NULL, pos < size ? size - pos : 0, "\\u%04x", ch);
+        } else {
+            if (pos < size) {
+                buf[pos] = (char)ch;
+            }
+            pos++;
+        }
+    }
+
+    if (pos < size) {
+        buf[pos] = '"';
+    }
+    pos++;
+
+    return pos;
+}
+
+/**
+ * @brief Build the topic of a stream
+ *
+ * @return 0 on success, -1 if the name does not fit in a topic
+ */
+static int stream_topic(const char *stream_name, char *topic, size_t size) {
+    int len = snprintf(topic, size, "%s/%s", DETECTION_WS_TOPIC, stream_name);
+    return len > 0 && (size_t)len < size ? 0 : -1;
+}
+
+/**
+ * @brief Find the state of a stream by topic, adding it if asked
+ */
+static int find_stream(const char *topic, bool create) {
+    for (int i = 0; i < detection_ws.stream_count; i++) {
+        if (strcmp(detection_ws.streams[i].topic, topic) == 0) {
+            return i;
+        }
+    }
+
+    if (!create || detection_ws.stream_count == MAX_STREAMS) {
+        return -1;
+    }
+
+    int index = detection_ws.stream_count++;
+    detection_stream_state_t *state = &detection_ws.streams[index];
+    snprintf(state->topic, sizeof(state->topic), "%s", topic);
+    state->last_count = 0;
+    state->last_message = NULL;
+
+    // Overlays only need the newest boxes, so a slow client skips stale ones
+    websocket_manager_set_topic_policy(topic, WS_TOPIC_POLICY_COALESCE);
+
+    return index;
+}
+
+/**
+ * @brief Build the message for a detection update
+ */
+static int build_update(char *buf, size_t size, const char *topic, uint64_t seq,
+                        time_t timestamp, const detection_result_t *result) {
+    size_t pos = (size_t)snprintf(buf, size, "{\"type\":\"detection\",\"topic\":");
+    pos = append_json_string(buf, size, pos, topic);
+    pos += (size_t)snprintf(buf + (pos < size ? pos : size), pos < size ? size - pos : 0,
+                            ",\"payload\":{\"seq\":%" PRIu64 ",\"ts\":%lld,\"d\":[",
+                            seq, (long long)timestamp);
+
+    // Each detection is [label, confidence, x, y, width, height]
+    for (int i = 0; i < result->count; i++) {
+        const detection_t *d = &result->detections[i];
+        if (pos < size) {
+            pos += (size_t)snprintf(buf + pos, size - pos, "%s[", i > 0 ? "," : "");
+        }
+        pos = append_json_string(buf, size, pos, d->label);
+        if (pos < size) {
+            pos += (size_t)snprintf(buf + pos, size - pos, ",%.3f,%.4f,%.4f,%.4f,%.4f]",
+                                    d->confidence, d->x, d->y, d->width, d->height);
+        }
+    }
+
+    if (pos < size) {
+        pos += (size_t)snprintf(buf + pos, size - pos, "]}}");
+    }
+
+    return pos < size ? (int)pos : -1;
+}
+
+/**
+ * @brief Push the detections of a processed frame to subscribed clients
+ */
+void detection_ws_publish(const char *stream_name, const detection_result_t *result, time_t timestamp) {
+    if (!stream_name || !result) {
+        return;
+    }
+
+    char topic[MAX_TOPIC_LENGTH];
+    if (stream_topic(stream_name, topic, sizeof(topic)) != 0) {
+        return;
+    }
+
+    if (timestamp == 0) {
+        timestamp = time(NULL);
+    }
+
+    pthread_mutex_lock(&detection_ws.mutex);
+
+    int index = find_stream(topic, true);
+    if (index < 0) {
+        pthread_mutex_unlock(&detection_ws.mutex);
+        return;
+    }
+    detection_stream_state_t *state = &detection_ws.streams[index];
+
+    // Nothing was on screen and nothing is now
+    if (result->count == 0 && state->last_count == 0) {
+        pthread_mutex_unlock(&detection_ws.mutex);
+        return;
+    }
+
+    uint64_t seq = detection_ws.next_seq;
+    char message[DETECTION_WS_MESSAGE_SIZE];
+    int len = build_update(message, sizeof(message), topic, seq, timestamp, result);
+    if (len < 0) {
+        pthread_mutex_unlock(&detection_ws.mutex);
+        log_error("Detection update for stream %s does not fit in a message", stream_name);
+        return;
+    }
+
+    char *history_copy = strdup(message);
+    char *state_copy = strdup(message);
+    if (!history_copy || !state_copy) {
+        pthread_mutex_unlock(&detection_ws.mutex);
+        free(history_copy);
+        free(state_copy);
+        log_error("Failed to allocate detection update for stream %s", stream_name);
+        return;
+    }
+    detection_ws.next_seq++;
+
+    detection_update_t *slot = &detection_ws.history[seq % DETECTION_WS_HISTORY];
+    free(slot->message);
+    slot->seq = seq;
+    slot->stream = index;
+    slot->message = history_copy;
+
+    free(state->last_message);
+    state->last_message = state_copy;
+    state->last_count = result->count;
+
+    // Published under the lock so clients see updates in sequence order
+    websocket_manager_publish(topic, message, (size_t)len);
+
+    pthread_mutex_unlock(&detection_ws.mutex);
+}
+
+/**
+ * @brief Send a short control message to a client
+ */
+static void send_control(struct mg_connection *c, const char *type, const char *topic, const char *payload) {
+    char message[256];
+    int len = snprintf(message, sizeof(message), "{\"type\":\"%s\",\"topic\":", type);
+    len = (int)append_json_string(message, sizeof(message), (size_t)len, topic);
+    if (len < (int)sizeof(message)) {
+        len += snprintf(message + len, sizeof(message) - (size_t)len, ",\"payload\":%s}", payload);
+    }
+    if (len > 0 && len < (int)sizeof(message)) {
+        mg_reactor_ws_send(c, message, (size_t)len);
+    }
+}
+
+/**
+ * @brief Send a resuming client what it missed
+ *
+ * @param since Last sequence number the client saw, 0 for none
+ */
+static void resume_client(struct mg_connection *c, const char *topic, uint64_t since) {
+    char payload[96];
+
+    pthread_mutex_lock(&detection_ws.mutex);
+
+    uint64_t current = detection_ws.next_seq - 1;
+    uint64_t oldest = detection_ws.next_seq > DETECTION_WS_HISTORY ?
+                      detection_ws.next_seq - DETECTION_WS_HISTORY : 1;
+    int index = find_stream(topic, false);
+
+    // The history covers everything after since, so replay it
+    bool replay = since > 0 && since + 1 >= oldest && since <= current;
+
+    snprintf(payload, sizeof(payload), "{\"seq\":%" PRIu64 ",\"reset\":%s}",
+             current, replay ? "false" : "true");
+    send_control(c, "subscribed", topic, payload);
+
+    if (index >= 0 && replay) {
+        for (uint64_t seq = since + 1; seq <= current; seq++) {
+            detection_update_t *slot = &detection_ws.history[seq % DETECTION_WS_HISTORY];
+            if (slot->seq == seq && slot->stream == index && slot->message) {
+                mg_reactor_ws_send(c, slot->message, strlen(slot->message));
+            }
+        }
+    } else if (index >= 0 && detection_ws.streams[index].last_message) {
+        // Too far behind to replay, start over from the current boxes
+        const char *latest = detection_ws.streams[index].last_message;
+        mg_reactor_ws_send(c, latest, strlen(latest));
+    }
+
+    pthread_mutex_unlock(&detection_ws.mutex);
+}
+
+/**
+ * @brief WebSocket handler for the detection/live/<stream> topics
+ */
+static void websocket_handle_detection_live(struct mg_connection *c, const char *data,
+                                            size_t data_len, void *user_data) {
+    (void)data_len;
+    (void)user_data;
+
+    cJSON *json = cJSON_Parse(data);
+    cJSON *topic_obj = json ? cJSON_GetObjectItem(json, "topic") : NULL;
+    cJSON *type_obj = json ? cJSON_GetObjectItem(json, "type") : NULL;
+    const char *topic = topic_obj && cJSON_IsString(topic_obj) ? topic_obj->valuestring : NULL;
+    const char *type = type_obj && cJSON_IsString(type_obj) ? type_obj->valuestring : "subscribe";
+
+    size_t prefix_len = strlen(DETECTION_WS_TOPIC);
+    if (!topic || strncmp(topic, DETECTION_WS_TOPIC, prefix_len) != 0 ||
+        topic[prefix_len] != '/' || topic[prefix_len + 1] == '\0' ||
+        strlen(topic) >= MAX_TOPIC_LENGTH) {
+        send_control(c, "error", DETECTION_WS_TOPIC,
+                     "{\"error\":\"Subscribe to detection/live/<stream name>\"}");
+        cJSON_Delete(json);
+        return;
+    }
+
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "%p", (void *)c);
+
+    if (strcmp(type, "unsubscribe") == 0) {
+        websocket_client_unsubscribe(client_id, topic);
+        log_debug("Client %s unsubscribed from %s", client_id, topic);
+    } else if (strcmp(type, "subscribe") == 0) {
+        if (!websocket_client_subscribe(client_id, topic)) {
+            send_control(c, "error", topic, "{\"error\":\"Subscription failed\"}");
+        } else {
+            cJSON *payload = cJSON_GetObjectItem(json, "payload");
+            cJSON *since_obj = payload ? cJSON_GetObjectItem(payload, "since") : NULL;
+            uint64_t since = since_obj && cJSON_IsNumber(since_obj) && since_obj->valuedouble > 0 ?
+                             (uint64_t)since_obj->valuedouble : 0;
+
+            log_debug("Client %s subscribed to %s from sequence %" PRIu64, client_id, topic, since);
+            resume_client(c, topic, since);
+        }
+    } else {
+        send_control(c, "error", topic, "{\"error\":\"Unknown message type\"}");
+    }
+
+    cJSON_Delete(json);
+}
+
+/**
+ * @brief Register the live detection WebSocket topic
+ */
+int detection_ws_init(void) {
+    if (websocket_manager_register_handler(DETECTION_WS_TOPIC, websocket_handle_detection_live, NULL) != 0) {
+        log_error("Failed to register live detection WebSocket topic");
+        return -1;
+    }
+
+    log_info("Live detection results available on WebSocket topic %s/<stream>", DETECTION_WS_TOPIC);
+    return 0;
+}
@@ -178,7 +178,8 @@ void serve_download_file(struct mg_connection *c, const char *file_path, const c
     
     // Format timestamp for filename in UTC
     char timestamp_str[32] = {0};
-    struct tm *tm_info = gmtime(&timestamp);
+    struct tm tm_buf;
+    struct tm *tm_info = gmtime_r(&timestamp, &tm_buf);
     if (tm_info) {
         strftime(timestamp_str, sizeof(timestamp_str), "%Y%m%d_%H%M%S", tm_info);
     }
@@ -421,34 +421,13 @@ void batch_delete_recordings_task_function(struct mg_connection *c, struct mg_ht
 void mg_handle_batch_delete_recordings(struct mg_connection *c, struct mg_http_message *hm) {
     log_info("Handling POST /api/recordings/batch-delete request");
     
-    // Send an immediate response to the client before processing the deletion
-    // This prevents the client from waiting for the deletion to complete
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Batch deletion in progress\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, batch_delete_recordings_task_function)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = batch_delete_recordings_task_function;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Batch deletion in progress\"}");
     
     log_info("Batch delete recordings task started in a worker thread");
 }
@@ -19,6 +19,7 @@
 #include "web/api_handlers_recordings_batch_ws.h"
 #include "web/mongoose_server_websocket_utils.h"
 #include "web/mongoose_server_multithreading.h"
+#include "web/mongoose_server_reactor.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "core/shutdown_coordinator.h"
@@ -126,8 +127,8 @@ void send_progress_update(struct mg_connection *conn, int current, int total,
     
     log_info("Sending progress update: %s", message);
     
-    // Send message directly using mongoose
-    mg_ws_send(conn, message, len, WEBSOCKET_OP_TEXT);
+    // Hand the message to the event loop that owns the connection
+    mg_reactor_ws_send(conn, message, len);
 }
 
 /**
@@ -172,9 +173,9 @@ void send_final_result(const char *client_id, bool success, int total,
     // Get client connection directly from pointer value stored in client_id string
     struct mg_connection *conn = NULL;
     if (sscanf(client_id, "%p", &conn) == 1 && conn) {
-        // Send message directly using mongoose
+        // Hand the message to the event loop that owns the connection
         log_info("Sending final result to client %s", client_id);
-        mg_ws_send(conn, message, strlen(message), WEBSOCKET_OP_TEXT);
+        mg_reactor_ws_send(conn, message, strlen(message));
     } else {
         log_error("Invalid client ID or connection not found: %s", client_id);
     }
@@ -1172,32 +1173,13 @@ void batch_delete_recordings_ws_handler(struct mg_connection *c, struct mg_http_
 void mg_handle_batch_delete_recordings_ws(struct mg_connection *c, struct mg_http_message *hm) {
     log_info("Handling POST /api/recordings/batch-delete-ws request");
     
-    // Send an immediate response to the client before processing the deletion
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Batch deletion in progress\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, batch_delete_recordings_ws_handler)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = batch_delete_recordings_ws_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Batch deletion in progress\"}");
     
     log_info("Batch delete recordings task started in a worker thread");
 }
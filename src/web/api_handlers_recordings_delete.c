@@ -258,32 +258,13 @@ void mg_handle_delete_recording(struct mg_connection *c, struct mg_http_message
     
     log_info("Handling DELETE /api/recordings/%llu request", (unsigned long long)id);
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, delete_recording_handler)) {
         return;
     }
     
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
-        return;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = delete_recording_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("Delete recording task started in a worker thread");
 }
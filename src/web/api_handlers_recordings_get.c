@@ -20,6 +20,200 @@
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
 #include "web/mongoose_server_multithreading.h"
+#include "web/json_writer.h"
+
+/**
+ * @brief Recordings read from the database per batch of a streamed list
+ */
+#define RECORDINGS_STREAM_BATCH 50
+
+/**
+ * @brief Recordings list being streamed to a client
+ */
+typedef struct {
+    char stream_name[64];
+    time_t start_time;
+    time_t end_time;
+    int has_detection;
+    char sort_field[32];
+    char sort_order[8];
+    bool by_start_time;
+    bool ascending;
+    bool use_cursor;
+    recording_cursor_t cursor;      // Last recording written, when use_cursor is set
+    bool by_page;                   // Located by page number, so its anchor can be remembered
+    uint64_t generation;            // List version when the page anchor was looked up
+    int page;
+    int limit;
+    int offset;
+    int total_count;
+    int sent;                       // Recordings written so far
+    bool started;
+    bool exhausted;                 // The last batch came back short
+    recording_metadata_t batch[RECORDINGS_STREAM_BATCH];
+    int batch_count;                // Recordings in batch not written yet
+} recordings_stream_t;
+
+/**
+ * @brief Read the next batch of recordings
+ *
+ * Batches after the first continue from the last recording written when
+ * sorting by start time, so rows added meanwhile do not shift the page.
+ *
+ * @return Number of recordings read, -1 on error
+ */
+static int recordings_stream_fetch(recordings_stream_t *stream) {
+    int want = stream->limit - stream->sent;
+    if (want > RECORDINGS_STREAM_BATCH) {
+        want = RECORDINGS_STREAM_BATCH;
+    }
+    
+    // Pages sorted by start time are read here rather than through
+    // get_recording_metadata_paginated, which would remember page anchors
+    // for the batch size instead of the page size
+    const char *stream_name = stream->stream_name[0] != '\0' ? stream->stream_name : NULL;
+    int count;
+    if (stream->by_start_time) {
+        count = get_recording_metadata_after(stream->start_time, stream->end_time, stream_name,
+                                             stream->has_detection, stream->ascending,
+                                             stream->use_cursor ? &stream->cursor : NULL,
+                                             stream->batch, want,
+                                             stream->use_cursor ? 0 : stream->offset + stream->sent);
+    } else {
+        count = get_recording_metadata_paginated(stream->start_time, stream->end_time, stream_name,
+                                                 stream->has_detection, stream->sort_field,
+                                                 stream->sort_order, stream->batch, want,
+                                                 stream->offset + stream->sent);
+    }
+    
+    if (count < 0) {
+        return -1;
+    }
+    
+    stream->batch_count = count;
+    stream->exhausted = count < want;
+    if (count > 0 && stream->by_start_time) {
+        stream->cursor.start_time = stream->batch[count - 1].start_time;
+        stream->cursor.id = stream->batch[count - 1].id;
+        stream->use_cursor = true;
+    }
+    
+    return count;
+}
+
+/**
+ * @brief Write one recording of the list
+ */
+static void write_recording(json_writer_t *writer, const recording_metadata_t *recording) {
+    // Format timestamps in UTC
+    char start_time_str[32] = {0};
+    char end_time_str[32] = {0};
+    struct tm tm_buf;
+    struct tm *tm_info;
+    
+    tm_info = gmtime_r(&recording->start_time, &tm_buf);
+    if (tm_info) {
+        strftime(start_time_str, sizeof(start_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+    }
+    
+    tm_info = gmtime_r(&recording->end_time, &tm_buf);
+    if (tm_info) {
+        strftime(end_time_str, sizeof(end_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+    }
+    
+    // Calculate duration in seconds
+    int duration = (int)difftime(recording->end_time, recording->start_time);
+    
+    // Format file size for display (e.g., "1.8 MB")
+    char size_str[32] = {0};
+    if (recording->size_bytes < 1024) {
+        snprintf(size_str, sizeof(size_str), "%ld B", recording->size_bytes);
+    } else if (recording->size_bytes < 1024 * 1024) {
+        snprintf(size_str, sizeof(size_str), "%.1f KB", recording->size_bytes / 1024.0);
+    } else if (recording->size_bytes < 1024 * 1024 * 1024) {
+        snprintf(size_str, sizeof(size_str), "%.1f MB", recording->size_bytes / (1024.0 * 1024.0));
+    } else {
+        snprintf(size_str, sizeof(size_str), "%.1f GB", recording->size_bytes / (1024.0 * 1024.0 * 1024.0));
+    }
+    
+    json_writer_object_begin(writer, NULL);
+    json_writer_int(writer, "id", (int64_t)recording->id);
+    json_writer_string(writer, "stream", recording->stream_name);
+    json_writer_string(writer, "file_path", recording->file_path);
+    json_writer_string(writer, "start_time", start_time_str);
+    json_writer_string(writer, "end_time", end_time_str);
+    json_writer_int(writer, "duration", duration);
+    json_writer_string(writer, "size", size_str);
+    json_writer_bool(writer, "has_detection", recording->detection_count > 0);
+    json_writer_int(writer, "detection_count", recording->detection_count);
+    json_writer_string(writer, "detection_labels", recording->detection_labels);
+    json_writer_object_end(writer);
+}
+
+/**
+ * @brief Write the next batch of the recordings list
+ */
+static int recordings_stream_produce(json_writer_t *writer, void *ctx) {
+    recordings_stream_t *stream = (recordings_stream_t *)ctx;
+    
+    if (!stream->started) {
+        json_writer_object_begin(writer, NULL);
+        json_writer_array_begin(writer, "recordings");
+        stream->started = true;
+    }
+    
+    if (stream->batch_count == 0 && !stream->exhausted && stream->sent < stream->limit) {
+        if (recordings_stream_fetch(stream) < 0) {
+            log_error("Failed to get recordings from database after %d rows", stream->sent);
+            return -1;
+        }
+    }
+    
+    if (stream->batch_count > 0) {
+        for (int i = 0; i < stream->batch_count; i++) {
+            write_recording(writer, &stream->batch[i]);
+        }
+        stream->sent += stream->batch_count;
+        stream->batch_count = 0;
+        
+        if (!stream->exhausted && stream->sent < stream->limit) {
+            return 0;
+        }
+    }
+    
+    json_writer_array_end(writer);
+    
+    // Add pagination info
+    int total_pages = (stream->total_count + stream->limit - 1) / stream->limit; // Ceiling division
+    json_writer_object_begin(writer, "pagination");
+    json_writer_int(writer, "page", stream->page);
+    json_writer_int(writer, "pages", total_pages);
+    json_writer_int(writer, "total", stream->total_count);
+    json_writer_int(writer, "limit", stream->limit);
+    
+    // Cursor for the following page, cheaper than asking for page + 1
+    if (stream->by_start_time && stream->sent == stream->limit) {
+        // A full page: asking for page + 1 by number seeks from here too
+        if (stream->by_page) {
+            set_recording_page_anchor(stream->start_time, stream->end_time,
+                                      stream->stream_name[0] != '\0' ? stream->stream_name : NULL,
+                                      stream->has_detection, stream->ascending, stream->limit,
+                                      stream->offset, &stream->cursor, stream->generation);
+        }
+        
+        char next_cursor[64];
+        snprintf(next_cursor, sizeof(next_cursor), "%lld_%llu",
+                 (long long)stream->cursor.start_time,
+                 (unsigned long long)stream->cursor.id);
+        json_writer_string(writer, "next_cursor", next_cursor);
+    }
+    json_writer_object_end(writer);
+    
+    json_writer_object_end(writer);
+    
+    log_info("Successfully streamed GET /api/recordings response (%d recordings)", stream->sent);
+    return 1;
+}
 
 /**
  * @brief Worker function for GET /api/recordings
@@ -72,9 +266,11 @@ void mg_handle_get_recordings_worker(struct mg_connection *c, struct mg_http_mes
     char sort_field[32] = "start_time";
     char sort_order[8] = "desc";
     int has_detection = 0;
+    char cursor_str[64] = {0};
     
     // Parse query string
-    char *param = strtok(query_string, "&");
+    char *saveptr = NULL;
+    char *param = strtok_r(query_string, "&", &saveptr);
     while (param) {
         if (strncmp(param, "stream=", 7) == 0) {
             strncpy(stream_name, param + 7, sizeof(stream_name) - 1);
@@ -92,8 +288,10 @@ void mg_handle_get_recordings_worker(struct mg_connection *c, struct mg_http_mes
             strncpy(sort_order, param + 6, sizeof(sort_order) - 1);
         } else if (strncmp(param, "detection=", 10) == 0) {
             has_detection = atoi(param + 10);
+        } else if (strncmp(param, "cursor=", 7) == 0) {
+            strncpy(cursor_str, param + 7, sizeof(cursor_str) - 1);
         }
-        param = strtok(NULL, "&");
+        param = strtok_r(NULL, "&", &saveptr);
     }
     
     // Validate parameters
@@ -104,17 +302,23 @@ void mg_handle_get_recordings_worker(struct mg_connection *c, struct mg_http_mes
     // Calculate offset from page and limit
     int offset = (page - 1) * limit;
     
-    // Get recordings from database
-    recording_metadata_t *recordings = NULL;
-    int count = 0;
-    int total_count = 0;
-    
-    // Allocate memory for recordings
-    recordings = (recording_metadata_t *)malloc(limit * sizeof(recording_metadata_t));
-    if (!recordings) {
-        log_error("Failed to allocate memory for recordings");
-        mg_send_json_error(c, 500, "Failed to allocate memory for recordings");
-        return;
+    // A cursor ("<start_time>_<id>" of the last recording on the previous page)
+    // selects keyset pagination, which only applies when sorting by start time
+    bool by_start_time = strcmp(sort_field, "start_time") == 0;
+    bool ascending = strcasecmp(sort_order, "asc") == 0;
+    bool use_cursor = false;
+    recording_cursor_t cursor = {0};
+    
+    if (cursor_str[0] != '\0' && by_start_time) {
+        long long cursor_start = 0;
+        unsigned long long cursor_id = 0;
+        if (sscanf(cursor_str, "%lld_%llu", &cursor_start, &cursor_id) == 2) {
+            cursor.start_time = (time_t)cursor_start;
+            cursor.id = (uint64_t)cursor_id;
+            use_cursor = true;
+        } else {
+            log_warn("Ignoring invalid recordings cursor: %s", cursor_str);
+        }
     }
     
     // Parse time strings to time_t
@@ -182,143 +386,62 @@ void mg_handle_get_recordings_worker(struct mg_connection *c, struct mg_http_mes
     }
     
     // Get total count first (for pagination)
-    total_count = get_recording_count(start_time, end_time, 
-                                     stream_name[0] != '\0' ? stream_name : NULL,
-                                     has_detection);
+    int total_count = get_recording_count(start_time, end_time, 
+                                          stream_name[0] != '\0' ? stream_name : NULL,
+                                          has_detection);
     
     if (total_count < 0) {
         log_error("Failed to get total recording count from database");
-        free(recordings);
         mg_send_json_error(c, 500, "Failed to get recording count from database");
         return;
     }
     
-    // Get recordings with pagination
-    count = get_recording_metadata_paginated(start_time, end_time, 
-                                           stream_name[0] != '\0' ? stream_name : NULL,
-                                           has_detection, sort_field, sort_order,
-                                           recordings, limit, offset);
-    
-    if (count < 0) {
-        log_error("Failed to get recordings from database");
-        free(recordings);
-        mg_send_json_error(c, 500, "Failed to get recordings from database");
-        return;
-    }
-    
-    // Create response object with recordings array and pagination
-    cJSON *response = cJSON_CreateObject();
-    if (!response) {
-        log_error("Failed to create response JSON object");
-        free(recordings);
-        mg_send_json_error(c, 500, "Failed to create response JSON");
+    recordings_stream_t *stream = (recordings_stream_t *)calloc(1, sizeof(recordings_stream_t));
+    if (!stream) {
+        log_error("Failed to allocate memory for recordings");
+        mg_send_json_error(c, 500, "Failed to allocate memory for recordings");
         return;
     }
     
-    // Create recordings array
-    cJSON *recordings_array = cJSON_CreateArray();
-    if (!recordings_array) {
-        log_error("Failed to create recordings JSON array");
-        free(recordings);
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to create recordings JSON");
-        return;
+    strncpy(stream->stream_name, stream_name, sizeof(stream->stream_name) - 1);
+    strncpy(stream->sort_field, sort_field, sizeof(stream->sort_field) - 1);
+    strncpy(stream->sort_order, sort_order, sizeof(stream->sort_order) - 1);
+    stream->start_time = start_time;
+    stream->end_time = end_time;
+    stream->has_detection = has_detection;
+    stream->by_start_time = by_start_time;
+    stream->ascending = ascending;
+    stream->use_cursor = use_cursor;
+    stream->cursor = cursor;
+    stream->page = page;
+    stream->limit = limit;
+    stream->offset = offset;
+    stream->total_count = total_count;
+    
+    // A page asked for by number starts from the last row of the page before
+    // when that page has been served
+    if (by_start_time && !use_cursor) {
+        stream->by_page = true;
+        stream->use_cursor = get_recording_page_anchor(start_time, end_time,
+                                                       stream_name[0] != '\0' ? stream_name : NULL,
+                                                       has_detection, ascending, limit, offset,
+                                                       &stream->cursor, &stream->generation);
     }
     
-    // Add recordings array to response
-    cJSON_AddItemToObject(response, "recordings", recordings_array);
-    
-    // Create pagination object
-    cJSON *pagination = cJSON_CreateObject();
-    if (!pagination) {
-        log_error("Failed to create pagination JSON object");
-        free(recordings);
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to create pagination JSON");
+    // The first batch is read up front so a database error still gets a 500
+    if (recordings_stream_fetch(stream) < 0) {
+        log_error("Failed to get recordings from database");
+        free(stream);
+        mg_send_json_error(c, 500, "Failed to get recordings from database");
         return;
     }
     
-    // Add pagination info
-    int total_pages = (total_count + limit - 1) / limit; // Ceiling division
-    cJSON_AddNumberToObject(pagination, "page", page);
-    cJSON_AddNumberToObject(pagination, "pages", total_pages);
-    cJSON_AddNumberToObject(pagination, "total", total_count);
-    cJSON_AddNumberToObject(pagination, "limit", limit);
-    
-    // Add pagination object to response
-    cJSON_AddItemToObject(response, "pagination", pagination);
-    
-    // Add each recording to the array
-    for (int i = 0; i < count; i++) {
-        cJSON *recording = cJSON_CreateObject();
-        if (!recording) {
-            log_error("Failed to create recording JSON object");
-            continue;
-        }
-        
-        // Format timestamps in UTC
-        char start_time_str[32] = {0};
-        char end_time_str[32] = {0};
-        struct tm *tm_info;
-        
-        tm_info = gmtime(&recordings[i].start_time);
-        if (tm_info) {
-            strftime(start_time_str, sizeof(start_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
-        }
-        
-        tm_info = gmtime(&recordings[i].end_time);
-        if (tm_info) {
-            strftime(end_time_str, sizeof(end_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
-        }
-        
-        // Calculate duration in seconds
-        int duration = (int)difftime(recordings[i].end_time, recordings[i].start_time);
-        
-        // Format file size for display (e.g., "1.8 MB")
-        char size_str[32] = {0};
-        if (recordings[i].size_bytes < 1024) {
-            snprintf(size_str, sizeof(size_str), "%ld B", recordings[i].size_bytes);
-        } else if (recordings[i].size_bytes < 1024 * 1024) {
-            snprintf(size_str, sizeof(size_str), "%.1f KB", recordings[i].size_bytes / 1024.0);
-        } else if (recordings[i].size_bytes < 1024 * 1024 * 1024) {
-            snprintf(size_str, sizeof(size_str), "%.1f MB", recordings[i].size_bytes / (1024.0 * 1024.0));
-        } else {
-            snprintf(size_str, sizeof(size_str), "%.1f GB", recordings[i].size_bytes / (1024.0 * 1024.0 * 1024.0));
-        }
-        
-        cJSON_AddNumberToObject(recording, "id", recordings[i].id);
-        cJSON_AddStringToObject(recording, "stream", recordings[i].stream_name);
-        cJSON_AddStringToObject(recording, "file_path", recordings[i].file_path);
-        cJSON_AddStringToObject(recording, "start_time", start_time_str);
-        cJSON_AddStringToObject(recording, "end_time", end_time_str);
-        cJSON_AddNumberToObject(recording, "duration", duration);
-        cJSON_AddStringToObject(recording, "size", size_str);
-        cJSON_AddBoolToObject(recording, "has_detection", false); // Default to false as it's not in metadata
-        
-        cJSON_AddItemToArray(recordings_array, recording);
-    }
-    
-    // Free recordings
-    free(recordings);
-    
-    // Convert to string
-    char *json_str = cJSON_PrintUnformatted(response);
-    if (!json_str) {
-        log_error("Failed to convert response JSON to string");
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to convert response JSON to string");
+    log_info("Streaming JSON response for GET /api/recordings request");
+    if (json_writer_stream(c, 200, recordings_stream_produce, free, stream) != 0) {
+        free(stream);
+        mg_send_json_error(c, 500, "Failed to create response JSON");
         return;
     }
-    
-    // Send response directly
-    log_info("Sending JSON response for GET /api/recordings request");
-    mg_send_json_response(c, 200, json_str);
-    
-    // Clean up
-    free(json_str);
-    cJSON_Delete(response);
-    
-    log_info("Successfully handled GET /api/recordings request");
 }
 
 /**
@@ -392,14 +515,15 @@ void mg_handle_get_recording_worker(struct mg_connection *c, struct mg_http_mess
     // Format timestamps in UTC
     char start_time_str[32] = {0};
     char end_time_str[32] = {0};
+    struct tm tm_buf;
     struct tm *tm_info;
     
-    tm_info = gmtime(&recording.start_time);
+    tm_info = gmtime_r(&recording.start_time, &tm_buf);
     if (tm_info) {
         strftime(start_time_str, sizeof(start_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
     }
     
-    tm_info = gmtime(&recording.end_time);
+    tm_info = gmtime_r(&recording.end_time, &tm_buf);
     if (tm_info) {
         strftime(end_time_str, sizeof(end_time_str), "%Y-%m-%d %H:%M:%S UTC", tm_info);
     }
@@ -427,7 +551,10 @@ void mg_handle_get_recording_worker(struct mg_connection *c, struct mg_http_mess
     cJSON_AddStringToObject(recording_obj, "end_time", end_time_str);
     cJSON_AddNumberToObject(recording_obj, "duration", duration);
     cJSON_AddStringToObject(recording_obj, "size", size_str);
-    cJSON_AddBoolToObject(recording_obj, "has_detection", false); // Default to false as it's not in metadata
+    cJSON_AddBoolToObject(recording_obj, "has_detection", recording.detection_count > 0);
+    cJSON_AddNumberToObject(recording_obj, "detection_count", recording.detection_count);
+    cJSON_AddNumberToObject(recording_obj, "max_confidence", recording.max_confidence);
+    cJSON_AddStringToObject(recording_obj, "detection_labels", recording.detection_labels);
     
     // Convert to string
     char *json_str = cJSON_PrintUnformatted(recording_obj);
@@ -5,6 +5,8 @@
 #include <string.h>
 #include <sys/stat.h>
 #include "web/mongoose_adapter.h"
+#include "web/mongoose_server_sendfile.h"
+#include "web/mongoose_server_routes.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "web/http_server.h"
@@ -23,9 +25,9 @@ void mg_handle_hls_master_playlist(struct mg_connection *c, struct mg_http_messa
     memcpy(uri, hm->uri.buf, uri_len);
     uri[uri_len] = '\0';
     
-    // Parse the URI to extract stream name
+    // Take the stream name from the parameter captured by the route
     char stream_name[MAX_STREAM_NAME] = {0};
-    if (sscanf(uri, "/api/streaming/%[^/]/hls/", stream_name) != 1) {
+    if (mg_route_get_param(hm, 0, stream_name, sizeof(stream_name)) <= 0) {
         log_error("Failed to extract stream name from URI: %s", uri);
         mg_http_reply(c, 400, "", "{\"error\": \"Invalid URI format\"}\n");
         return;
@@ -62,7 +64,7 @@ void mg_handle_hls_master_playlist(struct mg_connection *c, struct mg_http_messa
             "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
             "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n";
         
-        mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
+        mg_http_sendfile(c, hm, hls_file_path, &(struct mg_http_serve_opts){
             .mime_types = "",
             .extra_headers = headers
         });
@@ -85,9 +87,9 @@ void mg_handle_hls_media_playlist(struct mg_connection *c, struct mg_http_messag
     memcpy(uri, hm->uri.buf, uri_len);
     uri[uri_len] = '\0';
     
-    // Parse the URI to extract stream name
+    // Take the stream name from the parameter captured by the route
     char stream_name[MAX_STREAM_NAME] = {0};
-    if (sscanf(uri, "/api/streaming/%[^/]/hls/", stream_name) != 1) {
+    if (mg_route_get_param(hm, 0, stream_name, sizeof(stream_name)) <= 0) {
         log_error("Failed to extract stream name from URI: %s", uri);
         mg_http_reply(c, 400, "", "{\"error\": \"Invalid URI format\"}\n");
         return;
@@ -124,7 +126,7 @@ void mg_handle_hls_media_playlist(struct mg_connection *c, struct mg_http_messag
             "Access-Control-Allow-Methods: GET, OPTIONS\r\n"
             "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n";
         
-        mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
+        mg_http_sendfile(c, hm, hls_file_path, &(struct mg_http_serve_opts){
             .mime_types = "",
             .extra_headers = headers
         });
@@ -231,7 +233,7 @@ void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_messag
             "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n",
             content_type_header, cache_control);
         
-        mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
+        mg_http_sendfile(c, hm, hls_file_path, &(struct mg_http_serve_opts){
             .mime_types = "",
             .extra_headers = headers
         });
@@ -254,9 +256,9 @@ void mg_handle_hls_segment(struct mg_connection *c, struct mg_http_message *hm)
     memcpy(uri, hm->uri.buf, uri_len);
     uri[uri_len] = '\0';
     
-    // Parse the URI to extract stream name
+    // Take the stream name from the parameter captured by the route
     char stream_name[MAX_STREAM_NAME] = {0};
-    if (sscanf(uri, "/api/streaming/%[^/]/hls/", stream_name) != 1) {
+    if (mg_route_get_param(hm, 0, stream_name, sizeof(stream_name)) <= 0) {
         log_error("Failed to extract stream name from URI: %s", uri);
         mg_http_reply(c, 400, "", "{\"error\": \"Invalid URI format\"}\n");
         return;
@@ -347,7 +349,7 @@ void mg_handle_hls_segment(struct mg_connection *c, struct mg_http_message *hm)
             "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n",
             content_type_header, cache_control);
         
-        mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
+        mg_http_sendfile(c, hm, hls_file_path, &(struct mg_http_serve_opts){
             .mime_types = "",
             .extra_headers = headers
         });
@@ -21,6 +21,9 @@
 #include "web/api_handlers.h"
 #include "web/mongoose_adapter.h"
 #include "web/api_handlers_system_ws.h"
+#include "web/system_status.h"
+#include "web/mongoose_server_multithreading.h"
+#include "web/mongoose_server_reactor.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "core/version.h"
@@ -29,11 +32,11 @@
 #include "database/database_manager.h"
 #include "database/db_streams.h"
 #include "database/db_recordings.h"
+#include "database/db_backup.h"
+#include "database/db_checkpoint.h"
+#include "storage/storage_manager.h"
 #include "mongoose.h"
 
-// External function from api_handlers_system_go2rtc.c
-extern bool get_go2rtc_memory_usage(unsigned long long *memory_usage);
-
 // External declarations
 extern bool daemon_mode;
 
@@ -44,502 +47,46 @@ extern void get_system_logs(char ***logs, int *count);
 
 /**
  * @brief Direct handler for GET /api/system/info
+ *
+ * Answered from the snapshot kept by the system status sampler.
  */
 void mg_handle_get_system_info(struct mg_connection *c, struct mg_http_message *hm) {
-    log_info("Handling GET /api/system/info request");
+    log_debug("Handling GET /api/system/info request");
     
-    // Create JSON object
-    cJSON *info = cJSON_CreateObject();
-    if (!info) {
-        log_error("Failed to create system info JSON object");
-        mg_send_json_error(c, 500, "Failed to create system info JSON");
+    system_status_snapshot_t *snapshot = system_status_acquire();
+    if (!snapshot) {
+        log_error("No system status available");
+        mg_send_json_error(c, 500, "Failed to get system info");
         return;
     }
     
-    // Add version information
-    cJSON_AddStringToObject(info, "version", LIGHTNVR_VERSION_STRING);
-    
-    // Get system information
-    struct utsname system_info;
-    if (uname(&system_info) == 0) {
-        // Create CPU object
-        cJSON *cpu = cJSON_CreateObject();
-        if (cpu) {
-            cJSON_AddStringToObject(cpu, "model", system_info.machine);
-            
-            // Get CPU cores
-            int cores = sysconf(_SC_NPROCESSORS_ONLN);
-            cJSON_AddNumberToObject(cpu, "cores", cores);
-            
-            // Calculate CPU usage (simplified)
-            double cpu_usage = 0.0;
-            FILE *fp = fopen("/proc/stat", "r");
-            if (fp) {
-                unsigned long user, nice, system, idle, iowait, irq, softirq;
-                if (fscanf(fp, "cpu %lu %lu %lu %lu %lu %lu %lu", 
-                          &user, &nice, &system, &idle, &iowait, &irq, &softirq) == 7) {
-                    unsigned long total = user + nice + system + idle + iowait + irq + softirq;
-                    unsigned long active = user + nice + system + irq + softirq;
-                    cpu_usage = (double)active / (double)total * 100.0;
-                }
-                fclose(fp);
-            }
-            cJSON_AddNumberToObject(cpu, "usage", cpu_usage);
-            
-            // Add CPU object to info
-            cJSON_AddItemToObject(info, "cpu", cpu);
-        }
-    }
-    
-    // Get system-wide memory information first
-    struct sysinfo sys_info;
-    unsigned long long system_total = 0;
-    unsigned long long system_free = 0;
-    unsigned long long system_used = 0;
-    
-    if (sysinfo(&sys_info) == 0) {
-        // Calculate memory values in bytes
-        system_total = sys_info.totalram * sys_info.mem_unit;
-        system_free = sys_info.freeram * sys_info.mem_unit;
-        system_used = system_total - system_free;
-    }
-    
-    // Get memory information for the LightNVR process
-    cJSON *memory = cJSON_CreateObject();
-    if (memory) {
-        // Get process memory usage using /proc/self/status
-        FILE *fp = fopen("/proc/self/status", "r");
-        unsigned long vm_rss = 0;
-        
-        if (fp) {
-            char line[256];
-            while (fgets(line, sizeof(line), fp)) {
-                if (strncmp(line, "VmRSS:", 6) == 0) {
-                    // VmRSS is in kB - actual physical memory used
-                    sscanf(line + 6, "%lu", &vm_rss);
-                    break;
-                }
-            }
-            fclose(fp);
-        }
-        
-        // Convert kB to bytes
-        unsigned long long used = vm_rss * 1024;
-        
-        // Use the system total memory as the total for LightNVR as well
-        // This makes it simpler to understand the memory usage
-        unsigned long long total = system_total;
-        
-        // Calculate free as the difference between total and used
-        unsigned long long free = (total > used) ? (total - used) : 0;
-        
-        cJSON_AddNumberToObject(memory, "total", total);
-        cJSON_AddNumberToObject(memory, "used", used);
-        cJSON_AddNumberToObject(memory, "free", free);
-        
-        // Add memory object to info
-        cJSON_AddItemToObject(info, "memory", memory);
-    }
-    
-    // Get memory information for the go2rtc process
-    cJSON *go2rtc_memory = cJSON_CreateObject();
-    if (go2rtc_memory) {
-        unsigned long long go2rtc_used = 0;
-        
-        // Try to get go2rtc memory usage
-        if (get_go2rtc_memory_usage(&go2rtc_used)) {
-            log_debug("go2rtc memory usage: %llu bytes", go2rtc_used);
-        } else {
-            log_warn("Failed to get go2rtc memory usage, using 0");
-        }
-        
-        // Use the system total memory as the total for go2rtc as well
-        unsigned long long total = system_total;
-        
-        // Calculate free as the difference between total and used
-        unsigned long long free = (total > go2rtc_used) ? (total - go2rtc_used) : 0;
-        
-        cJSON_AddNumberToObject(go2rtc_memory, "total", total);
-        cJSON_AddNumberToObject(go2rtc_memory, "used", go2rtc_used);
-        cJSON_AddNumberToObject(go2rtc_memory, "free", free);
-        
-        // Add go2rtc memory object to info
-        cJSON_AddItemToObject(info, "go2rtcMemory", go2rtc_memory);
-    }
-    
-    // Get system-wide memory information
-    cJSON *system_memory = cJSON_CreateObject();
-    if (system_memory) {
-        cJSON_AddNumberToObject(system_memory, "total", system_total);
-        cJSON_AddNumberToObject(system_memory, "used", system_used);
-        cJSON_AddNumberToObject(system_memory, "free", system_free);
-        
-        // Add system memory object to info
-        cJSON_AddItemToObject(info, "systemMemory", system_memory);
-    }
-    
-    // Get uptime of the LightNVR process
-    // Use /proc/self/stat to get process start time
-    FILE *stat_file = fopen("/proc/self/stat", "r");
-    if (stat_file) {
-        // Fields in /proc/self/stat
-        char comm[256];
-        char state;
-        int ppid, pgrp, session, tty_nr, tpgid;
-        unsigned long flags, minflt, cminflt, majflt, cmajflt, utime, stime;
-        long cutime, cstime, priority, nice, num_threads, itrealvalue;
-        unsigned long long starttime;
-        
-        // Read the stat file
-        fscanf(stat_file, "%*d %s %c %d %d %d %d %d %lu %lu %lu %lu %lu %lu %lu %ld %ld %ld %ld %ld %ld %llu",
-               comm, &state, &ppid, &pgrp, &session, &tty_nr, &tpgid,
-               &flags, &minflt, &cminflt, &majflt, &cmajflt, &utime, &stime,
-               &cutime, &cstime, &priority, &nice, &num_threads, &itrealvalue, &starttime);
-        fclose(stat_file);
-        
-        // Get system uptime
-        FILE *uptime_file = fopen("/proc/uptime", "r");
-        double system_uptime = 0;
-        if (uptime_file) {
-            fscanf(uptime_file, "%lf", &system_uptime);
-            fclose(uptime_file);
-        }
-        
-        // Calculate process uptime in seconds
-        // starttime is in clock ticks since system boot
-        // Convert to seconds by dividing by sysconf(_SC_CLK_TCK)
-        long clock_ticks = sysconf(_SC_CLK_TCK);
-        double process_uptime = system_uptime - ((double)starttime / clock_ticks);
-        
-        // Add process uptime to info
-        cJSON_AddNumberToObject(info, "uptime", process_uptime);
-    } else {
-        // Fallback to system uptime if process uptime can't be determined
-        struct sysinfo sys_info;
-        if (sysinfo(&sys_info) == 0) {
-            cJSON_AddNumberToObject(info, "uptime", sys_info.uptime);
-        }
-    }
-    
-    // Get disk information for the configured storage path
-    struct statvfs disk_info;
-    if (statvfs(g_config.storage_path, &disk_info) == 0) {
-        // Create disk object for LightNVR storage
-        cJSON *disk = cJSON_CreateObject();
-        if (disk) {
-            // Calculate disk values in bytes for consistency
-            unsigned long long total = disk_info.f_blocks * disk_info.f_frsize;
-            unsigned long long free = disk_info.f_bfree * disk_info.f_frsize;
-            
-            // Get actual usage of the storage directory
-            unsigned long long used = 0;
-            char command[512];
-            snprintf(command, sizeof(command), "du -sb %s 2>/dev/null | cut -f1", g_config.storage_path);
-            FILE *fp = popen(command, "r");
-            if (fp) {
-                if (fscanf(fp, "%llu", &used) != 1) {
-                    // If du command fails, fall back to statvfs calculation
-                    used = (disk_info.f_blocks - disk_info.f_bfree) * disk_info.f_frsize;
-                }
-                pclose(fp);
-            } else {
-                // Fallback if popen fails
-                used = (disk_info.f_blocks - disk_info.f_bfree) * disk_info.f_frsize;
-            }
-            
-            cJSON_AddNumberToObject(disk, "total", total);
-            cJSON_AddNumberToObject(disk, "used", used);
-            cJSON_AddNumberToObject(disk, "free", free);
-            
-            // Add disk object to info
-            cJSON_AddItemToObject(info, "disk", disk);
-        }
-        
-        // Create system-wide disk object
-        cJSON *system_disk = cJSON_CreateObject();
-        if (system_disk) {
-            // Get system-wide disk information
-            struct statvfs root_disk_info;
-            if (statvfs("/", &root_disk_info) == 0) {
-                unsigned long long total = root_disk_info.f_blocks * root_disk_info.f_frsize;
-                unsigned long long free = root_disk_info.f_bfree * root_disk_info.f_frsize;
-                unsigned long long used = total - free;
-                
-                cJSON_AddNumberToObject(system_disk, "total", total);
-                cJSON_AddNumberToObject(system_disk, "used", used);
-                cJSON_AddNumberToObject(system_disk, "free", free);
-            }
-            
-            // Add system disk object to info
-            cJSON_AddItemToObject(info, "systemDisk", system_disk);
-        }
-    }
-    
-    // Create network object
-    cJSON *network = cJSON_CreateObject();
-    if (network) {
-        // Create interfaces array
-        cJSON *interfaces = cJSON_CreateArray();
-        if (interfaces) {
-            // Get network interfaces with IP addresses using getifaddrs
-            struct ifaddrs *ifaddr, *ifa;
-            int family;
-            char host[NI_MAXHOST];
-            
-            if (getifaddrs(&ifaddr) == 0) {
-                // Walk through linked list, maintaining head pointer so we can free list later
-                for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-                    if (ifa->ifa_addr == NULL)
-                        continue;
-                    
-                    family = ifa->ifa_addr->sa_family;
-                    
-                    // Skip loopback interface
-                    if (strcmp(ifa->ifa_name, "lo") == 0)
-                        continue;
-                    
-                    // Check if this is an IPv4 address
-                    if (family == AF_INET) {
-                        // Get IP address
-                        int s = getnameinfo(ifa->ifa_addr, sizeof(struct sockaddr_in),
-                                           host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST);
-                        if (s == 0) {
-                            // Check if we already have this interface in our array
-                            bool found = false;
-                            cJSON *existing_iface = NULL;
-                            
-                            for (int i = 0; i < cJSON_GetArraySize(interfaces); i++) {
-                                existing_iface = cJSON_GetArrayItem(interfaces, i);
-                                cJSON *name_obj = cJSON_GetObjectItem(existing_iface, "name");
-                                if (name_obj && name_obj->valuestring && strcmp(name_obj->valuestring, ifa->ifa_name) == 0) {
-                                    found = true;
-                                    break;
-                                }
-                            }
-                            
-                            if (!found) {
-                                // Create new interface object
-                                cJSON *iface = cJSON_CreateObject();
-                                if (iface) {
-                                    cJSON_AddStringToObject(iface, "name", ifa->ifa_name);
-                                    cJSON_AddStringToObject(iface, "address", host);
-                                    
-                                    // Get MAC address (simplified)
-                                    char mac[128] = "Unknown";
-                                    char mac_path[256];
-                                    snprintf(mac_path, sizeof(mac_path), "/sys/class/net/%s/address", ifa->ifa_name);
-                                    FILE *mac_file = fopen(mac_path, "r");
-                                    if (mac_file) {
-                                        if (fgets(mac, sizeof(mac), mac_file)) {
-                                            // Remove newline
-                                            mac[strcspn(mac, "\n")] = 0;
-                                        }
-                                        fclose(mac_file);
-                                    }
-                                    
-                                    cJSON_AddStringToObject(iface, "mac", mac);
-                                    cJSON_AddBoolToObject(iface, "up", (ifa->ifa_flags & IFF_UP) != 0);
-                                    
-                                    cJSON_AddItemToArray(interfaces, iface);
-                                }
-                            }
-                        }
-                    }
-                }
-                
-                freeifaddrs(ifaddr);
-            } else {
-                // Fallback to /proc/net/dev if getifaddrs fails
-                FILE *fp = fopen("/proc/net/dev", "r");
-                if (fp) {
-                    char line[256];
-                    // Skip header lines
-                    fgets(line, sizeof(line), fp);
-                    fgets(line, sizeof(line), fp);
-                    
-                    // Read interfaces
-                    while (fgets(line, sizeof(line), fp)) {
-                        char *name = strtok(line, ":");
-                        if (name) {
-                            // Trim whitespace
-                            while (*name == ' ') name++;
-                            
-                            // Skip loopback
-                            if (strcmp(name, "lo") != 0) {
-                                cJSON *iface = cJSON_CreateObject();
-                                if (iface) {
-                                    cJSON_AddStringToObject(iface, "name", name);
-                                    
-                                    // Try to get IP address using ip command
-                                    char ip_cmd[256];
-                                    char ip_addr[128] = "Unknown";
-                                    snprintf(ip_cmd, sizeof(ip_cmd), "ip -4 addr show %s | grep -oP '(?<=inet\\s)\\d+(\\.\\d+){3}'", name);
-                                    FILE *ip_fp = popen(ip_cmd, "r");
-                                    if (ip_fp) {
-                                        if (fgets(ip_addr, sizeof(ip_addr), ip_fp)) {
-                                            // Remove newline
-                                            ip_addr[strcspn(ip_addr, "\n")] = 0;
-                                        }
-                                        pclose(ip_fp);
-                                    }
-                                    
-                                    cJSON_AddStringToObject(iface, "address", ip_addr);
-                                    
-                                    // Get MAC address
-                                    char mac[128] = "Unknown";
-                                    char mac_path[256];
-                                    snprintf(mac_path, sizeof(mac_path), "/sys/class/net/%s/address", name);
-                                    FILE *mac_file = fopen(mac_path, "r");
-                                    if (mac_file) {
-                                        if (fgets(mac, sizeof(mac), mac_file)) {
-                                            // Remove newline
-                                            mac[strcspn(mac, "\n")] = 0;
-                                        }
-                                        fclose(mac_file);
-                                    }
-                                    
-                                    cJSON_AddStringToObject(iface, "mac", mac);
-                                    
-                                    // Check if interface is up
-                                    char flags_path[256];
-                                    snprintf(flags_path, sizeof(flags_path), "/sys/class/net/%s/flags", name);
-                                    FILE *flags_file = fopen(flags_path, "r");
-                                    bool is_up = false;
-                                    if (flags_file) {
-                                        unsigned int flags;
-                                        if (fscanf(flags_file, "%x", &flags) == 1) {
-                                            is_up = (flags & 1) != 0; // IFF_UP is 0x1
-                                        }
-                                        fclose(flags_file);
-                                    }
-                                    
-                                    cJSON_AddBoolToObject(iface, "up", is_up);
-                                    
-                                    cJSON_AddItemToArray(interfaces, iface);
-                                }
-                            }
-                        }
-                    }
-                    fclose(fp);
-                }
-            }
-            
-            // Add interfaces array to network object
-            cJSON_AddItemToObject(network, "interfaces", interfaces);
-        }
-        
-        // Add network object to info
-        cJSON_AddItemToObject(info, "network", network);
-    }
-    
-    // Create streams object
-    cJSON *streams_obj = cJSON_CreateObject();
-    if (streams_obj) {
-        // Get count of enabled streams from the database
-        int enabled_streams = get_enabled_stream_count();
-        log_debug("Enabled streams count from database: %d", enabled_streams);
-        
-        cJSON_AddNumberToObject(streams_obj, "active", enabled_streams);
-        cJSON_AddNumberToObject(streams_obj, "total", g_config.max_streams);
-        
-        // Add streams object to info
-        cJSON_AddItemToObject(info, "streams", streams_obj);
-    }
-    
-    // Create recordings object
-    cJSON *recordings = cJSON_CreateObject();
-    if (recordings) {
-        // Get recordings count from database using the db_recordings function
-        int recording_count = 0;
-        
-        // Use the get_recording_count function from db_recordings.h
-        // Parameters: start_time, end_time, stream_name, has_detection
-        // Pass 0 for start_time and end_time to get all recordings
-        // Pass NULL for stream_name to get recordings from all streams
-        // Pass 0 for has_detection to get all recordings regardless of detection status
-        recording_count = get_recording_count(0, 0, NULL, 0);
-        if (recording_count < 0) {
-            recording_count = 0; // Reset if query fails
-            log_error("Failed to get recording count from database");
-        }
-        
-        // Get recordings size from storage directory
-        unsigned long long recording_size = 0;
-        
-        // Check if we have a recordings directory
-        char recordings_dir[512];
-        snprintf(recordings_dir, sizeof(recordings_dir), "%s/", g_config.storage_path);
-        
-        struct stat st;
-        if (stat(recordings_dir, &st) == 0 && S_ISDIR(st.st_mode)) {
-            // Get size of recordings directory using du command
-            char command[512];
-            snprintf(command, sizeof(command), "du -sb %s 2>/dev/null | cut -f1", recordings_dir);
-            log_debug("Executing command: %s", command);
-            
-            FILE *fp = popen(command, "r");
-            if (fp) {
-                if (fscanf(fp, "%llu", &recording_size) != 1) {
-                    log_error("Failed to parse du command output");
-                    recording_size = 0;
-                } else {
-                    log_debug("Recordings size from du command: %llu bytes", recording_size);
-                }
-                pclose(fp);
-            } else {
-                log_error("Failed to execute du command");
-            }
-            
-            // If du command failed, try to get size using stat
-            if (recording_size == 0) {
-                log_debug("Trying to get recordings size using stat");
-                
-                // Use a different approach - recursively list all files and sum their sizes
-                char find_command[512];
-                snprintf(find_command, sizeof(find_command), 
-                        "find %s -type f -name \"*.mp4\" -exec stat -c %%s {} \\; | awk '{sum+=$1} END {print sum}'", 
-                        recordings_dir);
-                log_debug("Executing command: %s", find_command);
-                
-                FILE *find_fp = popen(find_command, "r");
-                if (find_fp) {
-                    if (fscanf(find_fp, "%llu", &recording_size) != 1) {
-                        log_error("Failed to parse find command output");
-                        recording_size = 0;
-                    } else {
-                        log_debug("Recordings size from find command: %llu bytes", recording_size);
-                    }
-                    pclose(find_fp);
-                } else {
-                    log_error("Failed to execute find command");
-                }
-            }
-        } 
-        
-        cJSON_AddNumberToObject(recordings, "count", recording_count);
-        cJSON_AddNumberToObject(recordings, "size", recording_size);
-        
-        // Add recordings object to info
-        cJSON_AddItemToObject(info, "recordings", recordings);
-    }
-    
-    // Convert to string
-    char *json_str = cJSON_PrintUnformatted(info);
-    if (!json_str) {
-        log_error("Failed to convert system info JSON to string");
-        cJSON_Delete(info);
-        mg_send_json_error(c, 500, "Failed to convert system info JSON to string");
+    // The client already has this snapshot
+    struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+    if (inm && inm->len == strlen(snapshot->etag) &&
+        strncmp(inm->buf, snapshot->etag, inm->len) == 0) {
+        mg_printf(c, "HTTP/1.1 304 Not Modified\r\n"
+                  "ETag: %s\r\n"
+                  "Cache-Control: no-cache\r\n"
+                  "Content-Length: 0\r\n"
+                  "\r\n",
+                  snapshot->etag);
+        c->is_resp = 0;
+        system_status_release(snapshot);
         return;
     }
     
-    // Send response
-    mg_send_json_response(c, 200, json_str);
-    
-    // Clean up
-    free(json_str);
-    cJSON_Delete(info);
+    mg_printf(c, "HTTP/1.1 200 OK\r\n"
+              "Content-Type: application/json\r\n"
+              "Content-Length: %lu\r\n"
+              "ETag: %s\r\n"
+              "Cache-Control: no-cache\r\n"
+              "Access-Control-Allow-Origin: *\r\n"
+              "\r\n",
+              (unsigned long)snapshot->len, snapshot->etag);
+    mg_send(c, snapshot->json, snapshot->len);
+    c->is_resp = 0;
     
-    log_info("Successfully handled GET /api/system/info request");
+    system_status_release(snapshot);
 }
 
 /**
@@ -659,7 +206,8 @@ void mg_handle_post_system_backup(struct mg_connection *c, struct mg_http_messag
     
     // Create a timestamp for the backup filename
     time_t now = time(NULL);
-    struct tm* tm_info = localtime(&now);
+    struct tm tm_buf;
+    struct tm* tm_info = localtime_r(&now, &tm_buf);
     char timestamp[20];
     strftime(timestamp, sizeof(timestamp), "%Y%m%d_%H%M%S", tm_info);
     
@@ -809,6 +357,15 @@ void mg_handle_post_system_backup(struct mg_connection *c, struct mg_http_messag
     
     log_info("Configuration backup created: %s", backup_path);
     
+    // Copy the database in the background, progress is sent on the
+    // system/backup WebSocket topic. The source is the live database: with
+    // the database on tmpfs, db_path is only the last snapshot.
+    const char *db_live_path = get_db_live_path();
+    char db_backup_path[1024];
+    snprintf(db_backup_path, sizeof(db_backup_path), "%s.bak", g_config.db_path);
+    int db_backup_result = backup_database_async(db_live_path[0] != '\0' ? db_live_path : g_config.db_path,
+                                                 db_backup_path);
+    
     // Create success response with download URL using cJSON
     cJSON *success = cJSON_CreateObject();
     if (!success) {
@@ -825,6 +382,9 @@ void mg_handle_post_system_backup(struct mg_connection *c, struct mg_http_messag
     snprintf(backup_url, sizeof(backup_url), "/backups/%s", backup_filename);
     cJSON_AddStringToObject(success, "backupUrl", backup_url);
     cJSON_AddStringToObject(success, "filename", backup_filename);
+    cJSON_AddStringToObject(success, "databaseBackup", 
+                            db_backup_result == 0 ? "started" : 
+                            db_backup_result == 1 ? "running" : "failed");
     
     // Convert to string
     json_str = cJSON_PrintUnformatted(success);
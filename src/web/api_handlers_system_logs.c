@@ -6,7 +6,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -14,13 +14,12 @@
 #include "web/api_handlers.h"
 #include "web/mongoose_adapter.h"
 #include "web/api_handlers_system_ws.h"
+#include "web/json_writer.h"
 #include "core/logger.h"
+#include "core/log_ring.h"
 #include "core/config.h"
 #include "mongoose.h"
 
-// Forward declarations
-static int log_level_meets_minimum(const char *log_level, const char *min_level);
-
 /**
  * @brief Get system logs
  * 
@@ -128,241 +127,74 @@ void get_system_logs(char ***logs, int *count) {
     free(buffer);
 }
 
-/**
- * @brief Check if a log level meets the minimum required level
- * 
- * @param log_level The log level to check
- * @param min_level The minimum required level
- * @return int 1 if the log level meets the minimum, 0 otherwise
- */
-static int log_level_meets_minimum(const char *log_level, const char *min_level) {
-    // Convert log levels to numeric values for comparison
-    int level_value = 3; // Default to DEBUG (3)
-    int min_value = 3;   // Default to DEBUG (3)
-    
-    // Map log level strings to numeric values
-    // ERROR = 0, WARNING = 1, INFO = 2, DEBUG = 3
-    if (strcmp(log_level, "error") == 0) {
-        level_value = 0;
-    } else if (strcmp(log_level, "warning") == 0) {
-        level_value = 1;
-    } else if (strcmp(log_level, "info") == 0) {
-        level_value = 2;
-    } else if (strcmp(log_level, "debug") == 0) {
-        level_value = 3;
-    }
-    
-    if (strcmp(min_level, "error") == 0) {
-        min_value = 0;
-    } else if (strcmp(min_level, "warning") == 0) {
-        min_value = 1;
-    } else if (strcmp(min_level, "info") == 0) {
-        min_value = 2;
-    } else if (strcmp(min_level, "debug") == 0) {
-        min_value = 3;
-    }
-    
-    // IMPORTANT: The logic here is inverted from what you might expect
-    // When min_level is "error" (0), we only want to include error logs (0)
-    // When min_level is "warning" (1), we want to include error (0) and warning (1)
-    // When min_level is "info" (2), we want to include error (0), warning (1), and info (2)
-    // When min_level is "debug" (3), we want to include all logs
-    
-    // So we return true if the log level value is LESS THAN OR EQUAL TO the minimum level value
-    return level_value <= min_value;
-}
-
 /**
  * @brief Direct handler for GET /api/system/logs
+ * 
+ * Served from the in-memory log ring. Query parameters: level (minimum
+ * level, default debug), count (newest entries to return, default all
+ * that are kept) and since (only entries after this sequence number).
  */
 void mg_handle_get_system_logs(struct mg_connection *c, struct mg_http_message *hm) {
-    log_info("Handling GET /api/system/logs request");
-    
-    // Get query parameters
-    char level[16] = "debug";
+    log_debug("Handling GET /api/system/logs request");
     
-    // Extract log level from query parameters
+    // Extract parameters from the query string
     struct mg_str query = mg_str_n(mg_str_get_ptr(&hm->query), mg_str_get_len(&hm->query));
     char level_buf[16] = {0};
-    int level_len = mg_http_get_var(&query, "level", level_buf, sizeof(level_buf) - 1);
-    if (level_len > 0) {
-        strncpy(level, level_buf, sizeof(level) - 1);
-        level[sizeof(level) - 1] = '\0';
+    char count_buf[16] = {0};
+    char since_buf[24] = {0};
+    mg_http_get_var(&query, "level", level_buf, sizeof(level_buf));
+    mg_http_get_var(&query, "count", count_buf, sizeof(count_buf));
+    mg_http_get_var(&query, "since", since_buf, sizeof(since_buf));
+    
+    log_level_t level = log_ring_parse_level(level_buf[0] ? level_buf : NULL, LOG_LEVEL_DEBUG);
+    uint64_t since = since_buf[0] ? strtoull(since_buf, NULL, 10) : 0;
+    int count = count_buf[0] ? atoi(count_buf) : LOG_RING_CAPACITY;
+    if (count <= 0 || count > LOG_RING_CAPACITY) {
+        count = LOG_RING_CAPACITY;
     }
     
-    // Get system logs
-    char **logs = NULL;
-    int count = 0;
-    
-    get_system_logs(&logs, &count);
-    
-    if (!logs) {
-        mg_send_json_error(c, 500, "Failed to get system logs");
-        return;
-    }
-    
-    // Create JSON object
-    cJSON *logs_obj = cJSON_CreateObject();
-    if (!logs_obj) {
-        log_error("Failed to create logs JSON object");
-        
-        // Free logs
-        for (int i = 0; i < count; i++) {
-            free(logs[i]);
-        }
-        free(logs);
-        
+    log_ring_entry_t *entries = malloc(sizeof(log_ring_entry_t) * (size_t)count);
+    json_writer_t *writer = (json_writer_t *)malloc(sizeof(json_writer_t));
+    if (!entries || !writer) {
+        log_error("Failed to allocate system logs response");
+        free(entries);
+        free(writer);
         mg_send_json_error(c, 500, "Failed to create logs JSON");
         return;
     }
     
-    // Create logs array
-    cJSON *logs_array = cJSON_CreateArray();
-    if (!logs_array) {
-        log_error("Failed to create logs array");
-        
-        // Free logs
-        for (int i = 0; i < count; i++) {
-            free(logs[i]);
-        }
-        free(logs);
-        
-        cJSON_Delete(logs_obj);
-        mg_send_json_error(c, 500, "Failed to create logs array");
-        return;
-    }
-    
-    // Parse and add logs to array as objects (similar to WebSocket implementation)
-    for (int i = 0; i < count; i++) {
-        if (logs[i] != NULL) {
-            // Parse log line (format: [TIMESTAMP] [LEVEL] MESSAGE)
-            char timestamp[32] = "Unknown";
-            char log_level[16] = "info";
-            char *message = logs[i];
-            
-            // First, check if this is a standard format log
-            if (logs[i][0] == '[') {
-                char *timestamp_end = strchr(logs[i] + 1, ']');
-                if (timestamp_end) {
-                    size_t timestamp_len = timestamp_end - (logs[i] + 1);
-                    if (timestamp_len < sizeof(timestamp)) {
-                        memcpy(timestamp, logs[i] + 1, timestamp_len);
-                        timestamp[timestamp_len] = '\0';
-                        
-                        // Look for level
-                        char *level_start = strchr(timestamp_end + 1, '[');
-                        if (level_start) {
-                            char *level_end = strchr(level_start + 1, ']');
-                            if (level_end) {
-                                size_t level_len = level_end - (level_start + 1);
-                                if (level_len < sizeof(log_level)) {
-                                    memcpy(log_level, level_start + 1, level_len);
-                                    log_level[level_len] = '\0';
-                                    
-                                    // Convert to lowercase for consistency
-                                    for (int j = 0; log_level[j]; j++) {
-                                        log_level[j] = tolower(log_level[j]);
-                                    }
-                                    
-                                    // Message starts after level
-                                    message = level_end + 1;
-                                    if (message && *message) {
-                                        while (*message == ' ') message++; // Skip leading spaces
-                                    } else {
-                                        message = ""; // Set to empty string if NULL or empty
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            } 
-            // Check for alternative format: TIMESTAMP LEVEL MESSAGE
-            else if (isdigit(logs[i][0])) {
-                // Try to parse YYYY-MM-DD HH:MM:SS format
-                if (strlen(logs[i]) > 19 && logs[i][4] == '-' && logs[i][7] == '-' && logs[i][10] == ' ' && logs[i][13] == ':' && logs[i][16] == ':') {
-                    strncpy(timestamp, logs[i], 19);
-                    timestamp[19] = '\0';
-                    
-                    // Extract level - assume it follows timestamp immediately
-                    char *level_start = logs[i] + 19;
-                    while (*level_start == ' ') level_start++; // Skip spaces
-                    
-                    // Find end of level (next space)
-                    char *level_end = strchr(level_start, ' ');
-                    if (level_end) {
-                        size_t level_len = level_end - level_start;
-                        if (level_len < sizeof(log_level)) {
-                            memcpy(log_level, level_start, level_len);
-                            log_level[level_len] = '\0';
-                            
-                            // Convert to lowercase for consistency
-                            for (int j = 0; log_level[j]; j++) {
-                                log_level[j] = tolower(log_level[j]);
-                            }
-                            
-                            // Message starts after level
-                            message = level_end + 1;
-                            if (message && *message) {
-                                while (*message == ' ') message++; // Skip leading spaces
-                            } else {
-                                message = ""; // Set to empty string if NULL or empty
-                            }
-                        }
-                    }
-                }
-            }
-            
-            // Normalize log level
-            if (strcmp(log_level, "warn") == 0) {
-                strcpy(log_level, "warning");
-            }
-            
-            // Check if this log meets the minimum level
-            if (log_level_meets_minimum(log_level, level)) {
-                // Create log entry object
-                cJSON *log_entry = cJSON_CreateObject();
-                if (log_entry) {
-                    cJSON_AddStringToObject(log_entry, "timestamp", timestamp);
-                    cJSON_AddStringToObject(log_entry, "level", log_level);
-                    cJSON_AddStringToObject(log_entry, "message", message);
-                    
-                    cJSON_AddItemToArray(logs_array, log_entry);
-                }
-            }
-        }
+    uint64_t last_seq = 0;
+    bool more = false;
+    int found = log_ring_read(since, level, entries, count, &last_seq, &more);
+    
+    // Bounded by the log ring, so the response is written in one go
+    json_writer_begin(writer, c, 200);
+    json_writer_object_begin(writer, NULL);
+    json_writer_array_begin(writer, "logs");
+    
+    for (int i = 0; i < found; i++) {
+        json_writer_object_begin(writer, NULL);
+        json_writer_int(writer, "seq", (int64_t)entries[i].seq);
+        json_writer_string(writer, "timestamp", entries[i].timestamp);
+        json_writer_string(writer, "level", log_ring_level_name(entries[i].level));
+        json_writer_string(writer, "message", entries[i].message);
+        json_writer_object_end(writer);
     }
     
-    // Add logs array to response
-    cJSON_AddItemToObject(logs_obj, "logs", logs_array);
+    json_writer_array_end(writer);
     
     // Add metadata
-    cJSON_AddStringToObject(logs_obj, "file", g_config.log_file);
-    cJSON_AddStringToObject(logs_obj, "level", level);
+    json_writer_string(writer, "file", g_config.log_file);
+    json_writer_string(writer, "level", log_ring_level_name(level));
+    json_writer_int(writer, "latest_seq", (int64_t)last_seq);
+    json_writer_bool(writer, "more", more);
     
-    // Convert to string
-    char *json_str = cJSON_PrintUnformatted(logs_obj);
+    json_writer_object_end(writer);
+    json_writer_end(writer);
     
     // Clean up
-    for (int i = 0; i < count; i++) {
-        free(logs[i]);
-    }
-    free(logs);
-    cJSON_Delete(logs_obj);
-    
-    if (!json_str) {
-        log_error("Failed to convert logs JSON to string");
-        mg_send_json_error(c, 500, "Failed to convert logs JSON to string");
-        return;
-    }
-    
-    // Send response
-    mg_send_json_response(c, 200, json_str);
-    
-    // Clean up
-    free(json_str);
-    
-    log_info("Successfully handled GET /api/system/logs request");
+    free(writer);
+    free(entries);
 }
 
 /**
@@ -401,6 +233,9 @@ void mg_handle_post_system_logs_clear(struct mg_connection *c, struct mg_http_me
     int fd = open(log_file, O_WRONLY | O_TRUNC | O_CREAT, 0644);
     if (fd >= 0) {
         close(fd);
+        
+        // Drop the in-memory copy too, so the cleared logs do not come back
+        log_ring_clear();
         log_info("Log file cleared via API: %s", log_file);
         
         // Create success response using cJSON
@@ -2,19 +2,24 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdint.h>
 #include <pthread.h>
 
 #include "web/api_handlers_system_ws.h"
 #include "web/websocket_bridge.h"
 #include "web/mongoose_server_websocket_utils.h"
+#include "web/websocket_client.h"
+#include "web/websocket_manager.h"
+#include "database/db_backup.h"
 #include "core/logger.h"
+#include "core/log_ring.h"
 #include "../external/cjson/cJSON.h"
 
+// Log entries sent per fetch unless the client asks for a count
+#define SYSTEM_LOGS_FETCH_DEFAULT 100
+
 // Forward declarations
-extern void get_system_logs(char ***logs, int *count);
-static int send_filtered_logs_to_client(const char *client_id, const char *min_level);
-static int log_level_meets_minimum(const char *log_level, const char *min_level);
-extern __attribute__((weak)) int get_json_logs(const char *min_level, const char *last_timestamp, char ***logs, int *count);
+static uint64_t get_number_param(const cJSON *params, const char *name);
 
 // Map to store client log level preferences
 // Key: client_id, Value: log level string (error, warning, info, debug)
@@ -26,6 +31,8 @@ typedef struct {
 #define MAX_CLIENTS 100
 static client_log_level_t client_log_levels[MAX_CLIENTS];
 static int client_log_level_count = 0;
+// Handlers of several event loops may update the preferences at once
+static pthread_mutex_t client_log_levels_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 /**
  * @brief Set log level for a client
@@ -34,12 +41,15 @@ static int client_log_level_count = 0;
  * @param log_level Log level string (error, warning, info, debug)
  */
 static void set_client_log_level(const char *client_id, const char *log_level) {
+    pthread_mutex_lock(&client_log_levels_mutex);
+
     // Check if client already exists
     for (int i = 0; i < client_log_level_count; i++) {
         if (strcmp(client_log_levels[i].client_id, client_id) == 0) {
             // Update existing client
             strncpy(client_log_levels[i].log_level, log_level, sizeof(client_log_levels[i].log_level) - 1);
             client_log_levels[i].log_level[sizeof(client_log_levels[i].log_level) - 1] = '\0';
+            pthread_mutex_unlock(&client_log_levels_mutex);
             log_debug("Updated log level for client %s: %s", client_id, log_level);
             return;
         }
@@ -54,8 +64,10 @@ static void set_client_log_level(const char *client_id, const char *log_level) {
         client_log_levels[client_log_level_count].log_level[sizeof(client_log_levels[client_log_level_count].log_level) - 1] = '\0';
         
         client_log_level_count++;
+        pthread_mutex_unlock(&client_log_levels_mutex);
         log_debug("Added log level for client %s: %s", client_id, log_level);
     } else {
+        pthread_mutex_unlock(&client_log_levels_mutex);
         log_error("Maximum number of clients reached, cannot add log level for client %s", client_id);
     }
 }
@@ -64,17 +76,22 @@ static void set_client_log_level(const char *client_id, const char *log_level) {
  * @brief Get log level for a client
  * 
  * @param client_id WebSocket client ID
- * @return const char* Log level string, or "info" if not found
+ * @param log_level Buffer for the log level string, "info" if not found
+ * @param log_level_size Size of the buffer
  */
-static const char *get_client_log_level(const char *client_id) {
+static void get_client_log_level(const char *client_id, char *log_level, size_t log_level_size) {
+    // Default to info if not found
+    const char *level = "info";
+
+    pthread_mutex_lock(&client_log_levels_mutex);
     for (int i = 0; i < client_log_level_count; i++) {
         if (strcmp(client_log_levels[i].client_id, client_id) == 0) {
-            return client_log_levels[i].log_level;
+            level = client_log_levels[i].log_level;
+            break;
         }
     }
-    
-    // Default to info if not found
-    return "info";
+    snprintf(log_level, log_level_size, "%s", level);
+    pthread_mutex_unlock(&client_log_levels_mutex);
 }
 
 /**
@@ -83,6 +100,7 @@ static const char *get_client_log_level(const char *client_id) {
  * @param client_id WebSocket client ID
  */
 static void remove_client_log_level(const char *client_id) {
+    pthread_mutex_lock(&client_log_levels_mutex);
     for (int i = 0; i < client_log_level_count; i++) {
         if (strcmp(client_log_levels[i].client_id, client_id) == 0) {
             // Move last client to this position
@@ -92,10 +110,12 @@ static void remove_client_log_level(const char *client_id) {
             }
             
             client_log_level_count--;
+            pthread_mutex_unlock(&client_log_levels_mutex);
             log_debug("Removed log level for client %s", client_id);
             return;
         }
     }
+    pthread_mutex_unlock(&client_log_levels_mutex);
 }
 
 /**
@@ -199,22 +219,26 @@ void websocket_handle_system_logs(const char *client_id, const char *message) {
         // Extract log level from subscription parameters
         const char *log_level = "info"; // Default to info
         
+        // Parameters come in params, or in the payload as the web client sends them
         cJSON *params_obj = cJSON_GetObjectItem(json, "params");
-        if (params_obj && cJSON_IsObject(params_obj)) {
-            cJSON *level_obj = cJSON_GetObjectItem(params_obj, "level");
-            if (level_obj && cJSON_IsString(level_obj)) {
-                log_level = level_obj->valuestring;
-                log_debug("Client %s subscribed to system logs with level: %s", client_id, log_level);
-            }
+        if (!params_obj || !cJSON_IsObject(params_obj)) {
+            params_obj = payload_obj;
+        }
+        
+        cJSON *level_obj = cJSON_GetObjectItem(params_obj, "level");
+        if (level_obj && cJSON_IsString(level_obj)) {
+            log_level = level_obj->valuestring;
         }
         
         // Store client log level preference
         set_client_log_level(client_id, log_level);
         
-        log_info("Client %s subscribed to system logs with level: %s", client_id, log_level);
+        uint64_t since = get_number_param(params_obj, "since");
+        log_debug("Client %s subscribed to system logs with level: %s, since: %llu",
+                  client_id, log_level, (unsigned long long)since);
         
-        // Fetch logs using the new JSON-based approach
-        fetch_system_logs(client_id, log_level, NULL);
+        // Send what the client missed, or the newest logs
+        fetch_system_logs(client_id, log_level, since, (int)get_number_param(params_obj, "count"));
     }
     // Handle unsubscribe message
     else if (strcmp(type, "unsubscribe") == 0) {
@@ -225,46 +249,31 @@ void websocket_handle_system_logs(const char *client_id, const char *message) {
     }
     // Handle fetch message for pagination
     else if (strcmp(type, "fetch") == 0) {
-        // Extract log level and last timestamp from parameters
-        const char *log_level = get_client_log_level(client_id); // Use stored preference
-        const char *last_timestamp = NULL;
+        // Extract log level and last sequence number from parameters
+        char stored_level[sizeof(client_log_levels[0].log_level)];
+        get_client_log_level(client_id, stored_level, sizeof(stored_level));
+        const char *log_level = stored_level; // Use stored preference
         
-        // First check if we have a params object
         cJSON *params_obj = cJSON_GetObjectItem(json, "params");
-        if (params_obj && cJSON_IsObject(params_obj)) {
-            // Check if level is specified in the fetch request
-            cJSON *level_obj = cJSON_GetObjectItem(params_obj, "level");
-            if (level_obj && cJSON_IsString(level_obj)) {
-                log_level = level_obj->valuestring;
-                // Update stored preference
-                set_client_log_level(client_id, log_level);
-            }
-            
-            // Get last timestamp for pagination
-            cJSON *timestamp_obj = cJSON_GetObjectItem(params_obj, "last_timestamp");
-            if (timestamp_obj && cJSON_IsString(timestamp_obj)) {
-                last_timestamp = timestamp_obj->valuestring;
-            }
+        if (!params_obj || !cJSON_IsObject(params_obj)) {
+            params_obj = payload_obj;
         }
         
-        // If we didn't find params or timestamp in params, check the payload object directly
-        // This handles the case where the frontend sends the timestamp in the payload directly
-        if (!last_timestamp) {
-            // Check if payload_obj is the same as json (for direct payload)
-            if (payload_obj == json) {
-                cJSON *timestamp_obj = cJSON_GetObjectItem(payload_obj, "last_timestamp");
-                if (timestamp_obj && cJSON_IsString(timestamp_obj)) {
-                    last_timestamp = timestamp_obj->valuestring;
-                    log_debug("Found last_timestamp in direct payload: %s", last_timestamp);
-                }
-            }
+        // Check if level is specified in the fetch request
+        cJSON *level_obj = cJSON_GetObjectItem(params_obj, "level");
+        if (level_obj && cJSON_IsString(level_obj)) {
+            log_level = level_obj->valuestring;
+            // Update stored preference
+            set_client_log_level(client_id, log_level);
         }
         
-        log_info("Client %s fetching logs with level: %s, last_timestamp: %s", 
-                client_id, log_level, last_timestamp ? last_timestamp : "NULL");
+        // Only entries after the last one the client received
+        uint64_t since = get_number_param(params_obj, "since");
         
-        // Fetch logs using the new JSON-based approach
-        fetch_system_logs(client_id, log_level, last_timestamp);
+        log_debug("Client %s fetching logs with level: %s, since: %llu",
+                  client_id, log_level, (unsigned long long)since);
+        
+        fetch_system_logs(client_id, log_level, since, (int)get_number_param(params_obj, "count"));
     }
     // Handle unknown message type
     else {
@@ -289,372 +298,199 @@ void websocket_handle_system_logs(const char *client_id, const char *message) {
 }
 
 /**
- * @brief Check if a log level meets the minimum required level
- * 
- * @param log_level The log level to check
- * @param min_level The minimum required level
- * @return int 1 if the log level meets the minimum, 0 otherwise
+ * @brief Read a non-negative number from a message's parameters
+ *
+ * @param params Parameters object
+ * @param name Parameter name
+ * @return uint64_t The number, or 0 if missing or not a number
  */
-static int log_level_meets_minimum(const char *log_level, const char *min_level) {
-    // Convert log levels to numeric values for comparison
-    int level_value = 2; // Default to INFO (2)
-    int min_value = 2;   // Default to INFO (2)
-    
-    // Map log level strings to numeric values
-    // ERROR = 0, WARNING = 1, INFO = 2, DEBUG = 3
-    if (strcmp(log_level, "error") == 0) {
-        level_value = 0;
-    } else if (strcmp(log_level, "warning") == 0) {
-        level_value = 1;
-    } else if (strcmp(log_level, "info") == 0) {
-        level_value = 2;
-    } else if (strcmp(log_level, "debug") == 0) {
-        level_value = 3;
+static uint64_t get_number_param(const cJSON *params, const char *name) {
+    cJSON *number_obj = cJSON_GetObjectItem(params, name);
+    if (number_obj && cJSON_IsNumber(number_obj) && number_obj->valuedouble > 0) {
+        return (uint64_t)number_obj->valuedouble;
     }
-    
-    if (strcmp(min_level, "error") == 0) {
-        min_value = 0;
-    } else if (strcmp(min_level, "warning") == 0) {
-        min_value = 1;
-    } else if (strcmp(min_level, "info") == 0) {
-        min_value = 2;
-    } else if (strcmp(min_level, "debug") == 0) {
-        min_value = 3;
-    }
-    
-    // IMPORTANT: The logic here is inverted from what you might expect
-    // When min_level is "error" (0), we only want to include error logs (0)
-    // When min_level is "warning" (1), we want to include error (0) and warning (1)
-    // When min_level is "info" (2), we want to include error (0), warning (1), and info (2)
-    // When min_level is "debug" (3), we want to include all logs
-    
-    // So we return true if the log level value is LESS THAN OR EQUAL TO the minimum level value
-    return level_value <= min_value;
+    return 0;
 }
 
 /**
- * @brief Send system logs to a specific client with filtering
+ * @brief Fetch system logs after a sequence number
+ * 
+ * Entries are copied out of the in-memory log ring, so a poll costs only
+ * the entries the client has not seen yet instead of a read of the log file.
  * 
- * @param client_id The client ID to send logs to
- * @param min_level The minimum log level to include
- * @return int 1 if logs were sent, 0 otherwise
+ * @param client_id WebSocket client ID
+ * @param min_level Minimum log level to include
+ * @param since Last sequence number the client received, 0 for the newest logs
+ * @param max_logs Most entries to send, 0 for the default
+ * @return int Number of logs sent
  */
-static int send_filtered_logs_to_client(const char *client_id, const char *min_level) {
-    log_info("send_filtered_logs_to_client called for client %s with level %s", client_id, min_level);
-    
-    char **logs = NULL;
-    int count = 0;
+int fetch_system_logs(const char *client_id, const char *min_level, uint64_t since, int max_logs) {
+    struct mg_connection *conn = NULL;
+    if (sscanf(client_id, "%p", &conn) != 1 || !conn) {
+        log_error("Invalid client ID or connection not found: %s", client_id);
+        return 0;
+    }
     
-    get_system_logs(&logs, &count);
+    if (max_logs <= 0) {
+        max_logs = SYSTEM_LOGS_FETCH_DEFAULT;
+    } else if (max_logs > LOG_RING_CAPACITY) {
+        max_logs = LOG_RING_CAPACITY;
+    }
     
-    if (logs == NULL || count == 0) {
+    log_ring_entry_t *entries = malloc(sizeof(log_ring_entry_t) * (size_t)max_logs);
+    if (!entries) {
+        log_error("Failed to allocate log entries for client %s", client_id);
         return 0;
     }
     
-    // Limit the number of logs to process at once to prevent memory issues on A1 platform
-    const int max_logs = 50;
-    if (count > max_logs) {
-        log_info("Limiting logs from %d to %d to prevent memory issues", count, max_logs);
-        count = max_logs;
-    }
+    log_level_t level = log_ring_parse_level(min_level, LOG_LEVEL_INFO);
+    uint64_t last_seq = 0;
+    bool more = false;
+    int count = log_ring_read(since, level, entries, max_logs, &last_seq, &more);
     
     // Create JSON array of logs
+    cJSON *payload = cJSON_CreateObject();
     cJSON *logs_array = cJSON_CreateArray();
+    cJSON_AddItemToObject(payload, "logs", logs_array);
     
     for (int i = 0; i < count; i++) {
-        if (logs[i] != NULL) {
-            // Parse log line (format: [TIMESTAMP] [LEVEL] MESSAGE)
-            // Use smaller buffers to reduce stack usage
-            char timestamp[24] = "";
-            char log_level[12] = "";
-            char *message = NULL;
-            
-            // First, check if this is a standard format log
-            if (logs[i][0] == '[') {
-                char *timestamp_end = strchr(logs[i] + 1, ']');
-                if (timestamp_end) {
-                    size_t timestamp_len = timestamp_end - (logs[i] + 1);
-                    if (timestamp_len < sizeof(timestamp)) {
-                        memcpy(timestamp, logs[i] + 1, timestamp_len);
-                        timestamp[timestamp_len] = '\0';
-                        
-                        // Look for level
-                        char *level_start = strchr(timestamp_end + 1, '[');
-                        if (level_start) {
-                            char *level_end = strchr(level_start + 1, ']');
-                            if (level_end) {
-                                size_t level_len = level_end - (level_start + 1);
-                                if (level_len < sizeof(log_level)) {
-                                    memcpy(log_level, level_start + 1, level_len);
-                                    log_level[level_len] = '\0';
-                                    
-                                    // Convert to lowercase for consistency
-                                    for (int j = 0; log_level[j]; j++) {
-                                        log_level[j] = tolower(log_level[j]);
-                                    }
-                                    
-                                    // Message starts after level
-                                    message = level_end + 1;
-                                    if (message && *message) {
-                                        while (*message == ' ') message++; // Skip leading spaces
-                                    } else {
-                                        message = ""; // Set to empty string if NULL or empty
-                                    }
-                                }
-                            }
-                        }
-                    }
-                }
-            } 
-            // Check for alternative format: TIMESTAMP LEVEL MESSAGE
-            else if (isdigit(logs[i][0])) {
-                // Try to parse YYYY-MM-DD HH:MM:SS format
-                if (strlen(logs[i]) > 19 && logs[i][4] == '-' && logs[i][7] == '-' && logs[i][10] == ' ' && logs[i][13] == ':' && logs[i][16] == ':') {
-                    strncpy(timestamp, logs[i], 19);
-                    timestamp[19] = '\0';
-                    
-                    // Extract level - assume it follows timestamp immediately
-                    char *level_start = logs[i] + 19;
-                    while (*level_start == ' ') level_start++; // Skip spaces
-                    
-                    // Find end of level (next space)
-                    char *level_end = strchr(level_start, ' ');
-                    if (level_end) {
-                        size_t level_len = level_end - level_start;
-                        if (level_len < sizeof(log_level)) {
-                            memcpy(log_level, level_start, level_len);
-                            log_level[level_len] = '\0';
-                            
-                            // Convert to lowercase for consistency
-                            for (int j = 0; log_level[j]; j++) {
-                                log_level[j] = tolower(log_level[j]);
-                            }
-                            
-                            // Message starts after level
-                            message = level_end + 1;
-                            if (message && *message) {
-                                while (*message == ' ') message++; // Skip leading spaces
-                            } else {
-                                message = ""; // Set to empty string if NULL or empty
-                            }
-                        }
-                    }
-                }
-            }
-            
-            // If parsing failed, use defaults
-            if (!message) {
-                message = logs[i];
-                
-                // Check if the message starts with "Unknown"
-                if (strncmp(message, "Unknown", 7) == 0) {
-                    strcpy(log_level, "info");
-                    
-                    // Skip "Unknown" prefix in the message
-                    if (strlen(message) > 7) {
-                        message += 7;
-                        while (*message == ' ') message++; // Skip spaces
-                    }
-                } else {
-                    strcpy(log_level, "info");
-                }
-            }
-            
-            // Normalize log level
-            if (strcmp(log_level, "warn") == 0) {
-                strcpy(log_level, "warning");
-            }
-            
-            // Only include logs that meet the minimum level
-            if (log_level_meets_minimum(log_level, min_level)) {
-                // Create log entry object
-                cJSON *log_entry = cJSON_CreateObject();
-                if (log_entry) {
-                    cJSON_AddStringToObject(log_entry, "timestamp", timestamp[0] ? timestamp : "Unknown");
-                    cJSON_AddStringToObject(log_entry, "level", log_level);
-                    cJSON_AddStringToObject(log_entry, "message", message);
-                    
-                    cJSON_AddItemToArray(logs_array, log_entry);
-                }
-            }
-        }
+        cJSON *log_entry = cJSON_CreateObject();
+        cJSON_AddNumberToObject(log_entry, "seq", (double)entries[i].seq);
+        cJSON_AddStringToObject(log_entry, "timestamp", entries[i].timestamp);
+        cJSON_AddStringToObject(log_entry, "level", log_ring_level_name(entries[i].level));
+        cJSON_AddStringToObject(log_entry, "message", entries[i].message);
+        cJSON_AddItemToArray(logs_array, log_entry);
     }
     
-    // Create JSON payload
-    cJSON *payload = cJSON_CreateObject();
-    cJSON_AddItemToObject(payload, "logs", logs_array);
     // Include level at the top level for frontend filtering purposes
-    cJSON_AddStringToObject(payload, "level", min_level);
+    cJSON_AddStringToObject(payload, "level", log_ring_level_name(level));
+    // Sequence number to send back as since on the next fetch
+    cJSON_AddNumberToObject(payload, "latest_seq", (double)last_seq);
+    if (count > 0) {
+        cJSON_AddStringToObject(payload, "latest_timestamp", entries[count - 1].timestamp);
+    }
+    // More entries are waiting after latest_seq
+    cJSON_AddBoolToObject(payload, "more", more);
+    
+    free(entries);
     
     // Convert payload to string
     char *payload_str = cJSON_PrintUnformatted(payload);
+    cJSON_Delete(payload);
+    if (!payload_str) {
+        log_error("Failed to convert logs payload to string");
+        return 0;
+    }
     
     // Create WebSocket message
     char *logs_message = NULL;
     int len = asprintf(&logs_message, "{\"type\":\"update\",\"topic\":\"system/logs\",\"payload\":%s}", payload_str);
-    
-    int result = 0;
-    
-    if (len > 0 && logs_message != NULL) {
-        // Get client connection directly from pointer value stored in client_id string
-        struct mg_connection *conn = NULL;
-        if (sscanf(client_id, "%p", &conn) == 1 && conn) {
-            // Send message directly using mongoose
-            mg_ws_send(conn, logs_message, strlen(logs_message), WEBSOCKET_OP_TEXT);
-            result = 1;
-        } else {
-            log_error("Invalid client ID or connection not found: %s", client_id);
-        }
-        
-        // Free the message
-        free(logs_message);
-    }
-    
-    cJSON_Delete(payload);
     free(payload_str);
     
-    // Free logs
-    for (int i = 0; i < count; i++) {
-        free(logs[i]);
+    if (len < 0 || logs_message == NULL) {
+        log_error("Failed to create logs message for client %s", client_id);
+        return 0;
     }
-    free(logs);
     
-    return result;
+    mg_ws_send(conn, logs_message, (size_t)len, WEBSOCKET_OP_TEXT);
+    free(logs_message);
+    
+    return count;
 }
 
 /**
- * @brief Fetch system logs with timestamp-based pagination
+ * @brief Build a system/backup progress message
  * 
- * @param client_id WebSocket client ID
- * @param min_level Minimum log level to include
- * @param last_timestamp Last timestamp received by client (for pagination)
- * @return int Number of logs sent
+ * @param progress Backup progress
+ * @return char* Allocated message, must be freed with mg_websocket_message_free
  */
-int fetch_system_logs(const char *client_id, const char *min_level, const char *last_timestamp) {
-    log_info("fetch_system_logs called for client %s with level %s, last_timestamp %s", 
-             client_id, min_level, last_timestamp ? last_timestamp : "NULL");
-    
-    // Get logs from JSON log file if the function is available
-    char **logs = NULL;
-    int count = 0;
-    int result = -1;
+static char *create_backup_progress_message(const db_backup_progress_t *progress) {
+    cJSON *payload = cJSON_CreateObject();
+    if (!payload) {
+        return NULL;
+    }
     
-    if (get_json_logs) {
-        result = get_json_logs(min_level, last_timestamp, &logs, &count);
+    int copied = progress->pages_total - progress->pages_remaining;
+    double percent = progress->pages_total > 0 ? 
+                     100.0 * (double)copied / (double)progress->pages_total : 0.0;
+    if (!progress->in_progress && progress->result == 0 && progress->finished_at > 0) {
+        percent = 100.0;
     }
     
-    // If JSON logs are not available or there was an error, fall back to regular logs
-    if (result != 0 || logs == NULL || count == 0) {
-        // Fall back to regular logs if JSON logs are not available
-        if (!get_json_logs) {
-            log_info("JSON logger not available, falling back to regular logs");
-            return send_filtered_logs_to_client(client_id, min_level);
-        }
-        
-        log_warn("No logs found or error getting logs");
-        
-        // Send empty logs array
-        cJSON *payload = cJSON_CreateObject();
-        cJSON_AddItemToObject(payload, "logs", cJSON_CreateArray());
-        cJSON_AddStringToObject(payload, "level", min_level);
-        cJSON_AddBoolToObject(payload, "more", false);
-        
-        // Convert payload to string
-        char *payload_str = cJSON_PrintUnformatted(payload);
-        
-        // Create WebSocket message
-        char *logs_message = NULL;
-        int len = asprintf(&logs_message, "{\"type\":\"update\",\"topic\":\"system/logs\",\"payload\":%s}", payload_str);
-        
-        if (len > 0 && logs_message != NULL) {
-            // Get client connection directly from pointer value stored in client_id string
-            struct mg_connection *conn = NULL;
-            if (sscanf(client_id, "%p", &conn) == 1 && conn) {
-                // Send message directly using mongoose
-                mg_ws_send(conn, logs_message, strlen(logs_message), WEBSOCKET_OP_TEXT);
-            } else {
-                log_error("Invalid client ID or connection not found: %s", client_id);
-            }
-            
-            // Free the message
-            free(logs_message);
-        }
-        
-        cJSON_Delete(payload);
-        free(payload_str);
-        
-        return 0;
+    cJSON_AddBoolToObject(payload, "inProgress", progress->in_progress);
+    cJSON_AddNumberToObject(payload, "pagesTotal", progress->pages_total);
+    cJSON_AddNumberToObject(payload, "pagesRemaining", progress->pages_remaining);
+    cJSON_AddNumberToObject(payload, "percent", percent);
+    cJSON_AddNumberToObject(payload, "restarts", progress->restarts);
+    cJSON_AddNumberToObject(payload, "startedAt", (double)progress->started_at);
+    cJSON_AddNumberToObject(payload, "finishedAt", (double)progress->finished_at);
+    if (!progress->in_progress && progress->finished_at > 0) {
+        cJSON_AddBoolToObject(payload, "success", progress->result == 0);
     }
     
-    // Create JSON array of logs
-    cJSON *logs_array = cJSON_CreateArray();
+    char *payload_str = cJSON_PrintUnformatted(payload);
+    cJSON_Delete(payload);
+    if (!payload_str) {
+        return NULL;
+    }
     
-    // Track the latest timestamp for pagination
-    char latest_timestamp[32] = "";
+    char *message = mg_websocket_message_create(progress->in_progress ? "progress" : "result", 
+                                                "system/backup", payload_str);
+    free(payload_str);
     
-    // Process each log entry (already in JSON format)
-    for (int i = 0; i < count; i++) {
-        if (logs[i] != NULL) {
-            // Parse JSON log entry
-            cJSON *log_entry = cJSON_Parse(logs[i]);
-            if (log_entry) {
-                // Add to logs array
-                cJSON_AddItemToArray(logs_array, log_entry);
-                
-                // Update latest timestamp for pagination
-                cJSON *timestamp = cJSON_GetObjectItem(log_entry, "timestamp");
-                if (timestamp && cJSON_IsString(timestamp) && timestamp->valuestring) {
-                    strncpy(latest_timestamp, timestamp->valuestring, sizeof(latest_timestamp) - 1);
-                    latest_timestamp[sizeof(latest_timestamp) - 1] = '\0';
-                }
-            }
-        }
-    }
+    return message;
+}
+
+/**
+ * @brief Send database backup progress to subscribed clients
+ * 
+ * @param progress Backup progress
+ * @param user_data Unused
+ */
+void system_backup_progress_ws(const db_backup_progress_t *progress, void *user_data) {
+    (void)user_data;
     
-    // Create JSON payload
-    cJSON *payload = cJSON_CreateObject();
-    cJSON_AddItemToObject(payload, "logs", logs_array);
-    // Include level at the top level for frontend filtering purposes
-    cJSON_AddStringToObject(payload, "level", min_level);
-    // Include latest timestamp for pagination
-    if (latest_timestamp[0] != '\0') {
-        cJSON_AddStringToObject(payload, "latest_timestamp", latest_timestamp);
+    char *message = create_backup_progress_message(progress);
+    if (!message) {
+        return;
     }
-    // Indicate if there might be more logs
-    cJSON_AddBoolToObject(payload, "more", count >= 50); // Assume more if we hit the limit
-    
-    // Convert payload to string
-    char *payload_str = cJSON_PrintUnformatted(payload);
     
-    // Create WebSocket message
-    char *logs_message = NULL;
-    int len = asprintf(&logs_message, "{\"type\":\"update\",\"topic\":\"system/logs\",\"payload\":%s}", payload_str);
+    // Framed once and shared by every subscriber
+    websocket_manager_publish("system/backup", message, strlen(message));
     
-    int sent = 0;
+    mg_websocket_message_free(message);
+}
+
+/**
+ * @brief WebSocket handler for database backup progress
+ * 
+ * @param client_id WebSocket client ID
+ * @param message WebSocket message
+ */
+void websocket_handle_system_backup(const char *client_id, const char *message) {
+    cJSON *json = cJSON_Parse(message);
+    cJSON *type_obj = json ? cJSON_GetObjectItem(json, "type") : NULL;
+    const char *type = type_obj && cJSON_IsString(type_obj) ? type_obj->valuestring : "subscribe";
     
-    if (len > 0 && logs_message != NULL) {
-        // Get client connection directly from pointer value stored in client_id string
-        struct mg_connection *conn = NULL;
-        if (sscanf(client_id, "%p", &conn) == 1 && conn) {
-            // Send message directly using mongoose
-            mg_ws_send(conn, logs_message, strlen(logs_message), WEBSOCKET_OP_TEXT);
-            sent = count;
-        } else {
-            log_error("Invalid client ID or connection not found: %s", client_id);
+    if (strcmp(type, "unsubscribe") == 0) {
+        log_info("Client %s unsubscribed from backup progress", client_id);
+        websocket_client_unsubscribe(client_id, "system/backup");
+    } else {
+        // Subscribe, or fetch the current state
+        if (strcmp(type, "subscribe") == 0) {
+            log_info("Client %s subscribed to backup progress", client_id);
+            websocket_client_subscribe(client_id, "system/backup");
         }
         
-        // Free the message
-        free(logs_message);
-    }
-    
-    cJSON_Delete(payload);
-    free(payload_str);
-    
-    // Free logs
-    for (int i = 0; i < count; i++) {
-        free(logs[i]);
+        db_backup_progress_t progress;
+        get_backup_progress(&progress);
+        
+        char *response = create_backup_progress_message(&progress);
+        if (response) {
+            mg_websocket_message_send_to_client(client_id, response);
+            mg_websocket_message_free(response);
+        }
     }
-    free(logs);
     
-    return sent ? count : 0;
+    cJSON_Delete(json);
 }
@@ -19,18 +19,37 @@
 #include "mongoose.h"
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
+#include "database/db_recording_index.h"
+#include "database/db_activity.h"
+#include "web/json_writer.h"
 
 // Forward declarations for Mongoose API handlers
 void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message *hm);
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm);
 
 // Maximum number of segments to return in a single request
 #define MAX_TIMELINE_SEGMENTS 1000
 
+// Maximum number of gaps to return with the segments
+#define MAX_TIMELINE_GAPS 1000
+
+// Segments written per call while streaming the segments response
+#define TIMELINE_STREAM_BATCH 100
+
+// Shortest stretch without recordings reported as a gap, in seconds
+#define TIMELINE_MIN_GAP_SECONDS 2
+
 // Maximum number of segments in a manifest
 #define MAX_MANIFEST_SEGMENTS 100
 
+// Maximum number of buckets in a heatmap response
+#define MAX_HEATMAP_BUCKETS 10000
+
+// Longest range served from minute buckets, in seconds
+#define HEATMAP_MINUTE_MAX_RANGE (24 * 60 * 60)
+
 // Mutex for manifest creation
 static pthread_mutex_t manifest_mutex = PTHREAD_MUTEX_INITIALIZER;
 
@@ -44,6 +63,30 @@ int get_timeline_segments(const char *stream_name, time_t start_time, time_t end
         return -1;
     }
     
+    // The recording index also returns the segment the range starts in
+    recording_index_entry_t *entries = (recording_index_entry_t *)malloc(max_segments * sizeof(recording_index_entry_t));
+    if (!entries) {
+        log_error("Failed to allocate memory for recording index entries");
+        return -1;
+    }
+    
+    int indexed = recording_index_find_range(stream_name, start_time, end_time, entries, max_segments);
+    if (indexed >= 0) {
+        for (int i = 0; i < indexed; i++) {
+            memset(&segments[i], 0, sizeof(segments[i]));
+            segments[i].id = entries[i].id;
+            strncpy(segments[i].stream_name, stream_name, sizeof(segments[i].stream_name) - 1);
+            strncpy(segments[i].file_path, entries[i].file_path, sizeof(segments[i].file_path) - 1);
+            segments[i].start_time = entries[i].start_time;
+            segments[i].end_time = entries[i].end_time;
+            segments[i].size_bytes = entries[i].size_bytes;
+            segments[i].has_detection = false;
+        }
+        free(entries);
+        return indexed;
+    }
+    free(entries);
+    
     // Allocate memory for recording metadata
     recording_metadata_t *recordings = (recording_metadata_t *)malloc(max_segments * sizeof(recording_metadata_t));
     if (!recordings) {
@@ -78,6 +121,128 @@ int get_timeline_segments(const char *stream_name, time_t start_time, time_t end
     return count;
 }
 
+/**
+ * Segments response being streamed to a client
+ *
+ * The segments are read in one query, capped at MAX_TIMELINE_SEGMENTS,
+ * because the gaps come from the same range; only the response itself is
+ * produced as the client reads it.
+ */
+typedef struct {
+    char stream_name[MAX_STREAM_NAME];
+    char start_time_display[32];
+    char end_time_display[32];
+    timeline_segment_t *segments;
+    int count;
+    int next;                       // First segment not written yet
+    recording_gap_t *gaps;
+    int gap_count;                  // -1 when the recording index had no answer
+} timeline_stream_t;
+
+/**
+ * Free a streamed segments response
+ */
+static void timeline_stream_release(void *ctx) {
+    timeline_stream_t *stream = (timeline_stream_t *)ctx;
+    
+    free(stream->segments);
+    free(stream->gaps);
+    free(stream);
+}
+
+/**
+ * Write the next batch of the segments response
+ */
+static int timeline_stream_produce(json_writer_t *writer, void *ctx) {
+    timeline_stream_t *stream = (timeline_stream_t *)ctx;
+    struct tm tm_buf;
+    struct tm *tm_info;
+    
+    if (stream->next == 0) {
+        json_writer_object_begin(writer, NULL);
+        json_writer_array_begin(writer, "segments");
+    }
+    
+    // Add the next batch of segments to the array
+    int last = stream->next + TIMELINE_STREAM_BATCH;
+    if (last > stream->count) {
+        last = stream->count;
+    }
+    
+    for (int i = stream->next; i < last; i++) {
+        const timeline_segment_t *segment = &stream->segments[i];
+        
+        // Format timestamps in UTC
+        char segment_start_time[32] = {0};
+        char segment_end_time[32] = {0};
+        
+        tm_info = gmtime_r(&segment->start_time, &tm_buf);
+        if (tm_info) {
+            strftime(segment_start_time, sizeof(segment_start_time), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+        }
+        
+        tm_info = gmtime_r(&segment->end_time, &tm_buf);
+        if (tm_info) {
+            strftime(segment_end_time, sizeof(segment_end_time), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+        }
+        
+        // Calculate duration in seconds
+        int duration = (int)difftime(segment->end_time, segment->start_time);
+        
+        // Format file size for display (e.g., "1.8 MB")
+        char size_str[32] = {0};
+        if (segment->size_bytes < 1024) {
+            snprintf(size_str, sizeof(size_str), "%ld B", segment->size_bytes);
+        } else if (segment->size_bytes < 1024 * 1024) {
+            snprintf(size_str, sizeof(size_str), "%.1f KB", segment->size_bytes / 1024.0);
+        } else if (segment->size_bytes < 1024 * 1024 * 1024) {
+            snprintf(size_str, sizeof(size_str), "%.1f MB", segment->size_bytes / (1024.0 * 1024.0));
+        } else {
+            snprintf(size_str, sizeof(size_str), "%.1f GB", segment->size_bytes / (1024.0 * 1024.0 * 1024.0));
+        }
+        
+        json_writer_object_begin(writer, NULL);
+        json_writer_int(writer, "id", (int64_t)segment->id);
+        json_writer_string(writer, "stream", segment->stream_name);
+        json_writer_string(writer, "start_time", segment_start_time);
+        json_writer_string(writer, "end_time", segment_end_time);
+        json_writer_int(writer, "duration", duration);
+        json_writer_string(writer, "size", size_str);
+        json_writer_bool(writer, "has_detection", segment->has_detection);
+        
+        // Add Unix timestamps for easier frontend processing
+        json_writer_int(writer, "start_timestamp", (int64_t)segment->start_time);
+        json_writer_int(writer, "end_timestamp", (int64_t)segment->end_time);
+        json_writer_object_end(writer);
+    }
+    
+    if (last < stream->count) {
+        stream->next = last;
+        return 0;
+    }
+    json_writer_array_end(writer);
+    
+    // Add metadata
+    json_writer_string(writer, "stream", stream->stream_name);
+    json_writer_string(writer, "start_time", stream->start_time_display);
+    json_writer_string(writer, "end_time", stream->end_time_display);
+    json_writer_int(writer, "segment_count", stream->count);
+    
+    if (stream->gap_count >= 0) {
+        json_writer_array_begin(writer, "gaps");
+        for (int i = 0; i < stream->gap_count; i++) {
+            json_writer_object_begin(writer, NULL);
+            json_writer_int(writer, "start_timestamp", (int64_t)stream->gaps[i].start_time);
+            json_writer_int(writer, "end_timestamp", (int64_t)stream->gaps[i].end_time);
+            json_writer_object_end(writer);
+        }
+        json_writer_array_end(writer);
+    }
+    
+    json_writer_object_end(writer);
+    return 1;
+}
+
 /**
  * @brief Handler for GET /api/timeline/segments
  */
@@ -205,106 +370,230 @@ void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_mes
         return;
     }
     
-    // Create response object
-    cJSON *response = cJSON_CreateObject();
-    if (!response) {
-        log_error("Failed to create response JSON object");
-        free(segments);
-        mg_send_json_error(c, 500, "Failed to create response JSON");
-        return;
-    }
+    // Stretches without recordings, only when the recording index can answer
+    // without a database query
+    recording_gap_t *gaps = (recording_gap_t *)malloc(MAX_TIMELINE_GAPS * sizeof(recording_gap_t));
+    int gap_count = gaps ? recording_index_find_gaps(stream_name, start_time, end_time,
+                                                     TIMELINE_MIN_GAP_SECONDS, gaps, MAX_TIMELINE_GAPS) : -1;
     
-    // Create segments array
-    cJSON *segments_array = cJSON_CreateArray();
-    if (!segments_array) {
-        log_error("Failed to create segments JSON array");
+    timeline_stream_t *stream = (timeline_stream_t *)calloc(1, sizeof(timeline_stream_t));
+    if (!stream) {
+        log_error("Failed to allocate timeline segments response");
         free(segments);
-        cJSON_Delete(response);
-        mg_send_json_error(c, 500, "Failed to create segments JSON");
+        free(gaps);
+        mg_send_json_error(c, 500, "Failed to create response JSON");
         return;
     }
     
-    // Add segments array to response
-    cJSON_AddItemToObject(response, "segments", segments_array);
-    
-    // Add metadata
-    cJSON_AddStringToObject(response, "stream", stream_name);
+    strncpy(stream->stream_name, stream_name, sizeof(stream->stream_name) - 1);
+    stream->segments = segments;
+    stream->count = count;
+    stream->gaps = gaps;
+    stream->gap_count = gap_count;
     
     // Format timestamps for display in UTC
-    char start_time_display[32] = {0};
-    char end_time_display[32] = {0};
+    struct tm tm_buf;
     struct tm *tm_info;
     
-    tm_info = gmtime(&start_time);
+    tm_info = gmtime_r(&start_time, &tm_buf);
     if (tm_info) {
-        strftime(start_time_display, sizeof(start_time_display), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+        strftime(stream->start_time_display, sizeof(stream->start_time_display), "%Y-%m-%d %H:%M:%S UTC", tm_info);
     }
     
-    tm_info = gmtime(&end_time);
+    tm_info = gmtime_r(&end_time, &tm_buf);
     if (tm_info) {
-        strftime(end_time_display, sizeof(end_time_display), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+        strftime(stream->end_time_display, sizeof(stream->end_time_display), "%Y-%m-%d %H:%M:%S UTC", tm_info);
     }
     
-    cJSON_AddStringToObject(response, "start_time", start_time_display);
-    cJSON_AddStringToObject(response, "end_time", end_time_display);
-    cJSON_AddNumberToObject(response, "segment_count", count);
+    if (json_writer_stream(c, 200, timeline_stream_produce, timeline_stream_release, stream) != 0) {
+        timeline_stream_release(stream);
+        mg_send_json_error(c, 500, "Failed to create response JSON");
+        return;
+    }
     
-    // Add each segment to the array
-    for (int i = 0; i < count; i++) {
-        cJSON *segment = cJSON_CreateObject();
-        if (!segment) {
-            log_error("Failed to create segment JSON object");
-            continue;
+    log_info("Streaming GET /api/timeline/segments response (%d segments)", count);
+}
+
+
+/**
+ * Parse a time query parameter, either Unix seconds or an ISO 8601 string
+ */
+static bool parse_timeline_time(const char *str, time_t *out) {
+    if (!str || str[0] == '\0') {
+        return false;
+    }
+    
+    // Plain Unix timestamp
+    char *end = NULL;
+    long long seconds = strtoll(str, &end, 10);
+    if (end && *end == '\0') {
+        *out = (time_t)seconds;
+        return true;
+    }
+    
+    // URL-decode the time string (replace %3A with :)
+    char decoded[64] = {0};
+    strncpy(decoded, str, sizeof(decoded) - 1);
+    char *pos = decoded;
+    while ((pos = strstr(pos, "%3A")) != NULL) {
+        *pos = ':';
+        memmove(pos + 1, pos + 3, strlen(pos + 3) + 1);
+    }
+    
+    struct tm tm = {0};
+    if (strptime(decoded, "%Y-%m-%dT%H:%M:%S", &tm) != NULL ||
+        strptime(decoded, "%Y-%m-%dT%H:%M:%S.000Z", &tm) != NULL ||
+        strptime(decoded, "%Y-%m-%dT%H:%M:%S.000", &tm) != NULL ||
+        strptime(decoded, "%Y-%m-%dT%H:%M:%SZ", &tm) != NULL) {
+        // Same interpretation as the segments endpoint
+        tm.tm_isdst = -1;
+        *out = mktime(&tm);
+        return true;
+    }
+    
+    log_error("Failed to parse time string: %s", decoded);
+    return false;
+}
+
+/**
+ * @brief Handler for GET /api/timeline/heatmap
+ * 
+ * Returns detection counts and max confidence per stream, label and time
+ * bucket, read from the minute or hour activity rollups.
+ */
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm) {
+    log_info("Handling GET /api/timeline/heatmap request");
+    
+    char stream_name[MAX_STREAM_NAME] = {0};
+    char start_time_str[64] = {0};
+    char end_time_str[64] = {0};
+    char resolution[16] = {0};
+    
+    // Stream is optional, without it all streams are returned
+    mg_http_get_var(&hm->query, "stream", stream_name, sizeof(stream_name));
+    mg_http_get_var(&hm->query, "start", start_time_str, sizeof(start_time_str));
+    mg_http_get_var(&hm->query, "end", end_time_str, sizeof(end_time_str));
+    mg_http_get_var(&hm->query, "resolution", resolution, sizeof(resolution));
+    
+    time_t end_time = time(NULL);
+    time_t start_time = end_time - (24 * 60 * 60);
+    
+    if (end_time_str[0] != '\0' && !parse_timeline_time(end_time_str, &end_time)) {
+        mg_send_json_error(c, 400, "Invalid end time");
+        return;
+    }
+    
+    if (start_time_str[0] != '\0') {
+        if (!parse_timeline_time(start_time_str, &start_time)) {
+            mg_send_json_error(c, 400, "Invalid start time");
+            return;
         }
-        
-        // Format timestamps in UTC
-        char segment_start_time[32] = {0};
-        char segment_end_time[32] = {0};
-        
-        tm_info = gmtime(&segments[i].start_time);
-        if (tm_info) {
-            strftime(segment_start_time, sizeof(segment_start_time), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+    } else {
+        // Default to the 24 hours before the end
+        start_time = end_time - (24 * 60 * 60);
+    }
+    
+    if (end_time < start_time) {
+        mg_send_json_error(c, 400, "End time is before start time");
+        return;
+    }
+    
+    // Minute buckets for short ranges, hour buckets otherwise
+    int bucket_seconds = (end_time - start_time) <= HEATMAP_MINUTE_MAX_RANGE ?
+                         ACTIVITY_BUCKET_MINUTE : ACTIVITY_BUCKET_HOUR;
+    if (strcmp(resolution, "hour") == 0) {
+        bucket_seconds = ACTIVITY_BUCKET_HOUR;
+    } else if (strcmp(resolution, "minute") == 0) {
+        if (end_time - start_time > HEATMAP_MINUTE_MAX_RANGE) {
+            mg_send_json_error(c, 400, "Minute resolution is limited to ranges of 24 hours");
+            return;
         }
-        
-        tm_info = gmtime(&segments[i].end_time);
-        if (tm_info) {
-            strftime(segment_end_time, sizeof(segment_end_time), "%Y-%m-%d %H:%M:%S UTC", tm_info);
+        bucket_seconds = ACTIVITY_BUCKET_MINUTE;
+    } else if (resolution[0] != '\0') {
+        mg_send_json_error(c, 400, "Resolution must be minute or hour");
+        return;
+    }
+    
+    // One extra entry tells whether the range holds more than fits
+    detection_activity_t *activity = (detection_activity_t *)malloc((MAX_HEATMAP_BUCKETS + 1) * sizeof(detection_activity_t));
+    if (!activity) {
+        log_error("Failed to allocate memory for heatmap buckets");
+        mg_send_json_error(c, 500, "Failed to allocate memory for heatmap");
+        return;
+    }
+    
+    int count = get_detection_activity(stream_name[0] != '\0' ? stream_name : NULL,
+                                       start_time, end_time, bucket_seconds,
+                                       activity, MAX_HEATMAP_BUCKETS + 1);
+    if (count < 0) {
+        log_error("Failed to get detection activity");
+        free(activity);
+        mg_send_json_error(c, 500, "Failed to get detection activity");
+        return;
+    }
+    
+    // Entries come ordered by bucket. When there are too many, end on a
+    // whole bucket so the client can ask for the rest from the next one.
+    bool truncated = count > MAX_HEATMAP_BUCKETS;
+    time_t next_start = 0;
+    if (truncated) {
+        next_start = activity[MAX_HEATMAP_BUCKETS].bucket;
+        count = MAX_HEATMAP_BUCKETS;
+        while (count > 0 && activity[count - 1].bucket == next_start) {
+            count--;
         }
-        
-        // Calculate duration in seconds
-        int duration = (int)difftime(segments[i].end_time, segments[i].start_time);
-        
-        // Format file size for display (e.g., "1.8 MB")
-        char size_str[32] = {0};
-        if (segments[i].size_bytes < 1024) {
-            snprintf(size_str, sizeof(size_str), "%ld B", segments[i].size_bytes);
-        } else if (segments[i].size_bytes < 1024 * 1024) {
-            snprintf(size_str, sizeof(size_str), "%.1f KB", segments[i].size_bytes / 1024.0);
-        } else if (segments[i].size_bytes < 1024 * 1024 * 1024) {
-            snprintf(size_str, sizeof(size_str), "%.1f MB", segments[i].size_bytes / (1024.0 * 1024.0));
-        } else {
-            snprintf(size_str, sizeof(size_str), "%.1f GB", segments[i].size_bytes / (1024.0 * 1024.0 * 1024.0));
+        if (count == 0) {
+            // A single bucket with more entries than the limit
+            count = MAX_HEATMAP_BUCKETS;
+            next_start += bucket_seconds;
+        }
+        log_warn("Heatmap for %s limited to %d entries, more from %lld",
+                 stream_name[0] != '\0' ? stream_name : "all streams", count, (long long)next_start);
+    }
+    
+    cJSON *response = cJSON_CreateObject();
+    cJSON *buckets_array = cJSON_CreateArray();
+    if (!response || !buckets_array) {
+        log_error("Failed to create heatmap JSON");
+        cJSON_Delete(response);
+        cJSON_Delete(buckets_array);
+        free(activity);
+        mg_send_json_error(c, 500, "Failed to create heatmap JSON");
+        return;
+    }
+    
+    if (stream_name[0] != '\0') {
+        cJSON_AddStringToObject(response, "stream", stream_name);
+    }
+    cJSON_AddStringToObject(response, "resolution", bucket_seconds == ACTIVITY_BUCKET_MINUTE ? "minute" : "hour");
+    cJSON_AddNumberToObject(response, "bucket_seconds", bucket_seconds);
+    cJSON_AddNumberToObject(response, "start_timestamp", (double)start_time);
+    cJSON_AddNumberToObject(response, "end_timestamp", (double)end_time);
+    cJSON_AddNumberToObject(response, "bucket_count", count);
+    cJSON_AddBoolToObject(response, "truncated", truncated);
+    if (truncated) {
+        cJSON_AddNumberToObject(response, "next_start_timestamp", (double)next_start);
+    }
+    cJSON_AddItemToObject(response, "buckets", buckets_array);
+    
+    for (int i = 0; i < count; i++) {
+        cJSON *bucket = cJSON_CreateObject();
+        if (!bucket) {
+            log_error("Failed to create heatmap bucket JSON object");
+            continue;
         }
         
-        cJSON_AddNumberToObject(segment, "id", segments[i].id);
-        cJSON_AddStringToObject(segment, "stream", segments[i].stream_name);
-        cJSON_AddStringToObject(segment, "start_time", segment_start_time);
-        cJSON_AddStringToObject(segment, "end_time", segment_end_time);
-        cJSON_AddNumberToObject(segment, "duration", duration);
-        cJSON_AddStringToObject(segment, "size", size_str);
-        cJSON_AddBoolToObject(segment, "has_detection", segments[i].has_detection);
-        
-        // Add Unix timestamps for easier frontend processing
-        cJSON_AddNumberToObject(segment, "start_timestamp", (double)segments[i].start_time);
-        cJSON_AddNumberToObject(segment, "end_timestamp", (double)segments[i].end_time);
+        cJSON_AddNumberToObject(bucket, "timestamp", (double)activity[i].bucket);
+        cJSON_AddStringToObject(bucket, "stream", activity[i].stream_name);
+        cJSON_AddStringToObject(bucket, "label", activity[i].label);
+        cJSON_AddNumberToObject(bucket, "count", activity[i].count);
+        cJSON_AddNumberToObject(bucket, "max_confidence", activity[i].max_confidence);
         
-        cJSON_AddItemToArray(segments_array, segment);
+        cJSON_AddItemToArray(buckets_array, bucket);
     }
     
-    // Free segments
-    free(segments);
+    free(activity);
     
-    // Convert to string
     char *json_str = cJSON_PrintUnformatted(response);
     if (!json_str) {
         log_error("Failed to convert response JSON to string");
@@ -313,16 +602,14 @@ void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_mes
         return;
     }
     
-    // Send response
     mg_send_json_response(c, 200, json_str);
     
     free(json_str);
     cJSON_Delete(response);
     
-    log_info("Successfully handled GET /api/timeline/segments request");
+    log_info("Successfully handled GET /api/timeline/heatmap request (%d buckets)", count);
 }
 
-
 /**
  * Create a playback manifest for a sequence of recordings
  */
@@ -587,6 +874,21 @@ void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message
 }
 
 
+// Redirect to the recording playback endpoint
+static void send_playback_redirect(struct mg_connection *c, uint64_t recording_id) {
+    char redirect_url[256];
+    snprintf(redirect_url, sizeof(redirect_url), "/api/recordings/play/%llu", (unsigned long long)recording_id);
+    
+    log_info("Redirecting to recording playback: %s", redirect_url);
+    
+    // Send redirect response
+    mg_printf(c, "HTTP/1.1 302 Found\r\n");
+    mg_printf(c, "Connection: close\r\n");
+    mg_printf(c, "Location: %s\r\n", redirect_url);
+    mg_printf(c, "Content-Length: 0\r\n");
+    mg_printf(c, "\r\n");
+}
+
 /**
  * @brief Handler for GET /api/timeline/play
  */
@@ -667,6 +969,13 @@ void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message
         start_time = time(NULL) - (24 * 60 * 60);
     }
     
+    // Look up the recording that covers the start time in memory first
+    recording_index_entry_t covering;
+    if (recording_index_find_covering(stream_name, start_time, &covering) == 0) {
+        send_playback_redirect(c, covering.id);
+        return;
+    }
+    
     // Get timeline segments
     timeline_segment_t *segments = (timeline_segment_t *)malloc(MAX_TIMELINE_SEGMENTS * sizeof(timeline_segment_t));
     if (!segments) {
@@ -716,16 +1025,5 @@ void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message
     // Free segments
     free(segments);
     
-    // Redirect to the recording playback endpoint
-    char redirect_url[256];
-    snprintf(redirect_url, sizeof(redirect_url), "/api/recordings/play/%llu", (unsigned long long)recording_id);
-    
-    log_info("Redirecting to recording playback: %s", redirect_url);
-    
-    // Send redirect response
-    mg_printf(c, "HTTP/1.1 302 Found\r\n");
-    mg_printf(c, "Connection: close\r\n");
-    mg_printf(c, "Location: %s\r\n", redirect_url);
-    mg_printf(c, "Content-Length: 0\r\n");
-    mg_printf(c, "\r\n");
+    send_playback_redirect(c, recording_id);
 }
@@ -784,32 +784,13 @@ void mg_handle_users_update(struct mg_connection *c, struct mg_http_message *hm)
         return;
     }
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
-        return;
-    }
-    
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, users_update_handler)) {
         return;
     }
     
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = users_update_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("User update task started in a worker thread");
 }
@@ -953,32 +934,13 @@ void mg_handle_users_delete(struct mg_connection *c, struct mg_http_message *hm)
         return;
     }
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
-        return;
-    }
-    
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, users_delete_handler)) {
         return;
     }
     
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = users_delete_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("User delete task started in a worker thread");
 }
@@ -1087,32 +1049,13 @@ void mg_handle_users_generate_api_key(struct mg_connection *c, struct mg_http_me
         return;
     }
     
-    // Send an immediate response to the client before processing the request
-    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
-    
-    // Create a thread data structure
-    struct mg_thread_data *data = calloc(1, sizeof(struct mg_thread_data));
-    if (!data) {
-        log_error("Failed to allocate memory for thread data");
-        mg_http_reply(c, 500, "", "Internal Server Error\n");
-        return;
-    }
-    
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-        log_error("Failed to duplicate HTTP message");
-        free(data);
+    // Hand the request to a worker, an error response is sent if that fails
+    if (!mg_offload_request(c, hm, users_generate_api_key_handler)) {
         return;
     }
     
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    data->handler_func = users_generate_api_key_handler;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Acknowledge the request now, the worker does the processing
+    mg_send_json_response(c, 202, "{\"success\":true,\"message\":\"Processing request\"}");
     
     log_info("User generate API key task started in a worker thread");
 }
@@ -0,0 +1,333 @@
+/**
+ * @file json_writer.c
+ * @brief Streaming JSON writer for large API responses
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "web/json_writer.h"
+#include "web/api_handlers.h"
+#include "core/logger.h"
+
+/**
+ * @brief Response being produced by json_writer_stream
+ */
+typedef struct {
+    json_writer_t w;
+    json_writer_produce_fn produce;
+    json_writer_release_fn release;
+    void *ctx;
+    mg_event_handler_t saved_pfn;   // Mongoose's HTTP handler, restored when done
+    void *saved_pfn_data;
+} json_writer_stream_t;
+
+/**
+ * @brief Write the buffered bytes out as a chunk
+ */
+static void json_writer_flush(json_writer_t *w) {
+    if (w->len > 0) {
+        mg_http_write_chunk(w->c, w->buf, w->len);
+        w->bytes_written += w->len;
+        w->len = 0;
+    }
+}
+
+/**
+ * @brief Append raw bytes
+ */
+static void json_writer_raw(json_writer_t *w, const char *data, size_t len) {
+    while (len > 0) {
+        if (w->len == sizeof(w->buf)) {
+            json_writer_flush(w);
+        }
+
+        size_t n = sizeof(w->buf) - w->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Append a string literal with escaping
+ */
+static void json_writer_quoted(json_writer_t *w, const char *value) {
+    json_writer_raw(w, "\"", 1);
+
+    const char *run = value;
+    for (const char *p = value; *p; p++) {
+        unsigned char ch = (unsigned char)*p;
+        const char *escape = NULL;
+        char hex[8];
+
+        switch (ch) {
+            case '"':  escape = "\\\""; break;
+            case '\\': escape = "\\\\"; break;
+            case '\b': escape = "\\b"; break;
+            case '\f': escape = "\\f"; break;
+            case '\n': escape = "\\n"; break;
+            case '\r': escape = "\\r"; break;
+            case '\t': escape = "\\t"; break;
+            default:
+                if (ch < 0x20) {
+                    snprintf(hex, sizeof(hex), "\\u%04x", ch);
+                    escape = hex;
+                }
+                break;
+        }
+
+        if (escape) {
+            json_writer_raw(w, run, (size_t)(p - run));
+            json_writer_raw(w, escape, strlen(escape));
+            run = p + 1;
+        }
+    }
+    json_writer_raw(w, run, strlen(run));
+
+    json_writer_raw(w, "\"", 1);
+}
+
+/**
+ * @brief Write the separator and member name that go before a value
+ */
+static void json_writer_prefix(json_writer_t *w, const char *key) {
+    if (w->has_items[w->depth]) {
+        json_writer_raw(w, ",", 1);
+    }
+    w->has_items[w->depth] = true;
+
+    if (key) {
+        json_writer_quoted(w, key);
+        json_writer_raw(w, ":", 1);
+    }
+}
+
+/**
+ * @brief Open an object or array
+ */
+static void json_writer_open(json_writer_t *w, const char *key, char bracket) {
+    json_writer_prefix(w, key);
+    json_writer_raw(w, &bracket, 1);
+
+    if (w->depth + 1 >= JSON_WRITER_MAX_DEPTH) {
+        log_error("JSON response nested too deeply");
+        w->error = true;
+        return;
+    }
+    w->depth++;
+    w->has_items[w->depth] = false;
+}
+
+/**
+ * @brief Close an object or array
+ */
+static void json_writer_close(json_writer_t *w, char bracket) {
+    if (w->depth == 0) {
+        log_error("Unbalanced JSON response");
+        w->error = true;
+        return;
+    }
+    w->depth--;
+    json_writer_raw(w, &bracket, 1);
+}
+
+/**
+ * @brief Start a JSON response with chunked transfer encoding
+ */
+void json_writer_begin(json_writer_t *w, struct mg_connection *c, int status_code) {
+    w->c = c;
+    w->len = 0;
+    w->depth = 0;
+    w->has_items[0] = false;
+    w->error = false;
+    w->bytes_written = 0;
+
+    const char *reason = "OK";
+    if (status_code == 400) {
+        reason = "Bad Request";
+    } else if (status_code == 404) {
+        reason = "Not Found";
+    } else if (status_code >= 500) {
+        reason = "Internal Server Error";
+    }
+
+    mg_printf(c, "HTTP/1.1 %d %s\r\n%sTransfer-Encoding: chunked\r\n\r\n",
+              status_code, reason, MG_JSON_RESPONSE_HEADERS);
+}
+
+/**
+ * @brief Free a streamed response's state
+ */
+static void json_writer_stream_free(json_writer_stream_t *stream) {
+    if (stream->release) {
+        stream->release(stream->ctx);
+    }
+    free(stream);
+}
+
+/**
+ * @brief Protocol handler that produces a streamed response
+ */
+static void json_writer_stream_cb(struct mg_connection *c, int ev, void *ev_data) {
+    (void)ev_data;
+    json_writer_stream_t *stream = (json_writer_stream_t *)c->pfn_data;
+
+    if (ev == MG_EV_POLL || ev == MG_EV_WRITE) {
+        if (c->is_closing) {
+            return;
+        }
+
+        // Only produce while the client keeps up
+        while (c->send.len < JSON_WRITER_HIGH_WATER) {
+            size_t before = stream->w.bytes_written + stream->w.len;
+            int result = stream->produce(&stream->w, stream->ctx);
+
+            if (result < 0) {
+                // The status line is gone, so a cut off body is the only way
+                // left to tell the client the response failed
+                log_error("Aborting streamed JSON response after %zu bytes", stream->w.bytes_written);
+                c->is_closing = 1;
+                return;
+            }
+
+            if (result > 0) {
+                json_writer_end(&stream->w);
+                c->pfn = stream->saved_pfn;
+                c->pfn_data = stream->saved_pfn_data;
+                json_writer_stream_free(stream);
+                return;
+            }
+
+            if (stream->w.bytes_written + stream->w.len == before) {
+                // Nothing to write yet, try again at the next poll
+                break;
+            }
+        }
+
+        // Let the rows written so far go out instead of waiting for a full chunk
+        json_writer_flush(&stream->w);
+    } else if (ev == MG_EV_CLOSE) {
+        json_writer_stream_free(stream);
+        c->pfn = NULL;
+        c->pfn_data = NULL;
+    }
+}
+
+/**
+ * @brief Stream a JSON response, producing it as the client reads it
+ */
+int json_writer_stream(struct mg_connection *c, int status_code,
+                       json_writer_produce_fn produce, json_writer_release_fn release, void *ctx) {
+    json_writer_stream_t *stream = (json_writer_stream_t *)malloc(sizeof(json_writer_stream_t));
+    if (!stream) {
+        log_error("Failed to allocate streamed JSON response");
+        return -1;
+    }
+
+    stream->produce = produce;
+    stream->release = release;
+    stream->ctx = ctx;
+    stream->saved_pfn = c->pfn;
+    stream->saved_pfn_data = c->pfn_data;
+
+    json_writer_begin(&stream->w, c, status_code);
+
+    c->pfn = json_writer_stream_cb;
+    c->pfn_data = stream;
+    c->is_resp = 1;
+
+    return 0;
+}
+
+/**
+ * @brief Finish the response
+ */
+int json_writer_end(json_writer_t *w) {
+    if (w->depth != 0) {
+        log_error("JSON response ended with %d unclosed containers", w->depth);
+        w->error = true;
+    }
+
+    json_writer_flush(w);
+
+    // Empty chunk ends the body
+    mg_http_write_chunk(w->c, "", 0);
+    w->c->is_resp = 0;
+
+    log_debug("Streamed JSON response of %zu bytes", w->bytes_written);
+    return w->error ? -1 : 0;
+}
+
+void json_writer_object_begin(json_writer_t *w, const char *key) {
+    json_writer_open(w, key, '{');
+}
+
+void json_writer_object_end(json_writer_t *w) {
+    json_writer_close(w, '}');
+}
+
+void json_writer_array_begin(json_writer_t *w, const char *key) {
+    json_writer_open(w, key, '[');
+}
+
+void json_writer_array_end(json_writer_t *w) {
+    json_writer_close(w, ']');
+}
+
+void json_writer_string(json_writer_t *w, const char *key, const char *value) {
+    json_writer_prefix(w, key);
+    if (value) {
+        json_writer_quoted(w, value);
+    } else {
+        json_writer_raw(w, "null", 4);
+    }
+}
+
+void json_writer_number(json_writer_t *w, const char *key, double value) {
+    char number[32];
+    int len;
+
+    if (value != value || value - value != 0) {
+        // NaN and infinity have no JSON representation
+        len = snprintf(number, sizeof(number), "null");
+    } else if (value == (double)(long long)value && value > -1e15 && value < 1e15) {
+        len = snprintf(number, sizeof(number), "%lld", (long long)value);
+    } else {
+        // Shortest form that reads back as the same value
+        len = snprintf(number, sizeof(number), "%1.15g", value);
+        if (strtod(number, NULL) != value) {
+            len = snprintf(number, sizeof(number), "%1.17g", value);
+        }
+    }
+
+    json_writer_prefix(w, key);
+    json_writer_raw(w, number, (size_t)len);
+}
+
+void json_writer_int(json_writer_t *w, const char *key, int64_t value) {
+    char number[24];
+    int len = snprintf(number, sizeof(number), "%lld", (long long)value);
+
+    json_writer_prefix(w, key);
+    json_writer_raw(w, number, (size_t)len);
+}
+
+void json_writer_bool(json_writer_t *w, const char *key, bool value) {
+    json_writer_prefix(w, key);
+    if (value) {
+        json_writer_raw(w, "true", 4);
+    } else {
+        json_writer_raw(w, "false", 5);
+    }
+}
+
+void json_writer_null(json_writer_t *w, const char *key) {
+    json_writer_prefix(w, key);
+    json_writer_raw(w, "null", 4);
+}
@@ -14,7 +14,7 @@
 extern __attribute__((weak)) char *mg_websocket_message_create(const char *type, const char *topic, const char *payload);
 extern __attribute__((weak)) bool mg_websocket_message_send_to_client(const char *client_id, const char *message);
 extern __attribute__((weak)) void mg_websocket_message_free(char *message);
-extern __attribute__((weak)) int fetch_system_logs(const char *client_id, const char *min_level, const char *last_timestamp);
+extern __attribute__((weak)) int fetch_system_logs(const char *client_id, const char *min_level, uint64_t since, int max_logs);
 
 // Mutex to protect log broadcasting
 static pthread_mutex_t broadcast_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -6,15 +6,22 @@
 #include <signal.h>
 #include <unistd.h>
 #include <regex.h>
+#include <sys/stat.h>
 
 #include "web/mongoose_server.h"
 #include "web/http_server.h"
 #include "core/logger.h"
+#include "core/config.h"
 #include "core/shutdown_coordinator.h"
 #include "utils/memory.h"
 #include "web/mongoose_server_websocket.h"
 #include "web/websocket_manager.h"
+#include "web/websocket_outbox.h"
 #include "web/mongoose_server_multithreading.h"
+#include "web/mongoose_server_reactor.h"
+#include "web/mongoose_server_routes.h"
+#include "web/web_asset_pack.h"
+#include "web/system_status.h"
 
 // Include Mongoose
 #include "mongoose.h"
@@ -30,6 +37,7 @@
 void mg_handle_get_timeline_segments(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_manifest(struct mg_connection *c, struct mg_http_message *hm);
 void mg_handle_timeline_playback(struct mg_connection *c, struct mg_http_message *hm);
+void mg_handle_get_timeline_heatmap(struct mg_connection *c, struct mg_http_message *hm);
 
 // Forward declarations for HLS API handlers
 void mg_handle_hls_master_playlist(struct mg_connection *c, struct mg_http_message *hm);
@@ -40,16 +48,6 @@ void mg_handle_direct_hls_request(struct mg_connection *c, struct mg_http_messag
 // Default initial handler capacity
 #define INITIAL_HANDLER_CAPACITY 32
 
-// API handler function type
-typedef void (*mg_api_handler_t)(struct mg_connection *c, struct mg_http_message *hm);
-
-// API route entry structure
-typedef struct {
-    const char *method;     // HTTP method (GET, POST, etc.)
-    const char *uri;        // URI pattern
-    mg_api_handler_t handler; // Handler function
-} mg_api_route_t;
-
 // Forward declarations
 static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_data);
 static void *mongoose_server_event_loop(void *arg);
@@ -152,6 +150,7 @@ static const mg_api_route_t s_api_routes[] = {
     {"GET", "/api/timeline/segments", mg_handle_get_timeline_segments},
     {"GET", "/api/timeline/manifest", mg_handle_timeline_manifest},
     {"GET", "/api/timeline/play", mg_handle_timeline_playback},
+    {"GET", "/api/timeline/heatmap", mg_handle_get_timeline_heatmap},
     
     // End of table marker
     {NULL, NULL, NULL}
@@ -201,7 +200,11 @@ static bool handle_api_request(struct mg_connection *c, struct mg_http_message *
  * @brief Initialize the route table
  */
 static void init_route_table(void) {
-    // Nothing to initialize since we're using the static s_api_routes table
+    // Compile the routes table into a trie so requests do not scan it
+    if (mg_routes_init(s_api_routes) != 0) {
+        log_error("Failed to build route trie");
+        return;
+    }
     log_info("Route table initialized using API routes table");
 }
 
@@ -209,7 +212,7 @@ static void init_route_table(void) {
  * @brief Free the route table
  */
 static void free_route_table(void) {
-    // Nothing to free since we're using a static table
+    mg_routes_free();
     log_info("Route table reference cleared");
 }
 
@@ -224,22 +227,14 @@ static int match_route(struct mg_http_message *hm) {
         return -1;
     }
     
-    // Try to match each route
-    for (int i = 0; s_api_routes[i].method != NULL; i++) {
-        // Check method
-        if (!mg_match(hm->method, mg_str(s_api_routes[i].method), NULL)) {
-            continue;
-        }
-        
-        // Check if URI matches the pattern
-        if (mg_match(hm->uri, mg_str(s_api_routes[i].uri), NULL)) {
-            // Route matched
-            log_debug("Route matched: method=%.*s, pattern=%s, uri=%.*s", 
-                     (int)hm->method.len, hm->method.buf,
-                     s_api_routes[i].uri, 
-                     (int)hm->uri.len, hm->uri.buf);
-            return i;
-        }
+    int route_index = mg_routes_match(hm, NULL);
+    if (route_index >= 0) {
+        // Route matched
+        log_debug("Route matched: method=%.*s, pattern=%s, uri=%.*s", 
+                 (int)hm->method.len, hm->method.buf,
+                 s_api_routes[route_index].uri, 
+                 (int)hm->uri.len, hm->uri.buf);
+        return route_index;
     }
     
     // No route matched
@@ -323,11 +318,40 @@ http_server_handle_t mongoose_server_init(const http_server_config_t *config) {
     
     // No mutex needed as we're not tracking statistics
     
-    log_info("Using per-request threading for all requests");
+    // Offloaded requests run on a fixed set of worker threads
+    if (mg_worker_pool_init(MG_WORKER_THREADS) != 0) {
+        log_warn("Failed to start worker pool, offloaded requests will each get a thread");
+    }
+
+    // Map the packed web UI, by default it sits next to the web root
+    char pack_path[MAX_PATH_LENGTH + 8];
+    if (g_config.web_asset_pack[0] != '\0') {
+        snprintf(pack_path, sizeof(pack_path), "%s", g_config.web_asset_pack);
+    } else {
+        size_t root_len = strlen(server->config.web_root);
+        while (root_len > 1 && server->config.web_root[root_len - 1] == '/') {
+            root_len--;
+        }
+        snprintf(pack_path, sizeof(pack_path), "%.*s.pack", (int)root_len, server->config.web_root);
+    }
+    if (web_asset_pack_open(pack_path) == 0) {
+        // The pack hides the web root entirely, so an old one left behind
+        // by an install that only updated the files keeps serving the old UI
+        char index_path[MAX_PATH_LENGTH + 16];
+        snprintf(index_path, sizeof(index_path), "%s/index.html", server->config.web_root);
+
+        struct stat pack_st;
+        struct stat index_st;
+        if (stat(pack_path, &pack_st) == 0 && stat(index_path, &index_st) == 0 &&
+            pack_st.st_mtime < index_st.st_mtime) {
+            log_warn("Web asset pack %s is older than %s and is served instead of it; "
+                     "rebuild or remove the pack", pack_path, index_path);
+        }
+    }
 
     server->handler_capacity = INITIAL_HANDLER_CAPACITY;
     server->handler_count = 0;
-    server->running = false;
+    atomic_store(&server->running, false);
 
     log_info("HTTP server initialized");
     return server;
@@ -345,7 +369,7 @@ int http_server_start(http_server_handle_t server) {
         return -1;
     }
 
-    if (server->running) {
+    if (atomic_load(&server->running)) {
         log_warn("Server is already running");
         return 0;
     }
@@ -358,8 +382,13 @@ int http_server_start(http_server_handle_t server) {
         snprintf(listen_url, sizeof(listen_url), "http://0.0.0.0:%d", server->config.port);
     }
 
-    // Start listening
-    struct mg_connection *c = mg_http_listen(server->mgr, listen_url, mongoose_event_handler, server);
+    // Start listening, sharing the port with the other event loops if there are any
+    struct mg_connection *c;
+    if (server->config.event_loops > 1) {
+        c = mg_reactor_listen(server->mgr, listen_url, mongoose_event_handler, server);
+    } else {
+        c = mg_http_listen(server->mgr, listen_url, mongoose_event_handler, server);
+    }
     if (c == NULL) {
         log_error("Failed to start server on %s", listen_url);
         return -1;
@@ -389,20 +418,32 @@ int http_server_start(http_server_handle_t server) {
         mg_tls_init(c, &opts);
     }
 
-    server->running = true;
+    atomic_store(&server->running, true);
     log_info("HTTP server started on port %d", server->config.port);
 
     // Create a thread that runs the event loop
     pthread_t thread;
     if (pthread_create(&thread, NULL, (void *(*)(void *))mongoose_server_event_loop, server) != 0) {
         log_error("Failed to create server thread");
-        server->running = false;
+        atomic_store(&server->running, false);
         return -1;
     }
 
     // Detach thread to let it run independently
     pthread_detach(thread);
 
+    // WebSocket messages from other threads are handed to the loop that owns the connection
+    mg_reactor_register(server->mgr, thread);
+
+    if (server->config.event_loops > 1) {
+        mg_reactors_start(server, listen_url, mongoose_event_handler);
+    }
+
+    // System info is sampled in the background and served from a snapshot
+    if (system_status_start() != 0) {
+        log_warn("System status sampler not started, system info will be sampled per request");
+    }
+
     return 0;
 }
 
@@ -414,13 +455,15 @@ void http_server_stop(http_server_handle_t server) {
         return;
     }
 
-    if (!server->running) {
+    if (!atomic_load(&server->running)) {
         return;
     }
 
-    server->running = false;
+    atomic_store(&server->running, false);
     log_info("Stopping HTTP server");
 
+    system_status_stop();
+
     // Give WebSocket connections time to send close frames
     usleep(250000); // 250ms for WebSocket connections to close
 
@@ -495,6 +538,12 @@ void http_server_stop(http_server_handle_t server) {
     // Give a short time for the manager to process the closed connections
     usleep(250000); // 250ms
 
+    // Workers send their responses through the manager, so finish them first
+    mg_worker_pool_shutdown();
+
+    // Stop the other event loops, freeing their managers closes their connections
+    mg_reactors_stop();
+
     // Explicitly poll the manager one more time to process closed connections
     mg_mgr_poll(server->mgr, 0);
     
@@ -562,7 +611,7 @@ void http_server_destroy(http_server_handle_t server) {
     }
 
     // Stop server if running
-    if (server->running) {
+    if (atomic_load(&server->running)) {
         http_server_stop(server);
     }
 
@@ -601,6 +650,8 @@ void http_server_destroy(http_server_handle_t server) {
 
     // Free route table
     free_route_table();
+
+    web_asset_pack_close();
     
     // Finally free the server structure
     free(server);
@@ -873,7 +924,10 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
         bool handled = false;
         
         // Special handling for root path
-        if (strcmp(uri, "/") == 0) {
+        if (strcmp(uri, "/") == 0 && web_asset_pack_serve(c, hm, uri)) {
+            handled = true;
+        }
+        else if (strcmp(uri, "/") == 0) {
             log_info("Root path detected in main handler, redirecting to index.html");
             // Directly serve index.html for root path
             char index_path[MAX_PATH_LENGTH * 2];
@@ -948,6 +1002,9 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
             // Call the WebSocket close handler directly
             mg_handle_websocket_close(c);
             
+            // Drop broadcasts still queued for this client
+            ws_outbox_release(c);
+            
             // Find the component ID for this connection
             char conn_name[64];
             snprintf(conn_name, sizeof(conn_name), "websocket_%p", (void*)c);
@@ -975,10 +1032,19 @@ static void mongoose_event_handler(struct mg_connection *c, int ev, void *ev_dat
         // Connection error
         log_error("Connection error: %s", (char *)ev_data);
     } else if (ev == MG_EV_POLL) {
-        // Poll event - do nothing
+        // Send WebSocket messages queued for this event loop by other threads
+        if (c->is_listening) {
+            mg_reactor_poll(c);
+        } else if (c->is_websocket) {
+            // Feed broadcasts held back while this client was behind
+            ws_outbox_flush(c);
+        }
     } else if (ev == MG_EV_READ || ev == MG_EV_WRITE) {
         // Read/write events - normal socket operations
         // No need to log these high-frequency events
+        if (ev == MG_EV_WRITE && c->is_websocket) {
+            ws_outbox_flush(c);
+        }
     } else if (ev == 7) {
         // Event 7 appears to be related to WebSocket data frame start
         // Handle silently to avoid log spam
@@ -1005,11 +1071,11 @@ static void *mongoose_server_event_loop(void *arg) {
     
     // Run event loop until server is stopped
     int poll_count = 0;
-    while (server->running) {
+    while (atomic_load(&server->running)) {
         // Check if shutdown has been initiated
         if (is_shutdown_initiated()) {
             log_info("Shutdown initiated, stopping Mongoose event loop");
-            server->running = false;
+            atomic_store(&server->running, false);
             break;
         }
         
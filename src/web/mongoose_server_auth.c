@@ -47,6 +47,8 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
 
     // Get Authorization header
     struct mg_str *auth_header = mg_http_get_header(hm, "Authorization");
+    char cookie_auth_buf[520];
+    struct mg_str cookie_auth_header;
     
     // If no Authorization header, check for session or auth cookie
     if (auth_header == NULL) {
@@ -108,23 +110,15 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
                         
                         log_info("Found auth cookie value: %s", auth_cookie_value);
                         
-                        // Create a temporary buffer for the Authorization header value
-                        char auth_value[512];
-                        snprintf(auth_value, sizeof(auth_value), "Basic %s", auth_cookie_value);
-                        
-                        // Create a static buffer for the header
-                        static char auth_header_buf[512];
-                        strncpy(auth_header_buf, auth_value, sizeof(auth_header_buf) - 1);
-                        auth_header_buf[sizeof(auth_header_buf) - 1] = '\0';
-                        
-                        // Create a static mg_str for the header
-                        static struct mg_str static_auth_header;
-                        static_auth_header.buf = auth_header_buf;
-                        static_auth_header.len = strlen(auth_header_buf);
+                        // Build the Authorization header value in a buffer that
+                        // outlives this block; requests are handled on several
+                        // event loops at once, so it must not be static
+                        snprintf(cookie_auth_buf, sizeof(cookie_auth_buf), "Basic %s", auth_cookie_value);
+                        cookie_auth_header = mg_str(cookie_auth_buf);
                         
                         // Use the cookie value as the Authorization header
-                        auth_header = &static_auth_header;
-                        log_info("Using auth cookie for authentication: %s", auth_header_buf);
+                        auth_header = &cookie_auth_header;
+                        log_info("Using auth cookie for authentication: %s", cookie_auth_buf);
                     }
                 } else {
                     log_info("No auth cookie found in cookie string: %s", cookie_str);
@@ -172,14 +166,11 @@ int mongoose_server_basic_auth_check(struct mg_http_message *hm, http_server_t *
         if (user[0] != '\0') {
             // First try to authenticate against the database
             int64_t user_id;
+            // Inactive users are rejected by db_auth_authenticate itself
             if (db_auth_authenticate(user, pass, &user_id) == 0) {
-                // Get the user to check if they're active
-                user_t db_user;
-                if (db_auth_get_user_by_id(user_id, &db_user) == 0 && db_user.is_active) {
-                    log_info("Authentication successful with database credentials for user: %s (ID: %lld)", 
-                            user, (long long)user_id);
-                    return 0; // Authentication successful
-                }
+                log_debug("Authentication successful with database credentials for user: %s (ID: %lld)", 
+                         user, (long long)user_id);
+                return 0; // Authentication successful
             }
             
             // If database authentication fails, check against server config (legacy)
@@ -11,6 +11,7 @@
 #include <string.h>
 #include <pthread.h>
 #include <unistd.h>
+#include <time.h>
 
 #include "web/mongoose_server.h"
 #include "web/mongoose_server_multithreading.h"
@@ -19,6 +20,52 @@
 
 // Thread data structure is defined in the header file
 
+// Distinct routes whose concurrency is tracked
+#define MG_WORKER_MAX_ROUTES 64
+
+/**
+ * @brief Request waiting for a worker
+ */
+typedef struct {
+  struct mg_thread_data *data;
+  int route;                  // Index into the route table, -1 if untracked
+  struct timespec queued_at;
+} mg_worker_job_t;
+
+/**
+ * @brief Per-route counters, a route is identified by its handler
+ */
+typedef struct {
+  void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm);
+  int running;
+  int queued;
+} mg_worker_route_t;
+
+// Worker pool state
+static struct {
+  bool running;
+  int thread_count;
+  pthread_t threads[MG_WORKER_MAX_THREADS];
+  mg_worker_job_t queue[MG_WORKER_QUEUE_SIZE];  // Oldest first
+  int queue_len;
+  mg_worker_route_t routes[MG_WORKER_MAX_ROUTES];
+  int route_count;
+  int active;
+  uint64_t completed;
+  uint64_t rejected;
+  double total_queue_ms;
+  double max_queue_ms;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+} worker_pool = {
+  .running = false,
+  .thread_count = 0,
+  .queue_len = 0,
+  .route_count = 0,
+  .mutex = PTHREAD_MUTEX_INITIALIZER,
+  .cond = PTHREAD_COND_INITIALIZER
+};
+
 /**
  * @brief Start a thread
  * 
@@ -111,14 +158,319 @@ void *mg_thread_function(void *param) {
     mg_wakeup(p->mgr, p->conn_id, "Failed to parse request", 22);
   }
   
+  log_debug("Worker thread completed for connection ID %lu", p->conn_id);
+  
   // Free resources
   free((void *) p->message.buf);
   free(p);
   
-  log_debug("Worker thread completed for connection ID %lu", p->conn_id);
   return NULL;
 }
 
+/**
+ * @brief Find the route of a handler, adding it if needed (pool mutex held)
+ */
+static int worker_pool_route(void (*handler_func)(struct mg_connection *, struct mg_http_message *)) {
+  for (int i = 0; i < worker_pool.route_count; i++) {
+    if (worker_pool.routes[i].handler_func == handler_func) {
+      return i;
+    }
+  }
+  
+  if (worker_pool.route_count == MG_WORKER_MAX_ROUTES) {
+    return -1;
+  }
+  
+  mg_worker_route_t *route = &worker_pool.routes[worker_pool.route_count];
+  route->handler_func = handler_func;
+  route->running = 0;
+  route->queued = 0;
+  
+  return worker_pool.route_count++;
+}
+
+/**
+ * @brief Milliseconds between two monotonic times
+ */
+static double worker_pool_elapsed_ms(const struct timespec *start, const struct timespec *end) {
+  return (double)(end->tv_sec - start->tv_sec) * 1000.0 +
+         (double)(end->tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/**
+ * @brief Take the oldest request whose route has a free slot (pool mutex held)
+ * 
+ * @return true if a request was taken
+ */
+static bool worker_pool_take(mg_worker_job_t *job) {
+  for (int i = 0; i < worker_pool.queue_len; i++) {
+    int route = worker_pool.queue[i].route;
+    
+    // A busy route does not hold up the requests queued behind it
+    if (route >= 0 && worker_pool.routes[route].running >= MG_WORKER_ROUTE_CONCURRENCY) {
+      continue;
+    }
+    
+    *job = worker_pool.queue[i];
+    memmove(&worker_pool.queue[i], &worker_pool.queue[i + 1],
+            (worker_pool.queue_len - i - 1) * sizeof(mg_worker_job_t));
+    worker_pool.queue_len--;
+    
+    if (route >= 0) {
+      worker_pool.routes[route].queued--;
+      worker_pool.routes[route].running++;
+    }
+    return true;
+  }
+  
+  return false;
+}
+
+/**
+ * @brief Worker thread
+ */
+static void *worker_pool_thread(void *arg) {
+  (void) arg;
+  
+  pthread_mutex_lock(&worker_pool.mutex);
+  
+  while (worker_pool.running) {
+    mg_worker_job_t job;
+    if (!worker_pool_take(&job)) {
+      pthread_cond_wait(&worker_pool.cond, &worker_pool.mutex);
+      continue;
+    }
+    
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    double queue_ms = worker_pool_elapsed_ms(&job.queued_at, &now);
+    worker_pool.total_queue_ms += queue_ms;
+    if (queue_ms > worker_pool.max_queue_ms) {
+      worker_pool.max_queue_ms = queue_ms;
+    }
+    worker_pool.active++;
+    
+    pthread_mutex_unlock(&worker_pool.mutex);
+    
+    mg_thread_function(job.data);
+    
+    pthread_mutex_lock(&worker_pool.mutex);
+    
+    worker_pool.active--;
+    worker_pool.completed++;
+    if (job.route >= 0) {
+      worker_pool.routes[job.route].running--;
+    }
+    
+    // A request that was waiting on this route's limit may run now
+    pthread_cond_broadcast(&worker_pool.cond);
+  }
+  
+  pthread_mutex_unlock(&worker_pool.mutex);
+  return NULL;
+}
+
+/**
+ * @brief Start the worker pool
+ */
+int mg_worker_pool_init(int threads) {
+  if (threads < 1) {
+    threads = 1;
+  } else if (threads > MG_WORKER_MAX_THREADS) {
+    threads = MG_WORKER_MAX_THREADS;
+  }
+  
+  pthread_mutex_lock(&worker_pool.mutex);
+  
+  if (worker_pool.running) {
+    pthread_mutex_unlock(&worker_pool.mutex);
+    return 0;
+  }
+  
+  worker_pool.running = true;
+  worker_pool.thread_count = 0;
+  worker_pool.queue_len = 0;
+  worker_pool.route_count = 0;
+  worker_pool.active = 0;
+  worker_pool.completed = 0;
+  worker_pool.rejected = 0;
+  worker_pool.total_queue_ms = 0;
+  worker_pool.max_queue_ms = 0;
+  
+  for (int i = 0; i < threads; i++) {
+    if (pthread_create(&worker_pool.threads[i], NULL, worker_pool_thread, NULL) != 0) {
+      log_error("Failed to create worker thread %d", i);
+      break;
+    }
+    worker_pool.thread_count++;
+  }
+  
+  if (worker_pool.thread_count == 0) {
+    worker_pool.running = false;
+    pthread_mutex_unlock(&worker_pool.mutex);
+    return -1;
+  }
+  
+  pthread_mutex_unlock(&worker_pool.mutex);
+  
+  log_info("Worker pool started with %d threads (queue %d, %d per route)",
+           worker_pool.thread_count, MG_WORKER_QUEUE_SIZE, MG_WORKER_ROUTE_CONCURRENCY);
+  return 0;
+}
+
+/**
+ * @brief Stop the worker pool
+ */
+void mg_worker_pool_shutdown(void) {
+  pthread_mutex_lock(&worker_pool.mutex);
+  
+  if (!worker_pool.running) {
+    pthread_mutex_unlock(&worker_pool.mutex);
+    return;
+  }
+  
+  worker_pool.running = false;
+  pthread_cond_broadcast(&worker_pool.cond);
+  pthread_mutex_unlock(&worker_pool.mutex);
+  
+  for (int i = 0; i < worker_pool.thread_count; i++) {
+    pthread_join(worker_pool.threads[i], NULL);
+  }
+  
+  // Nothing is left to run the requests still waiting, so tell their clients
+  // to come back; the managers are still polled and deliver the reply
+  static const char body[] = "{\"error\": \"Server is shutting down\"}\n";
+  char reply[192];
+  int reply_len = snprintf(reply, sizeof(reply),
+                           "HTTP/1.1 503 Service Unavailable\r\n"
+                           "Content-Type: application/json\r\n"
+                           "Retry-After: %d\r\n"
+                           "Content-Length: %zu\r\n\r\n%s",
+                           MG_WORKER_RETRY_AFTER, sizeof(body) - 1, body);
+  
+  pthread_mutex_lock(&worker_pool.mutex);
+  for (int i = 0; i < worker_pool.queue_len; i++) {
+    struct mg_thread_data *data = worker_pool.queue[i].data;
+    mg_wakeup(data->mgr, data->conn_id, reply, (size_t) reply_len);
+    free((void *) data->message.buf);
+    free(data);
+  }
+  if (worker_pool.queue_len > 0) {
+    log_info("Answered %d queued requests with 503 on shutdown", worker_pool.queue_len);
+  }
+  worker_pool.queue_len = 0;
+  worker_pool.thread_count = 0;
+  pthread_mutex_unlock(&worker_pool.mutex);
+  
+  log_info("Worker pool stopped");
+}
+
+/**
+ * @brief Get worker pool metrics
+ */
+void mg_worker_pool_get_stats(mg_worker_pool_stats_t *stats) {
+  if (!stats) {
+    return;
+  }
+  
+  pthread_mutex_lock(&worker_pool.mutex);
+  stats->threads = worker_pool.thread_count;
+  stats->active = worker_pool.active;
+  stats->queued = worker_pool.queue_len;
+  stats->completed = worker_pool.completed;
+  stats->rejected = worker_pool.rejected;
+  stats->avg_queue_ms = worker_pool.completed + worker_pool.active > 0 ?
+      worker_pool.total_queue_ms / (double)(worker_pool.completed + worker_pool.active) : 0;
+  stats->max_queue_ms = worker_pool.max_queue_ms;
+  pthread_mutex_unlock(&worker_pool.mutex);
+}
+
+/**
+ * @brief Queue a request for the worker pool
+ * 
+ * @return 0 if queued, 1 if the pool is not running, -1 if saturated
+ */
+static int worker_pool_submit(struct mg_thread_data *data) {
+  pthread_mutex_lock(&worker_pool.mutex);
+  
+  if (!worker_pool.running) {
+    pthread_mutex_unlock(&worker_pool.mutex);
+    return 1;
+  }
+  
+  int route = worker_pool_route(data->handler_func);
+  
+  // Shed rather than queue work that would wait behind a full queue, and
+  // keep one route from filling the queue on its own
+  if (worker_pool.queue_len == MG_WORKER_QUEUE_SIZE ||
+      (route >= 0 && worker_pool.routes[route].queued >= MG_WORKER_ROUTE_QUEUE_LIMIT)) {
+    worker_pool.rejected++;
+    pthread_mutex_unlock(&worker_pool.mutex);
+    return -1;
+  }
+  
+  mg_worker_job_t *job = &worker_pool.queue[worker_pool.queue_len++];
+  job->data = data;
+  job->route = route;
+  clock_gettime(CLOCK_MONOTONIC, &job->queued_at);
+  
+  if (route >= 0) {
+    worker_pool.routes[route].queued++;
+  }
+  
+  pthread_cond_signal(&worker_pool.cond);
+  pthread_mutex_unlock(&worker_pool.mutex);
+  
+  return 0;
+}
+
+/**
+ * @brief Handle a request on a worker thread
+ */
+bool mg_offload_request(struct mg_connection *c, struct mg_http_message *hm,
+                        void (*handler_func)(struct mg_connection *c, struct mg_http_message *hm)) {
+  // Allocate thread data
+  struct mg_thread_data *data = 
+      (struct mg_thread_data *) calloc(1, sizeof(*data));
+  
+  if (!data) {
+    log_error("Failed to allocate memory for thread data");
+    mg_http_reply(c, 500, "", "Internal Server Error\n");
+    return false;
+  }
+  
+  // Copy the HTTP message
+  data->message = mg_strdup(hm->message);
+  if (data->message.len == 0) {
+    log_error("Failed to duplicate HTTP message");
+    free(data);
+    mg_http_reply(c, 500, "", "Internal Server Error\n");
+    return false;
+  }
+  
+  // Set connection ID, manager, and handler function
+  data->conn_id = c->id;
+  data->mgr = c->mgr;
+  data->handler_func = handler_func;
+  
+  int rc = worker_pool_submit(data);
+  if (rc > 0) {
+    // No pool (e.g. the standalone test program), fall back to a thread per request
+    mg_start_thread(mg_thread_function, data);
+  } else if (rc < 0) {
+    log_warn("Worker pool saturated, rejecting request: %.*s", (int)hm->uri.len, hm->uri.buf);
+    free((void *) data->message.buf);
+    free(data);
+    char headers[96];
+    snprintf(headers, sizeof(headers), "Content-Type: application/json\r\nRetry-After: %d\r\n",
+             MG_WORKER_RETRY_AFTER);
+    mg_http_reply(c, 503, headers, "{\"error\": \"Server busy, try again later\"}\n");
+    return false;
+  }
+  
+  return true;
+}
+
 /**
  * @brief Handle HTTP request with multithreading
  * 
@@ -140,8 +492,8 @@ bool mg_handle_request_with_threading(struct mg_connection *c,
     // Return false to let the normal request handling continue
     return false;
   } else {
-    // Multithreading path - spawn a thread to handle the request
-    log_debug("Spawning thread to handle request: %.*s", 
+    // Multithreading path - hand the request to a worker thread
+    log_debug("Offloading request to worker pool: %.*s", 
              (int)hm->uri.len, hm->uri.buf);
     
     // Extract URI for logging
@@ -152,31 +504,8 @@ bool mg_handle_request_with_threading(struct mg_connection *c,
     
     log_debug("Handling request with threading: %s", uri);
     
-    // Allocate thread data
-    struct mg_thread_data *data = 
-        (struct mg_thread_data *) calloc(1, sizeof(*data));
-    
-    if (!data) {
-      log_error("Failed to allocate memory for thread data");
-      mg_http_reply(c, 500, "", "Internal Server Error\n");
-      return true;
-    }
-    
-    // Copy the HTTP message
-    data->message = mg_strdup(hm->message);
-    if (data->message.len == 0) {
-      log_error("Failed to duplicate HTTP message");
-      free(data);
-      mg_http_reply(c, 500, "", "Internal Server Error\n");
-      return true;
-    }
-    
-    // Set connection ID, manager, and handler function
-    data->conn_id = c->id;
-    data->mgr = c->mgr;
-    
-    // Start thread
-    mg_start_thread(mg_thread_function, data);
+    // Queue for a worker, an error response is sent if that fails
+    mg_offload_request(c, hm, NULL);
     
     return true;
   }
@@ -0,0 +1,555 @@
+/**
+ * @file mongoose_server_reactor.c
+ * @brief Event loops (reactors) serving the HTTP front end
+ *
+ * Each event loop owns a Mongoose manager and polls it on its own thread.
+ * Mongoose managers are not thread safe, so WebSocket messages produced on
+ * other threads are queued for the loop that owns the connection and sent
+ * when its listener is polled.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <netdb.h>
+
+#include "web/mongoose_server_reactor.h"
+#include "web/websocket_manager.h"
+#include "core/logger.h"
+#include "core/shutdown_coordinator.h"
+
+/**
+ * @brief WebSocket message waiting for its event loop
+ */
+typedef struct reactor_msg {
+    struct reactor_msg *next;
+    unsigned long conn_id;          // 0 for a broadcast to the WebSocket clients of the loop
+    ws_frame_t *frame;              // Broadcasts share one framed copy
+    char topic[64];                 // Broadcast topic, empty for every client
+    size_t len;
+    char data[];
+} reactor_msg_t;
+
+/**
+ * @brief Event loop
+ */
+typedef struct {
+    struct mg_mgr *mgr;
+    pthread_t thread;
+    bool owned;                     // Manager and thread were created here
+    reactor_msg_t *head;
+    reactor_msg_t *tail;
+    pthread_mutex_t mutex;
+} reactor_t;
+
+// Registered event loops
+static struct {
+    reactor_t reactors[MG_MAX_REACTORS];
+    int count;
+    http_server_t *server;
+    pthread_mutex_t mutex;
+} reactor_set = {
+    .count = 0,
+    .server = NULL,
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * @brief Find the event loop of a manager
+ *
+ * Called with reactor_set.mutex held. The event loop may only be used until
+ * it is released, mg_reactors_stop destroys it right after.
+ */
+static reactor_t *find_reactor(struct mg_mgr *mgr) {
+    for (int i = 0; i < reactor_set.count; i++) {
+        if (reactor_set.reactors[i].mgr == mgr) {
+            return &reactor_set.reactors[i];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Append a message to the queue of an event loop
+ */
+static void reactor_push(reactor_t *reactor, reactor_msg_t *msg) {
+    pthread_mutex_lock(&reactor->mutex);
+    if (reactor->tail) {
+        reactor->tail->next = msg;
+    } else {
+        reactor->head = msg;
+    }
+    reactor->tail = msg;
+    pthread_mutex_unlock(&reactor->mutex);
+}
+
+/**
+ * @brief Free a queued message
+ */
+static void reactor_msg_free(reactor_msg_t *msg) {
+    ws_frame_unref(msg->frame);
+    free(msg);
+}
+
+/**
+ * @brief Queue a message for an event loop
+ */
+static bool reactor_enqueue(reactor_t *reactor, unsigned long conn_id, const char *data, size_t len) {
+    reactor_msg_t *msg = malloc(sizeof(reactor_msg_t) + len);
+    if (!msg) {
+        log_error("Failed to allocate WebSocket message for event loop");
+        return false;
+    }
+
+    msg->next = NULL;
+    msg->conn_id = conn_id;
+    msg->frame = NULL;
+    msg->topic[0] = '\0';
+    msg->len = len;
+    memcpy(msg->data, data, len);
+
+    reactor_push(reactor, msg);
+    return true;
+}
+
+/**
+ * @brief Queue a shared frame for every WebSocket client of an event loop
+ */
+static bool reactor_enqueue_frame(reactor_t *reactor, const char *topic, ws_frame_t *frame) {
+    reactor_msg_t *msg = malloc(sizeof(reactor_msg_t));
+    if (!msg) {
+        log_error("Failed to allocate WebSocket message for event loop");
+        return false;
+    }
+
+    msg->next = NULL;
+    msg->conn_id = 0;
+    msg->frame = ws_frame_ref(frame);
+    snprintf(msg->topic, sizeof(msg->topic), "%s", topic ? topic : "");
+    msg->len = 0;
+
+    reactor_push(reactor, msg);
+    return true;
+}
+
+/**
+ * @brief Free the messages still queued for an event loop
+ */
+static void reactor_discard(reactor_t *reactor) {
+    pthread_mutex_lock(&reactor->mutex);
+    reactor_msg_t *msg = reactor->head;
+    reactor->head = NULL;
+    reactor->tail = NULL;
+    pthread_mutex_unlock(&reactor->mutex);
+
+    while (msg) {
+        reactor_msg_t *next = msg->next;
+        reactor_msg_free(msg);
+        msg = next;
+    }
+}
+
+/**
+ * @brief Open a listening socket with SO_REUSEPORT on the address of a listen URL
+ *
+ * @param url Listen URL, e.g. "http://0.0.0.0:8080" or "https://[::]:8443"
+ * @param loc Set to the address the socket is bound to
+ * @return Socket, or -1 on error
+ */
+static int open_reuseport_socket(const char *url, struct mg_addr *loc) {
+    // An empty host means every address, like Mongoose listeners
+    struct mg_str host_str = mg_url_host(url);
+    char host[128] = {0};
+    if (host_str.len >= sizeof(host)) {
+        log_error("Listen address too long: %s", url);
+        return -1;
+    }
+    memcpy(host, host_str.buf, host_str.len);
+
+    // IPv6 literals may keep their brackets
+    char *node = host;
+    size_t node_len = strlen(node);
+    if (node_len >= 2 && node[0] == '[' && node[node_len - 1] == ']') {
+        node[node_len - 1] = '\0';
+        node++;
+    }
+
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)mg_url_port(url));
+
+    struct addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+
+    struct addrinfo *res = NULL;
+    int rc = getaddrinfo(node[0] ? node : NULL, service, &hints, &res);
+    if (rc != 0 || !res) {
+        log_error("Failed to resolve listen address %s: %s", url, gai_strerror(rc));
+        return -1;
+    }
+
+    int fd = socket(res->ai_family, res->ai_socktype, res->ai_protocol);
+    if (fd < 0) {
+        log_error("Failed to create listening socket: %s", strerror(errno));
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on)) != 0) {
+        log_error("Failed to set SO_REUSEPORT on listening socket: %s", strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    if (bind(fd, res->ai_addr, res->ai_addrlen) != 0 ||
+        listen(fd, MG_REACTOR_LISTEN_BACKLOG) != 0) {
+        log_error("Failed to listen on %s: %s", url, strerror(errno));
+        close(fd);
+        freeaddrinfo(res);
+        return -1;
+    }
+
+    memset(loc, 0, sizeof(*loc));
+    if (res->ai_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)res->ai_addr;
+        memcpy(loc->ip, &sin6->sin6_addr, 16);
+        loc->port = sin6->sin6_port;
+        loc->is_ip6 = true;
+    } else {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)res->ai_addr;
+        memcpy(loc->ip, &sin->sin_addr, 4);
+        loc->port = sin->sin_port;
+    }
+    freeaddrinfo(res);
+
+    // Mongoose expects non-blocking sockets that are not inherited by children
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+    return fd;
+}
+
+/**
+ * @brief Build the listen URL of a throwaway listener on the same host
+ *
+ * Replaces the port of the listen URL with 0, so Mongoose opens a socket
+ * of the same address family on a port the kernel picks.
+ */
+static bool throwaway_listen_url(const char *url, char *buf, size_t size) {
+    const char *host = strstr(url, "://");
+    host = host ? host + 3 : url;
+
+    // The port follows the last colon after an IPv6 literal's closing bracket
+    const char *bracket = strchr(host, ']');
+    const char *colon = strrchr(bracket ? bracket : host, ':');
+    size_t host_end = colon ? (size_t)(colon - url) : strlen(url);
+
+    int written = snprintf(buf, size, "%.*s:0", (int)host_end, url);
+    return written > 0 && (size_t)written < size;
+}
+
+/**
+ * @brief Make a Mongoose HTTP listener use a socket opened here
+ *
+ * This is the only place that relies on Mongoose internals. Mongoose binds
+ * its listeners itself and has no hook to set SO_REUSEPORT first, so the
+ * listener is created on a throwaway port and its socket is replaced. Only
+ * the descriptor and the local address are swapped; Mongoose keeps its own
+ * HTTP protocol handler and polls the new descriptor like any other.
+ */
+static void adopt_listener_socket(struct mg_connection *c, int fd, const struct mg_addr *loc) {
+    close((int)(size_t)c->fd);
+    c->fd = (void *)(size_t)fd;
+    c->loc = *loc;
+}
+
+/**
+ * @brief Send a WebSocket text message on the owning loop's thread
+ *
+ * Goes through the connection's outbox, so a reply never overtakes the
+ * broadcasts still queued for a client that is behind.
+ */
+static bool reactor_ws_send_now(struct mg_connection *c, const char *data, size_t len) {
+    ws_frame_t *frame = ws_frame_create(data, len);
+    if (!frame) {
+        log_error("Failed to frame WebSocket message");
+        return false;
+    }
+
+    bool sent = ws_outbox_send(c, frame, NULL, WS_TOPIC_POLICY_DROP_OLDEST);
+    ws_frame_unref(frame);
+    return sent;
+}
+
+/**
+ * @brief Register an event loop
+ */
+int mg_reactor_register(struct mg_mgr *mgr, pthread_t thread) {
+    pthread_mutex_lock(&reactor_set.mutex);
+
+    if (reactor_set.count == MG_MAX_REACTORS) {
+        pthread_mutex_unlock(&reactor_set.mutex);
+        log_error("Too many event loops registered");
+        return -1;
+    }
+
+    reactor_t *reactor = &reactor_set.reactors[reactor_set.count];
+    memset(reactor, 0, sizeof(*reactor));
+    reactor->mgr = mgr;
+    reactor->thread = thread;
+    pthread_mutex_init(&reactor->mutex, NULL);
+    reactor_set.count++;
+
+    pthread_mutex_unlock(&reactor_set.mutex);
+    return 0;
+}
+
+/**
+ * @brief Listen on an address shared with the other event loops
+ */
+struct mg_connection *mg_reactor_listen(struct mg_mgr *mgr, const char *url,
+                                        mg_event_handler_t fn, void *fn_data) {
+    char throwaway_url[160];
+    if (!url || !throwaway_listen_url(url, throwaway_url, sizeof(throwaway_url))) {
+        log_error("Invalid listen URL: %s", url ? url : "(null)");
+        return NULL;
+    }
+
+    struct mg_addr loc;
+    int fd = open_reuseport_socket(url, &loc);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct mg_connection *c = mg_http_listen(mgr, throwaway_url, fn, fn_data);
+    if (!c) {
+        close(fd);
+        return NULL;
+    }
+
+    adopt_listener_socket(c, fd, &loc);
+
+    return c;
+}
+
+/**
+ * @brief Event loop thread
+ */
+static void *reactor_thread_func(void *arg) {
+    struct mg_mgr *mgr = (struct mg_mgr *)arg;
+    http_server_t *server = reactor_set.server;
+
+    log_info("Mongoose event loop started");
+
+    while (atomic_load(&server->running) && !is_shutdown_initiated()) {
+        mg_mgr_poll(mgr, MG_REACTOR_POLL_MS);
+    }
+
+    log_info("Mongoose event loop stopped");
+    return NULL;
+}
+
+/**
+ * @brief Start the additional event loops
+ */
+int mg_reactors_start(http_server_t *server, const char *url, mg_event_handler_t fn) {
+    if (!server || !url) {
+        return -1;
+    }
+
+    reactor_set.server = server;
+
+    int started = 0;
+    for (int i = 1; i < server->config.event_loops; i++) {
+        struct mg_mgr *mgr = calloc(1, sizeof(struct mg_mgr));
+        if (!mgr) {
+            log_error("Failed to allocate memory for Mongoose event manager");
+            break;
+        }
+
+        mg_mgr_init(mgr);
+        mg_wakeup_init(mgr);
+
+        struct mg_connection *c = mg_reactor_listen(mgr, url, fn, server);
+        if (!c) {
+            mg_mgr_free(mgr);
+            free(mgr);
+            break;
+        }
+
+        if (server->config.ssl_enabled) {
+            struct mg_tls_opts opts = {
+                .cert = server->config.cert_path,
+                .key = server->config.key_path,
+            };
+            mg_tls_init(c, &opts);
+        }
+
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, reactor_thread_func, mgr) != 0) {
+            log_error("Failed to create event loop thread");
+            mg_mgr_free(mgr);
+            free(mgr);
+            break;
+        }
+
+        if (mg_reactor_register(mgr, thread) != 0) {
+            // The loop is running, so it has to be stopped before it is freed
+            pthread_join(thread, NULL);
+            mg_mgr_free(mgr);
+            free(mgr);
+            break;
+        }
+
+        pthread_mutex_lock(&reactor_set.mutex);
+        reactor_set.reactors[reactor_set.count - 1].owned = true;
+        pthread_mutex_unlock(&reactor_set.mutex);
+
+        started++;
+    }
+
+    log_info("Started %d additional event loops on %s", started, url);
+    return started;
+}
+
+/**
+ * @brief Stop the additional event loops and free their managers
+ */
+void mg_reactors_stop(void) {
+    // Lookups happen under the set mutex, so once the count is cleared no
+    // other thread is left holding an event loop
+    pthread_mutex_lock(&reactor_set.mutex);
+    int count = reactor_set.count;
+    reactor_set.count = 0;
+    pthread_mutex_unlock(&reactor_set.mutex);
+
+    // The loops exit once the server is no longer running
+    for (int i = 0; i < count; i++) {
+        if (reactor_set.reactors[i].owned) {
+            pthread_join(reactor_set.reactors[i].thread, NULL);
+        }
+    }
+
+    for (int i = 0; i < count; i++) {
+        reactor_t *reactor = &reactor_set.reactors[i];
+
+        if (reactor->owned) {
+            mg_mgr_free(reactor->mgr);
+            free(reactor->mgr);
+        }
+
+        reactor_discard(reactor);
+        pthread_mutex_destroy(&reactor->mutex);
+    }
+
+    if (count > 1) {
+        log_info("Stopped %d additional event loops", count - 1);
+    }
+}
+
+/**
+ * @brief Send a WebSocket text message from any thread
+ */
+bool mg_reactor_ws_send(struct mg_connection *c, const char *data, size_t len) {
+    if (!c || !data) {
+        return false;
+    }
+
+    pthread_mutex_lock(&reactor_set.mutex);
+    reactor_t *reactor = find_reactor(c->mgr);
+
+    // Already on the owning loop, or no loop registered yet
+    if (!reactor || pthread_equal(reactor->thread, pthread_self())) {
+        pthread_mutex_unlock(&reactor_set.mutex);
+        return reactor_ws_send_now(c, data, len);
+    }
+
+    bool queued = reactor_enqueue(reactor, c->id, data, len);
+    pthread_mutex_unlock(&reactor_set.mutex);
+
+    return queued;
+}
+
+/**
+ * @brief Hand a framed message to every event loop
+ */
+int mg_reactor_ws_publish(const char *topic, ws_frame_t *frame) {
+    if (!frame) {
+        return 0;
+    }
+
+    int queued = 0;
+
+    pthread_mutex_lock(&reactor_set.mutex);
+    for (int i = 0; i < reactor_set.count; i++) {
+        if (reactor_enqueue_frame(&reactor_set.reactors[i], topic, frame)) {
+            queued++;
+        }
+    }
+    pthread_mutex_unlock(&reactor_set.mutex);
+
+    return queued;
+}
+
+/**
+ * @brief Send the messages queued for an event loop
+ */
+void mg_reactor_poll(struct mg_connection *listener) {
+    pthread_mutex_lock(&reactor_set.mutex);
+    reactor_t *reactor = find_reactor(listener->mgr);
+    if (!reactor) {
+        pthread_mutex_unlock(&reactor_set.mutex);
+        return;
+    }
+
+    pthread_mutex_lock(&reactor->mutex);
+    reactor_msg_t *msg = reactor->head;
+    reactor->head = NULL;
+    reactor->tail = NULL;
+    pthread_mutex_unlock(&reactor->mutex);
+    pthread_mutex_unlock(&reactor_set.mutex);
+
+    while (msg) {
+        reactor_msg_t *next = msg->next;
+
+        if (msg->conn_id == 0) {
+            websocket_manager_broadcast_frame(listener->mgr, msg->topic[0] ? msg->topic : NULL, msg->frame);
+        } else {
+            // The connection may have closed since the message was queued
+            for (struct mg_connection *c = listener->mgr->conns; c != NULL; c = c->next) {
+                if (c->id == msg->conn_id) {
+                    if (c->is_websocket && !c->is_closing) {
+                        reactor_ws_send_now(c, msg->data, msg->len);
+                    }
+                    break;
+                }
+            }
+        }
+
+        reactor_msg_free(msg);
+        msg = next;
+    }
+}
+
+/**
+ * @brief Get the number of registered event loops
+ */
+int mg_reactor_count(void) {
+    pthread_mutex_lock(&reactor_set.mutex);
+    int count = reactor_set.count;
+    pthread_mutex_unlock(&reactor_set.mutex);
+    return count;
+}
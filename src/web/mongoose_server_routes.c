@@ -0,0 +1,424 @@
+/**
+ * @file mongoose_server_routes.c
+ * @brief API route dispatch for the Mongoose HTTP server
+ *
+ * The routes table is compiled into one trie per HTTP method, keyed on
+ * path segments, so a request walks its own path instead of glob matching
+ * every pattern in the table.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <limits.h>
+
+#include "web/mongoose_server_routes.h"
+#include "core/logger.h"
+
+// Most distinct HTTP methods in the routes table
+#define MAX_ROUTE_METHODS 8
+
+/**
+ * @brief Kind of path segment in a route pattern
+ */
+typedef enum {
+    ROUTE_SEGMENT_LITERAL,      // Matched exactly
+    ROUTE_SEGMENT_PARAM,        // "#" followed by a slash, one or more segments
+    ROUTE_SEGMENT_GLOB,         // Literal text with wildcards, matched with mg_match
+    ROUTE_SEGMENT_REST          // Trailing "#", the rest of the URI
+} route_segment_kind_t;
+
+/**
+ * @brief Trie node, one per distinct pattern segment
+ */
+typedef struct route_node {
+    route_segment_kind_t kind;
+    char *segment;
+    size_t segment_len;
+    int route_index;            // Route ending here, -1 if none
+    int min_index;              // Lowest route index in this subtree
+    struct route_node **children;
+    int child_count;
+} route_node_t;
+
+/**
+ * @brief Search state while matching a request
+ */
+typedef struct {
+    int best;
+    mg_route_params_t best_params;
+    mg_route_params_t params;
+} route_search_t;
+
+// Dispatch trie
+static struct {
+    struct {
+        char method[16];
+        route_node_t *root;
+    } methods[MAX_ROUTE_METHODS];
+    int method_count;
+} route_trie = {
+    .method_count = 0
+};
+
+/**
+ * @brief Create a trie node
+ */
+static route_node_t *route_node_create(route_segment_kind_t kind, const char *segment, size_t len) {
+    route_node_t *node = calloc(1, sizeof(route_node_t));
+    if (!node) {
+        return NULL;
+    }
+
+    node->segment = malloc(len + 1);
+    if (!node->segment) {
+        free(node);
+        return NULL;
+    }
+    memcpy(node->segment, segment, len);
+    node->segment[len] = '\0';
+
+    node->kind = kind;
+    node->segment_len = len;
+    node->route_index = -1;
+    node->min_index = INT_MAX;
+    return node;
+}
+
+/**
+ * @brief Free a trie node and its children
+ */
+static void route_node_free(route_node_t *node) {
+    if (!node) {
+        return;
+    }
+
+    for (int i = 0; i < node->child_count; i++) {
+        route_node_free(node->children[i]);
+    }
+    free(node->children);
+    free(node->segment);
+    free(node);
+}
+
+/**
+ * @brief Find or add the child of a node for a pattern segment
+ */
+static route_node_t *route_node_child(route_node_t *node, route_segment_kind_t kind,
+                                      const char *segment, size_t len) {
+    for (int i = 0; i < node->child_count; i++) {
+        route_node_t *child = node->children[i];
+        if (child->kind == kind && child->segment_len == len &&
+            memcmp(child->segment, segment, len) == 0) {
+            return child;
+        }
+    }
+
+    route_node_t *child = route_node_create(kind, segment, len);
+    if (!child) {
+        return NULL;
+    }
+
+    route_node_t **children = realloc(node->children, (node->child_count + 1) * sizeof(route_node_t *));
+    if (!children) {
+        route_node_free(child);
+        return NULL;
+    }
+    node->children = children;
+    node->children[node->child_count++] = child;
+
+    return child;
+}
+
+/**
+ * @brief Get the trie root for a method, adding it if needed
+ */
+static route_node_t *route_method_root(const char *method, bool create) {
+    for (int i = 0; i < route_trie.method_count; i++) {
+        if (strcmp(route_trie.methods[i].method, method) == 0) {
+            return route_trie.methods[i].root;
+        }
+    }
+
+    if (!create || route_trie.method_count == MAX_ROUTE_METHODS ||
+        strlen(method) >= sizeof(route_trie.methods[0].method)) {
+        return NULL;
+    }
+
+    route_node_t *root = route_node_create(ROUTE_SEGMENT_LITERAL, "", 0);
+    if (!root) {
+        return NULL;
+    }
+
+    int i = route_trie.method_count++;
+    strcpy(route_trie.methods[i].method, method);
+    route_trie.methods[i].root = root;
+    return root;
+}
+
+/**
+ * @brief Count the wildcards in a pattern segment
+ */
+static int count_wildcards(const char *segment, size_t len) {
+    int count = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (segment[i] == '#' || segment[i] == '*' || segment[i] == '?') {
+            count++;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Add a route to the trie
+ */
+static int route_insert(const mg_api_route_t *route, int index) {
+    if (route->uri[0] != '/') {
+        log_error("Route pattern must start with '/': %s", route->uri);
+        return -1;
+    }
+
+    route_node_t *node = route_method_root(route->method, true);
+    if (!node) {
+        log_error("Failed to add routes for method %s", route->method);
+        return -1;
+    }
+
+    // Track the lowest index along the path so searches can skip subtrees
+    if (index < node->min_index) {
+        node->min_index = index;
+    }
+
+    int params = 0;
+    const char *segment = route->uri + 1;
+    while (true) {
+        const char *slash = strchr(segment, '/');
+        size_t len = slash ? (size_t)(slash - segment) : strlen(segment);
+
+        route_segment_kind_t kind = ROUTE_SEGMENT_LITERAL;
+        int wildcards = count_wildcards(segment, len);
+        if (len == 1 && segment[0] == '#') {
+            kind = slash ? ROUTE_SEGMENT_PARAM : ROUTE_SEGMENT_REST;
+        } else if (wildcards > 0) {
+            kind = ROUTE_SEGMENT_GLOB;
+        }
+
+        params += wildcards;
+        if (params > MG_ROUTE_MAX_PARAMS) {
+            log_error("Route pattern has more than %d parameters: %s", MG_ROUTE_MAX_PARAMS, route->uri);
+            return -1;
+        }
+
+        node = route_node_child(node, kind, segment, len);
+        if (!node) {
+            log_error("Failed to allocate route trie node for %s", route->uri);
+            return -1;
+        }
+        if (index < node->min_index) {
+            node->min_index = index;
+        }
+
+        if (!slash) {
+            break;
+        }
+        segment = slash + 1;
+    }
+
+    // When a pattern is listed twice the first one wins, as with a linear scan
+    if (node->route_index < 0) {
+        node->route_index = index;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Record a route ending at a node if it beats the best so far
+ */
+static void route_search_accept(const route_node_t *node, route_search_t *search) {
+    if (node->route_index >= 0 && node->route_index < search->best) {
+        search->best = node->route_index;
+        search->best_params = search->params;
+    }
+}
+
+static void route_search(const route_node_t *node, const char *rest, const char *end,
+                         route_search_t *search);
+
+/**
+ * @brief Continue a search below a child whose segment ended at a slash or
+ *        at the end of the URI
+ */
+static void route_search_next(const route_node_t *child, const char *slash, const char *end,
+                              route_search_t *search) {
+    if (slash) {
+        route_search(child, slash + 1, end, search);
+    } else {
+        route_search_accept(child, search);
+    }
+}
+
+/**
+ * @brief Find the next slash in a URI
+ */
+static const char *route_next_slash(const char *from, const char *end) {
+    return from < end ? memchr(from, '/', (size_t)(end - from)) : NULL;
+}
+
+/**
+ * @brief Match the rest of a URI against the children of a node
+ *
+ * As with mg_match, "#" matches slashes too, so a parameter or a glob
+ * containing "#" may take several segments. Shorter spans are tried first,
+ * which captures what mg_match would.
+ *
+ * @param rest Start of the next path segment
+ * @param end End of the URI
+ */
+static void route_search(const route_node_t *node, const char *rest, const char *end,
+                         route_search_t *search) {
+    const char *slash = route_next_slash(rest, end);
+    size_t len = slash ? (size_t)(slash - rest) : (size_t)(end - rest);
+    int saved_count = search->params.count;
+
+    for (int i = 0; i < node->child_count; i++) {
+        const route_node_t *child = node->children[i];
+
+        // Nothing below this child can beat the route already found
+        if (child->min_index >= search->best) {
+            continue;
+        }
+
+        switch (child->kind) {
+            case ROUTE_SEGMENT_LITERAL:
+                if (child->segment_len == len && memcmp(child->segment, rest, len) == 0) {
+                    route_search_next(child, slash, end, search);
+                }
+                break;
+
+            case ROUTE_SEGMENT_PARAM:
+                // Followed by a slash in the pattern, so the value ends at one
+                for (const char *s = slash; s && child->min_index < search->best;
+                     s = route_next_slash(s + 1, end)) {
+                    search->params.values[search->params.count++] = mg_str_n(rest, (size_t)(s - rest));
+                    route_search(child, s + 1, end, search);
+                    search->params.count = saved_count;
+                }
+                break;
+
+            case ROUTE_SEGMENT_GLOB: {
+                // Only "#" and "?" match a slash, otherwise the glob is one segment
+                bool spans = memchr(child->segment, '#', child->segment_len) != NULL ||
+                             memchr(child->segment, '?', child->segment_len) != NULL;
+                const char *s = slash;
+                while (child->min_index < search->best) {
+                    struct mg_str caps[MG_ROUTE_MAX_PARAMS + 1];
+                    memset(caps, 0, sizeof(caps));
+                    size_t span = (size_t)((s ? s : end) - rest);
+                    if (mg_match(mg_str_n(rest, span), mg_str_n(child->segment, child->segment_len), caps)) {
+                        for (int j = 0; j < MG_ROUTE_MAX_PARAMS && caps[j].buf != NULL &&
+                             search->params.count < MG_ROUTE_MAX_PARAMS; j++) {
+                            search->params.values[search->params.count++] = caps[j];
+                        }
+                        route_search_next(child, s, end, search);
+                        search->params.count = saved_count;
+                    }
+                    if (!s || !spans) {
+                        break;
+                    }
+                    s = route_next_slash(s + 1, end);
+                }
+                break;
+            }
+
+            case ROUTE_SEGMENT_REST:
+                search->params.values[search->params.count++] = mg_str_n(rest, (size_t)(end - rest));
+                route_search_accept(child, search);
+                search->params.count = saved_count;
+                break;
+        }
+    }
+}
+
+/**
+ * @brief Build the dispatch trie for a routes table
+ */
+int mg_routes_init(const mg_api_route_t *routes) {
+    mg_routes_free();
+
+    int count = 0;
+    for (int i = 0; routes[i].method != NULL; i++) {
+        if (route_insert(&routes[i], i) != 0) {
+            mg_routes_free();
+            return -1;
+        }
+        count++;
+    }
+
+    log_info("Route trie built for %d routes across %d methods", count, route_trie.method_count);
+    return 0;
+}
+
+/**
+ * @brief Free the dispatch trie
+ */
+void mg_routes_free(void) {
+    for (int i = 0; i < route_trie.method_count; i++) {
+        route_node_free(route_trie.methods[i].root);
+        route_trie.methods[i].root = NULL;
+    }
+    route_trie.method_count = 0;
+}
+
+/**
+ * @brief Find the route for a request
+ */
+int mg_routes_match(struct mg_http_message *hm, mg_route_params_t *params) {
+    if (!hm || hm->uri.len == 0 || hm->uri.buf[0] != '/') {
+        return -1;
+    }
+
+    char method[16];
+    if (hm->method.len >= sizeof(method)) {
+        return -1;
+    }
+    memcpy(method, hm->method.buf, hm->method.len);
+    method[hm->method.len] = '\0';
+
+    const route_node_t *root = route_method_root(method, false);
+    if (!root) {
+        return -1;
+    }
+
+    route_search_t search;
+    search.best = INT_MAX;
+    search.best_params.count = 0;
+    search.params.count = 0;
+
+    route_search(root, hm->uri.buf + 1, hm->uri.buf + hm->uri.len, &search);
+
+    if (search.best == INT_MAX) {
+        return -1;
+    }
+
+    if (params) {
+        *params = search.best_params;
+    }
+    return search.best;
+}
+
+/**
+ * @brief Copy a parameter captured by the route of a request
+ */
+int mg_route_get_param(struct mg_http_message *hm, int index, char *buf, size_t buf_size) {
+    mg_route_params_t params;
+    if (!buf || buf_size == 0 || mg_routes_match(hm, &params) < 0 ||
+        index < 0 || index >= params.count || params.values[index].len >= buf_size) {
+        return -1;
+    }
+
+    memcpy(buf, params.values[index].buf, params.values[index].len);
+    buf[params.values[index].len] = '\0';
+    return (int)params.values[index].len;
+}
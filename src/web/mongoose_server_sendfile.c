@@ -0,0 +1,345 @@
+/**
+ * @file mongoose_server_sendfile.c
+ * @brief Zero-copy file serving for the Mongoose HTTP server
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/sendfile.h>
+
+#include "web/mongoose_server_sendfile.h"
+#include "core/logger.h"
+
+/**
+ * @brief File body being sent on a connection
+ */
+typedef struct {
+    int file_fd;
+    off_t offset;
+    off_t remaining;
+    mg_event_handler_t saved_pfn;   // Mongoose's HTTP handler, restored when done
+    void *saved_pfn_data;
+} sendfile_state_t;
+
+// Content types by file extension
+static const struct {
+    const char *ext;
+    const char *type;
+} content_types[] = {
+    {"mp4", "video/mp4"},
+    {"m4s", "video/iso.segment"},
+    {"ts", "video/mp2t"},
+    {"m3u8", "application/vnd.apple.mpegurl"},
+    {"webm", "video/webm"},
+    {"mkv", "video/x-matroska"},
+    {"avi", "video/x-msvideo"},
+    {"mov", "video/quicktime"},
+    {"jpg", "image/jpeg"},
+    {"jpeg", "image/jpeg"},
+    {"png", "image/png"},
+    {"json", "application/json"},
+    {NULL, NULL}
+};
+
+/**
+ * @brief Check whether a block of CRLF separated headers contains a header
+ */
+static bool has_header(const char *headers, const char *name) {
+    size_t name_len = strlen(name);
+
+    for (const char *line = headers; line && *line; ) {
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            return true;
+        }
+        line = strstr(line, "\r\n");
+        if (line) {
+            line += 2;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Pick the Content-Type of a file
+ *
+ * mime_types is either a single type or Mongoose's "ext=type,..." list.
+ */
+static void get_content_type(const char *path, const char *mime_types, char *type, size_t type_size) {
+    const char *ext = strrchr(path, '.');
+    ext = ext ? ext + 1 : "";
+
+    if (mime_types && mime_types[0] != '\0') {
+        if (!strchr(mime_types, '=')) {
+            snprintf(type, type_size, "%s", mime_types);
+            return;
+        }
+
+        size_t ext_len = strlen(ext);
+        for (const char *entry = mime_types; entry && *entry; ) {
+            const char *eq = strchr(entry, '=');
+            const char *end = strchr(entry, ',');
+            if (!end) {
+                end = entry + strlen(entry);
+            }
+            if (eq && eq < end && (size_t)(eq - entry) == ext_len &&
+                strncasecmp(entry, ext, ext_len) == 0) {
+                snprintf(type, type_size, "%.*s", (int)(end - eq - 1), eq + 1);
+                return;
+            }
+            entry = *end ? end + 1 : NULL;
+        }
+    }
+
+    for (int i = 0; content_types[i].ext; i++) {
+        if (strcasecmp(ext, content_types[i].ext) == 0) {
+            snprintf(type, type_size, "%s", content_types[i].type);
+            return;
+        }
+    }
+
+    snprintf(type, type_size, "application/octet-stream");
+}
+
+/**
+ * @brief Parse a single byte range
+ *
+ * @return 1 if a range was parsed, 0 to serve the whole file, -1 if it
+ *         cannot be satisfied
+ */
+static int parse_range(const struct mg_str *header, off_t size, off_t *start, off_t *end) {
+    char value[128];
+    if (header->len >= sizeof(value)) {
+        return 0;
+    }
+    memcpy(value, header->buf, header->len);
+    value[header->len] = '\0';
+
+    // Multiple ranges are not supported, the whole file is sent instead
+    if (strncmp(value, "bytes=", 6) != 0 || strchr(value, ',')) {
+        return 0;
+    }
+
+    const char *spec = value + 6;
+    char *dash = strchr(spec, '-');
+    if (!dash) {
+        return 0;
+    }
+
+    char *endp;
+    if (dash == spec) {
+        // Suffix range: the last N bytes
+        long long suffix = strtoll(dash + 1, &endp, 10);
+        if (endp == dash + 1 || suffix <= 0) {
+            return -1;
+        }
+        *start = suffix >= (long long)size ? 0 : size - (off_t)suffix;
+        *end = size - 1;
+    } else {
+        long long first = strtoll(spec, &endp, 10);
+        if (endp != dash || first < 0) {
+            return 0;
+        }
+        *start = (off_t)first;
+        *end = size - 1;
+        if (dash[1] != '\0') {
+            long long last = strtoll(dash + 1, &endp, 10);
+            if (last < first) {
+                return 0;
+            }
+            if (last < (long long)size - 1) {
+                *end = (off_t)last;
+            }
+        }
+    }
+
+    return *start < size ? 1 : -1;
+}
+
+/**
+ * @brief Hand the connection back to Mongoose's HTTP handler
+ */
+static void sendfile_finish(struct mg_connection *c) {
+    sendfile_state_t *state = (sendfile_state_t *)c->pfn_data;
+
+    c->pfn = state->saved_pfn;
+    c->pfn_data = state->saved_pfn_data;
+    c->is_resp = 0;
+
+    close(state->file_fd);
+    free(state);
+}
+
+/**
+ * @brief Protocol handler that sends the file body
+ */
+static void sendfile_cb(struct mg_connection *c, int ev, void *ev_data) {
+    (void)ev_data;
+    sendfile_state_t *state = (sendfile_state_t *)c->pfn_data;
+
+    if (ev == MG_EV_POLL || ev == MG_EV_WRITE) {
+        // The headers go out through Mongoose's send buffer first
+        if (c->send.len > 0 || c->is_closing) {
+            return;
+        }
+
+        int sock = (int)(size_t)c->fd;
+        size_t budget = MG_SENDFILE_MAX_PER_POLL;
+
+        while (state->remaining > 0 && budget > 0) {
+            size_t chunk = MG_SENDFILE_CHUNK_SIZE;
+            if ((off_t)chunk > state->remaining) {
+                chunk = (size_t)state->remaining;
+            }
+            if (chunk > budget) {
+                chunk = budget;
+            }
+
+            ssize_t n = sendfile(sock, state->file_fd, &state->offset, chunk);
+            if (n > 0) {
+                state->remaining -= n;
+                budget -= (size_t)n;
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n < 0 && errno == EAGAIN) {
+                // Socket buffer is full, carry on at the next poll
+                return;
+            }
+
+            // The file shrank or the socket failed; the promised length
+            // cannot be delivered, so the connection has to go
+            log_warn("sendfile stopped with %lld bytes left: %s",
+                     (long long)state->remaining, n < 0 ? strerror(errno) : "end of file");
+            c->is_closing = 1;
+            return;
+        }
+
+        if (state->remaining == 0) {
+            sendfile_finish(c);
+        }
+    } else if (ev == MG_EV_CLOSE) {
+        close(state->file_fd);
+        free(state);
+        c->pfn = NULL;
+        c->pfn_data = NULL;
+    }
+}
+
+/**
+ * @brief Serve a file, copying the body straight from the page cache
+ */
+void mg_http_sendfile(struct mg_connection *c, struct mg_http_message *hm,
+                      const char *path, const struct mg_http_serve_opts *opts) {
+    // sendfile would bypass the TLS layer
+    if (c->is_tls) {
+        mg_http_serve_file(c, hm, path, opts);
+        return;
+    }
+
+    const char *extra_headers = opts && opts->extra_headers ? opts->extra_headers : "";
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        mg_http_reply(c, 404, extra_headers, "Not found\n");
+        return;
+    }
+
+    char etag[64];
+    snprintf(etag, sizeof(etag), "\"%lld.%lld\"", (long long)st.st_mtime, (long long)st.st_size);
+
+    struct mg_str *inm = hm ? mg_http_get_header(hm, "If-None-Match") : NULL;
+    if (inm && inm->len == strlen(etag) && strncmp(inm->buf, etag, inm->len) == 0) {
+        close(fd);
+        mg_http_reply(c, 304, extra_headers, "");
+        return;
+    }
+
+    off_t size = st.st_size;
+    off_t start = 0;
+    off_t end = size - 1;
+    int status = 200;
+    char range_header[128] = "";
+
+    struct mg_str *range = hm ? mg_http_get_header(hm, "Range") : NULL;
+    if (range) {
+        int result = parse_range(range, size, &start, &end);
+        if (result < 0) {
+            close(fd);
+            snprintf(range_header, sizeof(range_header), "Content-Range: bytes */%lld\r\n", (long long)size);
+            mg_printf(c, "HTTP/1.1 416 Range Not Satisfiable\r\n%sContent-Length: 0\r\n%s\r\n",
+                      range_header, extra_headers);
+            c->is_resp = 0;
+            return;
+        }
+        if (result > 0) {
+            status = 206;
+            snprintf(range_header, sizeof(range_header), "Content-Range: bytes %lld-%lld/%lld\r\n",
+                     (long long)start, (long long)end, (long long)size);
+        }
+    }
+
+    off_t length = size > 0 ? end - start + 1 : 0;
+
+    char content_type[128] = "";
+    if (!has_header(extra_headers, "Content-Type")) {
+        char type[96];
+        get_content_type(path, opts ? opts->mime_types : NULL, type, sizeof(type));
+        snprintf(content_type, sizeof(content_type), "Content-Type: %s\r\n", type);
+    }
+
+    mg_printf(c,
+              "HTTP/1.1 %d %s\r\n"
+              "%s"
+              "Etag: %s\r\n"
+              "Content-Length: %lld\r\n"
+              "%s"
+              "%s"
+              "%s\r\n",
+              status, status == 206 ? "Partial Content" : "OK",
+              content_type, etag, (long long)length, range_header,
+              has_header(extra_headers, "Accept-Ranges") ? "" : "Accept-Ranges: bytes\r\n",
+              extra_headers);
+
+    if ((hm && mg_strcasecmp(hm->method, mg_str("HEAD")) == 0) || length == 0) {
+        close(fd);
+        c->is_resp = 0;
+        return;
+    }
+
+    sendfile_state_t *state = malloc(sizeof(sendfile_state_t));
+    if (!state) {
+        // Headers are already queued, so the connection cannot be reused
+        log_error("Failed to allocate sendfile state for %s", path);
+        close(fd);
+        c->is_draining = 1;
+        return;
+    }
+
+    state->file_fd = fd;
+    state->offset = start;
+    state->remaining = length;
+    state->saved_pfn = c->pfn;
+    state->saved_pfn_data = c->pfn_data;
+
+    c->pfn = sendfile_cb;
+    c->pfn_data = state;
+    c->is_resp = 1;
+
+    log_debug("Sending %s with sendfile (%lld bytes from offset %lld)",
+              path, (long long)length, (long long)start);
+}
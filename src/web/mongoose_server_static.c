@@ -8,6 +8,8 @@
 #include "web/mongoose_server_static.h"
 #include "web/mongoose_adapter.h"
 #include "web/mongoose_server_auth.h"
+#include "web/mongoose_server_sendfile.h"
+#include "web/web_asset_pack.h"
 #include "core/logger.h"
 #include "core/config.h"
 #include "video/streams.h"
@@ -203,7 +205,7 @@ void mongoose_server_handle_static_file(struct mg_connection *c, struct mg_http_
                 "Access-Control-Allow-Headers: Origin, Content-Type, Accept, Authorization\r\n",
                 content_type_header, cache_control);
             
-            mg_http_serve_file(c, hm, hls_file_path, &(struct mg_http_serve_opts){
+            mg_http_sendfile(c, hm, hls_file_path, &(struct mg_http_serve_opts){
                 .mime_types = "",
                 .extra_headers = headers
             });
@@ -220,6 +222,11 @@ void mongoose_server_handle_static_file(struct mg_connection *c, struct mg_http_
         }
     }
 
+    // Files in the asset pack are answered from memory
+    if (web_asset_pack_serve(c, hm, uri)) {
+        return;
+    }
+
     // Special handling for root path
     if (strcmp(uri, "/") == 0) {
         // Directly serve index.html for root path
@@ -256,8 +263,9 @@ void mongoose_server_handle_static_file(struct mg_connection *c, struct mg_http_
             mg_http_reply(c, 404, "", "404 Not Found - Index file missing\n");
             return;
         }
-    } else {
+    } else if (!web_asset_pack_loaded()) {
         // For non-root paths, construct file path
+        // With an asset pack loaded it holds the whole UI, so the disk is not checked
         char file_path[MAX_PATH_LENGTH * 2];
         snprintf(file_path, sizeof(file_path), "%s%s", server->config.web_root, uri);
 
@@ -489,6 +497,10 @@ auth_success:
         }
 
         // For SPA routes, directly serve index.html without redirection
+        if (web_asset_pack_serve(c, hm, "/index.html")) {
+            return;
+        }
+
         char index_path[MAX_PATH_LENGTH * 2];
         snprintf(index_path, sizeof(index_path), "%s/index.html", server->config.web_root);
         
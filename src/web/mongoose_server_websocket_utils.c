@@ -4,6 +4,7 @@
 
 #include "web/websocket_bridge.h"
 #include "web/websocket_client.h"
+#include "web/mongoose_server_reactor.h"
 #include "core/logger.h"
 #include "mongoose.h"
 
@@ -54,11 +55,9 @@ bool mg_websocket_message_send_to_client(const char *client_id, const char *mess
         return false;
     }
     
-    // Send message directly using mongoose
+    // Hand the message to the event loop that owns the connection
     size_t len = strlen(message);
-    mg_ws_send(conn, message, len, WEBSOCKET_OP_TEXT);
-    
-    return true;
+    return mg_reactor_ws_send(conn, message, len);
 }
 
 /**
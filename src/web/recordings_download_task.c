@@ -15,6 +15,7 @@
 #include "web/recordings_download_task.h"
 #include "web/mongoose_adapter.h"
 #include "web/mongoose_server_auth.h"
+#include "web/mongoose_server_sendfile.h"
 #include "web/http_server.h"
 #include "web/api_handlers.h"
 #include "core/logger.h"
@@ -142,8 +143,8 @@ void mg_handle_download_recording(struct mg_connection *c, struct mg_http_messag
         .extra_headers = headers
     };
     
-    log_debug("Serving file directly using mg_http_serve_file: %s", recording.file_path);
-    mg_http_serve_file(c, hm, recording.file_path, &opts);
+    log_debug("Serving file directly using mg_http_sendfile: %s", recording.file_path);
+    mg_http_sendfile(c, hm, recording.file_path, &opts);
     
     log_info("Successfully handled GET /api/recordings/download/%llu request", (unsigned long long)id);
 }
@@ -22,6 +22,7 @@
 #include "database/database_manager.h"
 #include "database/db_recordings.h"
 #include "web/mongoose_server_multithreading.h"
+#include "web/mongoose_server_sendfile.h"
 
 /**
  * @brief Create a playback recording task
@@ -198,9 +199,9 @@ void playback_recording_task_function(void *arg) {
         log_info("Range request: %s", task->range_header);
     }
 
-    // Let Mongoose handle the file serving, including range requests
-    log_info("Serving file using Mongoose's built-in file server");
-    mg_http_serve_file(c, task->hm, recording.file_path, &opts);
+    // Serve the file with sendfile, including range requests
+    log_info("Serving file with sendfile");
+    mg_http_sendfile(c, task->hm, recording.file_path, &opts);
 
     log_info("File serving initiated");
 
@@ -229,16 +230,15 @@ static struct {
 static void init_active_requests(void) {
     static bool initialized = false;
     
+    // Checked under the mutex, handlers on several event loops may get here at once
+    pthread_mutex_lock(&g_playback_mutex);
+    
     if (!initialized) {
-        pthread_mutex_lock(&g_playback_mutex);
-        
-        if (!initialized) {
-            memset(g_active_requests, 0, sizeof(g_active_requests));
-            initialized = true;
-        }
-        
-        pthread_mutex_unlock(&g_playback_mutex);
+        memset(g_active_requests, 0, sizeof(g_active_requests));
+        initialized = true;
     }
+    
+    pthread_mutex_unlock(&g_playback_mutex);
 }
 
 // Check if a request is already being processed
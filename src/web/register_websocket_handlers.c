@@ -7,6 +7,9 @@
 #include "web/websocket_manager.h"
 #include "web/api_handlers_recordings_batch_ws.h"
 #include "web/api_handlers_system_ws.h"
+#include "web/api_handlers_detection_ws.h"
+#include "web/system_status.h"
+#include "database/db_backup.h"
 #include "core/logger.h"
 
 /**
@@ -28,5 +31,18 @@ void websocket_register_handlers(void) {
     // Register system logs handler
     websocket_handler_register("system/logs", websocket_handle_system_logs);
     
+    // Register database backup progress handler
+    websocket_handler_register("system/backup", websocket_handle_system_backup);
+    set_backup_progress_callback(system_backup_progress_ws, NULL);
+    
+    // A client that falls behind only needs the latest backup progress
+    websocket_manager_set_topic_policy("system/backup", WS_TOPIC_POLICY_COALESCE);
+    
+    // Register live detection results, one topic per stream under detection/live
+    detection_ws_init();
+    
+    // Register system status updates pushed by the sampler
+    system_status_ws_init();
+    
     log_info("WebSocket handlers registered");
 }
@@ -0,0 +1,936 @@
+/**
+ * @file system_status.c
+ * @brief Background sampler behind GET /api/system/info
+ *
+ * System info used to be gathered on every request: /proc reads, go2rtc
+ * lookups, database counts and two `du` runs over the whole archive. A
+ * thread now samples it on its own schedule and renders a snapshot that
+ * requests are answered from, with an ETag, and that is pushed to
+ * WebSocket subscribers whenever it changes.
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <ftw.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include <sys/sysinfo.h>
+#include <sys/statvfs.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+
+#include "cJSON.h"
+#include "web/system_status.h"
+#include "web/websocket_manager.h"
+#include "web/websocket_client.h"
+#include "web/mongoose_server_multithreading.h"
+#include "web/mongoose_server_reactor.h"
+#include "core/logger.h"
+#include "core/config.h"
+#include "core/version.h"
+#include "database/db_streams.h"
+#include "database/db_recordings.h"
+#include "database/db_checkpoint.h"
+#include "storage/storage_manager.h"
+#include "storage/storage_tiering.h"
+
+// External function from api_handlers_system_go2rtc.c
+extern bool get_go2rtc_memory_usage(unsigned long long *memory_usage);
+
+// Sampler state
+static struct {
+    pthread_t thread;
+    bool running;
+    system_status_snapshot_t *snapshot;     // Latest published snapshot
+    uint64_t snapshot_hash;
+    uint64_t snapshot_stable_hash;          // Hash without the gauges
+    time_t snapshot_published;              // Monotonic seconds
+    pthread_mutex_t mutex;                  // Guards running and snapshot
+    pthread_cond_t cond;
+
+    // Everything below belongs to whoever holds sample_mutex
+    pthread_mutex_t sample_mutex;
+    unsigned long long cpu_total;           // /proc/stat counters of the previous sample
+    unsigned long long cpu_active;
+    double cpu_usage;
+    time_t slow_sampled;                    // Monotonic seconds, 0 for never
+    unsigned long long go2rtc_used;
+    int enabled_streams;
+    int recording_count;
+    cJSON *interfaces;
+    time_t storage_walked;                  // Monotonic seconds, 0 for never
+    bool storage_measured;                  // Whether a walk has succeeded
+    unsigned long long storage_used;
+} sampler = {
+    .running = false,
+    .snapshot = NULL,
+    .mutex = PTHREAD_MUTEX_INITIALIZER,
+    .cond = PTHREAD_COND_INITIALIZER,
+    .sample_mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+// Bytes counted by the storage walk in progress
+static unsigned long long walk_bytes;
+
+/**
+ * @brief Seconds on the monotonic clock
+ */
+static time_t monotonic_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec;
+}
+
+// Members that move on almost every sample. A change to them alone is
+// published at most every SYSTEM_STATUS_SLOW_INTERVAL, so the ETag holds
+// and subscribers are not pushed a new document every second.
+static const char *gauge_members[] = {
+    "cpu",
+    "memory",
+    "go2rtcMemory",
+    "systemMemory",
+    "uptime",
+    "disk",
+    "systemDisk",
+    "database",
+    "workerPool",
+    NULL
+};
+
+/**
+ * @brief FNV-1a hash of a rendered snapshot
+ */
+static uint64_t hash_json(const char *json, size_t len) {
+    uint64_t hash = UINT64_C(14695981039346656037);
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (unsigned char)json[i];
+        hash *= UINT64_C(1099511628211);
+    }
+    return hash;
+}
+
+/**
+ * @brief Update CPU usage from the /proc/stat counters
+ *
+ * Usage is measured over the time since the previous sample; the first
+ * sample reports the average since boot.
+ */
+static void sample_cpu(void) {
+    FILE *fp = fopen("/proc/stat", "r");
+    if (!fp) {
+        return;
+    }
+
+    unsigned long long user, nice, system, idle, iowait, irq, softirq;
+    if (fscanf(fp, "cpu %llu %llu %llu %llu %llu %llu %llu",
+               &user, &nice, &system, &idle, &iowait, &irq, &softirq) == 7) {
+        unsigned long long total = user + nice + system + idle + iowait + irq + softirq;
+        unsigned long long active = user + nice + system + irq + softirq;
+
+        unsigned long long total_delta = total - sampler.cpu_total;
+        unsigned long long active_delta = active - sampler.cpu_active;
+        if (total_delta > 0) {
+            sampler.cpu_usage = (double)active_delta / (double)total_delta * 100.0;
+        }
+
+        sampler.cpu_total = total;
+        sampler.cpu_active = active;
+    }
+    fclose(fp);
+}
+
+/**
+ * @brief Get the resident memory of this process in bytes
+ */
+static unsigned long long get_process_rss(void) {
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (!fp) {
+        return 0;
+    }
+
+    unsigned long vm_rss = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (strncmp(line, "VmRSS:", 6) == 0) {
+            // VmRSS is in kB - actual physical memory used
+            sscanf(line + 6, "%lu", &vm_rss);
+            break;
+        }
+    }
+    fclose(fp);
+
+    return (unsigned long long)vm_rss * 1024;
+}
+
+/**
+ * @brief Get the uptime of this process in seconds
+ *
+ * @return Uptime, or -1 if it cannot be determined
+ */
+static double get_process_uptime(void) {
+    FILE *stat_file = fopen("/proc/self/stat", "r");
+    if (!stat_file) {
+        return -1;
+    }
+
+    // The process start time is the 22nd field, in clock ticks since boot.
+    // The command name may contain spaces, so parse from its closing paren.
+    char line[1024];
+    unsigned long long starttime = 0;
+    bool found = false;
+    if (fgets(line, sizeof(line), stat_file)) {
+        char *p = strrchr(line, ')');
+        found = p && sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %*u %*u "
+                                   "%*d %*d %*d %*d %*d %*d %llu", &starttime) == 1;
+    }
+    fclose(stat_file);
+
+    double system_uptime = 0;
+    FILE *uptime_file = fopen("/proc/uptime", "r");
+    if (uptime_file) {
+        if (fscanf(uptime_file, "%lf", &system_uptime) != 1) {
+            system_uptime = 0;
+        }
+        fclose(uptime_file);
+    }
+
+    if (!found || system_uptime <= 0) {
+        return -1;
+    }
+
+    return system_uptime - ((double)starttime / (double)sysconf(_SC_CLK_TCK));
+}
+
+/**
+ * @brief Read the MAC address of an interface
+ */
+static void read_interface_mac(const char *name, char *mac, size_t size) {
+    char mac_path[256];
+    snprintf(mac_path, sizeof(mac_path), "/sys/class/net/%s/address", name);
+    FILE *mac_file = fopen(mac_path, "r");
+    if (mac_file) {
+        if (fgets(mac, (int)size, mac_file)) {
+            // Remove newline
+            mac[strcspn(mac, "\n")] = 0;
+        }
+        fclose(mac_file);
+    }
+}
+
+/**
+ * @brief List the network interfaces with an IPv4 address
+ */
+static cJSON *sample_interfaces(void) {
+    cJSON *interfaces = cJSON_CreateArray();
+    if (!interfaces) {
+        return NULL;
+    }
+
+    struct ifaddrs *ifaddr, *ifa;
+    char host[NI_MAXHOST];
+
+    if (getifaddrs(&ifaddr) == 0) {
+        for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
+            // Skip interfaces without an IPv4 address and loopback
+            if (ifa->ifa_addr == NULL || ifa->ifa_addr->sa_family != AF_INET ||
+                strcmp(ifa->ifa_name, "lo") == 0) {
+                continue;
+            }
+
+            if (getnameinfo(ifa->ifa_addr, sizeof(struct sockaddr_in),
+                            host, NI_MAXHOST, NULL, 0, NI_NUMERICHOST) != 0) {
+                continue;
+            }
+
+            // Only the first address of each interface is listed
+            bool found = false;
+            for (int i = 0; i < cJSON_GetArraySize(interfaces); i++) {
+                cJSON *name_obj = cJSON_GetObjectItem(cJSON_GetArrayItem(interfaces, i), "name");
+                if (name_obj && name_obj->valuestring && strcmp(name_obj->valuestring, ifa->ifa_name) == 0) {
+                    found = true;
+                    break;
+                }
+            }
+            if (found) {
+                continue;
+            }
+
+            cJSON *iface = cJSON_CreateObject();
+            if (iface) {
+                char mac[128] = "Unknown";
+                read_interface_mac(ifa->ifa_name, mac, sizeof(mac));
+
+                cJSON_AddStringToObject(iface, "name", ifa->ifa_name);
+                cJSON_AddStringToObject(iface, "address", host);
+                cJSON_AddStringToObject(iface, "mac", mac);
+                cJSON_AddBoolToObject(iface, "up", (ifa->ifa_flags & IFF_UP) != 0);
+                cJSON_AddItemToArray(interfaces, iface);
+            }
+        }
+
+        freeifaddrs(ifaddr);
+        return interfaces;
+    }
+
+    // Fallback to /proc/net/dev if getifaddrs fails
+    FILE *fp = fopen("/proc/net/dev", "r");
+    if (!fp) {
+        return interfaces;
+    }
+
+    char line[256];
+    // Skip header lines
+    if (!fgets(line, sizeof(line), fp) || !fgets(line, sizeof(line), fp)) {
+        fclose(fp);
+        return interfaces;
+    }
+
+    while (fgets(line, sizeof(line), fp)) {
+        char *saveptr = NULL;
+        char *name = strtok_r(line, ":", &saveptr);
+        if (!name) {
+            continue;
+        }
+
+        // Trim whitespace
+        while (*name == ' ') name++;
+
+        // Skip loopback
+        if (strcmp(name, "lo") == 0) {
+            continue;
+        }
+
+        cJSON *iface = cJSON_CreateObject();
+        if (!iface) {
+            continue;
+        }
+
+        cJSON_AddStringToObject(iface, "name", name);
+
+        // Try to get IP address using ip command
+        char ip_cmd[256];
+        char ip_addr[128] = "Unknown";
+        snprintf(ip_cmd, sizeof(ip_cmd), "ip -4 addr show %s | grep -oP '(?<=inet\\s)\\d+(\\.\\d+){3}'", name);
+        FILE *ip_fp = popen(ip_cmd, "r");
+        if (ip_fp) {
+            if (fgets(ip_addr, sizeof(ip_addr), ip_fp)) {
+                // Remove newline
+                ip_addr[strcspn(ip_addr, "\n")] = 0;
+            }
+            pclose(ip_fp);
+        }
+        cJSON_AddStringToObject(iface, "address", ip_addr);
+
+        char mac[128] = "Unknown";
+        read_interface_mac(name, mac, sizeof(mac));
+        cJSON_AddStringToObject(iface, "mac", mac);
+
+        // Check if interface is up
+        char flags_path[256];
+        snprintf(flags_path, sizeof(flags_path), "/sys/class/net/%s/flags", name);
+        FILE *flags_file = fopen(flags_path, "r");
+        bool is_up = false;
+        if (flags_file) {
+            unsigned int flags;
+            if (fscanf(flags_file, "%x", &flags) == 1) {
+                is_up = (flags & 1) != 0; // IFF_UP is 0x1
+            }
+            fclose(flags_file);
+        }
+        cJSON_AddBoolToObject(iface, "up", is_up);
+
+        cJSON_AddItemToArray(interfaces, iface);
+    }
+    fclose(fp);
+
+    return interfaces;
+}
+
+/**
+ * @brief Refresh the values that need a database query, a process lookup
+ *        or an interface scan
+ */
+static void sample_slow(void) {
+    unsigned long long go2rtc_used = 0;
+    if (get_go2rtc_memory_usage(&go2rtc_used)) {
+        log_debug("go2rtc memory usage: %llu bytes", go2rtc_used);
+    }
+    sampler.go2rtc_used = go2rtc_used;
+
+    sampler.enabled_streams = get_enabled_stream_count();
+
+    // All recordings, regardless of time, stream or detection status
+    int recording_count = get_recording_count(0, 0, NULL, 0);
+    if (recording_count < 0) {
+        log_error("Failed to get recording count from database");
+        recording_count = 0;
+    }
+    sampler.recording_count = recording_count;
+
+    cJSON *interfaces = sample_interfaces();
+    if (interfaces) {
+        cJSON_Delete(sampler.interfaces);
+        sampler.interfaces = interfaces;
+    }
+}
+
+/**
+ * @brief Add a regular file to the storage walk
+ */
+static int count_file_bytes(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)path;
+    (void)ftw;
+
+    if (type == FTW_F) {
+        walk_bytes += (unsigned long long)st->st_size;
+    }
+    return 0;
+}
+
+/**
+ * @brief Measure the space used by the storage directory
+ *
+ * Walks the directory in process instead of running `du`; only done every
+ * SYSTEM_STATUS_STORAGE_INTERVAL seconds since it touches every recording.
+ */
+static void sample_storage(void) {
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    // A failed walk is not retried before the next interval either
+    sampler.storage_walked = start.tv_sec;
+
+    walk_bytes = 0;
+    if (nftw(g_config.storage_path, count_file_bytes, 32, FTW_PHYS | FTW_MOUNT) != 0) {
+        log_warn("Failed to walk storage directory %s", g_config.storage_path);
+        return;
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    sampler.storage_used = walk_bytes;
+    sampler.storage_measured = true;
+
+    log_debug("Storage directory uses %llu bytes (walked in %ld ms)", sampler.storage_used,
+              (long)((end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000));
+}
+
+/**
+ * @brief Add storage usage and the fill prediction
+ */
+static void add_disk(cJSON *info) {
+    struct statvfs disk_info;
+    if (statvfs(g_config.storage_path, &disk_info) != 0) {
+        return;
+    }
+
+    cJSON *disk = cJSON_CreateObject();
+    if (disk) {
+        unsigned long long total = (unsigned long long)disk_info.f_blocks * disk_info.f_frsize;
+        unsigned long long free = (unsigned long long)disk_info.f_bfree * disk_info.f_frsize;
+
+        // Until the first walk finishes, report the whole filesystem
+        unsigned long long used = sampler.storage_measured ? sampler.storage_used :
+                                  (unsigned long long)(disk_info.f_blocks - disk_info.f_bfree) * disk_info.f_frsize;
+
+        cJSON_AddNumberToObject(disk, "total", total);
+        cJSON_AddNumberToObject(disk, "used", used);
+        cJSON_AddNumberToObject(disk, "free", free);
+
+        // Add fill prediction based on current recording write rates
+        storage_prediction_t prediction;
+        if (get_storage_prediction(&prediction) == 0) {
+            cJSON *pred = cJSON_CreateObject();
+            if (pred) {
+                cJSON_AddNumberToObject(pred, "writeRate", (double)prediction.total_write_rate);
+                cJSON_AddNumberToObject(pred, "headroom", (double)prediction.headroom_bytes);
+                cJSON_AddNumberToObject(pred, "secondsToFull", (double)prediction.seconds_to_full);
+                cJSON_AddNumberToObject(pred, "updatedAt", (double)prediction.updated_at);
+
+                cJSON *streams = cJSON_CreateArray();
+                if (streams) {
+                    stream_write_rate_t rates[MAX_TRACKED_STREAMS];
+                    int rate_count = get_stream_write_rates(rates, MAX_TRACKED_STREAMS);
+                    for (int i = 0; i < rate_count; i++) {
+                        cJSON *stream_rate = cJSON_CreateObject();
+                        if (stream_rate) {
+                            cJSON_AddStringToObject(stream_rate, "name", rates[i].stream_name);
+                            cJSON_AddNumberToObject(stream_rate, "writeRate", (double)rates[i].write_rate);
+                            cJSON_AddItemToArray(streams, stream_rate);
+                        }
+                    }
+                    cJSON_AddItemToObject(pred, "streams", streams);
+                }
+
+                cJSON_AddItemToObject(disk, "prediction", pred);
+            }
+        }
+
+        // Add the cold tier, if recordings are moved to one
+        char cold_path[256];
+        storage_tiering_stats_t tiering_stats;
+        if (get_storage_tiering_cold_path(cold_path, sizeof(cold_path)) &&
+            get_storage_tiering_stats(&tiering_stats) == 0) {
+            cJSON *tiering = cJSON_CreateObject();
+            if (tiering) {
+                cJSON_AddBoolToObject(tiering, "enabled", tiering_stats.enabled);
+                cJSON_AddNumberToObject(tiering, "migratedRecordings", (double)tiering_stats.migrated_recordings);
+                cJSON_AddNumberToObject(tiering, "migratedBytes", (double)tiering_stats.migrated_bytes);
+                cJSON_AddNumberToObject(tiering, "failedMigrations", (double)tiering_stats.failed_migrations);
+                cJSON_AddNumberToObject(tiering, "lastPass", (double)tiering_stats.last_pass_time);
+
+                struct statvfs cold_info;
+                if (statvfs(cold_path, &cold_info) == 0) {
+                    cJSON_AddNumberToObject(tiering, "total", (double)cold_info.f_blocks * cold_info.f_frsize);
+                    cJSON_AddNumberToObject(tiering, "free", (double)cold_info.f_bfree * cold_info.f_frsize);
+                }
+
+                cJSON_AddItemToObject(disk, "tiering", tiering);
+            }
+        }
+
+        cJSON_AddItemToObject(info, "disk", disk);
+    }
+
+    cJSON *system_disk = cJSON_CreateObject();
+    if (system_disk) {
+        struct statvfs root_disk_info;
+        if (statvfs("/", &root_disk_info) == 0) {
+            unsigned long long total = (unsigned long long)root_disk_info.f_blocks * root_disk_info.f_frsize;
+            unsigned long long free = (unsigned long long)root_disk_info.f_bfree * root_disk_info.f_frsize;
+
+            cJSON_AddNumberToObject(system_disk, "total", total);
+            cJSON_AddNumberToObject(system_disk, "used", total - free);
+            cJSON_AddNumberToObject(system_disk, "free", free);
+        }
+
+        cJSON_AddItemToObject(info, "systemDisk", system_disk);
+    }
+}
+
+/**
+ * @brief Add a total/used/free memory object
+ */
+static void add_memory_object(cJSON *info, const char *name, unsigned long long total,
+                              unsigned long long used) {
+    cJSON *memory = cJSON_CreateObject();
+    if (memory) {
+        cJSON_AddNumberToObject(memory, "total", total);
+        cJSON_AddNumberToObject(memory, "used", used);
+        cJSON_AddNumberToObject(memory, "free", total > used ? total - used : 0);
+        cJSON_AddItemToObject(info, name, memory);
+    }
+}
+
+/**
+ * @brief Render the system info document from the sampled values
+ */
+static cJSON *build_info(void) {
+    cJSON *info = cJSON_CreateObject();
+    if (!info) {
+        return NULL;
+    }
+
+    cJSON_AddStringToObject(info, "version", LIGHTNVR_VERSION_STRING);
+
+    struct utsname system_info;
+    if (uname(&system_info) == 0) {
+        cJSON *cpu = cJSON_CreateObject();
+        if (cpu) {
+            cJSON_AddStringToObject(cpu, "model", system_info.machine);
+            cJSON_AddNumberToObject(cpu, "cores", sysconf(_SC_NPROCESSORS_ONLN));
+            cJSON_AddNumberToObject(cpu, "usage", sampler.cpu_usage);
+            cJSON_AddItemToObject(info, "cpu", cpu);
+        }
+    }
+
+    // LightNVR and go2rtc are shown against the system total, which makes
+    // their usage simpler to understand
+    unsigned long long system_total = 0;
+    unsigned long long system_free = 0;
+    struct sysinfo sys_info;
+    bool have_sysinfo = sysinfo(&sys_info) == 0;
+    if (have_sysinfo) {
+        system_total = (unsigned long long)sys_info.totalram * sys_info.mem_unit;
+        system_free = (unsigned long long)sys_info.freeram * sys_info.mem_unit;
+    }
+
+    add_memory_object(info, "memory", system_total, get_process_rss());
+    add_memory_object(info, "go2rtcMemory", system_total, sampler.go2rtc_used);
+    add_memory_object(info, "systemMemory", system_total, system_total - system_free);
+
+    // Fallback to system uptime if process uptime can't be determined
+    double uptime = get_process_uptime();
+    if (uptime >= 0) {
+        // Whole seconds, the fraction is noise
+        cJSON_AddNumberToObject(info, "uptime", (double)(long long)uptime);
+    } else if (have_sysinfo) {
+        cJSON_AddNumberToObject(info, "uptime", sys_info.uptime);
+    }
+
+    add_disk(info);
+
+    cJSON *network = cJSON_CreateObject();
+    if (network) {
+        cJSON *interfaces = sampler.interfaces ? cJSON_Duplicate(sampler.interfaces, 1) : cJSON_CreateArray();
+        if (interfaces) {
+            cJSON_AddItemToObject(network, "interfaces", interfaces);
+        }
+        cJSON_AddItemToObject(info, "network", network);
+    }
+
+    cJSON *streams_obj = cJSON_CreateObject();
+    if (streams_obj) {
+        cJSON_AddNumberToObject(streams_obj, "active", sampler.enabled_streams);
+        cJSON_AddNumberToObject(streams_obj, "total", g_config.max_streams);
+        cJSON_AddItemToObject(info, "streams", streams_obj);
+    }
+
+    // Recordings live in the storage directory, so its walk gives their size
+    cJSON *recordings = cJSON_CreateObject();
+    if (recordings) {
+        cJSON_AddNumberToObject(recordings, "count", sampler.recording_count);
+        cJSON_AddNumberToObject(recordings, "size", sampler.storage_used);
+        cJSON_AddItemToObject(info, "recordings", recordings);
+    }
+
+    cJSON *database = cJSON_CreateObject();
+    if (database) {
+        db_checkpoint_stats_t checkpoint_stats;
+        db_checkpoint_get_stats(&checkpoint_stats);
+
+        cJSON_AddNumberToObject(database, "walSize", (double)checkpoint_stats.wal_bytes);
+        cJSON_AddNumberToObject(database, "walFrames", checkpoint_stats.wal_frames);
+        cJSON_AddNumberToObject(database, "passiveCheckpoints", (double)checkpoint_stats.passive_count);
+        cJSON_AddNumberToObject(database, "truncateCheckpoints", (double)checkpoint_stats.truncate_count);
+        cJSON_AddNumberToObject(database, "busyCheckpoints", (double)checkpoint_stats.busy_count);
+        cJSON_AddNumberToObject(database, "lastCheckpointMs", checkpoint_stats.last_duration_ms);
+        cJSON_AddNumberToObject(database, "maxCheckpointMs", checkpoint_stats.max_duration_ms);
+        cJSON_AddNumberToObject(database, "lastCheckpoint", (double)checkpoint_stats.last_checkpoint);
+
+        cJSON_AddItemToObject(info, "database", database);
+    }
+
+    cJSON *workers = cJSON_CreateObject();
+    if (workers) {
+        mg_worker_pool_stats_t pool_stats;
+        mg_worker_pool_get_stats(&pool_stats);
+
+        cJSON_AddNumberToObject(workers, "threads", pool_stats.threads);
+        cJSON_AddNumberToObject(workers, "active", pool_stats.active);
+        cJSON_AddNumberToObject(workers, "queued", pool_stats.queued);
+        cJSON_AddNumberToObject(workers, "completed", (double)pool_stats.completed);
+        cJSON_AddNumberToObject(workers, "rejected", (double)pool_stats.rejected);
+        cJSON_AddNumberToObject(workers, "avgQueueMs", pool_stats.avg_queue_ms);
+        cJSON_AddNumberToObject(workers, "maxQueueMs", pool_stats.max_queue_ms);
+
+        cJSON_AddItemToObject(info, "workerPool", workers);
+    }
+
+    cJSON_AddNumberToObject(info, "eventLoops", mg_reactor_count());
+
+    return info;
+}
+
+/**
+ * @brief Push a snapshot to the WebSocket subscribers
+ */
+static void publish_snapshot(const system_status_snapshot_t *snapshot) {
+    if (!websocket_client_topic_has_subscribers(SYSTEM_STATUS_WS_TOPIC)) {
+        return;
+    }
+
+    static const char prefix[] = "{\"type\":\"status\",\"topic\":\"" SYSTEM_STATUS_WS_TOPIC "\",\"payload\":";
+    size_t len = sizeof(prefix) - 1 + snapshot->len + 1;
+    char *message = malloc(len + 1);
+    if (!message) {
+        log_error("Failed to allocate system status message");
+        return;
+    }
+
+    memcpy(message, prefix, sizeof(prefix) - 1);
+    memcpy(message + sizeof(prefix) - 1, snapshot->json, snapshot->len);
+    message[len - 1] = '}';
+    message[len] = '\0';
+
+    websocket_manager_publish(SYSTEM_STATUS_WS_TOPIC, message, len);
+    free(message);
+}
+
+/**
+ * @brief Take a sample and publish it if anything changed
+ *
+ * Called with sample_mutex held.
+ *
+ * @param walk_storage Whether the storage directory may be walked
+ */
+static void take_sample(bool walk_storage) {
+    time_t now = monotonic_seconds();
+
+    sample_cpu();
+
+    if (sampler.slow_sampled == 0 || now - sampler.slow_sampled >= SYSTEM_STATUS_SLOW_INTERVAL) {
+        sample_slow();
+        sampler.slow_sampled = now;
+    }
+
+    if (walk_storage && (sampler.storage_walked == 0 ||
+                         now - sampler.storage_walked >= SYSTEM_STATUS_STORAGE_INTERVAL)) {
+        sample_storage();
+    }
+
+    cJSON *info = build_info();
+    char *json = info ? cJSON_PrintUnformatted(info) : NULL;
+    if (!json) {
+        log_error("Failed to render system status");
+        cJSON_Delete(info);
+        return;
+    }
+
+    size_t len = strlen(json);
+    uint64_t hash = hash_json(json, len);
+
+    // Hash the rest again to tell real changes from gauges moving
+    for (int i = 0; gauge_members[i]; i++) {
+        cJSON_DeleteItemFromObject(info, gauge_members[i]);
+    }
+    char *stable_json = cJSON_PrintUnformatted(info);
+    cJSON_Delete(info);
+    uint64_t stable_hash = stable_json ? hash_json(stable_json, strlen(stable_json)) : hash;
+    free(stable_json);
+
+    pthread_mutex_lock(&sampler.mutex);
+    bool changed = !sampler.snapshot ||
+                   (hash != sampler.snapshot_hash &&
+                    (stable_hash != sampler.snapshot_stable_hash ||
+                     now - sampler.snapshot_published >= SYSTEM_STATUS_SLOW_INTERVAL));
+    pthread_mutex_unlock(&sampler.mutex);
+
+    if (!changed) {
+        free(json);
+        return;
+    }
+
+    system_status_snapshot_t *snapshot = malloc(sizeof(system_status_snapshot_t) + len + 1);
+    if (!snapshot) {
+        log_error("Failed to allocate system status snapshot");
+        free(json);
+        return;
+    }
+
+    atomic_init(&snapshot->refs, 1);
+    snprintf(snapshot->etag, sizeof(snapshot->etag), "\"%016llx\"", (unsigned long long)hash);
+    snapshot->len = len;
+    memcpy(snapshot->json, json, len + 1);
+    free(json);
+
+    pthread_mutex_lock(&sampler.mutex);
+    system_status_snapshot_t *previous = sampler.snapshot;
+    sampler.snapshot = snapshot;
+    sampler.snapshot_hash = hash;
+    sampler.snapshot_stable_hash = stable_hash;
+    sampler.snapshot_published = now;
+    pthread_mutex_unlock(&sampler.mutex);
+
+    system_status_release(previous);
+
+    publish_snapshot(snapshot);
+}
+
+/**
+ * @brief Sampler thread
+ */
+static void *system_status_thread_func(void *arg) {
+    (void)arg;
+
+    log_info("System status sampler thread started");
+
+    while (true) {
+        pthread_mutex_lock(&sampler.mutex);
+
+        if (sampler.running) {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_sec += SYSTEM_STATUS_FAST_INTERVAL;
+            pthread_cond_timedwait(&sampler.cond, &sampler.mutex, &deadline);
+        }
+
+        bool running = sampler.running;
+        pthread_mutex_unlock(&sampler.mutex);
+
+        if (!running) {
+            break;
+        }
+
+        pthread_mutex_lock(&sampler.sample_mutex);
+        take_sample(true);
+        pthread_mutex_unlock(&sampler.sample_mutex);
+    }
+
+    log_info("System status sampler thread exiting");
+    return NULL;
+}
+
+/**
+ * @brief Start the system status sampler
+ */
+int system_status_start(void) {
+    pthread_mutex_lock(&sampler.mutex);
+    if (sampler.running) {
+        pthread_mutex_unlock(&sampler.mutex);
+        return 0;
+    }
+    sampler.running = true;
+    pthread_mutex_unlock(&sampler.mutex);
+
+    // The storage walk can take a while on a large archive, so the first
+    // snapshot reports filesystem usage and the thread walks on its first pass
+    pthread_mutex_lock(&sampler.sample_mutex);
+    take_sample(false);
+    pthread_mutex_unlock(&sampler.sample_mutex);
+
+    if (pthread_create(&sampler.thread, NULL, system_status_thread_func, NULL) != 0) {
+        log_error("Failed to create system status sampler thread");
+        pthread_mutex_lock(&sampler.mutex);
+        sampler.running = false;
+        pthread_mutex_unlock(&sampler.mutex);
+        return -1;
+    }
+
+    log_info("System status sampler started (every %d s, storage walk every %d s)",
+             SYSTEM_STATUS_FAST_INTERVAL, SYSTEM_STATUS_STORAGE_INTERVAL);
+    return 0;
+}
+
+/**
+ * @brief Stop the system status sampler
+ */
+void system_status_stop(void) {
+    pthread_mutex_lock(&sampler.mutex);
+    if (!sampler.running) {
+        pthread_mutex_unlock(&sampler.mutex);
+        return;
+    }
+    sampler.running = false;
+    pthread_cond_signal(&sampler.cond);
+    pthread_mutex_unlock(&sampler.mutex);
+
+    pthread_join(sampler.thread, NULL);
+
+    pthread_mutex_lock(&sampler.mutex);
+    system_status_snapshot_t *snapshot = sampler.snapshot;
+    sampler.snapshot = NULL;
+    pthread_mutex_unlock(&sampler.mutex);
+    system_status_release(snapshot);
+
+    pthread_mutex_lock(&sampler.sample_mutex);
+    cJSON_Delete(sampler.interfaces);
+    sampler.interfaces = NULL;
+    sampler.slow_sampled = 0;
+    sampler.storage_walked = 0;
+    sampler.storage_measured = false;
+    pthread_mutex_unlock(&sampler.sample_mutex);
+
+    log_info("System status sampler stopped");
+}
+
+/**
+ * @brief Get the latest system status
+ */
+system_status_snapshot_t *system_status_acquire(void) {
+    pthread_mutex_lock(&sampler.mutex);
+    bool running = sampler.running;
+    pthread_mutex_unlock(&sampler.mutex);
+
+    // Without the thread, sample now and walk the storage as requests used to
+    if (!running) {
+        pthread_mutex_lock(&sampler.sample_mutex);
+        sampler.slow_sampled = 0;
+        sampler.storage_walked = 0;
+        take_sample(true);
+        pthread_mutex_unlock(&sampler.sample_mutex);
+    }
+
+    pthread_mutex_lock(&sampler.mutex);
+    system_status_snapshot_t *snapshot = sampler.snapshot;
+    if (snapshot) {
+        atomic_fetch_add(&snapshot->refs, 1);
+    }
+    pthread_mutex_unlock(&sampler.mutex);
+
+    return snapshot;
+}
+
+/**
+ * @brief Drop a reference taken by system_status_acquire()
+ */
+void system_status_release(system_status_snapshot_t *snapshot) {
+    if (snapshot && atomic_fetch_sub(&snapshot->refs, 1) == 1) {
+        free(snapshot);
+    }
+}
+
+/**
+ * @brief WebSocket handler for the system/status topic
+ */
+static void websocket_handle_system_status(struct mg_connection *c, const char *data,
+                                           size_t data_len, void *user_data) {
+    (void)data_len;
+    (void)user_data;
+
+    char client_id[32];
+    snprintf(client_id, sizeof(client_id), "%p", (void *)c);
+
+    cJSON *json = cJSON_Parse(data);
+    cJSON *type_obj = json ? cJSON_GetObjectItem(json, "type") : NULL;
+    const char *type = type_obj && cJSON_IsString(type_obj) ? type_obj->valuestring : "subscribe";
+
+    if (strcmp(type, "unsubscribe") == 0) {
+        websocket_client_unsubscribe(client_id, SYSTEM_STATUS_WS_TOPIC);
+        log_debug("Client %s unsubscribed from %s", client_id, SYSTEM_STATUS_WS_TOPIC);
+    } else if (strcmp(type, "subscribe") == 0 && websocket_client_subscribe(client_id, SYSTEM_STATUS_WS_TOPIC)) {
+        log_debug("Client %s subscribed to %s", client_id, SYSTEM_STATUS_WS_TOPIC);
+
+        // Send the current state; changes follow as they are sampled
+        system_status_snapshot_t *snapshot = system_status_acquire();
+        if (snapshot) {
+            char *message = malloc(snapshot->len + 64);
+            if (message) {
+                int len = snprintf(message, snapshot->len + 64,
+                                   "{\"type\":\"status\",\"topic\":\"%s\",\"payload\":%s}",
+                                   SYSTEM_STATUS_WS_TOPIC, snapshot->json);
+                mg_reactor_ws_send(c, message, (size_t)len);
+                free(message);
+            }
+            system_status_release(snapshot);
+        }
+    } else {
+        const char *error = "{\"type\":\"error\",\"topic\":\"" SYSTEM_STATUS_WS_TOPIC "\","
+                            "\"payload\":{\"error\":\"Subscription failed\"}}";
+        mg_reactor_ws_send(c, error, strlen(error));
+    }
+
+    cJSON_Delete(json);
+}
+
+/**
+ * @brief Register the system status WebSocket topic
+ */
+int system_status_ws_init(void) {
+    if (websocket_manager_register_handler(SYSTEM_STATUS_WS_TOPIC, websocket_handle_system_status, NULL) != 0) {
+        log_error("Failed to register system status WebSocket topic");
+        return -1;
+    }
+
+    // Only the latest status matters to a client that has fallen behind
+    websocket_manager_set_topic_policy(SYSTEM_STATUS_WS_TOPIC, WS_TOPIC_POLICY_COALESCE);
+    return 0;
+}
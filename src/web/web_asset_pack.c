@@ -0,0 +1,410 @@
+/**
+ * @file web_asset_pack.c
+ * @brief Web UI served from a precompressed archive held in memory
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <strings.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "web/web_asset_pack.h"
+#include "core/config.h"
+#include "core/logger.h"
+
+// Archive layout, written by scripts/pack_web_assets.py
+#define PACK_MAGIC "LNVRPAK1"
+#define PACK_HEADER_SIZE 16
+#define PACK_ENTRY_SIZE 72
+#define PACK_MAX_ETAG 64
+
+/**
+ * @brief Body variants stored for each file
+ */
+typedef enum {
+    PACK_VARIANT_IDENTITY = 0,
+    PACK_VARIANT_GZIP,
+    PACK_VARIANT_BROTLI,
+    PACK_VARIANT_COUNT
+} pack_variant_t;
+
+// Content-Encoding and ETag suffix of each variant
+static const struct {
+    const char *encoding;
+    const char *etag_suffix;
+} variant_info[PACK_VARIANT_COUNT] = {
+    {NULL, ""},
+    {"gzip", "-gz"},
+    {"br", "-br"}
+};
+
+/**
+ * @brief File entry, decoded from the archive
+ */
+typedef struct {
+    struct mg_str path;
+    struct mg_str type;
+    struct mg_str etag;
+    struct mg_str bodies[PACK_VARIANT_COUNT];  // Empty when the variant was not stored
+} pack_entry_t;
+
+// Mapped archive, read-only once opened
+static struct {
+    const unsigned char *data;
+    size_t size;
+    uint32_t count;
+} asset_pack = {
+    .data = NULL,
+    .size = 0,
+    .count = 0
+};
+
+static uint32_t read_u32(const unsigned char *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static uint64_t read_u64(const unsigned char *p) {
+    return (uint64_t)read_u32(p) | (uint64_t)read_u32(p + 4) << 32;
+}
+
+/**
+ * @brief Decode a slice of the archive, checking it lies inside
+ */
+static bool read_slice(const unsigned char *data, size_t size, uint64_t offset, uint64_t len,
+                       struct mg_str *out) {
+    if (offset > size || len > size - offset) {
+        return false;
+    }
+    *out = mg_str_n((const char *)data + offset, (size_t)len);
+    return true;
+}
+
+/**
+ * @brief Decode an entry of the archive
+ */
+static bool read_entry(const unsigned char *data, size_t size, uint32_t index, pack_entry_t *entry) {
+    const unsigned char *p = data + PACK_HEADER_SIZE + (size_t)index * PACK_ENTRY_SIZE;
+
+    if (!read_slice(data, size, read_u32(p), read_u32(p + 4), &entry->path) ||
+        !read_slice(data, size, read_u32(p + 8), read_u32(p + 12), &entry->type) ||
+        !read_slice(data, size, read_u32(p + 16), read_u32(p + 20), &entry->etag)) {
+        return false;
+    }
+
+    for (int i = 0; i < PACK_VARIANT_COUNT; i++) {
+        const unsigned char *v = p + 24 + i * 16;
+        if (!read_slice(data, size, read_u64(v), read_u64(v + 8), &entry->bodies[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Order paths by their bytes, as the pack script sorts them
+ */
+static int compare_path(struct mg_str a, struct mg_str b) {
+    size_t len = a.len < b.len ? a.len : b.len;
+    int result = memcmp(a.buf, b.buf, len);
+    if (result != 0) {
+        return result;
+    }
+    return a.len < b.len ? -1 : (a.len > b.len ? 1 : 0);
+}
+
+/**
+ * @brief Map an asset pack built by scripts/pack_web_assets.py
+ */
+int web_asset_pack_open(const char *path) {
+    web_asset_pack_close();
+
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        log_info("No web asset pack at %s, serving web assets from disk", path);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < PACK_HEADER_SIZE) {
+        log_error("Web asset pack %s is too small", path);
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        log_error("Failed to map web asset pack %s", path);
+        return -1;
+    }
+
+    const unsigned char *data = map;
+    uint32_t count = read_u32(data + 8);
+
+    if (memcmp(data, PACK_MAGIC, 8) != 0 ||
+        (uint64_t)count * PACK_ENTRY_SIZE > size - PACK_HEADER_SIZE) {
+        log_error("Web asset pack %s is not a valid pack", path);
+        munmap(map, size);
+        return -1;
+    }
+
+    // Check every entry once so lookups can trust the offsets
+    struct mg_str previous = mg_str_n(NULL, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        pack_entry_t entry;
+        if (!read_entry(data, size, i, &entry) || entry.etag.len > PACK_MAX_ETAG ||
+            (i > 0 && compare_path(previous, entry.path) >= 0)) {
+            log_error("Web asset pack %s has a bad entry at index %u", path, i);
+            munmap(map, size);
+            return -1;
+        }
+        previous = entry.path;
+    }
+
+    // The archive is read on every asset request
+    madvise(map, size, MADV_WILLNEED);
+
+    asset_pack.data = data;
+    asset_pack.size = size;
+    asset_pack.count = count;
+
+    log_info("Web asset pack %s loaded: %u files, %zu bytes", path, count, size);
+    return 0;
+}
+
+/**
+ * @brief Unmap the asset pack
+ */
+void web_asset_pack_close(void) {
+    if (asset_pack.data) {
+        munmap((void *)asset_pack.data, asset_pack.size);
+    }
+    asset_pack.data = NULL;
+    asset_pack.size = 0;
+    asset_pack.count = 0;
+}
+
+/**
+ * @brief Check whether an asset pack is mapped
+ */
+bool web_asset_pack_loaded(void) {
+    return asset_pack.data != NULL;
+}
+
+/**
+ * @brief Find the entry for a path
+ */
+static bool find_entry(struct mg_str path, pack_entry_t *entry) {
+    uint32_t low = 0;
+    uint32_t high = asset_pack.count;
+
+    while (low < high) {
+        uint32_t mid = low + (high - low) / 2;
+        read_entry(asset_pack.data, asset_pack.size, mid, entry);
+
+        int result = compare_path(entry->path, path);
+        if (result == 0) {
+            return true;
+        }
+        if (result < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check whether an Accept-Encoding header allows an encoding
+ */
+static bool accepts_encoding(const struct mg_str *header, const char *name) {
+    size_t name_len = strlen(name);
+    const char *p = header->buf;
+    const char *end = header->buf + header->len;
+
+    while (p < end) {
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        const char *token_end = comma ? comma : end;
+
+        while (p < token_end && (*p == ' ' || *p == '\t')) {
+            p++;
+        }
+        const char *semi = memchr(p, ';', (size_t)(token_end - p));
+        const char *name_end = semi ? semi : token_end;
+        while (name_end > p && (name_end[-1] == ' ' || name_end[-1] == '\t')) {
+            name_end--;
+        }
+
+        if ((size_t)(name_end - p) == name_len && strncasecmp(p, name, name_len) == 0) {
+            // "q=0" turns the encoding off
+            if (semi) {
+                char params[32];
+                size_t len = (size_t)(token_end - semi - 1);
+                if (len >= sizeof(params)) {
+                    len = sizeof(params) - 1;
+                }
+                memcpy(params, semi + 1, len);
+                params[len] = '\0';
+
+                const char *q = strstr(params, "q=");
+                if (q && strtod(q + 2, NULL) <= 0.0) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        p = comma ? comma + 1 : end;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Check whether an If-None-Match header lists an ETag
+ */
+static bool etag_matches(const struct mg_str *header, const char *etag) {
+    size_t etag_len = strlen(etag);
+    const char *p = header->buf;
+    const char *end = header->buf + header->len;
+
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) {
+            p++;
+        }
+        if (p < end && *p == '*') {
+            return true;
+        }
+        // Weak comparison, as RFC 9110 asks for If-None-Match
+        if (end - p > 2 && p[0] == 'W' && p[1] == '/') {
+            p += 2;
+        }
+        if ((size_t)(end - p) >= etag_len && memcmp(p, etag, etag_len) == 0) {
+            return true;
+        }
+
+        const char *comma = memchr(p, ',', (size_t)(end - p));
+        p = comma ? comma + 1 : end;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Pick the Cache-Control max-age for a content type
+ */
+static int cache_max_age(struct mg_str type) {
+    if (mg_match(type, mg_str("text/html*"), NULL)) {
+        return g_config.web_cache_max_age_html;
+    }
+    if (mg_match(type, mg_str("text/css*"), NULL)) {
+        return g_config.web_cache_max_age_css;
+    }
+    if (mg_match(type, mg_str("application/javascript*"), NULL)) {
+        return g_config.web_cache_max_age_js;
+    }
+    if (mg_match(type, mg_str("image/*"), NULL)) {
+        return g_config.web_cache_max_age_images;
+    }
+    if (mg_match(type, mg_str("font/*"), NULL) ||
+        mg_match(type, mg_str("application/vnd.ms-fontobject"), NULL)) {
+        return g_config.web_cache_max_age_fonts;
+    }
+    return g_config.web_cache_max_age_default;
+}
+
+/**
+ * @brief Answer a request for a web UI file from the asset pack
+ */
+bool web_asset_pack_serve(struct mg_connection *c, struct mg_http_message *hm, const char *uri) {
+    if (!asset_pack.data || !uri || uri[0] != '/') {
+        return false;
+    }
+
+    // Directories are served their index
+    char path[MAX_PATH_LENGTH];
+    size_t uri_len = strlen(uri);
+    if (uri[uri_len - 1] == '/') {
+        if (snprintf(path, sizeof(path), "%sindex.html", uri) >= (int)sizeof(path)) {
+            return false;
+        }
+    } else {
+        if (uri_len >= sizeof(path)) {
+            return false;
+        }
+        memcpy(path, uri, uri_len + 1);
+    }
+
+    pack_entry_t entry;
+    if (!find_entry(mg_str(path), &entry)) {
+        return false;
+    }
+
+    // Prefer brotli, then gzip, when the client takes them
+    pack_variant_t variant = PACK_VARIANT_IDENTITY;
+    struct mg_str *accept = mg_http_get_header(hm, "Accept-Encoding");
+    if (g_config.web_compression_enabled && accept) {
+        if (entry.bodies[PACK_VARIANT_BROTLI].len > 0 && accepts_encoding(accept, "br")) {
+            variant = PACK_VARIANT_BROTLI;
+        } else if (entry.bodies[PACK_VARIANT_GZIP].len > 0 && accepts_encoding(accept, "gzip")) {
+            variant = PACK_VARIANT_GZIP;
+        }
+    }
+
+    // Each variant has its own strong ETag
+    char etag[PACK_MAX_ETAG + 8];
+    snprintf(etag, sizeof(etag), "\"%.*s%s\"", (int)entry.etag.len, entry.etag.buf,
+             variant_info[variant].etag_suffix);
+
+    char encoding_header[48] = "";
+    if (variant_info[variant].encoding) {
+        snprintf(encoding_header, sizeof(encoding_header), "Content-Encoding: %s\r\n",
+                 variant_info[variant].encoding);
+    }
+
+    int max_age = cache_max_age(entry.type);
+
+    struct mg_str *inm = mg_http_get_header(hm, "If-None-Match");
+    if (inm && etag_matches(inm, etag)) {
+        mg_printf(c,
+                  "HTTP/1.1 304 Not Modified\r\n"
+                  "Etag: %s\r\n"
+                  "Cache-Control: max-age=%d\r\n"
+                  "Vary: Accept-Encoding\r\n"
+                  "Content-Length: 0\r\n\r\n",
+                  etag, max_age);
+        c->is_resp = 0;
+        log_debug("Web asset %s not modified", path);
+        return true;
+    }
+
+    struct mg_str body = entry.bodies[variant];
+    mg_printf(c,
+              "HTTP/1.1 200 OK\r\n"
+              "Content-Type: %.*s\r\n"
+              "%s"
+              "Content-Length: %zu\r\n"
+              "Etag: %s\r\n"
+              "Cache-Control: max-age=%d\r\n"
+              "Vary: Accept-Encoding\r\n\r\n",
+              (int)entry.type.len, entry.type.buf, encoding_header, body.len, etag, max_age);
+
+    if (mg_strcasecmp(hm->method, mg_str("HEAD")) != 0) {
+        mg_send(c, body.buf, body.len);
+    }
+    c->is_resp = 0;
+
+    log_debug("Served web asset %s from pack (%zu bytes%s%s)", path, body.len,
+              variant_info[variant].encoding ? ", " : "",
+              variant_info[variant].encoding ? variant_info[variant].encoding : "");
+    return true;
+}
@@ -2,13 +2,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
 
 #include "web/websocket_client.h"
 #include "core/logger.h"
 #include "mongoose.h"
 
 // Maximum number of WebSocket clients
-#define MAX_WS_CLIENTS 32
+#define MAX_WS_CLIENTS 128
 
 // Maximum number of subscriptions per client
 #define MAX_SUBSCRIPTIONS 16
@@ -16,23 +18,256 @@
 // Maximum topic name length
 #define MAX_TOPIC_LENGTH 64
 
+// Maximum number of distinct topics
+#define MAX_WS_TOPICS 64
+
+// Hash buckets for the client and topic indexes
+#define CLIENT_BUCKETS 256
+#define TOPIC_BUCKETS 64
+
+// Words in a topic's client bitmap
+#define CLIENT_WORDS ((MAX_WS_CLIENTS + 63) / 64)
+
 // WebSocket client structure
 typedef struct {
     char id[64];                                // Client ID
     struct mg_connection *conn;                 // Mongoose connection
-    char subscriptions[MAX_SUBSCRIPTIONS][MAX_TOPIC_LENGTH]; // Subscribed topics
     int subscription_count;                     // Number of subscriptions
     uint64_t last_activity;                     // Last activity timestamp
     bool active;                                // Whether the client is active
+    int next_by_id;                             // Next client in the ID bucket
+    int next_by_conn;                           // Next client in the connection bucket
 } ws_client_t;
 
+// Topic with the clients subscribed to it
+typedef struct {
+    char name[MAX_TOPIC_LENGTH];
+    uint64_t members[CLIENT_WORDS];             // Bit per client slot
+    int next;                                   // Next topic in the bucket
+} ws_topic_t;
+
 // Global state
 static ws_client_t s_clients[MAX_WS_CLIENTS];
 static int s_client_count = 0;
+static int s_id_buckets[CLIENT_BUCKETS];
+static int s_conn_buckets[CLIENT_BUCKETS];
+static ws_topic_t s_topics[MAX_WS_TOPICS];
+static int s_topic_count = 0;
+static int s_topic_buckets[TOPIC_BUCKETS];
+static bool s_indexes_ready = false;
+static pthread_mutex_t s_clients_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief FNV-1a hash of a string
+ */
+static uint32_t hash_string(const char *s) {
+    uint32_t hash = 2166136261u;
+    for (; *s; s++) {
+        hash ^= (unsigned char)*s;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * @brief Hash of a connection pointer
+ */
+static uint32_t hash_conn(const struct mg_connection *conn) {
+    uintptr_t value = (uintptr_t)conn;
+    return (uint32_t)((value >> 4) * 2654435761u);
+}
+
+/**
+ * @brief Empty the hash buckets the first time they are used
+ */
+static void ensure_indexes(void) {
+    if (s_indexes_ready) {
+        return;
+    }
+    for (int i = 0; i < CLIENT_BUCKETS; i++) {
+        s_id_buckets[i] = -1;
+        s_conn_buckets[i] = -1;
+    }
+    for (int i = 0; i < TOPIC_BUCKETS; i++) {
+        s_topic_buckets[i] = -1;
+    }
+    s_indexes_ready = true;
+}
+
+/**
+ * @brief Find a client by ID, with the mutex held
+ */
+static int find_by_id_locked(const char *client_id) {
+    ensure_indexes();
+    for (int i = s_id_buckets[hash_string(client_id) % CLIENT_BUCKETS]; i >= 0; i = s_clients[i].next_by_id) {
+        if (strcmp(s_clients[i].id, client_id) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Find a client by connection, with the mutex held
+ */
+static int find_by_connection_locked(const struct mg_connection *conn) {
+    ensure_indexes();
+    for (int i = s_conn_buckets[hash_conn(conn) % CLIENT_BUCKETS]; i >= 0; i = s_clients[i].next_by_conn) {
+        if (s_clients[i].conn == conn) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Find a topic by name, optionally adding it, with the mutex held
+ */
+static ws_topic_t *find_topic_locked(const char *topic, bool create) {
+    ensure_indexes();
+    uint32_t bucket = hash_string(topic) % TOPIC_BUCKETS;
+    for (int i = s_topic_buckets[bucket]; i >= 0; i = s_topics[i].next) {
+        if (strcmp(s_topics[i].name, topic) == 0) {
+            return &s_topics[i];
+        }
+    }
+
+    if (!create) {
+        return NULL;
+    }
+    if (s_topic_count == MAX_WS_TOPICS) {
+        log_error("Maximum number of WebSocket topics reached");
+        return NULL;
+    }
+
+    ws_topic_t *entry = &s_topics[s_topic_count];
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, topic, MAX_TOPIC_LENGTH - 1);
+    entry->next = s_topic_buckets[bucket];
+    s_topic_buckets[bucket] = s_topic_count;
+    s_topic_count++;
+    return entry;
+}
+
+/**
+ * @brief Unlink a client from a hash chain
+ */
+static void unlink_client(int *bucket, int index, bool by_id) {
+    for (int *link = bucket; *link >= 0; ) {
+        int *next = by_id ? &s_clients[*link].next_by_id : &s_clients[*link].next_by_conn;
+        if (*link == index) {
+            *link = *next;
+            return;
+        }
+        link = next;
+    }
+}
+
+/**
+ * @brief Remove a client and its subscriptions, with the mutex held
+ */
+static void remove_client_locked(int index) {
+    ws_client_t *client = &s_clients[index];
+
+    unlink_client(&s_id_buckets[hash_string(client->id) % CLIENT_BUCKETS], index, true);
+    if (client->conn) {
+        unlink_client(&s_conn_buckets[hash_conn(client->conn) % CLIENT_BUCKETS], index, false);
+    }
+
+    for (int i = 0; i < s_topic_count; i++) {
+        s_topics[i].members[index / 64] &= ~(UINT64_C(1) << (index % 64));
+    }
+
+    client->active = false;
+    client->conn = NULL;
+    client->subscription_count = 0;
+    s_client_count--;
+}
+
+/**
+ * @brief Subscribe a client to a topic, with the mutex held
+ */
+static bool subscribe_locked(const char *client_id, const char *topic) {
+    int index = find_by_id_locked(client_id);
+    if (index < 0) {
+        // Client not found, create a new one
+        for (int i = 0; i < MAX_WS_CLIENTS; i++) {
+            if (!s_clients[i].active) {
+                // Found an empty slot
+                ws_client_t *client = &s_clients[i];
+                client->active = true;
+                strncpy(client->id, client_id, sizeof(client->id) - 1);
+                client->id[sizeof(client->id) - 1] = '\0';
+                client->subscription_count = 0;
+                client->last_activity = mg_millis();
+
+                // Get connection from client ID (assuming it's a pointer)
+                struct mg_connection *conn = NULL;
+                if (sscanf(client_id, "%p", &conn) == 1 && conn != NULL) {
+                    client->conn = conn;
+                    log_debug("Successfully parsed connection pointer from client ID: %s", client_id);
+                } else {
+                    client->conn = NULL;
+                    log_warn("Failed to parse connection pointer from client ID: %s", client_id);
+                }
+
+                uint32_t id_bucket = hash_string(client->id) % CLIENT_BUCKETS;
+                client->next_by_id = s_id_buckets[id_bucket];
+                s_id_buckets[id_bucket] = i;
+
+                client->next_by_conn = -1;
+                if (client->conn) {
+                    uint32_t conn_bucket = hash_conn(client->conn) % CLIENT_BUCKETS;
+                    client->next_by_conn = s_conn_buckets[conn_bucket];
+                    s_conn_buckets[conn_bucket] = i;
+                }
+
+                index = i;
+                s_client_count++;
+                log_info("Created new WebSocket client: %s", client_id);
+                break;
+            }
+        }
+
+        if (index < 0) {
+            log_error("Maximum number of WebSocket clients reached");
+            return false;
+        }
+    }
+
+    ws_topic_t *entry = find_topic_locked(topic, true);
+    if (!entry) {
+        return false;
+    }
+
+    uint64_t bit = UINT64_C(1) << (index % 64);
+
+    // Check if client is already subscribed to this topic
+    if (entry->members[index / 64] & bit) {
+        return true;
+    }
+
+    // Check if client has reached maximum number of subscriptions
+    if (s_clients[index].subscription_count >= MAX_SUBSCRIPTIONS) {
+        log_error("Maximum number of subscriptions reached for client: %s", client_id);
+        return false;
+    }
+
+    // Add subscription
+    entry->members[index / 64] |= bit;
+    s_clients[index].subscription_count++;
+
+    // Update activity timestamp
+    s_clients[index].last_activity = mg_millis();
+
+    log_info("Client %s subscribed to topic: %s", client_id, topic);
+
+    return true;
+}
 
 /**
  * @brief Find a client by ID
- * 
+ *
  * @param client_id Client ID
  * @return int Client index or -1 if not found
  */
@@ -40,19 +275,17 @@ int websocket_client_find_by_id(const char *client_id) {
     if (!client_id) {
         return -1;
     }
-    
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (s_clients[i].active && strcmp(s_clients[i].id, client_id) == 0) {
-            return i;
-        }
-    }
-    
-    return -1;
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_id_locked(client_id);
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return index;
 }
 
 /**
  * @brief Find a client by connection
- * 
+ *
  * @param conn Mongoose connection
  * @return int Client index or -1 if not found
  */
@@ -60,41 +293,42 @@ int websocket_client_find_by_connection(const struct mg_connection *conn) {
     if (!conn) {
         return -1;
     }
-    
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (s_clients[i].active && s_clients[i].conn == conn) {
-            return i;
-        }
-    }
-    
-    return -1;
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_connection_locked(conn);
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return index;
 }
 
 /**
  * @brief Remove a client by connection
- * 
+ *
  * @param conn Mongoose connection
  * @return bool true if client was removed, false otherwise
  */
 bool websocket_client_remove_by_connection(const struct mg_connection *conn) {
-    int index = websocket_client_find_by_connection(conn);
+    if (!conn) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_connection_locked(conn);
     if (index < 0) {
+        pthread_mutex_unlock(&s_clients_mutex);
         return false;
     }
-    
-    // Mark client as inactive
-    s_clients[index].active = false;
-    s_clients[index].conn = NULL;
-    s_clients[index].subscription_count = 0;
-    
+
+    remove_client_locked(index);
     log_info("Removed WebSocket client: %s", s_clients[index].id);
-    
+    pthread_mutex_unlock(&s_clients_mutex);
+
     return true;
 }
 
 /**
  * @brief Check if a client is subscribed to a topic
- * 
+ *
  * @param client_id Client ID
  * @param topic Topic to check
  * @return bool true if subscribed, false otherwise
@@ -104,36 +338,69 @@ bool websocket_client_is_subscribed(const char *client_id, const char *topic) {
         log_warn("Invalid client_id or topic in websocket_client_is_subscribed");
         return false;
     }
-    
+
     // Check if client_id is empty
     if (client_id[0] == '\0') {
         log_warn("Empty client_id in websocket_client_is_subscribed");
         return false;
     }
-    
-    int index = websocket_client_find_by_id(client_id);
-    if (index < 0) {
-        // Client not found, but we'll auto-subscribe them
-        log_info("Client %s not found, auto-subscribing to topic: %s", client_id, topic);
-        websocket_client_subscribe(client_id, topic);
-        return true;  // Return true to allow the operation to proceed
-    }
-    
-    for (int i = 0; i < s_clients[index].subscription_count; i++) {
-        if (strcmp(s_clients[index].subscriptions[i], topic) == 0) {
-            return true;
-        }
+
+    pthread_mutex_lock(&s_clients_mutex);
+
+    int index = find_by_id_locked(client_id);
+    ws_topic_t *entry = find_topic_locked(topic, false);
+    if (index >= 0 && entry && (entry->members[index / 64] & (UINT64_C(1) << (index % 64)))) {
+        pthread_mutex_unlock(&s_clients_mutex);
+        return true;
     }
-    
-    // Client found but not subscribed, auto-subscribe them
-    log_info("Client %s found but not subscribed to topic: %s, auto-subscribing", client_id, topic);
-    websocket_client_subscribe(client_id, topic);
+
+    // Client not found or not subscribed, auto-subscribe them
+    log_info("Client %s not subscribed to topic: %s, auto-subscribing", client_id, topic);
+    subscribe_locked(client_id, topic);
+
+    pthread_mutex_unlock(&s_clients_mutex);
     return true;  // Return true to allow the operation to proceed
 }
 
+/**
+ * @brief Check if the client on a connection is subscribed to a topic
+ */
+bool websocket_client_connection_subscribed(const struct mg_connection *conn, const char *topic) {
+    if (!conn || !topic) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_connection_locked(conn);
+    ws_topic_t *entry = index >= 0 ? find_topic_locked(topic, false) : NULL;
+    bool subscribed = entry && (entry->members[index / 64] & (UINT64_C(1) << (index % 64)));
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return subscribed;
+}
+
+/**
+ * @brief Check whether any client is subscribed to a topic
+ */
+bool websocket_client_topic_has_subscribers(const char *topic) {
+    if (!topic) {
+        return false;
+    }
+
+    pthread_mutex_lock(&s_clients_mutex);
+    ws_topic_t *entry = find_topic_locked(topic, false);
+    bool found = false;
+    for (int w = 0; entry && w < CLIENT_WORDS && !found; w++) {
+        found = entry->members[w] != 0;
+    }
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return found;
+}
+
 /**
  * @brief Get all clients subscribed to a topic
- * 
+ *
  * @param topic Topic to check
  * @param client_ids Pointer to array of client IDs (will be allocated)
  * @return int Number of clients subscribed to the topic
@@ -142,67 +409,58 @@ int websocket_client_get_subscribed(const char *topic, char ***client_ids) {
     if (!topic || !client_ids) {
         return 0;
     }
-    
-    // Count subscribed clients
+
+    *client_ids = NULL;
+
+    pthread_mutex_lock(&s_clients_mutex);
+
+    ws_topic_t *entry = find_topic_locked(topic, false);
     int count = 0;
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (!s_clients[i].active) {
-            continue;
-        }
-        
-        for (int j = 0; j < s_clients[i].subscription_count; j++) {
-            if (strcmp(s_clients[i].subscriptions[j], topic) == 0) {
-                count++;
-                break;
-            }
-        }
+    for (int w = 0; entry && w < CLIENT_WORDS; w++) {
+        count += __builtin_popcountll(entry->members[w]);
     }
-    
+
     if (count == 0) {
-        *client_ids = NULL;
+        pthread_mutex_unlock(&s_clients_mutex);
         return 0;
     }
-    
+
     // Allocate array for client IDs
     *client_ids = (char **)malloc(count * sizeof(char *));
     if (!*client_ids) {
+        pthread_mutex_unlock(&s_clients_mutex);
         log_error("Failed to allocate memory for client IDs");
         return 0;
     }
-    
+
     // Fill array with client IDs
     int index = 0;
-    for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-        if (!s_clients[i].active) {
-            continue;
-        }
-        
-        for (int j = 0; j < s_clients[i].subscription_count; j++) {
-            if (strcmp(s_clients[i].subscriptions[j], topic) == 0) {
-                (*client_ids)[index] = strdup(s_clients[i].id);
-                if (!(*client_ids)[index]) {
-                    log_error("Failed to allocate memory for client ID");
-                    // Free already allocated IDs
-                    for (int k = 0; k < index; k++) {
-                        free((*client_ids)[k]);
-                    }
-                    free(*client_ids);
-                    *client_ids = NULL;
-                    return 0;
+    for (int w = 0; w < CLIENT_WORDS; w++) {
+        for (uint64_t bits = entry->members[w]; bits; bits &= bits - 1) {
+            int slot = w * 64 + __builtin_ctzll(bits);
+            (*client_ids)[index] = strdup(s_clients[slot].id);
+            if (!(*client_ids)[index]) {
+                log_error("Failed to allocate memory for client ID");
+                // Free already allocated IDs
+                for (int k = 0; k < index; k++) {
+                    free((*client_ids)[k]);
                 }
-                
-                index++;
-                break;
+                free(*client_ids);
+                *client_ids = NULL;
+                pthread_mutex_unlock(&s_clients_mutex);
+                return 0;
             }
+            index++;
         }
     }
-    
+
+    pthread_mutex_unlock(&s_clients_mutex);
     return count;
 }
 
 /**
  * @brief Subscribe a client to a topic
- * 
+ *
  * @param client_id Client ID
  * @param topic Topic to subscribe to
  * @return bool true on success, false on error
@@ -212,75 +470,19 @@ bool websocket_client_subscribe(const char *client_id, const char *topic) {
         log_error("Invalid parameters for websocket_client_subscribe");
         return false;
     }
-    
+
     log_debug("Subscribing client %s to topic: %s", client_id, topic);
-    
-    int index = websocket_client_find_by_id(client_id);
-    if (index < 0) {
-        // Client not found, create a new one
-        for (int i = 0; i < MAX_WS_CLIENTS; i++) {
-            if (!s_clients[i].active) {
-                // Found an empty slot
-                s_clients[i].active = true;
-                strncpy(s_clients[i].id, client_id, sizeof(s_clients[i].id) - 1);
-                s_clients[i].id[sizeof(s_clients[i].id) - 1] = '\0';
-                s_clients[i].subscription_count = 0;
-                s_clients[i].last_activity = mg_millis();
-                
-                // Get connection from client ID (assuming it's a pointer)
-                struct mg_connection *conn = NULL;
-                if (sscanf(client_id, "%p", &conn) == 1 && conn != NULL) {
-                    s_clients[i].conn = conn;
-                    log_debug("Successfully parsed connection pointer from client ID: %s", client_id);
-                } else {
-                    s_clients[i].conn = NULL;
-                    log_warn("Failed to parse connection pointer from client ID: %s", client_id);
-                }
-                
-                index = i;
-                s_client_count++;
-                log_info("Created new WebSocket client: %s", client_id);
-                break;
-            }
-        }
-        
-        if (index < 0) {
-            log_error("Maximum number of WebSocket clients reached");
-            return false;
-        }
-    }
-    
-    // Check if client is already subscribed to this topic
-    for (int i = 0; i < s_clients[index].subscription_count; i++) {
-        if (strcmp(s_clients[index].subscriptions[i], topic) == 0) {
-            // Already subscribed
-            return true;
-        }
-    }
-    
-    // Check if client has reached maximum number of subscriptions
-    if (s_clients[index].subscription_count >= MAX_SUBSCRIPTIONS) {
-        log_error("Maximum number of subscriptions reached for client: %s", client_id);
-        return false;
-    }
-    
-    // Add subscription
-    strncpy(s_clients[index].subscriptions[s_clients[index].subscription_count], 
-           topic, MAX_TOPIC_LENGTH - 1);
-    s_clients[index].subscriptions[s_clients[index].subscription_count][MAX_TOPIC_LENGTH - 1] = '\0';
-    s_clients[index].subscription_count++;
-    
-    // Update activity timestamp
-    s_clients[index].last_activity = mg_millis();
-    
-    log_info("Client %s subscribed to topic: %s", client_id, topic);
-    
-    return true;
+
+    pthread_mutex_lock(&s_clients_mutex);
+    bool result = subscribe_locked(client_id, topic);
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return result;
 }
 
 /**
  * @brief Unsubscribe a client from a topic
- * 
+ *
  * @param client_id Client ID
  * @param topic Topic to unsubscribe from
  * @return bool true on success, false on error
@@ -289,57 +491,53 @@ bool websocket_client_unsubscribe(const char *client_id, const char *topic) {
     if (!client_id || !topic) {
         return false;
     }
-    
-    int index = websocket_client_find_by_id(client_id);
+
+    pthread_mutex_lock(&s_clients_mutex);
+
+    int index = find_by_id_locked(client_id);
     if (index < 0) {
+        // Unknown client
+        pthread_mutex_unlock(&s_clients_mutex);
         return false;
     }
-    
-    // Find subscription
-    int sub_index = -1;
-    for (int i = 0; i < s_clients[index].subscription_count; i++) {
-        if (strcmp(s_clients[index].subscriptions[i], topic) == 0) {
-            sub_index = i;
-            break;
-        }
-    }
-    
-    if (sub_index < 0) {
+
+    ws_topic_t *entry = find_topic_locked(topic, false);
+    uint64_t bit = UINT64_C(1) << (index % 64);
+    if (!entry || !(entry->members[index / 64] & bit)) {
         // Not subscribed
+        pthread_mutex_unlock(&s_clients_mutex);
         return false;
     }
-    
-    // Remove subscription by shifting remaining subscriptions
-    for (int i = sub_index; i < s_clients[index].subscription_count - 1; i++) {
-        strcpy(s_clients[index].subscriptions[i], s_clients[index].subscriptions[i + 1]);
-    }
-    
+
+    entry->members[index / 64] &= ~bit;
     s_clients[index].subscription_count--;
-    
+
     // Update activity timestamp
     s_clients[index].last_activity = mg_millis();
-    
+
+    pthread_mutex_unlock(&s_clients_mutex);
+
     log_info("Client %s unsubscribed from topic: %s", client_id, topic);
-    
+
     return true;
 }
 
 /**
  * @brief Update client activity timestamp
- * 
+ *
  * @param client_id Client ID
  */
 void websocket_client_update_activity(const char *client_id) {
     if (!client_id) {
         return;
     }
-    
-    int index = websocket_client_find_by_id(client_id);
-    if (index < 0) {
-        return;
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_id_locked(client_id);
+    if (index >= 0) {
+        s_clients[index].last_activity = mg_millis();
     }
-    
-    s_clients[index].last_activity = mg_millis();
+    pthread_mutex_unlock(&s_clients_mutex);
 }
 
 /**
@@ -348,21 +546,20 @@ void websocket_client_update_activity(const char *client_id) {
 void websocket_client_cleanup_inactive(void) {
     uint64_t now = mg_millis();
     uint64_t timeout = 300000; // 5 minutes
-    
+
+    pthread_mutex_lock(&s_clients_mutex);
     for (int i = 0; i < MAX_WS_CLIENTS; i++) {
         if (s_clients[i].active && (now - s_clients[i].last_activity) > timeout) {
             log_info("Removing inactive WebSocket client: %s", s_clients[i].id);
-            s_clients[i].active = false;
-            s_clients[i].conn = NULL;
-            s_clients[i].subscription_count = 0;
-            s_client_count--;
+            remove_client_locked(i);
         }
     }
+    pthread_mutex_unlock(&s_clients_mutex);
 }
 
 /**
  * @brief Get client connection by ID
- * 
+ *
  * @param client_id Client ID
  * @return struct mg_connection* Connection or NULL if not found
  */
@@ -370,11 +567,11 @@ struct mg_connection* websocket_client_get_connection(const char *client_id) {
     if (!client_id) {
         return NULL;
     }
-    
-    int index = websocket_client_find_by_id(client_id);
-    if (index < 0) {
-        return NULL;
-    }
-    
-    return s_clients[index].conn;
+
+    pthread_mutex_lock(&s_clients_mutex);
+    int index = find_by_id_locked(client_id);
+    struct mg_connection *conn = index >= 0 ? s_clients[index].conn : NULL;
+    pthread_mutex_unlock(&s_clients_mutex);
+
+    return conn;
 }
@@ -6,6 +6,8 @@
 
 #include "web/websocket_manager.h"
 #include "web/websocket_handler.h"
+#include "web/websocket_client.h"
+#include "web/mongoose_server_reactor.h"
 #include "core/logger.h"
 #include "core/shutdown_coordinator.h"
 
@@ -23,6 +25,15 @@ typedef struct {
     bool active;
 } ws_handler_entry_t;
 
+// Maximum number of topics with their own queue policy
+#define MAX_WS_TOPIC_POLICIES 32
+
+// Queue policy of a topic
+typedef struct {
+    char topic[MAX_TOPIC_LENGTH];
+    ws_topic_policy_t policy;
+} ws_topic_policy_entry_t;
+
 // Global state
 static bool s_initialized = false;
 static pthread_mutex_t s_init_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -32,6 +43,11 @@ static pthread_mutex_t s_handlers_mutex = PTHREAD_MUTEX_INITIALIZER;
 static ws_handler_entry_t s_handlers[MAX_WS_HANDLERS];
 static int s_handler_count = 0;
 
+// Topic queue policies
+static ws_topic_policy_entry_t s_policies[MAX_WS_TOPIC_POLICIES];
+static int s_policy_count = 0;
+static pthread_mutex_t s_policies_mutex = PTHREAD_MUTEX_INITIALIZER;
+
 /**
  * @brief Find a WebSocket handler by topic
  * 
@@ -47,6 +63,33 @@ static int find_handler_by_topic(const char *topic) {
     return -1;
 }
 
+/**
+ * @brief Find the WebSocket handler a message topic is routed to
+ *
+ * An exact match wins; otherwise a handler registered for "a/b" also
+ * receives "a/b/<anything>", so one handler can serve a family of topics.
+ *
+ * @param topic Topic name
+ * @return int Index of handler or -1 if not found
+ */
+static int find_handler_for_message(const char *topic) {
+    int handler_idx = find_handler_by_topic(topic);
+    if (handler_idx >= 0) {
+        return handler_idx;
+    }
+
+    for (int i = 0; i < MAX_WS_HANDLERS; i++) {
+        if (!s_handlers[i].active) {
+            continue;
+        }
+        size_t len = strlen(s_handlers[i].topic);
+        if (len > 0 && strncmp(s_handlers[i].topic, topic, len) == 0 && topic[len] == '/') {
+            return i;
+        }
+    }
+    return -1;
+}
+
 /**
  * @brief Find a free slot in the WebSocket handlers array
  * 
@@ -315,7 +358,7 @@ void websocket_manager_handle_message(struct mg_connection *c, const char *data,
     
     // Find handler for topic
     pthread_mutex_lock(&s_handlers_mutex);
-    int handler_idx = find_handler_by_topic(topic);
+    int handler_idx = find_handler_for_message(topic);
     if (handler_idx >= 0) {
         // Call handler
         websocket_handler_t handler = s_handlers[handler_idx].handler;
@@ -351,30 +394,149 @@ void websocket_manager_handle_close(struct mg_connection *c) {
 }
 
 /**
- * @brief Broadcast a message to all WebSocket clients
+ * @brief Get the queue policy of a topic
  * 
- * @param mgr Mongoose manager
+ * @param topic Topic name, may be NULL
+ * @return ws_topic_policy_t Queue policy
+ */
+static ws_topic_policy_t get_topic_policy(const char *topic) {
+    ws_topic_policy_t policy = WS_TOPIC_POLICY_DROP_OLDEST;
+    if (!topic) {
+        return policy;
+    }
+    
+    pthread_mutex_lock(&s_policies_mutex);
+    for (int i = 0; i < s_policy_count; i++) {
+        if (strcmp(s_policies[i].topic, topic) == 0) {
+            policy = s_policies[i].policy;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_policies_mutex);
+    
+    return policy;
+}
+
+/**
+ * @brief Set what happens to messages of a topic for clients that are behind
+ * 
+ * @param topic Topic name
+ * @param policy Queue policy
+ * @return int 0 on success, non-zero on error
+ */
+int websocket_manager_set_topic_policy(const char *topic, ws_topic_policy_t policy) {
+    if (!topic || strlen(topic) >= MAX_TOPIC_LENGTH) {
+        log_error("Invalid topic for set_topic_policy");
+        return -1;
+    }
+    
+    pthread_mutex_lock(&s_policies_mutex);
+    
+    for (int i = 0; i < s_policy_count; i++) {
+        if (strcmp(s_policies[i].topic, topic) == 0) {
+            s_policies[i].policy = policy;
+            pthread_mutex_unlock(&s_policies_mutex);
+            return 0;
+        }
+    }
+    
+    if (s_policy_count == MAX_WS_TOPIC_POLICIES) {
+        pthread_mutex_unlock(&s_policies_mutex);
+        log_error("No free slots in WebSocket topic policies array");
+        return -1;
+    }
+    
+    strcpy(s_policies[s_policy_count].topic, topic);
+    s_policies[s_policy_count].policy = policy;
+    s_policy_count++;
+    
+    pthread_mutex_unlock(&s_policies_mutex);
+    
+    log_debug("WebSocket topic %s uses %s queue policy", topic,
+              policy == WS_TOPIC_POLICY_COALESCE ? "coalesce" : "drop oldest");
+    return 0;
+}
+
+/**
+ * @brief Publish a message to the clients subscribed to a topic
+ * 
+ * @param topic Topic name
  * @param data Message data
  * @param data_len Message data length
- * @return int Number of clients the message was sent to
+ * @return int Number of event loops the message was queued for
  */
-int websocket_manager_broadcast(struct mg_mgr *mgr, const char *data, size_t data_len) {
-    if (!mgr || !data) {
+int websocket_manager_publish(const char *topic, const char *data, size_t data_len) {
+    if (!topic || !data) {
+        log_error("Invalid parameters for WebSocket publish");
+        return 0;
+    }
+    
+    ws_frame_t *frame = ws_frame_create(data, data_len);
+    if (!frame) {
+        return 0;
+    }
+    
+    // Each event loop takes its own reference
+    int queued = mg_reactor_ws_publish(topic, frame);
+    ws_frame_unref(frame);
+    
+    return queued;
+}
+
+/**
+ * @brief Send a framed message to the WebSocket clients of a manager
+ * 
+ * @param mgr Mongoose manager
+ * @param topic Only clients subscribed to this topic, NULL for all clients
+ * @param frame Framed message
+ * @return int Number of clients the message was sent or queued to
+ */
+int websocket_manager_broadcast_frame(struct mg_mgr *mgr, const char *topic, ws_frame_t *frame) {
+    if (!mgr || !frame) {
         log_error("Invalid parameters for WebSocket broadcast");
         return 0;
     }
     
+    ws_topic_policy_t policy = get_topic_policy(topic);
     int count = 0;
     
-    // Traverse all connections and send to WebSocket clients
+    // Traverse all connections and queue the shared frame for WebSocket clients
     for (struct mg_connection *c = mgr->conns; c != NULL; c = c->next) {
-        // Check if this is a WebSocket client
-        if (c->data[0] == 'W') {
-            // Send message
-            mg_ws_send(c, data, data_len, WEBSOCKET_OP_TEXT);
+        if (c->data[0] != 'W' || !c->is_websocket || c->is_closing) {
+            continue;
+        }
+        if (topic && !websocket_client_connection_subscribed(c, topic)) {
+            continue;
+        }
+        if (ws_outbox_send(c, frame, topic, policy)) {
             count++;
         }
     }
     
     return count;
 }
+
+/**
+ * @brief Broadcast a message to all WebSocket clients
+ * 
+ * @param mgr Mongoose manager
+ * @param data Message data
+ * @param data_len Message data length
+ * @return int Number of clients the message was sent to
+ */
+int websocket_manager_broadcast(struct mg_mgr *mgr, const char *data, size_t data_len) {
+    if (!mgr || !data) {
+        log_error("Invalid parameters for WebSocket broadcast");
+        return 0;
+    }
+    
+    ws_frame_t *frame = ws_frame_create(data, data_len);
+    if (!frame) {
+        return 0;
+    }
+    
+    int count = websocket_manager_broadcast_frame(mgr, NULL, frame);
+    ws_frame_unref(frame);
+    
+    return count;
+}
@@ -0,0 +1,298 @@
+/**
+ * @file websocket_outbox.c
+ * @brief Shared WebSocket frames and bounded per-connection send queues
+ *
+ * A broadcast is framed once into a reference counted buffer. Clients that
+ * keep up get the bytes appended to their send buffer straight away; a
+ * client whose send buffer is past the high water mark gets a reference
+ * queued instead, and the queue is bounded so a slow link cannot grow
+ * memory without limit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "web/websocket_outbox.h"
+#include "core/logger.h"
+
+// Hash buckets for the queues, keyed on the connection itself. Connection
+// ids are only unique within one manager, and each event loop has its own.
+#define WS_OUTBOX_BUCKETS 256
+
+// Maximum topic name length
+#define MAX_TOPIC_LENGTH 64
+
+/**
+ * @brief Frame waiting in a queue
+ */
+typedef struct ws_outbox_entry {
+    struct ws_outbox_entry *next;
+    ws_frame_t *frame;
+    char topic[MAX_TOPIC_LENGTH];
+} ws_outbox_entry_t;
+
+/**
+ * @brief Queue of one connection
+ *
+ * Only the thread that polls the connection touches the entries.
+ */
+typedef struct ws_outbox {
+    struct ws_outbox *next;         // Next queue in the hash bucket
+    const struct mg_connection *conn;
+    ws_outbox_entry_t *head;
+    ws_outbox_entry_t *tail;
+    int count;
+    unsigned long dropped;
+} ws_outbox_t;
+
+// Queues of connections that have fallen behind
+static struct {
+    ws_outbox_t *buckets[WS_OUTBOX_BUCKETS];
+    atomic_int pending;             // Queues holding frames, lets polls skip the lookup
+    pthread_mutex_t mutex;
+} outboxes = {
+    .mutex = PTHREAD_MUTEX_INITIALIZER
+};
+
+/**
+ * @brief Frame a text message
+ */
+ws_frame_t *ws_frame_create(const char *payload, size_t len) {
+    if (!payload) {
+        return NULL;
+    }
+
+    // Server frames are not masked: FIN + opcode, then the length
+    unsigned char header[10];
+    size_t header_len;
+    header[0] = 0x80 | WEBSOCKET_OP_TEXT;
+    if (len < 126) {
+        header[1] = (unsigned char)len;
+        header_len = 2;
+    } else if (len < 65536) {
+        header[1] = 126;
+        header[2] = (unsigned char)(len >> 8);
+        header[3] = (unsigned char)len;
+        header_len = 4;
+    } else {
+        header[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            header[2 + i] = (unsigned char)((uint64_t)len >> (56 - 8 * i));
+        }
+        header_len = 10;
+    }
+
+    ws_frame_t *frame = malloc(sizeof(ws_frame_t) + header_len + len);
+    if (!frame) {
+        log_error("Failed to allocate WebSocket frame of %zu bytes", len);
+        return NULL;
+    }
+
+    atomic_init(&frame->refs, 1);
+    frame->len = header_len + len;
+    memcpy(frame->data, header, header_len);
+    memcpy(frame->data + header_len, payload, len);
+
+    return frame;
+}
+
+/**
+ * @brief Take another reference to a frame
+ */
+ws_frame_t *ws_frame_ref(ws_frame_t *frame) {
+    if (frame) {
+        atomic_fetch_add(&frame->refs, 1);
+    }
+    return frame;
+}
+
+/**
+ * @brief Drop a reference to a frame
+ */
+void ws_frame_unref(ws_frame_t *frame) {
+    if (frame && atomic_fetch_sub(&frame->refs, 1) == 1) {
+        free(frame);
+    }
+}
+
+/**
+ * @brief Hash bucket of a connection's queue
+ *
+ * The queue is released when the connection closes, before mongoose frees
+ * it, so a connection reusing the address never sees an old queue.
+ */
+static size_t outbox_bucket(const struct mg_connection *c) {
+    // Allocations are at least 16 byte aligned, the low bits carry nothing
+    return (size_t)(((uintptr_t)c >> 4) % WS_OUTBOX_BUCKETS);
+}
+
+/**
+ * @brief Find the queue of a connection
+ */
+static ws_outbox_t *find_outbox(const struct mg_connection *c, bool create) {
+    size_t bucket = outbox_bucket(c);
+
+    pthread_mutex_lock(&outboxes.mutex);
+
+    ws_outbox_t *box = outboxes.buckets[bucket];
+    while (box && box->conn != c) {
+        box = box->next;
+    }
+
+    if (!box && create) {
+        box = calloc(1, sizeof(ws_outbox_t));
+        if (box) {
+            box->conn = c;
+            box->next = outboxes.buckets[bucket];
+            outboxes.buckets[bucket] = box;
+        } else {
+            log_error("Failed to allocate WebSocket send queue");
+        }
+    }
+
+    pthread_mutex_unlock(&outboxes.mutex);
+    return box;
+}
+
+/**
+ * @brief Remove the first frame of a queue
+ */
+static ws_frame_t *outbox_pop(ws_outbox_t *box) {
+    ws_outbox_entry_t *entry = box->head;
+    box->head = entry->next;
+    if (!box->head) {
+        box->tail = NULL;
+    }
+    box->count--;
+
+    ws_frame_t *frame = entry->frame;
+    free(entry);
+    return frame;
+}
+
+/**
+ * @brief Send a frame to a connection, or queue it if the connection is behind
+ */
+bool ws_outbox_send(struct mg_connection *c, ws_frame_t *frame, const char *topic,
+                    ws_topic_policy_t policy) {
+    if (!c || !frame || c->is_closing) {
+        return false;
+    }
+
+    ws_outbox_t *box = find_outbox(c, false);
+
+    // Nothing waiting and the socket is keeping up, so send it now
+    if ((!box || box->count == 0) && c->send.len < WS_OUTBOX_HIGH_WATER) {
+        mg_send(c, frame->data, frame->len);
+        return true;
+    }
+
+    if (!box) {
+        box = find_outbox(c, true);
+        if (!box) {
+            return false;
+        }
+    }
+
+    // A newer state replaces the one the client has not received yet
+    if (policy == WS_TOPIC_POLICY_COALESCE && topic) {
+        for (ws_outbox_entry_t *entry = box->head; entry; entry = entry->next) {
+            if (strcmp(entry->topic, topic) == 0) {
+                ws_frame_unref(entry->frame);
+                entry->frame = ws_frame_ref(frame);
+                return true;
+            }
+        }
+    }
+
+    ws_outbox_entry_t *entry = malloc(sizeof(ws_outbox_entry_t));
+    if (!entry) {
+        log_error("Failed to allocate WebSocket send queue entry");
+        return false;
+    }
+    entry->next = NULL;
+    entry->frame = ws_frame_ref(frame);
+    snprintf(entry->topic, sizeof(entry->topic), "%s", topic ? topic : "");
+
+    if (box->count == WS_OUTBOX_MAX_FRAMES) {
+        ws_frame_unref(outbox_pop(box));
+        box->dropped++;
+        if (box->dropped == 1 || box->dropped % 100 == 0) {
+            log_warn("WebSocket connection %p is not keeping up, %lu messages dropped",
+                     (void *)c, box->dropped);
+        }
+    }
+
+    if (box->tail) {
+        box->tail->next = entry;
+    } else {
+        box->head = entry;
+    }
+    box->tail = entry;
+
+    if (box->count++ == 0) {
+        atomic_fetch_add(&outboxes.pending, 1);
+    }
+
+    return true;
+}
+
+/**
+ * @brief Move queued frames into the send buffer as it drains
+ */
+void ws_outbox_flush(struct mg_connection *c) {
+    if (atomic_load(&outboxes.pending) == 0) {
+        return;
+    }
+
+    ws_outbox_t *box = find_outbox(c, false);
+    if (!box || box->count == 0) {
+        return;
+    }
+
+    while (box->head && c->send.len < WS_OUTBOX_HIGH_WATER) {
+        ws_frame_t *frame = outbox_pop(box);
+        mg_send(c, frame->data, frame->len);
+        ws_frame_unref(frame);
+    }
+
+    if (box->count == 0) {
+        atomic_fetch_sub(&outboxes.pending, 1);
+    }
+}
+
+/**
+ * @brief Drop the queue of a closing connection
+ */
+void ws_outbox_release(struct mg_connection *c) {
+    size_t bucket = outbox_bucket(c);
+
+    pthread_mutex_lock(&outboxes.mutex);
+    ws_outbox_t **link = &outboxes.buckets[bucket];
+    while (*link && (*link)->conn != c) {
+        link = &(*link)->next;
+    }
+    ws_outbox_t *box = *link;
+    if (box) {
+        *link = box->next;
+    }
+    pthread_mutex_unlock(&outboxes.mutex);
+
+    if (!box) {
+        return;
+    }
+
+    if (box->count > 0) {
+        atomic_fetch_sub(&outboxes.pending, 1);
+    }
+    while (box->head) {
+        ws_frame_unref(outbox_pop(box));
+    }
+    if (box->dropped > 0) {
+        log_info("WebSocket connection %p closed after %lu dropped messages", (void *)c, box->dropped);
+    }
+    free(box);
+}
@@ -0,0 +1,433 @@
+#define _POSIX_C_SOURCE 200809L
+#define _XOPEN_SOURCE 700
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sqlite3.h>
+#include <unistd.h>
+
+#include "database/db_core.h"
+#include "database/db_schema.h"
+#include "database/db_detections.h"
+#include "database/db_activity.h"
+#include "database/db_recordings.h"
+#include "core/logger.h"
+
+// Test database path
+#define TEST_DB_PATH "/tmp/test_db_migration.sqlite"
+
+// Largest error of a value quantized to 16 bits and read back
+#define QUANT_TOLERANCE (1.0f / 65535.0f)
+
+// One row of the per-detection table used before v7
+typedef struct {
+    const char *stream_name;
+    int offset;                 // Seconds after the fixture's base time
+    const char *label;
+    float confidence;
+    float x, y, width, height;
+} fixture_detection_t;
+
+// Detections of the fixture; rows of the same stream and second form one frame
+static const fixture_detection_t fixture_detections[] = {
+    { "cam1", 10,   "person", 0.91f, 0.10f, 0.20f, 0.30f, 0.40f },
+    { "cam1", 10,   "car",    0.55f, 0.50f, 0.50f, 0.25f, 0.125f },
+    { "cam1", 70,   "person", 0.42f, 0.33f, 0.66f, 0.05f, 0.95f },
+    { "cam2", 3610, "dog",    0.77f, 0.00f, 1.00f, 0.999f, 0.001f },
+    { "cam1", 5000, "cat",    0.33f, 0.25f, 0.75f, 0.20f, 0.20f },
+};
+
+#define FIXTURE_DETECTIONS (int)(sizeof(fixture_detections) / sizeof(fixture_detections[0]))
+
+// Expected contents of an activity rollup bucket
+typedef struct {
+    const char *stream_name;
+    int offset;                 // Bucket start, seconds after the base time
+    const char *label;
+    int count;
+    float max_confidence;
+} expected_activity_t;
+
+static const expected_activity_t expected_minutes[] = {
+    { "cam1", 0,    "car",    1, 0.55f },
+    { "cam1", 0,    "person", 1, 0.91f },
+    { "cam1", 60,   "person", 1, 0.42f },
+    { "cam2", 3600, "dog",    1, 0.77f },
+    { "cam1", 4980, "cat",    1, 0.33f },
+};
+
+static const expected_activity_t expected_hours[] = {
+    { "cam1", 0,    "car",    1, 0.55f },
+    { "cam1", 0,    "person", 2, 0.91f },
+    { "cam1", 3600, "cat",    1, 0.33f },
+    { "cam2", 3600, "dog",    1, 0.77f },
+};
+
+// Hour aligned base time of the fixture, recent enough not to be purged
+static time_t base_time;
+
+// Remove the test database and its journals
+static void remove_test_database(void) {
+    unlink(TEST_DB_PATH);
+    unlink(TEST_DB_PATH "-wal");
+    unlink(TEST_DB_PATH "-shm");
+    unlink(TEST_DB_PATH "-journal");
+}
+
+// Create a database as it was at schema version 5
+static int create_v5_database(void) {
+    sqlite3 *db;
+    sqlite3_stmt *stmt;
+    char *err_msg = NULL;
+
+    remove_test_database();
+
+    int rc = sqlite3_open(TEST_DB_PATH, &db);
+    if (rc != SQLITE_OK) {
+        printf("Failed to create fixture database: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    const char *create_tables =
+        "CREATE TABLE schema_version ("
+        "id INTEGER PRIMARY KEY CHECK (id = 1),"
+        "version INTEGER NOT NULL,"
+        "updated_at INTEGER NOT NULL"
+        ");"
+        "INSERT INTO schema_version (id, version, updated_at) VALUES (1, 5, 0);"
+        "CREATE TABLE detections ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "stream_name TEXT NOT NULL,"
+        "timestamp INTEGER NOT NULL,"
+        "label TEXT NOT NULL,"
+        "confidence REAL NOT NULL,"
+        "x REAL NOT NULL,"
+        "y REAL NOT NULL,"
+        "width REAL NOT NULL,"
+        "height REAL NOT NULL"
+        ");"
+        "CREATE TABLE recordings ("
+        "id INTEGER PRIMARY KEY AUTOINCREMENT,"
+        "stream_name TEXT NOT NULL,"
+        "file_path TEXT NOT NULL,"
+        "start_time INTEGER NOT NULL,"
+        "end_time INTEGER,"
+        "size_bytes INTEGER,"
+        "width INTEGER,"
+        "height INTEGER,"
+        "fps INTEGER,"
+        "codec TEXT,"
+        "is_complete INTEGER DEFAULT 0"
+        ");";
+
+    rc = sqlite3_exec(db, create_tables, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        printf("Failed to create fixture tables: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_close(db);
+        return -1;
+    }
+
+    // Recording 1 covers the first cam1 frames, recording 2 the cam2 frame,
+    // recording 3 has no detections and the cam1 frame at 5000 no recording
+    char insert_recordings[1024];
+    snprintf(insert_recordings, sizeof(insert_recordings),
+             "INSERT INTO recordings (id, stream_name, file_path, start_time, end_time, size_bytes, "
+             "width, height, fps, codec, is_complete) VALUES "
+             "(1, 'cam1', '/tmp/cam1_1.mp4', %lld, %lld, 1000, 1280, 720, 15, 'h264', 1),"
+             "(2, 'cam2', '/tmp/cam2_1.mp4', %lld, %lld, 1000, 1280, 720, 15, 'h264', 1),"
+             "(3, 'cam1', '/tmp/cam1_2.mp4', %lld, %lld, 1000, 1280, 720, 15, 'h264', 1);",
+             (long long)base_time, (long long)(base_time + 600),
+             (long long)(base_time + 3600), (long long)(base_time + 4200),
+             (long long)(base_time + 7200), (long long)(base_time + 7800));
+
+    rc = sqlite3_exec(db, insert_recordings, NULL, NULL, &err_msg);
+    if (rc != SQLITE_OK) {
+        printf("Failed to insert fixture recordings: %s\n", err_msg);
+        sqlite3_free(err_msg);
+        sqlite3_close(db);
+        return -1;
+    }
+
+    rc = sqlite3_prepare_v2(db,
+        "INSERT INTO detections (stream_name, timestamp, label, confidence, x, y, width, height) "
+        "VALUES (?, ?, ?, ?, ?, ?, ?, ?);", -1, &stmt, NULL);
+    if (rc != SQLITE_OK) {
+        printf("Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        sqlite3_close(db);
+        return -1;
+    }
+
+    for (int i = 0; i < FIXTURE_DETECTIONS; i++) {
+        const fixture_detection_t *det = &fixture_detections[i];
+        sqlite3_bind_text(stmt, 1, det->stream_name, -1, SQLITE_STATIC);
+        sqlite3_bind_int64(stmt, 2, (sqlite3_int64)(base_time + det->offset));
+        sqlite3_bind_text(stmt, 3, det->label, -1, SQLITE_STATIC);
+        sqlite3_bind_double(stmt, 4, det->confidence);
+        sqlite3_bind_double(stmt, 5, det->x);
+        sqlite3_bind_double(stmt, 6, det->y);
+        sqlite3_bind_double(stmt, 7, det->width);
+        sqlite3_bind_double(stmt, 8, det->height);
+
+        if (sqlite3_step(stmt) != SQLITE_DONE) {
+            printf("Failed to insert fixture detection: %s\n", sqlite3_errmsg(db));
+            sqlite3_finalize(stmt);
+            sqlite3_close(db);
+            return -1;
+        }
+        sqlite3_reset(stmt);
+    }
+
+    sqlite3_finalize(stmt);
+    sqlite3_close(db);
+
+    printf("Version 5 fixture database created\n");
+    return 0;
+}
+
+// Run a query returning a single integer
+static int query_int(const char *sql, int *value) {
+    sqlite3 *db = get_db_handle();
+    sqlite3_stmt *stmt;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &stmt, NULL) != SQLITE_OK) {
+        printf("Failed to prepare statement: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    int rc = sqlite3_step(stmt) == SQLITE_ROW ? 0 : -1;
+    if (rc == 0) {
+        *value = sqlite3_column_int(stmt, 0);
+    }
+
+    sqlite3_finalize(stmt);
+    return rc;
+}
+
+// Check that a value survived quantization
+static int check_quantized(const char *what, int index, float actual, float expected) {
+    if (fabsf(actual - expected) > QUANT_TOLERANCE) {
+        printf("Detection %d: %s %f, expected %f\n", index, what, actual, expected);
+        return -1;
+    }
+    return 0;
+}
+
+// Verify the schema and the packed detection frames
+static int verify_detections(void) {
+    int value;
+
+    if (get_schema_version() != 8) {
+        printf("Expected schema version 8, found %d\n", get_schema_version());
+        return -1;
+    }
+
+    if (query_int("SELECT COUNT(*) FROM sqlite_master WHERE type='table' AND name='detections';", &value) != 0 ||
+        value != 0) {
+        printf("Per-detection table was not dropped\n");
+        return -1;
+    }
+
+    if (query_int("SELECT COUNT(*) FROM detection_frames;", &value) != 0 || value != 4) {
+        printf("Expected 4 detection frames, found %d\n", value);
+        return -1;
+    }
+
+    if (query_int("SELECT SUM(count) FROM detection_frames;", &value) != 0 || value != FIXTURE_DETECTIONS) {
+        printf("Expected %d packed detections, found %d\n", FIXTURE_DETECTIONS, value);
+        return -1;
+    }
+
+    // Read each frame back and compare it with the rows it was packed from
+    for (int i = 0; i < FIXTURE_DETECTIONS; i++) {
+        const fixture_detection_t *first = &fixture_detections[i];
+        if (i > 0 && strcmp(fixture_detections[i - 1].stream_name, first->stream_name) == 0 &&
+            fixture_detections[i - 1].offset == first->offset) {
+            continue;
+        }
+
+        int expected_count = 0;
+        for (int j = i; j < FIXTURE_DETECTIONS; j++) {
+            if (strcmp(fixture_detections[j].stream_name, first->stream_name) == 0 &&
+                fixture_detections[j].offset == first->offset) {
+                expected_count++;
+            }
+        }
+
+        detection_result_t result;
+        time_t timestamp = base_time + first->offset;
+        int count = get_detections_from_db_time_range(first->stream_name, &result, 0, timestamp, timestamp);
+        if (count != expected_count) {
+            printf("Frame %s@%d: expected %d detections, found %d\n",
+                   first->stream_name, first->offset, expected_count, count);
+            return -1;
+        }
+
+        for (int j = 0; j < count; j++) {
+            const fixture_detection_t *expected = &fixture_detections[i + j];
+            const detection_t *det = &result.detections[j];
+
+            if (strcmp(det->label, expected->label) != 0) {
+                printf("Detection %d: label %s, expected %s\n", i + j, det->label, expected->label);
+                return -1;
+            }
+
+            if (check_quantized("confidence", i + j, det->confidence, expected->confidence) != 0 ||
+                check_quantized("x", i + j, det->x, expected->x) != 0 ||
+                check_quantized("y", i + j, det->y, expected->y) != 0 ||
+                check_quantized("width", i + j, det->width, expected->width) != 0 ||
+                check_quantized("height", i + j, det->height, expected->height) != 0) {
+                return -1;
+            }
+        }
+    }
+
+    printf("Detection frames verified\n");
+    return 0;
+}
+
+// Verify the detection aggregates of the fixture recordings
+static int verify_recordings(void) {
+    recording_metadata_t recording;
+
+    if (get_recording_metadata_by_id(1, &recording) != 0) {
+        printf("Failed to read recording 1\n");
+        return -1;
+    }
+    if (recording.detection_count != 3 || fabsf(recording.max_confidence - 0.91f) > QUANT_TOLERANCE ||
+        !strstr(recording.detection_labels, "person") || !strstr(recording.detection_labels, "car")) {
+        printf("Recording 1: %d detections, max confidence %f, labels '%s'\n",
+               recording.detection_count, recording.max_confidence, recording.detection_labels);
+        return -1;
+    }
+
+    if (get_recording_metadata_by_id(2, &recording) != 0) {
+        printf("Failed to read recording 2\n");
+        return -1;
+    }
+    if (recording.detection_count != 1 || fabsf(recording.max_confidence - 0.77f) > QUANT_TOLERANCE ||
+        strcmp(recording.detection_labels, "dog") != 0) {
+        printf("Recording 2: %d detections, max confidence %f, labels '%s'\n",
+               recording.detection_count, recording.max_confidence, recording.detection_labels);
+        return -1;
+    }
+
+    if (get_recording_metadata_by_id(3, &recording) != 0) {
+        printf("Failed to read recording 3\n");
+        return -1;
+    }
+    if (recording.detection_count != 0) {
+        printf("Recording 3: expected no detections, found %d\n", recording.detection_count);
+        return -1;
+    }
+
+    int value;
+    if (query_int("SELECT COUNT(*) FROM detection_frames WHERE recording_id IS NULL OR recording_id = 0;", &value) != 0 ||
+        value != 1) {
+        printf("Expected 1 frame without a recording, found %d\n", value);
+        return -1;
+    }
+
+    printf("Recording aggregates verified\n");
+    return 0;
+}
+
+// Compare one activity rollup with the buckets expected from the fixture
+static int verify_activity_table(int bucket_seconds, const expected_activity_t *expected, int expected_count) {
+    detection_activity_t activity[16];
+
+    int count = get_detection_activity(NULL, base_time, base_time + 7200, bucket_seconds, activity, 16);
+    if (count != expected_count) {
+        printf("Expected %d activity buckets of %d seconds, found %d\n", expected_count, bucket_seconds, count);
+        return -1;
+    }
+
+    for (int i = 0; i < expected_count; i++) {
+        bool found = false;
+        for (int j = 0; j < count; j++) {
+            if (activity[j].bucket == base_time + expected[i].offset &&
+                strcmp(activity[j].stream_name, expected[i].stream_name) == 0 &&
+                strcmp(activity[j].label, expected[i].label) == 0) {
+                found = true;
+                if (activity[j].count != expected[i].count ||
+                    fabsf(activity[j].max_confidence - expected[i].max_confidence) > QUANT_TOLERANCE) {
+                    printf("Activity %s/%s@%d: count %d, max confidence %f, expected %d, %f\n",
+                           expected[i].stream_name, expected[i].label, expected[i].offset,
+                           activity[j].count, activity[j].max_confidence,
+                           expected[i].count, expected[i].max_confidence);
+                    return -1;
+                }
+                break;
+            }
+        }
+
+        if (!found) {
+            printf("Missing activity %s/%s@%d in buckets of %d seconds\n",
+                   expected[i].stream_name, expected[i].label, expected[i].offset, bucket_seconds);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// Verify the minute and hour activity rollups
+static int verify_activity(void) {
+    if (verify_activity_table(ACTIVITY_BUCKET_MINUTE, expected_minutes,
+                              (int)(sizeof(expected_minutes) / sizeof(expected_minutes[0]))) != 0 ||
+        verify_activity_table(ACTIVITY_BUCKET_HOUR, expected_hours,
+                              (int)(sizeof(expected_hours) / sizeof(expected_hours[0]))) != 0) {
+        return -1;
+    }
+
+    printf("Activity rollups verified\n");
+    return 0;
+}
+
+// Main test function
+int main(void) {
+    // Initialize logger
+    init_logger();
+
+    printf("=== Database Migration Test (v5 to v8) ===\n");
+
+    base_time = time(NULL);
+    base_time -= base_time % ACTIVITY_BUCKET_HOUR + 3 * ACTIVITY_BUCKET_HOUR;
+
+    if (create_v5_database() != 0) {
+        printf("Test failed: Could not create version 5 database\n");
+        return 1;
+    }
+
+    // Opening the database runs the migrations
+    if (init_database(TEST_DB_PATH) != 0) {
+        printf("Test failed: Could not migrate database\n");
+        return 1;
+    }
+
+    int result = 0;
+    if (verify_detections() != 0) {
+        printf("Test failed: Detections do not match the version 5 rows\n");
+        result = 1;
+    } else if (verify_recordings() != 0) {
+        printf("Test failed: Recording aggregates do not match\n");
+        result = 1;
+    } else if (verify_activity() != 0) {
+        printf("Test failed: Activity rollups do not match\n");
+        result = 1;
+    } else {
+        printf("\n=== All tests passed successfully ===\n");
+    }
+
+    // Clean up
+    shutdown_database();
+    remove_test_database();
+
+    return result;
+}
@@ -0,0 +1,269 @@
+/**
+ * @file test_mongoose_routes.c
+ * @brief Check the route trie against a linear mg_match scan
+ *
+ * The trie must pick the same route as scanning the routes table in order
+ * and glob matching method and URI with mg_match, which is how requests
+ * were dispatched before. In particular the first listed route has to win
+ * when several match, which the trie relies on its min_index pruning for.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "mongoose.h"
+#include "web/mongoose_server_routes.h"
+#include "core/logger.h"
+
+// Same methods and patterns, in the same order, as s_api_routes in
+// src/web/mongoose_server.c; handlers are not called by the test
+static const mg_api_route_t test_routes[] = {
+    {"POST", "/api/auth/login", NULL},
+    {"POST", "/api/auth/logout", NULL},
+    {"GET", "/api/auth/verify", NULL},
+    {"GET", "/api/auth/users", NULL},
+    {"GET", "/api/auth/users/#", NULL},
+    {"POST", "/api/auth/users", NULL},
+    {"PUT", "/api/auth/users/#", NULL},
+    {"DELETE", "/api/auth/users/#", NULL},
+    {"POST", "/api/auth/users/#/api-key", NULL},
+    {"GET", "/api/streams", NULL},
+    {"POST", "/api/streams", NULL},
+    {"POST", "/api/streams/test", NULL},
+    {"GET", "/api/streams/#", NULL},
+    {"PUT", "/api/streams/#", NULL},
+    {"DELETE", "/api/streams/#", NULL},
+    {"GET", "/api/settings", NULL},
+    {"POST", "/api/settings", NULL},
+    {"GET", "/api/system", NULL},
+    {"GET", "/api/system/info", NULL},
+    {"GET", "/api/system/logs", NULL},
+    {"POST", "/api/system/restart", NULL},
+    {"POST", "/api/system/shutdown", NULL},
+    {"POST", "/api/system/logs/clear", NULL},
+    {"POST", "/api/system/backup", NULL},
+    {"GET", "/api/system/status", NULL},
+    {"GET", "/api/recordings", NULL},
+    {"GET", "/api/recordings/play/#", NULL},
+    {"GET", "/api/recordings/download/#", NULL},
+    {"GET", "/api/recordings/files/check", NULL},
+    {"DELETE", "/api/recordings/files", NULL},
+    {"GET", "/api/recordings/#", NULL},
+    {"DELETE", "/api/recordings/#", NULL},
+    {"POST", "/api/recordings/batch-delete", NULL},
+    {"POST", "/api/recordings/batch-delete-ws", NULL},
+    {"GET", "/api/ws", NULL},
+    {"GET", "/api/streaming/#/hls/index.m3u8", NULL},
+    {"GET", "/api/streaming/#/hls/stream.m3u8", NULL},
+    {"GET", "/api/streaming/#/hls/segment_#.ts", NULL},
+    {"GET", "/api/streaming/#/hls/segment_#.m4s", NULL},
+    {"GET", "/api/streaming/#/hls/init.mp4", NULL},
+    {"POST", "/api/webrtc", NULL},
+    {"POST", "/api/webrtc/ice", NULL},
+    {"OPTIONS", "/api/webrtc", NULL},
+    {"OPTIONS", "/api/webrtc/ice", NULL},
+    {"GET", "/api/detection/results/#", NULL},
+    {"GET", "/api/detection/models", NULL},
+    {"GET", "/api/onvif/discovery/status", NULL},
+    {"GET", "/api/onvif/devices", NULL},
+    {"GET", "/api/onvif/device/profiles", NULL},
+    {"POST", "/api/onvif/discovery/start", NULL},
+    {"POST", "/api/onvif/discovery/stop", NULL},
+    {"POST", "/api/onvif/discovery/discover", NULL},
+    {"POST", "/api/onvif/device/add", NULL},
+    {"POST", "/api/onvif/device/test", NULL},
+    {"GET", "/api/timeline/segments", NULL},
+    {"GET", "/api/timeline/manifest", NULL},
+    {"GET", "/api/timeline/play", NULL},
+    {"GET", "/api/timeline/heatmap", NULL},
+    {NULL, NULL, NULL}
+};
+
+// Methods requests are made with, including ones no route uses
+static const char *test_methods[] = {"GET", "POST", "PUT", "DELETE", "OPTIONS", "HEAD"};
+
+// Values put in place of each "#" of a pattern
+static const char *test_values[] = {"cam1", "", "42", "a/b", "segment_7", "x.ts", "cam%201"};
+
+// Suffixes added to each URI
+static const char *test_suffixes[] = {"", "/", "//", "/extra", ".ts"};
+
+// URIs tried besides the ones built from the patterns
+static const char *extra_uris[] = {
+    "",
+    "/",
+    "//",
+    "/api",
+    "/api/",
+    "//api/streams",
+    "/api//streams",
+    "/api/streams//",
+    "/api/streaming//hls/init.mp4",
+    "/api/streaming/cam1//hls/init.mp4",
+    "/api/streaming/cam1/hls/segment_.ts",
+    "/api/streaming/cam1/hls/segment_42.ts.bak",
+    "/api/streaming/cam1/hls/segment_4/2.ts",
+    "/api/streaming/cam1/hls/segment_1_2.ts",
+    "/api/streaming/cam1/hls/Segment_1.ts",
+    "/api/streaming/cam1/hls/segment_1.m4s",
+    "/api/streaming/cam1/hls/segment_1.m4",
+    "/api/auth/users/5/api-key/",
+    "/api/auth/users//api-key",
+    "/api/recordings/files",
+    "/api/recordings/files/",
+    "/api/recordings/files/check/",
+    "/api/recordings/play",
+    "/api/recordings/play/",
+    "/API/streams",
+    "/api/streamsx",
+    "/api/stream",
+};
+
+static int failures = 0;
+static int checked = 0;
+
+// Route a request by scanning the table, as the server did before the trie
+static int linear_match(struct mg_http_message *hm, struct mg_str *caps) {
+    for (int i = 0; test_routes[i].method != NULL; i++) {
+        memset(caps, 0, (MG_ROUTE_MAX_PARAMS + 1) * sizeof(struct mg_str));
+        if (mg_match(hm->method, mg_str(test_routes[i].method), NULL) &&
+            mg_match(hm->uri, mg_str(test_routes[i].uri), caps)) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Compare the trie with the linear scan for one request
+static void check_request(const char *method, const char *uri) {
+    struct mg_http_message hm;
+    memset(&hm, 0, sizeof(hm));
+    hm.method = mg_str(method);
+    hm.uri = mg_str(uri);
+
+    struct mg_str caps[MG_ROUTE_MAX_PARAMS + 1];
+    mg_route_params_t params;
+    int expected = linear_match(&hm, caps);
+    int actual = mg_routes_match(&hm, &params);
+    checked++;
+
+    if (actual != expected) {
+        printf("MISMATCH %s %s: trie %d (%s), mg_match %d (%s)\n", method, uri,
+               actual, actual >= 0 ? test_routes[actual].uri : "none",
+               expected, expected >= 0 ? test_routes[expected].uri : "none");
+        failures++;
+        return;
+    }
+
+    // Handlers read the parameters, so they must be what mg_match captured
+    for (int i = 0; actual >= 0 && i <= params.count; i++) {
+        bool same = i < params.count
+            ? caps[i].buf == params.values[i].buf && caps[i].len == params.values[i].len
+            : caps[i].buf == NULL;
+        if (!same) {
+            printf("MISMATCH %s %s: parameter %d differs from mg_match\n", method, uri, i);
+            failures++;
+            break;
+        }
+    }
+}
+
+// Check a URI with every method
+static void check_uri(const char *uri) {
+    for (size_t m = 0; m < sizeof(test_methods) / sizeof(test_methods[0]); m++) {
+        check_request(test_methods[m], uri);
+    }
+}
+
+// Build URIs from a pattern by filling in its "#" and check them
+static void check_pattern(const char *pattern) {
+    size_t values = sizeof(test_values) / sizeof(test_values[0]);
+
+    for (size_t v = 0; v < values; v++) {
+        for (size_t s = 0; s < sizeof(test_suffixes) / sizeof(test_suffixes[0]); s++) {
+            char uri[256];
+            size_t len = 0;
+            int param = 0;
+
+            for (const char *p = pattern; *p && len < sizeof(uri) - 1; p++) {
+                if (*p == '#') {
+                    // Vary the value per parameter so patterns with two see different ones
+                    const char *value = test_values[(v + (size_t)param++) % values];
+                    len += (size_t)snprintf(uri + len, sizeof(uri) - len, "%s", value);
+                } else {
+                    uri[len++] = *p;
+                }
+            }
+            if (len >= sizeof(uri)) {
+                len = sizeof(uri) - 1;
+            }
+            uri[len] = '\0';
+            snprintf(uri + len, sizeof(uri) - len, "%s", test_suffixes[s]);
+
+            check_uri(uri);
+        }
+    }
+}
+
+// Check that parameters are captured from the request URI
+static void check_params(void) {
+    struct mg_http_message hm;
+    mg_route_params_t params;
+    memset(&hm, 0, sizeof(hm));
+    hm.method = mg_str("GET");
+    hm.uri = mg_str("/api/streaming/cam1/hls/segment_42.ts");
+
+    int index = mg_routes_match(&hm, &params);
+    if (index < 0 || strcmp(test_routes[index].uri, "/api/streaming/#/hls/segment_#.ts") != 0 ||
+        params.count != 2 ||
+        params.values[0].len != 4 || strncmp(params.values[0].buf, "cam1", 4) != 0 ||
+        params.values[1].len != 2 || strncmp(params.values[1].buf, "42", 2) != 0) {
+        printf("Parameters of %.*s not captured\n", (int)hm.uri.len, hm.uri.buf);
+        failures++;
+    }
+
+    char buf[16];
+    if (mg_route_get_param(&hm, 1, buf, sizeof(buf)) != 2 || strcmp(buf, "42") != 0) {
+        printf("mg_route_get_param did not return the segment number\n");
+        failures++;
+    }
+}
+
+int main(void) {
+    init_logger();
+    set_log_level(LOG_LEVEL_ERROR);
+
+    printf("=== Route Trie Test ===\n");
+
+    if (mg_routes_init(test_routes) != 0) {
+        printf("Test failed: Could not build the route trie\n");
+        return 1;
+    }
+
+    for (int i = 0; test_routes[i].method != NULL; i++) {
+        // A literal "#" never reaches the server, it starts the URL fragment
+        if (!strchr(test_routes[i].uri, '#')) {
+            check_uri(test_routes[i].uri);
+        }
+        check_pattern(test_routes[i].uri);
+    }
+
+    for (size_t i = 0; i < sizeof(extra_uris) / sizeof(extra_uris[0]); i++) {
+        check_uri(extra_uris[i]);
+    }
+
+    check_params();
+
+    mg_routes_free();
+
+    if (failures > 0) {
+        printf("Test failed: %d of %d requests routed differently\n", failures, checked);
+        return 1;
+    }
+
+    printf("Checked %d requests\n", checked);
+    printf("\n=== All tests passed successfully ===\n");
+    return 0;
+}
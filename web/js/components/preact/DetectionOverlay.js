@@ -2,19 +2,91 @@
  * Detection overlay functionality for LiveView
  */
 
+// Live WebSocket subscriptions by stream name
+const liveSubscriptions = {};
+
+/**
+ * Subscribe to pushed detection results for a stream
+ * @param {string} streamName - Name of the stream
+ * @param {Function} drawDetectionBoxes - Draws a list of detections
+ * @returns {boolean} Whether results will be pushed over the WebSocket
+ */
+function startDetectionPush(streamName, drawDetectionBoxes) {
+  const wsClient = window.wsClient;
+  if (!wsClient || wsClient.usingHttpFallback) {
+    return false;
+  }
+
+  const topic = `detection/live/${streamName}`;
+  let lastSeq = 0;
+
+  // Every update carries a sequence number; replays after a reconnect can
+  // overlap with live updates, so anything already drawn is skipped
+  const onDetection = (payload) => {
+    if (!payload || typeof payload.seq !== 'number' || payload.seq <= lastSeq) {
+      return;
+    }
+    lastSeq = payload.seq;
+
+    // Resume from here if the connection drops
+    wsClient.subscriptionParams.set(topic, { since: lastSeq });
+
+    // Each detection is [label, confidence, x, y, width, height]
+    drawDetectionBoxes((payload.d || []).map(([label, confidence, x, y, width, height]) => ({
+      label, confidence, x, y, width, height
+    })));
+  };
+
+  // The server could not replay what was missed and sends the latest state instead
+  const onSubscribed = (payload) => {
+    if (payload && payload.reset) {
+      lastSeq = 0;
+    }
+  };
+
+  wsClient.on('subscribed', topic, onSubscribed);
+  wsClient.on('detection', topic, onDetection);
+
+  liveSubscriptions[streamName] = { topic, onDetection, onSubscribed };
+  return true;
+}
+
+/**
+ * Stop pushed detection results for a stream
+ * @param {string} streamName - Name of the stream
+ */
+function stopDetectionPush(streamName) {
+  const subscription = liveSubscriptions[streamName];
+  if (!subscription) {
+    return;
+  }
+
+  const wsClient = window.wsClient;
+  if (wsClient) {
+    wsClient.off('subscribed', subscription.topic, subscription.onSubscribed);
+    wsClient.off('detection', subscription.topic, subscription.onDetection);
+  }
+
+  delete liveSubscriptions[streamName];
+}
+
 /**
  * Start detection polling for a stream
+ *
+ * Results are pushed over the WebSocket when it is available, and polled
+ * from the API otherwise.
  * @param {string} streamName - Name of the stream
  * @param {HTMLCanvasElement} canvasOverlay - Canvas element for drawing detection boxes
  * @param {HTMLVideoElement} videoElement - Video element
  * @param {Object} detectionIntervals - Reference to store interval IDs
- * @returns {number} Interval ID
+ * @returns {number|null} Interval ID, or null when results are pushed
  */
 export function startDetectionPolling(streamName, canvasOverlay, videoElement, detectionIntervals) {
-  // Clear existing interval if any
+  // Clear existing interval or subscription if any
   if (detectionIntervals[streamName]) {
     clearInterval(detectionIntervals[streamName]);
   }
+  stopDetectionPush(streamName);
   
   // Function to draw bounding boxes
   const drawDetectionBoxes = (detections) => {
@@ -88,6 +160,10 @@ export function startDetectionPolling(streamName, canvasOverlay, videoElement, d
     });
   };
   
+  if (startDetectionPush(streamName, drawDetectionBoxes)) {
+    return null;
+  }
+  
   // Use a more conservative polling interval (1000ms instead of 500ms)
   // and implement exponential backoff on errors
   let errorCount = 0;
@@ -148,6 +224,8 @@ export function startDetectionPolling(streamName, canvasOverlay, videoElement, d
  * @param {Object} detectionIntervals - Reference to stored interval IDs
  */
 export function cleanupDetectionPolling(streamName, detectionIntervals) {
+  stopDetectionPush(streamName);
+  
   const canvasId = `canvas-${streamName.replace(/\s+/g, '-')}`;
   const canvasOverlay = document.getElementById(canvasId);
   
@@ -373,6 +373,27 @@ export function SystemView() {
       window.wsClient = new WebSocketClient();
     }
   }, []);
+  
+  // Keep system info current with updates pushed by the server's sampler
+  useEffect(() => {
+    const wsClient = window.wsClient;
+    if (!wsClient || typeof wsClient.on !== 'function') {
+      return;
+    }
+    
+    const handleStatus = (payload) => {
+      if (payload && typeof payload === 'object') {
+        setSystemInfo(payload);
+        setHasData(true);
+      }
+    };
+    
+    wsClient.on('status', 'system/status', handleStatus);
+    
+    return () => {
+      wsClient.off('status', 'system/status', handleStatus);
+    };
+  }, []);
 
   return html`
     <section id="system-page" class="page">
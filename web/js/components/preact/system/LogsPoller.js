@@ -20,17 +20,9 @@ import { fetchJSON } from '../../../fetch-utils.js';
 export function LogsPoller({ logLevel, logCount, onLogsReceived }) {
   const [isPolling, setIsPolling] = useState(false);
   const pollingIntervalRef = useRef(null);
-  // Initialize with null, but will persist between renders
-  const lastTimestampRef = useRef(null);
-  
-  // Try to load the last timestamp from localStorage on initial render
-  useEffect(() => {
-    const savedTimestamp = localStorage.getItem('lastLogTimestamp');
-    if (savedTimestamp) {
-      console.log('Loaded last log timestamp from localStorage:', savedTimestamp);
-      lastTimestampRef.current = savedTimestamp;
-    }
-  }, []);
+  // Sequence number of the last log entry received, persists between renders.
+  // Not kept across page loads: sequence numbers restart with the server.
+  const lastSeqRef = useRef(0);
   
   // Function to fetch logs via WebSocket
   const fetchLogs = () => {
@@ -53,9 +45,9 @@ export function LogsPoller({ logLevel, logCount, onLogsReceived }) {
       count: logCount
     };
     
-    // Add last timestamp if available for pagination
-    if (lastTimestampRef.current) {
-      payload.last_timestamp = lastTimestampRef.current;
+    // Only ask for entries after the last one received
+    if (lastSeqRef.current) {
+      payload.since = lastSeqRef.current;
     }
     
     // Add client ID to the payload
@@ -122,12 +114,13 @@ export function LogsPoller({ logLevel, logCount, onLogsReceived }) {
         // Don't filter logs here - let the parent component handle filtering
         // This ensures we're always using the most current logLevel value
         
-        // Update last timestamp for pagination if available
-        if (payload.latest_timestamp) {
-          lastTimestampRef.current = payload.latest_timestamp;
-          // Save to localStorage for persistence between page refreshes
-          localStorage.setItem('lastLogTimestamp', payload.latest_timestamp);
-          console.log('Updated and saved last log timestamp:', payload.latest_timestamp);
+        // Resume from here on the next fetch
+        if (typeof payload.latest_seq === 'number') {
+          lastSeqRef.current = payload.latest_seq;
+          // Keep subscription params current so a reconnect resumes here too
+          if (window.wsClient.subscriptionParams && window.wsClient.subscriptionParams.has('system/logs')) {
+            window.wsClient.subscriptionParams.set('system/logs', { level: 'debug', since: payload.latest_seq });
+          }
         }
         
         // Call the callback with all logs - parent will filter
@@ -226,13 +219,13 @@ export function LogsPoller({ logLevel, logCount, onLogsReceived }) {
       // Subscribe to system logs topic
       if (window.wsClient && typeof window.wsClient.subscribe === 'function') {
         console.log('Subscribing to system/logs via WebSocket for polling');
-        // Include the last timestamp in the subscription if available
+        // Include the last sequence number in the subscription if available
         const subscriptionParams = { 
           level: 'debug',
-          ...(lastTimestampRef.current ? { since: lastTimestampRef.current } : {})
+          ...(lastSeqRef.current ? { since: lastSeqRef.current } : {})
         };
         window.wsClient.subscribe('system/logs', subscriptionParams);
-        console.log(`Subscribed to system/logs with level: debug and last_timestamp: ${lastTimestampRef.current || 'NULL'}`);
+        console.log(`Subscribed to system/logs with level: debug and since: ${lastSeqRef.current || 'none'}`);
       }
       
       // Fetch logs immediately
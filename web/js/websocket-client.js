@@ -492,7 +492,7 @@ class WebSocketClient {
         this.handlers[key].push(handler);
         
         // Subscribe to topic if not already subscribed
-        if (type !== 'welcome' && type !== 'ack' && type !== 'error') {
+        if (type !== 'welcome' && type !== 'ack' && type !== 'subscribed' && type !== 'error') {
             this.subscribe(topic);
         }
     }
@@ -518,7 +518,7 @@ class WebSocketClient {
         }
         
         // Unsubscribe from topic if no more handlers
-        if (this.handlers[key].length === 0 && type !== 'welcome' && type !== 'ack' && type !== 'error') {
+        if (this.handlers[key].length === 0 && type !== 'welcome' && type !== 'ack' && type !== 'subscribed' && type !== 'error') {
             this.unsubscribe(topic);
         }
     }